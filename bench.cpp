@@ -0,0 +1,669 @@
+/*
+ * ZeroTier One - Network Virtualization Everywhere
+ * Copyright (C) 2011-2016  ZeroTier, Inc.  https://www.zerotier.com/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmarks for the hot paths of the core
+ *
+ * Each benchmark is run in batches sized to take about a millisecond, for
+ * a fixed amount of time, and the time per operation in each batch is
+ * collected to report min, median, 90th and 99th percentile. Cycle counts
+ * are derived from the CPU timestamp counter where there is one. With
+ * -j the results are written to stdout as JSON for tracking regressions
+ * between releases.
+ *
+ * Usage: zerotier-bench [-j] [-t<milliseconds per benchmark>] [<name substring> ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "node/Constants.hpp"
+#include "node/RuntimeEnvironment.hpp"
+#include "node/Node.hpp"
+#include "node/CPU.hpp"
+#include "node/Utils.hpp"
+#include "node/Identity.hpp"
+#include "node/Packet.hpp"
+#include "node/Salsa20.hpp"
+#include "node/Poly1305.hpp"
+#include "node/SHA512.hpp"
+#include "node/C25519.hpp"
+#include "node/AES.hpp"
+#include "node/Hashtable.hpp"
+#include "node/Dictionary.hpp"
+#include "node/NetworkConfig.hpp"
+#include "node/Network.hpp"
+#include "node/Peer.hpp"
+#include "node/Path.hpp"
+#include "node/Topology.hpp"
+#include "node/Switch.hpp"
+#include "node/Multicaster.hpp"
+#include "node/SelfAwareness.hpp"
+#include "node/SignatureCache.hpp"
+#include "node/MulticastGroup.hpp"
+#include "node/MAC.hpp"
+#include "node/InetAddress.hpp"
+
+#include "osdep/OSUtils.hpp"
+
+#include "version.h"
+
+#include "ext/json/json.hpp"
+
+#ifdef __WINDOWS__
+#include <tchar.h>
+#endif
+
+using namespace ZeroTier;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// Timing
+
+static inline uint64_t _ns()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// CPU timestamp counter, or 0 where there isn't one
+static inline uint64_t _ticks()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	return (uint64_t)__builtin_ia32_rdtsc();
+#else
+	return 0;
+#endif
+}
+
+// Timestamp counter ticks per nanosecond, 0 if unknown
+static double _calibrateTicks()
+{
+	const uint64_t t0 = _ticks(),n0 = _ns();
+	while ((_ns() - n0) < 50000000ULL) {}
+	const uint64_t t1 = _ticks(),n1 = _ns();
+	return (t1 > t0) ? ((double)(t1 - t0) / (double)(n1 - n0)) : 0.0;
+}
+
+// Keeps results of benchmarked code alive
+static volatile uint64_t _sink = 0;
+
+struct BenchResult
+{
+	std::string name;
+	unsigned long bytes; // bytes processed per operation, 0 if not meaningful
+	uint64_t ops;
+	double nsMin,nsMedian,nsP90,nsP99,nsMean;
+};
+
+class Bench
+{
+public:
+	Bench(const std::vector<std::string> &filters,unsigned int msPerBench,bool json) :
+		_filters(filters),
+		_msPerBench(msPerBench),
+		_json(json),
+		_ticksPerNs(_calibrateTicks())
+	{
+	}
+
+	inline bool selected(const char *name) const
+	{
+		if (_filters.empty())
+			return true;
+		for(std::vector<std::string>::const_iterator f(_filters.begin());f!=_filters.end();++f) {
+			if (strstr(name,f->c_str()))
+				return true;
+		}
+		return false;
+	}
+
+	/**
+	 * Run a benchmark if selected
+	 *
+	 * @param name Benchmark name
+	 * @param bytes Bytes processed by one call to op, or 0
+	 * @param op Operation to time
+	 */
+	void run(const char *name,unsigned long bytes,const std::function<void()> &op)
+	{
+		if (!selected(name))
+			return;
+
+		// Size batches to take about a millisecond
+		unsigned long batch = 1;
+		for(;;) {
+			const uint64_t s = _ns();
+			for(unsigned long i=0;i<batch;++i)
+				op();
+			const uint64_t e = _ns() - s;
+			if ((e >= 1000000ULL)||(batch >= (1UL << 30)))
+				break;
+			batch = (e < 10000ULL) ? (batch * 16) : std::max(batch + 1,(unsigned long)(((double)batch * 1000000.0) / (double)e));
+		}
+
+		std::vector<double> samples;
+		const uint64_t end = _ns() + ((uint64_t)_msPerBench * 1000000ULL);
+		uint64_t ops = 0;
+		double total = 0.0;
+		do {
+			const uint64_t s = _ns();
+			for(unsigned long i=0;i<batch;++i)
+				op();
+			const double t = (double)(_ns() - s);
+			samples.push_back(t / (double)batch);
+			total += t;
+			ops += batch;
+		} while ((_ns() < end)||(samples.size() < 11));
+		std::sort(samples.begin(),samples.end());
+
+		BenchResult r;
+		r.name = name;
+		r.bytes = bytes;
+		r.ops = ops;
+		r.nsMin = samples.front();
+		r.nsMedian = samples[samples.size() / 2];
+		r.nsP90 = samples[(samples.size() * 90) / 100];
+		r.nsP99 = samples[(samples.size() * 99) / 100];
+		r.nsMean = total / (double)ops;
+		_results.push_back(r);
+
+		if (!_json) {
+			printf("%-40s %12.1f ns/op  p90 %12.1f  p99 %12.1f",name,r.nsMedian,r.nsP90,r.nsP99);
+			if (_ticksPerNs > 0.0) {
+				if (bytes)
+					printf("  %8.2f cycles/byte",(r.nsMedian * _ticksPerNs) / (double)bytes);
+				else printf("  %10.0f cycles/op",r.nsMedian * _ticksPerNs);
+			}
+			if (bytes)
+				printf("  %9.1f MiB/s",((double)bytes / 1048576.0) / (r.nsMedian / 1e9));
+			printf(ZT_EOL_S);
+			fflush(stdout);
+		}
+	}
+
+	void note(const char *what)
+	{
+		if (!_json) {
+			printf("# %s" ZT_EOL_S,what);
+			fflush(stdout);
+		}
+	}
+
+	nlohmann::json toJson() const
+	{
+		nlohmann::json j;
+		char ver[32];
+		Utils::snprintf(ver,sizeof(ver),"%d.%d.%d",ZEROTIER_ONE_VERSION_MAJOR,ZEROTIER_ONE_VERSION_MINOR,ZEROTIER_ONE_VERSION_REVISION);
+		j["version"] = ver;
+		j["cpuFeatures"] = CPU::featureNames();
+		j["cryptoImplementations"] = _impls();
+		if (_ticksPerNs > 0.0)
+			j["ticksPerNs"] = _ticksPerNs;
+		else j["ticksPerNs"] = nlohmann::json();
+		j["msPerBenchmark"] = _msPerBench;
+		nlohmann::json &res = j["results"];
+		res = nlohmann::json::array();
+		for(std::vector<BenchResult>::const_iterator r(_results.begin());r!=_results.end();++r) {
+			nlohmann::json b;
+			b["name"] = r->name;
+			b["ops"] = r->ops;
+			b["bytesPerOp"] = r->bytes;
+			b["nsPerOp"]["min"] = r->nsMin;
+			b["nsPerOp"]["median"] = r->nsMedian;
+			b["nsPerOp"]["p90"] = r->nsP90;
+			b["nsPerOp"]["p99"] = r->nsP99;
+			b["nsPerOp"]["mean"] = r->nsMean;
+			if (_ticksPerNs > 0.0) {
+				b["cyclesPerOp"] = r->nsMedian * _ticksPerNs;
+				if (r->bytes)
+					b["cyclesPerByte"] = (r->nsMedian * _ticksPerNs) / (double)r->bytes;
+				else b["cyclesPerByte"] = nlohmann::json();
+			} else {
+				b["cyclesPerOp"] = nlohmann::json();
+				b["cyclesPerByte"] = nlohmann::json();
+			}
+			if (r->bytes)
+				b["mibPerSecond"] = ((double)r->bytes / 1048576.0) / (r->nsMedian / 1e9);
+			res.push_back(b);
+		}
+		return j;
+	}
+
+	static std::string _impls()
+	{
+		std::string s("salsa20=");
+		s.append(Salsa20::implementation());
+		s.append(" poly1305=");
+		s.append(Poly1305::implementation());
+		s.append(" aes=");
+		s.append(AES::implementationName(AES::best()));
+		return s;
+	}
+
+private:
+	std::vector<std::string> _filters;
+	unsigned int _msPerBench;
+	bool _json;
+	double _ticksPerNs;
+	std::vector<BenchResult> _results;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// Host callbacks for a Node that goes nowhere
+
+static long _dataStoreGet(ZT_Node *,void *,const char *,void *,unsigned long,unsigned long,unsigned long *) { return -1; }
+static int _dataStorePut(ZT_Node *,void *,const char *,const void *,unsigned long,int) { return 0; }
+static int _wirePacketSend(ZT_Node *,void *,const struct sockaddr_storage *,const struct sockaddr_storage *,const void *data,unsigned int len,unsigned int) { _sink += len; return 0; }
+static void _virtualNetworkFrame(ZT_Node *,void *,uint64_t,void **,uint64_t,uint64_t,unsigned int,unsigned int,const void *,unsigned int) {}
+static int _virtualNetworkConfig(ZT_Node *,void *,uint64_t,void **,enum ZT_VirtualNetworkConfigOperation,const ZT_VirtualNetworkConfig *) { return 0; }
+static void _event(ZT_Node *,void *,enum ZT_Event,const void *) {}
+
+// Identity with the same public key as base but a different address (good enough for peers that are never verified)
+static Identity _fakeIdentity(const Identity &base,uint64_t address)
+{
+	char a[16];
+	Utils::snprintf(a,sizeof(a),"%.10llx",(unsigned long long)address);
+	std::string s(base.toString(false));
+	s.replace(0,10,a);
+	return Identity(s);
+}
+
+static void _rule(ZT_VirtualNetworkRule *rules,unsigned int &n,uint8_t t)
+{
+	memset(&(rules[n]),0,sizeof(ZT_VirtualNetworkRule));
+	rules[n++].t = t;
+}
+
+// Drop anything that isn't IPv4, ARP, or IPv6 (the default rule set most networks start with)
+static void _ethertypeRules(ZT_VirtualNetworkRule *rules,unsigned int &n)
+{
+	_rule(rules,n,0x80 | ZT_NETWORK_RULE_MATCH_ETHERTYPE); rules[n-1].v.etherType = 0x0800;
+	_rule(rules,n,0x80 | ZT_NETWORK_RULE_MATCH_ETHERTYPE); rules[n-1].v.etherType = 0x0806;
+	_rule(rules,n,0x80 | ZT_NETWORK_RULE_MATCH_ETHERTYPE); rules[n-1].v.etherType = 0x86dd;
+	_rule(rules,n,ZT_NETWORK_RULE_ACTION_DROP);
+}
+
+static void _portRule(ZT_VirtualNetworkRule *rules,unsigned int &n,uint8_t proto,uint16_t port,uint8_t action)
+{
+	_rule(rules,n,ZT_NETWORK_RULE_MATCH_IP_PROTOCOL); rules[n-1].v.ipProtocol = proto;
+	_rule(rules,n,ZT_NETWORK_RULE_MATCH_IP_DEST_PORT_RANGE); rules[n-1].v.port[0] = port; rules[n-1].v.port[1] = port;
+	_rule(rules,n,action);
+}
+
+} // anonymous namespace
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef __WINDOWS__
+int _tmain(int argc, _TCHAR* argv[])
+#else
+int main(int argc,char **argv)
+#endif
+{
+	bool json = false;
+	unsigned int msPerBench = 500;
+	std::vector<std::string> filters;
+	for(int i=1;i<argc;++i) {
+		if (!strcmp(argv[i],"-j")) {
+			json = true;
+		} else if ((argv[i][0] == '-')&&(argv[i][1] == 't')) {
+			msPerBench = std::max(Utils::strToUInt(argv[i] + 2),1U);
+		} else if (argv[i][0] == '-') {
+			fprintf(stderr,"Usage: %s [-j] [-t<milliseconds per benchmark>] [<name substring> ...]" ZT_EOL_S,argv[0]);
+			return 1;
+		} else filters.push_back(std::string(argv[i]));
+	}
+
+#ifdef __WINDOWS__
+	WSADATA wsaData;
+	WSAStartup(MAKEWORD(2,2),&wsaData);
+#endif
+
+	Bench b(filters,msPerBench,json);
+	if (!json) {
+		printf("# zerotier-bench %d.%d.%d, cpu: %s" ZT_EOL_S,ZEROTIER_ONE_VERSION_MAJOR,ZEROTIER_ONE_VERSION_MINOR,ZEROTIER_ONE_VERSION_REVISION,CPU::featureNames());
+		printf("# %s" ZT_EOL_S,Bench::_impls().c_str());
+	}
+
+	uint8_t key[64],data[16384];
+	Utils::getSecureRandom(key,sizeof(key));
+	Utils::getSecureRandom(data,sizeof(data));
+
+	// Crypto primitives ------------------------------------------------------
+
+	{
+		Salsa20 s20(key,256,key + 32);
+		b.run("salsa20-12.1400",1400,[&]() { s20.crypt12(data,data,1400); });
+		b.run("salsa20-12.16384",16384,[&]() { s20.crypt12(data,data,16384); });
+	}
+	{
+		uint8_t mac[16];
+		b.run("poly1305.1400",1400,[&]() { Poly1305::compute(mac,data,1400,key); _sink += mac[0]; });
+	}
+	{
+		uint8_t h[64];
+		b.run("sha512.64",64,[&]() { SHA512::hash(h,data,64); _sink += h[0]; });
+		b.run("sha512.1400",1400,[&]() { SHA512::hash(h,data,1400); _sink += h[0]; });
+	}
+	{
+		AES aes(key);
+		uint8_t tag[ZT_AES_GCM_TAG_LEN];
+		b.run("aes256-gcm.encrypt.1400",1400,[&]() { aes.gcmEncrypt(key,key,16,data,data,1400,tag); _sink += tag[0]; });
+	}
+	if (b.selected("c25519")) {
+		const C25519::Pair kp1(C25519::generate()),kp2(C25519::generate());
+		uint8_t k[64];
+		b.run("c25519.agree",0,[&]() { C25519::agree(kp1,kp2.pub,k,64); _sink += k[0]; });
+		C25519::Signature sig;
+		b.run("c25519.sign",0,[&]() { sig = C25519::sign(kp1,data,256); _sink += sig.data[0]; });
+		b.run("c25519.verify",0,[&]() { _sink += (uint64_t)C25519::verify(kp1.pub,data,256,sig); });
+	}
+
+	// Packets ----------------------------------------------------------------
+
+	{
+		Packet tmpl(Address(0x0102030405ULL),Address(0x0504030201ULL),Packet::VERB_FRAME);
+		tmpl.setSize(1400);
+		const unsigned int payloadLen = tmpl.size() - ZT_PACKET_IDX_VERB;
+		Packet p(tmpl);
+		unsigned int ctr = 0;
+
+		b.run("packet.armor.salsa20-poly1305.1400",payloadLen,[&]() { p.armor(key,true,ctr++,false); });
+		p = tmpl;
+		p.armor(key,true,0,false);
+		Packet armored(p);
+		b.run("packet.dearmor.salsa20-poly1305.1400",payloadLen,[&]() { p = armored; _sink += (uint64_t)p.dearmor(key); });
+
+		p = tmpl;
+		b.run("packet.armor.aes256-gcm.1400",payloadLen,[&]() { p.armor(key,true,ctr++,true); });
+		p = tmpl;
+		p.armor(key,true,0,true);
+		armored = p;
+		b.run("packet.dearmor.aes256-gcm.1400",payloadLen,[&]() { p = armored; _sink += (uint64_t)p.dearmor(key); });
+	}
+	{
+		// A compressible frame: an HTTP response with a text body
+		Packet tmpl(Address(0x0102030405ULL),Address(0x0504030201ULL),Packet::VERB_FRAME);
+		tmpl.append((uint64_t)0x8056c2e21c000001ULL);
+		tmpl.append((uint16_t)0x0800);
+		const char *const text = "HTTP/1.1 200 OK\r\nContent-Type: text/html; charset=utf-8\r\nCache-Control: no-cache\r\n\r\n<html><body><table><tr><td>zerotier</td><td>network</td></tr>";
+		while ((tmpl.size() + strlen(text)) < 1400)
+			tmpl.append(text,(unsigned int)strlen(text));
+		const unsigned int frameLen = tmpl.size() - ZT_PACKET_IDX_PAYLOAD;
+		Packet p(tmpl);
+		b.run("packet.compress.1400",frameLen,[&]() { p = tmpl; _sink += (uint64_t)p.compress(); });
+		p = tmpl;
+		p.compress();
+		const Packet compressed(p);
+		b.run("packet.uncompress.1400",frameLen,[&]() { p = compressed; _sink += (uint64_t)p.uncompress(); });
+	}
+
+	// Data structures --------------------------------------------------------
+
+	{
+		std::vector<uint64_t> keys(65536);
+		Utils::getSecureRandom(&(keys[0]),(unsigned int)(keys.size() * sizeof(uint64_t)));
+		Hashtable<uint64_t,uint64_t> ht;
+		unsigned long i = 0;
+		b.run("hashtable.set.64k",0,[&]() { ht.set(keys[i++ & 0xffff],i); });
+		for(std::vector<uint64_t>::const_iterator k(keys.begin());k!=keys.end();++k)
+			ht.set(*k,*k);
+		b.run("hashtable.get.64k",0,[&]() { _sink += *(ht.get(keys[i++ & 0xffff])); });
+		b.run("hashtable.get.miss",0,[&]() { _sink += (uint64_t)(ht.get(i++) != (uint64_t *)0); });
+	}
+
+	// Node subsystems --------------------------------------------------------
+
+	const bool needNode = (b.selected("dictionary")||b.selected("networkconfig")||b.selected("filter")||b.selected("topology")||b.selected("multicast")||b.selected("switch"));
+	if (needNode) {
+		b.note("starting node (identity generation and key agreement with roots)...");
+
+		ZT_Node_Callbacks cb;
+		memset(&cb,0,sizeof(cb));
+		cb.version = 0;
+		cb.dataStoreGetFunction = _dataStoreGet;
+		cb.dataStorePutFunction = _dataStorePut;
+		cb.wirePacketSendFunction = _wirePacketSend;
+		cb.virtualNetworkFrameFunction = _virtualNetworkFrame;
+		cb.virtualNetworkConfigFunction = _virtualNetworkConfig;
+		cb.eventCallback = _event;
+		const uint64_t now = OSUtils::now();
+		Node *const node = new Node((void *)0,&cb,now);
+		ZT_NodeStatus ns;
+		node->status(&ns);
+
+		// Our own set of subsystems, driven directly instead of through packets
+		RuntimeEnvironment *const RR = new RuntimeEnvironment(node);
+		RR->identity.fromString(ns.secretIdentity);
+		RR->publicIdentityStr = RR->identity.toString(false);
+		RR->secretIdentityStr = RR->identity.toString(true);
+		RR->sigCache = new SignatureCache();
+		RR->sw = new Switch(RR);
+		RR->mc = new Multicaster(RR);
+		RR->topology = new Topology(RR);
+		RR->sa = new SelfAwareness(RR);
+
+		// Peers with made-up keys and a direct path each
+		std::vector<Address> peers;
+		for(unsigned int i=0;i<1024;++i) {
+			const Identity id(_fakeIdentity(RR->identity,0x1100000000ULL + i));
+			uint8_t pk[ZT_PEER_SECRET_KEY_LENGTH];
+			Utils::getSecureRandom(pk,sizeof(pk));
+			SharedPtr<Peer> peer(RR->topology->addPeer(SharedPtr<Peer>(new Peer(RR,RR->identity,id,pk))));
+			char ip[64];
+			Utils::snprintf(ip,sizeof(ip),"10.%u.%u.%u/9993",(i >> 16) & 0xff,(i >> 8) & 0xff,(i & 0xff) + 1);
+			peer->received(RR->topology->getPath(InetAddress(),InetAddress(ip)),0,0,Packet::VERB_OK,0,Packet::VERB_HELLO,false);
+			peers.push_back(id.address());
+		}
+
+		const uint64_t nwid = (RR->identity.address().toInt() << 24) | 0x123456ULL;
+
+		// A network config with a bit of everything in it
+		NetworkConfig *const nc = new NetworkConfig();
+		nc->networkId = nwid;
+		nc->timestamp = now;
+		nc->credentialTimeMaxDelta = ZT_NETWORKCONFIG_DEFAULT_CREDENTIAL_TIME_MAX_MAX_DELTA;
+		nc->revision = 1;
+		nc->issuedTo = RR->identity.address();
+		nc->flags = ZT_NETWORKCONFIG_FLAG_ENABLE_BROADCAST;
+		nc->multicastLimit = 32;
+		nc->type = ZT_NETWORK_TYPE_PRIVATE;
+		strcpy(nc->name,"bench");
+		nc->staticIps[nc->staticIpCount++] = InetAddress("10.147.17.1/24");
+		nc->staticIps[nc->staticIpCount++] = InetAddress("fd00:1234:5678::1/88");
+		{
+			InetAddress t("10.147.17.0/24");
+			memcpy(&(nc->routes[nc->routeCount++].target),&t,sizeof(struct sockaddr_storage));
+		}
+		_ethertypeRules(nc->rules,nc->ruleCount);
+		_portRule(nc->rules,nc->ruleCount,6,25,ZT_NETWORK_RULE_ACTION_DROP);
+		_rule(nc->rules,nc->ruleCount,ZT_NETWORK_RULE_MATCH_TAGS_DIFFERENCE); nc->rules[nc->ruleCount-1].v.tag.id = 1000; nc->rules[nc->ruleCount-1].v.tag.value = 0;
+		_rule(nc->rules,nc->ruleCount,ZT_NETWORK_RULE_ACTION_ACCEPT);
+		{
+			ZT_VirtualNetworkRule cr[8];
+			unsigned int crc = 0;
+			_portRule(cr,crc,6,443,ZT_NETWORK_RULE_ACTION_ACCEPT);
+			nc->capabilities[nc->capabilityCount] = Capability(1,nwid,now,1,cr,crc);
+			nc->capabilities[nc->capabilityCount++].sign(RR->identity,RR->identity.address());
+		}
+		nc->tags[nc->tagCount] = Tag(nwid,now,RR->identity.address(),1000,42);
+		nc->tags[nc->tagCount++].sign(RR->identity);
+		nc->com = CertificateOfMembership(now,ZT_NETWORKCONFIG_DEFAULT_CREDENTIAL_TIME_MAX_MAX_DELTA,nwid,RR->identity.address());
+		nc->com.sign(RR->identity);
+
+		Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *const dict = new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>();
+		nc->toDictionary(*dict,false);
+		const std::string dictStr(dict->data(),dict->sizeBytes());
+
+		{
+			Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *const d = new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>();
+			char tmp[1024];
+			b.run("dictionary.load+get",(unsigned long)dictStr.length(),[&]() {
+				d->load(dictStr.c_str());
+				_sink += (uint64_t)d->get(ZT_NETWORKCONFIG_DICT_KEY_NETWORK_ID,tmp,sizeof(tmp));
+				_sink += (uint64_t)d->get(ZT_NETWORKCONFIG_DICT_KEY_NAME,tmp,sizeof(tmp));
+				_sink += (uint64_t)d->get(ZT_NETWORKCONFIG_DICT_KEY_COM,tmp,sizeof(tmp));
+				_sink += (uint64_t)d->get("nonexistent",tmp,sizeof(tmp));
+			});
+			delete d;
+		}
+		{
+			NetworkConfig *const nc2 = new NetworkConfig();
+			b.run("networkconfig.fromDictionary",(unsigned long)dictStr.length(),[&]() { _sink += (uint64_t)nc2->fromDictionary(*dict); });
+			Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *const d = new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>();
+			b.run("networkconfig.toDictionary",(unsigned long)dictStr.length(),[&]() { d->clear(); _sink += (uint64_t)nc->toDictionary(*d,false); });
+			delete d;
+			delete nc2;
+		}
+
+		if (b.selected("filter")) {
+			// IPv4 TCP segment from 10.147.17.1:40000 to 10.147.17.2:443
+			uint8_t ip[60];
+			memset(ip,0,sizeof(ip));
+			ip[0] = 0x45; ip[2] = 0; ip[3] = sizeof(ip); ip[8] = 64; ip[9] = 6;
+			ip[12] = 10; ip[13] = 147; ip[14] = 17; ip[15] = 1;
+			ip[16] = 10; ip[17] = 147; ip[18] = 17; ip[19] = 2;
+			ip[20] = 0x9c; ip[21] = 0x40; ip[22] = 0x01; ip[23] = 0xbb;
+			ip[32] = 0x50;
+
+			const Address dest(peers[0]);
+			SharedPtr<Network> nw(new Network(RR,nwid,(void *)0));
+			const MAC from(nw->mac()),to(dest,nwid);
+
+			NetworkConfig *const fc = new NetworkConfig(*nc);
+			fc->ruleCount = 0;
+			fc->capabilityCount = 0;
+			_rule(fc->rules,fc->ruleCount,ZT_NETWORK_RULE_ACTION_ACCEPT);
+			nw->setConfiguration(*fc,false);
+			b.run("filter.accept-all",0,[&]() { _sink += (uint64_t)nw->filterOutgoingPacket(false,RR->identity.address(),dest,from,to,ip,sizeof(ip),0x0800,0); });
+
+			// Default ethertype rules, then a few port and tag rules before accepting
+			*fc = *nc;
+			fc->ruleCount = 0;
+			fc->capabilityCount = 0;
+			_ethertypeRules(fc->rules,fc->ruleCount);
+			_rule(fc->rules,fc->ruleCount,ZT_NETWORK_RULE_MATCH_IPV4_DEST); fc->rules[fc->ruleCount-1].v.ipv4.ip = Utils::hton((uint32_t)0x0a630000); fc->rules[fc->ruleCount-1].v.ipv4.mask = 16;
+			_rule(fc->rules,fc->ruleCount,ZT_NETWORK_RULE_ACTION_DROP);
+			_portRule(fc->rules,fc->ruleCount,6,22,ZT_NETWORK_RULE_ACTION_ACCEPT);
+			_portRule(fc->rules,fc->ruleCount,17,53,ZT_NETWORK_RULE_ACTION_ACCEPT);
+			_portRule(fc->rules,fc->ruleCount,6,25,ZT_NETWORK_RULE_ACTION_DROP);
+			_rule(fc->rules,fc->ruleCount,ZT_NETWORK_RULE_MATCH_TAGS_EQUAL); fc->rules[fc->ruleCount-1].v.tag.id = 1000; fc->rules[fc->ruleCount-1].v.tag.value = 7;
+			_rule(fc->rules,fc->ruleCount,ZT_NETWORK_RULE_ACTION_DROP);
+			_rule(fc->rules,fc->ruleCount,ZT_NETWORK_RULE_ACTION_ACCEPT);
+			fc->revision = 2;
+			nw->setConfiguration(*fc,false);
+			b.run("filter.typical",0,[&]() { _sink += (uint64_t)nw->filterOutgoingPacket(false,RR->identity.address(),dest,from,to,ip,sizeof(ip),0x0800,0); });
+
+			// Nothing accepted by the base rules, so the capability's rules decide
+			*fc = *nc;
+			fc->ruleCount = 0;
+			_ethertypeRules(fc->rules,fc->ruleCount);
+			fc->revision = 3;
+			nw->setConfiguration(*fc,false);
+			b.run("filter.capability",0,[&]() { _sink += (uint64_t)nw->filterOutgoingPacket(false,RR->identity.address(),dest,from,to,ip,sizeof(ip),0x0800,0); });
+
+			delete fc;
+		}
+
+		{
+			unsigned long i = 0;
+			b.run("topology.getPeer.1k",0,[&]() { _sink += (uint64_t)(RR->topology->getPeer(peers[i++ & 1023]).ptr() != (Peer *)0); });
+		}
+
+		if (b.selected("switch")) {
+			// Two-fragment NOPs from peers to us, each with its own path, fed through the switch as they'd come off the wire
+			struct Fragmented
+			{
+				InetAddress from;
+				Buffer<ZT_PROTO_MAX_PACKET_LENGTH> head;
+				Packet::Fragment tail;
+			};
+			std::vector<Fragmented> fp(64);
+			for(unsigned int i=0;i<(unsigned int)fp.size();++i) {
+				const SharedPtr<Peer> peer(RR->topology->getPeer(peers[i]));
+				Packet p(RR->identity.address(),peers[i],Packet::VERB_NOP);
+				p.append(data,2000);
+				p.setFragmented(true);
+				p.armor(peer->key(),true,0,false);
+				char ip[64];
+				Utils::snprintf(ip,sizeof(ip),"10.0.0.%u/9993",i + 1);
+				fp[i].from = InetAddress(ip);
+				fp[i].head.append(p.data(),ZT_UDP_DEFAULT_PAYLOAD_MTU);
+				fp[i].tail.init(p,ZT_UDP_DEFAULT_PAYLOAD_MTU,p.size() - ZT_UDP_DEFAULT_PAYLOAD_MTU,1,2);
+			}
+			const InetAddress local;
+			const unsigned long packetBytes = fp[0].head.size() + fp[0].tail.size();
+
+			b.run("switch.reassemble.in-order",packetBytes,[&]() {
+				RR->sw->onRemotePacket(local,fp[0].from,fp[0].head.data(),fp[0].head.size());
+				RR->sw->onRemotePacket(local,fp[0].from,fp[0].tail.data(),fp[0].tail.size());
+			});
+			b.run("switch.reassemble.reversed",packetBytes,[&]() {
+				RR->sw->onRemotePacket(local,fp[0].from,fp[0].tail.data(),fp[0].tail.size());
+				RR->sw->onRemotePacket(local,fp[0].from,fp[0].head.data(),fp[0].head.size());
+			});
+
+			// All heads first, then all tails, so 64 packets are in flight at once
+			b.run("switch.reassemble.interleaved-64",packetBytes * (unsigned long)fp.size(),[&]() {
+				for(std::vector<Fragmented>::const_iterator f(fp.begin());f!=fp.end();++f)
+					RR->sw->onRemotePacket(local,f->from,f->head.data(),f->head.size());
+				for(std::vector<Fragmented>::const_iterator f(fp.begin());f!=fp.end();++f)
+					RR->sw->onRemotePacket(local,f->from,f->tail.data(),f->tail.size());
+			});
+
+			ZT_NodeStatus rs;
+			RR->sw->rxQueueStatus(&rs);
+			char tmp[256];
+			Utils::snprintf(tmp,sizeof(tmp),"rx queue: %u of %u in use, %llu evictions, %llu source limit evictions, %llu expirations",rs.rxQueueInUse,rs.rxQueueSize,(unsigned long long)rs.rxQueueEvictions,(unsigned long long)rs.rxQueueSourceLimitEvictions,(unsigned long long)rs.rxQueueExpirations);
+			b.note(tmp);
+		}
+
+		if (b.selected("multicast")) {
+			const MulticastGroup mg(MAC(0xffffffffffffULL),0);
+			for(unsigned int i=0;i<64;++i)
+				RR->mc->add(now,nwid,mg,peers[i]);
+			const std::vector<Address> alwaysSendTo;
+			const MAC src(RR->identity.address(),nwid);
+			b.run("multicast.send.32-of-64.64",0,[&]() { RR->mc->send(32,now,nwid,false,alwaysSendTo,mg,src,0x0806,data,64); });
+		}
+
+		delete dict;
+		delete nc;
+		delete RR->sa;
+		delete RR->topology;
+		delete RR->mc;
+		delete RR->sw;
+		delete RR->sigCache;
+		delete RR;
+		delete node;
+	}
+
+	if (json)
+		printf("%s" ZT_EOL_S,b.toJson().dump(2).c_str());
+
+	return 0;
+}
@@ -480,6 +480,55 @@ typedef struct
 	 * True if some kind of connectivity appears available
 	 */
 	int online;
+
+	/**
+	 * Credential and world signature checks answered from the verified signature cache
+	 */
+	uint64_t signatureCacheHits;
+
+	/**
+	 * Credential and world signatures that were not cached and had to be verified
+	 */
+	uint64_t signatureCacheMisses;
+
+	/**
+	 * Space-separated names of CPU instruction set features crypto code can use, e.g. "sse2 ssse3 avx2 aes"
+	 *
+	 * This pointer will remain valid as long as the node exists.
+	 */
+	const char *cpuFeatures;
+
+	/**
+	 * Implementation chosen for each crypto primitive, e.g. "salsa20=sse2+avx2x8 poly1305=avx2 aes=aesni ..."
+	 *
+	 * This pointer will remain valid as long as the node exists.
+	 */
+	const char *cryptoImplementations;
+
+	/**
+	 * Entries in the RX queue, which holds packets being reassembled from fragments or waiting for WHOIS
+	 */
+	unsigned int rxQueueSize;
+
+	/**
+	 * RX queue entries currently in use
+	 */
+	unsigned int rxQueueInUse;
+
+	/**
+	 * Incomplete packets discarded from the RX queue because it was full
+	 */
+	uint64_t rxQueueEvictions;
+
+	/**
+	 * Incomplete packets discarded because their physical path held its maximum share of the RX queue
+	 */
+	uint64_t rxQueueSourceLimitEvictions;
+
+	/**
+	 * Incomplete packets discarded from the RX queue after waiting too long for fragments or WHOIS
+	 */
+	uint64_t rxQueueExpirations;
 } ZT_NodeStatus;
 
 /**
@@ -1375,6 +1424,31 @@ typedef struct {
 	ZT_ClusterMemberStatus members[ZT_CLUSTER_MAX_MEMBERS];
 } ZT_ClusterStatus;
 
+/**
+ * A packet received from the physical wire, for batched processing
+ */
+typedef struct {
+	/**
+	 * Local address, or point to ZT_SOCKADDR_NULL if unspecified
+	 */
+	const struct sockaddr_storage *localAddress;
+
+	/**
+	 * Origin of packet
+	 */
+	const struct sockaddr_storage *remoteAddress;
+
+	/**
+	 * Packet data
+	 */
+	const void *packetData;
+
+	/**
+	 * Packet length
+	 */
+	unsigned int packetLength;
+} ZT_WirePacket;
+
 /**
  * An instance of a ZeroTier One node (opaque)
  */
@@ -1588,6 +1662,26 @@ typedef int (*ZT_PathLookupFunction)(
 	int,                              /* Desired ss_family or -1 for any */
 	struct sockaddr_storage *);       /* Result buffer */
 
+/**
+ * Function to ask the host to run ZT_Node_processIdentityValidations()
+ *
+ * Parameters:
+ *  (1) Node
+ *  (2) User pointer
+ *
+ * If provided, HELLOs from peers we don't know yet are queued instead of
+ * being handled right away, and this is called once for each one queued.
+ * Validating a new identity and agreeing on a key with it takes several
+ * milliseconds of CPU, so the host should wake a worker thread that calls
+ * ZT_Node_processIdentityValidations() rather than doing so on a packet I/O
+ * thread. This is called with internal locks held, so it must never call
+ * back into the node itself. If not provided, new identities are validated
+ * while their HELLO is being processed.
+ */
+typedef void (*ZT_IdentityValidationRequestFunction)(
+	ZT_Node *,                        /* Node */
+	void *);                          /* User ptr */
+
 /****************************************************************************/
 /* C Node API                                                               */
 /****************************************************************************/
@@ -1598,7 +1692,7 @@ typedef int (*ZT_PathLookupFunction)(
 struct ZT_Node_Callbacks
 {
 	/**
-	 * Struct version -- must currently be 0
+	 * Struct version -- 0, or 1 to include identityValidationRequestFunction
 	 */
 	long version;
 
@@ -1641,6 +1735,11 @@ struct ZT_Node_Callbacks
 	 * OPTIONAL: Function to get hints to physical paths to ZeroTier addresses
 	 */
 	ZT_PathLookupFunction pathLookupFunction;
+
+	/**
+	 * OPTIONAL: Function to request asynchronous identity validation (version 1+)
+	 */
+	ZT_IdentityValidationRequestFunction identityValidationRequestFunction;
 };
 
 /**
@@ -1673,6 +1772,10 @@ void ZT_Node_delete(ZT_Node *node);
 /**
  * Process a packet received from the physical wire
  *
+ * This can be called concurrently from more than one thread, e.g. one per
+ * receive socket. Packets on the same path should arrive on the same thread
+ * to keep them in order.
+ *
  * @param node Node instance
  * @param now Current clock in milliseconds
  * @param localAddress Local address, or point to ZT_SOCKADDR_NULL if unspecified
@@ -1691,6 +1794,43 @@ enum ZT_ResultCode ZT_Node_processWirePacket(
 	unsigned int packetLength,
 	volatile uint64_t *nextBackgroundTaskDeadline);
 
+/**
+ * Process several packets received from the physical wire
+ *
+ * This is equivalent to calling ZT_Node_processWirePacket() for each packet
+ * in order, but amortizes per-call overhead and reuses path and peer lookups
+ * across runs of packets from the same origin. It's intended for use with
+ * batched receive APIs such as recvmmsg().
+ *
+ * @param node Node instance
+ * @param now Current clock in milliseconds
+ * @param packets Array of received packets
+ * @param packetCount Number of packets in array
+ * @param nextBackgroundTaskDeadline Value/result: set to deadline for next call to processBackgroundTasks()
+ * @return OK (0) or error code if a fatal error condition has occurred
+ */
+enum ZT_ResultCode ZT_Node_processWirePackets(
+	ZT_Node *node,
+	uint64_t now,
+	const ZT_WirePacket *packets,
+	unsigned int packetCount,
+	volatile uint64_t *nextBackgroundTaskDeadline);
+
+/**
+ * Validate the identities of new peers whose HELLOs have been queued
+ *
+ * This is only needed if identityValidationRequestFunction is set in the
+ * callbacks. It does the slow part of accepting a new peer and then
+ * finishes processing its HELLO. It can be called concurrently from any
+ * number of worker threads.
+ *
+ * @param node Node instance
+ * @param now Current clock in milliseconds
+ * @param max Maximum number of queued HELLOs to process
+ * @return Number of queued HELLOs processed (0 if none were waiting)
+ */
+unsigned int ZT_Node_processIdentityValidations(ZT_Node *node,uint64_t now,unsigned int max);
+
 /**
  * Process a frame from a virtual network port (tap)
  *
@@ -2110,6 +2250,20 @@ void ZT_Node_clusterStatus(ZT_Node *node,ZT_ClusterStatus *cs);
  */
 void ZT_Node_setTrustedPaths(ZT_Node *node,const struct sockaddr_storage *networks,const uint64_t *ids,unsigned int count);
 
+/**
+ * Set the size of the RX queue
+ *
+ * The RX queue holds packets being reassembled from fragments and packets
+ * waiting for WHOIS replies. The default is enough for most nodes, but relays
+ * and other nodes receiving fragmented packets from many peers at once may
+ * need more. Each entry takes about 23kb. Packets in the queue when this is
+ * called are discarded.
+ *
+ * @param node Node instance
+ * @param size Number of entries (clamped to 4..4096)
+ */
+void ZT_Node_setRxQueueSize(ZT_Node *node,unsigned int size);
+
 /**
  * Get ZeroTier One version
  *
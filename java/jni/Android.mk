@@ -10,10 +10,12 @@ LOCAL_LDLIBS := -llog -latomic
 
 # ZeroTierOne SDK source files
 LOCAL_SRC_FILES := \
+	$(ZT1)/node/AES.cpp \
 	$(ZT1)/node/C25519.cpp \
 	$(ZT1)/node/Capability.cpp \
 	$(ZT1)/node/CertificateOfMembership.cpp \
 	$(ZT1)/node/CertificateOfOwnership.cpp \
+	$(ZT1)/node/CPU.cpp \
 	$(ZT1)/node/Identity.cpp \
 	$(ZT1)/node/IncomingPacket.cpp \
 	$(ZT1)/node/InetAddress.cpp \
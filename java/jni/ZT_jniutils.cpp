@@ -20,6 +20,7 @@
 #include "ZT_jnilookup.h"
 #include <string>
 #include <assert.h>
+#include <string.h>
 
 extern JniLookup lookup;
 
@@ -391,6 +392,76 @@ jobject newInetSocketAddress(JNIEnv *env, const sockaddr_storage &addr)
     return inetSocketAddressObject;
 }
 
+bool inetSocketAddressToSockaddr(JNIEnv *env, jobject in_addr, sockaddr_storage &addr)
+{
+    addr = ZT_SOCKADDR_NULL;
+    if(in_addr == NULL)
+    {
+        return true;
+    }
+
+    jclass inetAddressClass = lookup.findClass("java/net/InetAddress");
+    jclass inetSocketAddressClass = lookup.findClass("java/net/InetSocketAddress");
+    if(env->ExceptionCheck() || inetAddressClass == NULL || inetSocketAddressClass == NULL)
+    {
+        LOGE("Error finding InetAddress or InetSocketAddress class");
+        return false;
+    }
+
+    jmethodID inetAddress_getAddress = lookup.findMethod(
+        inetAddressClass, "getAddress", "()[B");
+    jmethodID inetSocketAddress_getAddress = lookup.findMethod(
+        inetSocketAddressClass, "getAddress", "()Ljava/net/InetAddress;");
+    jmethodID inetSocketAddress_getPort = lookup.findMethod(
+        inetSocketAddressClass, "getPort", "()I");
+    if(env->ExceptionCheck() || inetAddress_getAddress == NULL || inetSocketAddress_getAddress == NULL || inetSocketAddress_getPort == NULL)
+    {
+        LOGE("Error finding InetSocketAddress methods");
+        return false;
+    }
+
+    jobject inetAddressObject = env->CallObjectMethod(in_addr, inetSocketAddress_getAddress);
+    if(env->ExceptionCheck() || inetAddressObject == NULL)
+    {
+        return false;
+    }
+
+    int port = env->CallIntMethod(in_addr, inetSocketAddress_getPort);
+    jbyteArray addressArray = (jbyteArray)env->CallObjectMethod(inetAddressObject, inetAddress_getAddress);
+    if(env->ExceptionCheck() || addressArray == NULL)
+    {
+        LOGE("Exception calling InetSocketAddress.getPort() or InetAddress.getAddress()");
+        return false;
+    }
+
+    unsigned int addrSize = env->GetArrayLength(addressArray);
+    jbyte *bytes = (jbyte*)env->GetPrimitiveArrayCritical(addressArray, NULL);
+    bool ok = true;
+    if(addrSize == 16)
+    {
+        sockaddr_in6 ipv6 = {};
+        ipv6.sin6_family = AF_INET6;
+        ipv6.sin6_port = htons(port);
+        memcpy(ipv6.sin6_addr.s6_addr, bytes, 16);
+        memcpy(&addr, &ipv6, sizeof(sockaddr_in6));
+    }
+    else if(addrSize == 4)
+    {
+        sockaddr_in ipv4 = {};
+        ipv4.sin_family = AF_INET;
+        ipv4.sin_port = htons(port);
+        memcpy(&ipv4.sin_addr, bytes, 4);
+        memcpy(&addr, &ipv4, sizeof(sockaddr_in));
+    }
+    else
+    {
+        LOGE("Unknown IP version");
+        ok = false;
+    }
+    env->ReleasePrimitiveArrayCritical(addressArray, bytes, 0);
+    return ok;
+}
+
 jobject newPeerPhysicalPath(JNIEnv *env, const ZT_PeerPhysicalPath &ppp)
 {
     LOGV("newPeerPhysicalPath Called");
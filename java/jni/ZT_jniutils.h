@@ -50,6 +50,7 @@ jobject createVirtualNetworkConfigOperation(JNIEnv *env, ZT_VirtualNetworkConfig
 
 jobject newInetSocketAddress(JNIEnv *env, const sockaddr_storage &addr);
 jobject newInetAddress(JNIEnv *env, const sockaddr_storage &addr);
+bool inetSocketAddressToSockaddr(JNIEnv *env, jobject in_addr, sockaddr_storage &addr);
 
 jobject newMulticastGroup(JNIEnv *env, const ZT_MulticastGroup &mc);
 
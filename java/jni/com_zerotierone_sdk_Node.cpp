@@ -33,6 +33,7 @@
 #include "Mutex.hpp"
 
 #include <map>
+#include <vector>
 #include <string>
 #include <assert.h>
 #include <string.h>
@@ -955,6 +956,112 @@ JNIEXPORT jobject JNICALL Java_com_zerotier_sdk_Node_processWirePacket(
     return createResultObject(env, rc);
 }
 
+/*
+ * Class:     com_zerotier_sdk_Node
+ * Method:    processWirePackets
+ * Signature: (JJLjava/net/InetSocketAddress;[Ljava/net/InetSocketAddress;[[B[J)Lcom/zerotier/sdk/ResultCode;
+ */
+JNIEXPORT jobject JNICALL Java_com_zerotier_sdk_Node_processWirePackets(
+    JNIEnv *env, jobject obj,
+    jlong id,
+    jlong in_now,
+    jobject in_localAddress,
+    jobjectArray in_remoteAddresses,
+    jobjectArray in_packetData,
+    jlongArray out_nextBackgroundTaskDeadline)
+{
+    uint64_t nodeId = (uint64_t) id;
+    ZT_Node *node = findNode(nodeId);
+    if(node == NULL)
+    {
+        // cannot find valid node.  We should  never get here.
+        LOGE("Couldn't find a valid node!");
+        return createResultObject(env, ZT_RESULT_FATAL_ERROR_INTERNAL);
+    }
+
+    unsigned int nbtd_len = env->GetArrayLength(out_nextBackgroundTaskDeadline);
+    if(nbtd_len < 1)
+    {
+        LOGE("nbtd_len < 1");
+        return createResultObject(env, ZT_RESULT_FATAL_ERROR_INTERNAL);
+    }
+
+    unsigned int count = env->GetArrayLength(in_remoteAddresses);
+    if(count != (unsigned int)env->GetArrayLength(in_packetData))
+    {
+        LOGE("remoteAddresses and packetData lengths differ");
+        return createResultObject(env, ZT_RESULT_FATAL_ERROR_INTERNAL);
+    }
+
+    uint64_t now = (uint64_t)in_now;
+
+    sockaddr_storage localAddress;
+    if(!inetSocketAddressToSockaddr(env, in_localAddress, localAddress))
+    {
+        return createResultObject(env, ZT_RESULT_FATAL_ERROR_INTERNAL);
+    }
+
+    // Packets are copied out of the Java heap once and handed to the core together
+    std::vector<sockaddr_storage> remoteAddresses(count);
+    std::vector<ZT_WirePacket> packets;
+    std::vector<char> packetBuffer;
+    std::vector<unsigned int> packetOffsets;
+    packets.reserve(count);
+    packetOffsets.reserve(count);
+    for(unsigned int i = 0; i < count; ++i)
+    {
+        jobject remoteAddressObject = env->GetObjectArrayElement(in_remoteAddresses, i);
+        jbyteArray packetDataArray = (jbyteArray)env->GetObjectArrayElement(in_packetData, i);
+        if((remoteAddressObject == NULL)||(packetDataArray == NULL)||(!inetSocketAddressToSockaddr(env, remoteAddressObject, remoteAddresses[i])))
+        {
+            LOGE("Invalid packet %u in batch", i);
+            return createResultObject(env, ZT_RESULT_FATAL_ERROR_INTERNAL);
+        }
+
+        unsigned int packetLength = env->GetArrayLength(packetDataArray);
+        unsigned int offset = (unsigned int)packetBuffer.size();
+        packetBuffer.resize(offset + packetLength);
+        if(packetLength > 0)
+        {
+            env->GetByteArrayRegion(packetDataArray, 0, packetLength, (jbyte *)&packetBuffer[offset]);
+        }
+        packetOffsets.push_back(offset);
+
+        ZT_WirePacket p;
+        p.localAddress = &localAddress;
+        p.remoteAddress = &remoteAddresses[i];
+        p.packetData = (const void *)0; // set below once packetBuffer stops growing
+        p.packetLength = packetLength;
+        packets.push_back(p);
+
+        env->DeleteLocalRef(remoteAddressObject);
+        env->DeleteLocalRef(packetDataArray);
+    }
+    for(unsigned int i = 0; i < count; ++i)
+    {
+        packets[i].packetData = (packetBuffer.empty()) ? (const void *)0 : (const void *)&packetBuffer[packetOffsets[i]];
+    }
+
+    uint64_t nextBackgroundTaskDeadline = 0;
+
+    ZT_ResultCode rc = ZT_Node_processWirePackets(
+        node,
+        now,
+        (count > 0) ? &packets[0] : (const ZT_WirePacket *)0,
+        count,
+        &nextBackgroundTaskDeadline);
+    if(rc != ZT_RESULT_OK)
+    {
+        LOGE("ZT_Node_processWirePackets returned: %d", rc);
+    }
+
+    jlong *outDeadline = (jlong*)env->GetPrimitiveArrayCritical(out_nextBackgroundTaskDeadline, NULL);
+    outDeadline[0] = (jlong)nextBackgroundTaskDeadline;
+    env->ReleasePrimitiveArrayCritical(out_nextBackgroundTaskDeadline, outDeadline, 0);
+
+    return createResultObject(env, rc);
+}
+
 /*
  * Class:     com_zerotier_sdk_Node
  * Method:    processBackgroundTasks
@@ -39,6 +39,14 @@ JNIEXPORT jobject JNICALL Java_com_zerotier_sdk_Node_processVirtualNetworkFrame
 JNIEXPORT jobject JNICALL Java_com_zerotier_sdk_Node_processWirePacket
   (JNIEnv *, jobject, jlong, jlong, jobject, jobject, jbyteArray, jlongArray);
 
+/*
+ * Class:     com_zerotier_sdk_Node
+ * Method:    processWirePackets
+ * Signature: (JJLjava/net/InetSocketAddress;[Ljava/net/InetSocketAddress;[[B[J)Lcom/zerotier/sdk/ResultCode;
+ */
+JNIEXPORT jobject JNICALL Java_com_zerotier_sdk_Node_processWirePackets
+  (JNIEnv *, jobject, jlong, jlong, jobject, jobjectArray, jobjectArray, jlongArray);
+
 /*
  * Class:     com_zerotier_sdk_Node
  * Method:    processBackgroundTasks
@@ -178,6 +178,27 @@ public class Node {
             nextBackgroundTaskDeadline);
     }
 
+    /**
+     * Process several packets received from the physical wire on the same local address
+     *
+     * @param now Current clock in milliseconds
+     * @param localAddress Local address packets were received on, or null if unspecified
+     * @param remoteAddresses Origin of each packet
+     * @param packetData Packet data for each packet (same length as remoteAddresses)
+     * @param nextBackgroundTaskDeadline Value/result: set to deadline for next call to processBackgroundTasks()
+     * @return OK (0) or error code if a fatal error condition has occurred
+     */
+    public ResultCode processWirePackets(
+        long now,
+        InetSocketAddress localAddress,
+        InetSocketAddress[] remoteAddresses,
+        byte[][] packetData,
+        long[] nextBackgroundTaskDeadline) {
+        return processWirePackets(
+            nodeId, now, localAddress, remoteAddresses, packetData,
+            nextBackgroundTaskDeadline);
+    }
+
     /**
      * Perform periodic background operations
      *
@@ -399,6 +420,14 @@ public class Node {
         byte[] packetData,
         long[] nextBackgroundTaskDeadline);
 
+    private native ResultCode processWirePackets(
+        long nodeId,
+        long now,
+        InetSocketAddress localAddress,
+        InetSocketAddress[] remoteAddresses,
+        byte[][] packetData,
+        long[] nextBackgroundTaskDeadline);
+
     private native ResultCode processBackgroundTasks(
         long nodeId,
         long now,
@@ -18,6 +18,10 @@ include objects.mk
 # Trying to use dynamically linked libhttp-parser causes tons of compatibility problems.
 OBJS+=ext/http-parser/http_parser.o
 
+# Linux interface address and multicast tracking over rtnetlink, also used by
+# ManagedRoute so it's needed by every target and not just zerotier-one
+OBJS+=osdep/LinuxNetLink.o
+
 # Auto-detect miniupnpc and nat-pmp as well and use system libs if present,
 # otherwise build into binary as done on Mac and Windows.
 OBJS+=osdep/PortMapper.o
@@ -140,13 +144,17 @@ selftest:	$(OBJS) selftest.o
 	$(CXX) $(CXXFLAGS) $(LDFLAGS) -o zerotier-selftest selftest.o $(OBJS) $(LDLIBS)
 	$(STRIP) zerotier-selftest
 
+bench:	$(OBJS) bench.o
+	$(CXX) $(CXXFLAGS) $(LDFLAGS) -o zerotier-bench bench.o $(OBJS) $(LDLIBS)
+	$(STRIP) zerotier-bench
+
 manpages:	FORCE
 	cd doc ; ./build.sh
 
 doc:	manpages
 
 clean: FORCE
-	rm -rf *.so *.o node/*.o controller/*.o osdep/*.o service/*.o ext/http-parser/*.o ext/miniupnpc/*.o ext/libnatpmp/*.o $(OBJS) zerotier-one zerotier-idtool zerotier-cli zerotier-selftest build-* ZeroTierOneInstaller-* *.deb *.rpm .depend debian/files debian/zerotier-one*.debhelper debian/zerotier-one.substvars debian/*.log debian/zerotier-one doc/node_modules
+	rm -rf *.so *.o node/*.o controller/*.o osdep/*.o service/*.o ext/http-parser/*.o ext/miniupnpc/*.o ext/libnatpmp/*.o $(OBJS) zerotier-one zerotier-idtool zerotier-cli zerotier-selftest zerotier-bench build-* ZeroTierOneInstaller-* *.deb *.rpm .depend debian/files debian/zerotier-one*.debhelper debian/zerotier-one.substvars debian/*.log debian/zerotier-one doc/node_modules
 
 distclean:	clean
 
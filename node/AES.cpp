@@ -0,0 +1,660 @@
+/*
+ * ZeroTier One - Network Virtualization Everywhere
+ * Copyright (C) 2011-2016  ZeroTier, Inc.  https://www.zerotier.com/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "AES.hpp"
+#include "CPU.hpp"
+
+#ifdef ZT_AES_AESNI
+#include <immintrin.h>
+#endif
+
+namespace ZeroTier {
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// Portable implementation (FIPS-197 and SP 800-38D)
+
+static const uint8_t _sbox[256] = {
+	0x63,0x7c,0x77,0x7b,0xf2,0x6b,0x6f,0xc5,0x30,0x01,0x67,0x2b,0xfe,0xd7,0xab,0x76,
+	0xca,0x82,0xc9,0x7d,0xfa,0x59,0x47,0xf0,0xad,0xd4,0xa2,0xaf,0x9c,0xa4,0x72,0xc0,
+	0xb7,0xfd,0x93,0x26,0x36,0x3f,0xf7,0xcc,0x34,0xa5,0xe5,0xf1,0x71,0xd8,0x31,0x15,
+	0x04,0xc7,0x23,0xc3,0x18,0x96,0x05,0x9a,0x07,0x12,0x80,0xe2,0xeb,0x27,0xb2,0x75,
+	0x09,0x83,0x2c,0x1a,0x1b,0x6e,0x5a,0xa0,0x52,0x3b,0xd6,0xb3,0x29,0xe3,0x2f,0x84,
+	0x53,0xd1,0x00,0xed,0x20,0xfc,0xb1,0x5b,0x6a,0xcb,0xbe,0x39,0x4a,0x4c,0x58,0xcf,
+	0xd0,0xef,0xaa,0xfb,0x43,0x4d,0x33,0x85,0x45,0xf9,0x02,0x7f,0x50,0x3c,0x9f,0xa8,
+	0x51,0xa3,0x40,0x8f,0x92,0x9d,0x38,0xf5,0xbc,0xb6,0xda,0x21,0x10,0xff,0xf3,0xd2,
+	0xcd,0x0c,0x13,0xec,0x5f,0x97,0x44,0x17,0xc4,0xa7,0x7e,0x3d,0x64,0x5d,0x19,0x73,
+	0x60,0x81,0x4f,0xdc,0x22,0x2a,0x90,0x88,0x46,0xee,0xb8,0x14,0xde,0x5e,0x0b,0xdb,
+	0xe0,0x32,0x3a,0x0a,0x49,0x06,0x24,0x5c,0xc2,0xd3,0xac,0x62,0x91,0x95,0xe4,0x79,
+	0xe7,0xc8,0x37,0x6d,0x8d,0xd5,0x4e,0xa9,0x6c,0x56,0xf4,0xea,0x65,0x7a,0xae,0x08,
+	0xba,0x78,0x25,0x2e,0x1c,0xa6,0xb4,0xc6,0xe8,0xdd,0x74,0x1f,0x4b,0xbd,0x8b,0x8a,
+	0x70,0x3e,0xb5,0x66,0x48,0x03,0xf6,0x0e,0x61,0x35,0x57,0xb9,0x86,0xc1,0x1d,0x9e,
+	0xe1,0xf8,0x98,0x11,0x69,0xd9,0x8e,0x94,0x9b,0x1e,0x87,0xe9,0xce,0x55,0x28,0xdf,
+	0x8c,0xa1,0x89,0x0d,0xbf,0xe6,0x42,0x68,0x41,0x99,0x2d,0x0f,0xb0,0x54,0xbb,0x16
+};
+
+static inline uint8_t _xtime(const uint8_t x) { return (uint8_t)((x << 1) ^ ((x >> 7) * 0x1b)); }
+
+static void _expandKeyGeneric(const uint8_t *key,uint8_t rk[15][16])
+{
+	uint8_t *const w = &(rk[0][0]);
+	memcpy(w,key,32);
+	uint8_t rcon = 1;
+	for(unsigned int i=8;i<60;++i) {
+		uint8_t t[4];
+		memcpy(t,w + ((i - 1) * 4),4);
+		if ((i & 7) == 0) {
+			const uint8_t t0 = t[0];
+			t[0] = _sbox[t[1]] ^ rcon;
+			t[1] = _sbox[t[2]];
+			t[2] = _sbox[t[3]];
+			t[3] = _sbox[t0];
+			rcon = _xtime(rcon);
+		} else if ((i & 7) == 4) {
+			for(unsigned int j=0;j<4;++j)
+				t[j] = _sbox[t[j]];
+		}
+		for(unsigned int j=0;j<4;++j)
+			w[(i * 4) + j] = w[((i - 8) * 4) + j] ^ t[j];
+	}
+}
+
+static void _encryptGeneric(const uint8_t rk[15][16],const uint8_t *in,uint8_t *out)
+{
+	uint8_t s[16],t[16];
+	for(unsigned int i=0;i<16;++i)
+		s[i] = in[i] ^ rk[0][i];
+	for(unsigned int r=1;r<15;++r) {
+		// SubBytes and ShiftRows (state is column-major: s[(column * 4) + row])
+		for(unsigned int c=0;c<4;++c) {
+			for(unsigned int j=0;j<4;++j)
+				t[(c * 4) + j] = _sbox[s[(((c + j) & 3) * 4) + j]];
+		}
+		if (r < 14) {
+			// MixColumns
+			for(unsigned int c=0;c<4;++c) {
+				const uint8_t a0 = t[c * 4],a1 = t[(c * 4) + 1],a2 = t[(c * 4) + 2],a3 = t[(c * 4) + 3];
+				const uint8_t x = a0 ^ a1 ^ a2 ^ a3;
+				t[c * 4] = a0 ^ x ^ _xtime(a0 ^ a1);
+				t[(c * 4) + 1] = a1 ^ x ^ _xtime(a1 ^ a2);
+				t[(c * 4) + 2] = a2 ^ x ^ _xtime(a2 ^ a3);
+				t[(c * 4) + 3] = a3 ^ x ^ _xtime(a3 ^ a0);
+			}
+		}
+		for(unsigned int i=0;i<16;++i)
+			s[i] = t[i] ^ rk[r][i];
+	}
+	memcpy(out,s,16);
+}
+
+static inline uint64_t _be64(const uint8_t *p)
+{
+	return (((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) | ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) | ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) | ((uint64_t)p[6] << 8) | (uint64_t)p[7]);
+}
+
+static inline void _putBe64(uint8_t *p,const uint64_t v)
+{
+	for(unsigned int i=0;i<8;++i)
+		p[i] = (uint8_t)(v >> (56 - (i * 8)));
+}
+
+// x = x * h in GF(2^128), with both as big-endian (high, low) words
+static void _gmulGeneric(uint64_t x[2],const uint64_t h[2])
+{
+	uint64_t zh = 0,zl = 0,vh = h[0],vl = h[1];
+	for(unsigned int i=0;i<128;++i) {
+		const uint64_t m = 0ULL - (((i < 64) ? (x[0] >> (63 - i)) : (x[1] >> (127 - i))) & 1ULL);
+		zh ^= vh & m;
+		zl ^= vl & m;
+		const uint64_t r = 0ULL - (vl & 1ULL);
+		vl = (vl >> 1) | (vh << 63);
+		vh = (vh >> 1) ^ (0xe100000000000000ULL & r);
+	}
+	x[0] = zh;
+	x[1] = zl;
+}
+
+static inline void _ghashGeneric(uint64_t x[2],const uint64_t h[2],const uint8_t *p,unsigned int len)
+{
+	while (len) {
+		uint8_t b[16];
+		const unsigned int n = (len < 16) ? len : 16;
+		memcpy(b,p,n);
+		memset(b + n,0,16 - n);
+		x[0] ^= _be64(b);
+		x[1] ^= _be64(b + 8);
+		_gmulGeneric(x,h);
+		p += n;
+		len -= n;
+	}
+}
+
+static inline void _inc32(uint8_t ctr[16])
+{
+	for(unsigned int i=15;i>=12;--i) {
+		if (++ctr[i])
+			break;
+	}
+}
+
+#ifdef ZT_AES_AESNI
+
+//////////////////////////////////////////////////////////////////////////////
+// AES-NI and PCLMULQDQ, four blocks at a time
+//
+// GHASH works on byte-reversed blocks so PCLMULQDQ sees ordinary little-endian
+// 128-bit values. Multiplication and reduction follow Intel's white paper
+// "Intel Carry-Less Multiplication Instruction and its Usage for Computing
+// the GCM Mode" (Gueron and Kounavis). Products are summed before reducing,
+// so one reduction covers four (or sixteen) blocks.
+
+#define ZT_AES_TARGET_AESNI __attribute__((target("aes,pclmul,ssse3,sse4.1")))
+
+ZT_AES_TARGET_AESNI static inline __m128i _bswap(const __m128i x) { return _mm_shuffle_epi8(x,_mm_set_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15)); }
+
+// Unreduced product: lo, mid, and hi words accumulate so several products can share one reduction
+ZT_AES_TARGET_AESNI static inline void _clmulAcc(const __m128i a,const __m128i b,__m128i &lo,__m128i &mid,__m128i &hi)
+{
+	lo = _mm_xor_si128(lo,_mm_clmulepi64_si128(a,b,0x00));
+	mid = _mm_xor_si128(mid,_mm_xor_si128(_mm_clmulepi64_si128(a,b,0x10),_mm_clmulepi64_si128(a,b,0x01)));
+	hi = _mm_xor_si128(hi,_mm_clmulepi64_si128(a,b,0x11));
+}
+
+ZT_AES_TARGET_AESNI static inline __m128i _reduce(__m128i lo,__m128i mid,__m128i hi)
+{
+	lo = _mm_xor_si128(lo,_mm_slli_si128(mid,8));
+	hi = _mm_xor_si128(hi,_mm_srli_si128(mid,8));
+
+	// Shift the 256-bit product left by one bit (GCM's bit order)
+	__m128i t7 = _mm_srli_epi32(lo,31);
+	__m128i t8 = _mm_srli_epi32(hi,31);
+	lo = _mm_slli_epi32(lo,1);
+	hi = _mm_slli_epi32(hi,1);
+	__m128i t9 = _mm_srli_si128(t7,12);
+	t8 = _mm_slli_si128(t8,4);
+	t7 = _mm_slli_si128(t7,4);
+	lo = _mm_or_si128(lo,t7);
+	hi = _mm_or_si128(_mm_or_si128(hi,t8),t9);
+
+	// Reduce modulo x^128 + x^7 + x^2 + x + 1
+	t7 = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(lo,31),_mm_slli_epi32(lo,30)),_mm_slli_epi32(lo,25));
+	t8 = _mm_srli_si128(t7,4);
+	t7 = _mm_slli_si128(t7,12);
+	lo = _mm_xor_si128(lo,t7);
+	__m128i t2 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(lo,1),_mm_srli_epi32(lo,2)),_mm_srli_epi32(lo,7));
+	t2 = _mm_xor_si128(t2,t8);
+	lo = _mm_xor_si128(lo,t2);
+	return _mm_xor_si128(hi,lo);
+}
+
+ZT_AES_TARGET_AESNI static inline __m128i _gfmul(const __m128i a,const __m128i b)
+{
+	__m128i lo = _mm_setzero_si128(),mid = _mm_setzero_si128(),hi = _mm_setzero_si128();
+	_clmulAcc(a,b,lo,mid,hi);
+	return _reduce(lo,mid,hi);
+}
+
+ZT_AES_TARGET_AESNI static inline __m128i _encryptAesni(__m128i x,const __m128i k[15])
+{
+	x = _mm_xor_si128(x,k[0]);
+	for(unsigned int r=1;r<14;++r)
+		x = _mm_aesenc_si128(x,k[r]);
+	return _mm_aesenclast_si128(x,k[14]);
+}
+
+ZT_AES_TARGET_AESNI static inline __m128i _expandAssist1(__m128i t1,__m128i t2)
+{
+	t2 = _mm_shuffle_epi32(t2,0xff);
+	__m128i t4 = _mm_slli_si128(t1,4);
+	t1 = _mm_xor_si128(t1,t4);
+	t4 = _mm_slli_si128(t4,4);
+	t1 = _mm_xor_si128(t1,t4);
+	t4 = _mm_slli_si128(t4,4);
+	t1 = _mm_xor_si128(t1,t4);
+	return _mm_xor_si128(t1,t2);
+}
+
+ZT_AES_TARGET_AESNI static inline __m128i _expandAssist2(__m128i t1,__m128i t3)
+{
+	const __m128i t2 = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(t1,0x00),0xaa);
+	__m128i t4 = _mm_slli_si128(t3,4);
+	t3 = _mm_xor_si128(t3,t4);
+	t4 = _mm_slli_si128(t4,4);
+	t3 = _mm_xor_si128(t3,t4);
+	t4 = _mm_slli_si128(t4,4);
+	t3 = _mm_xor_si128(t3,t4);
+	return _mm_xor_si128(t3,t2);
+}
+
+#define ZT_AES_EXPAND_STEP(i,rcon) \
+	t1 = _expandAssist1(t1,_mm_aeskeygenassist_si128(t3,rcon)); \
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(rk[i]),t1); \
+	if ((i) < 14) { \
+		t3 = _expandAssist2(t1,t3); \
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(rk[(i) + 1]),t3); \
+	}
+
+ZT_AES_TARGET_AESNI static void _expandKeyAesni(const uint8_t *key,uint8_t rk[15][16])
+{
+	__m128i t1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(key));
+	__m128i t3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(key + 16));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(rk[0]),t1);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(rk[1]),t3);
+	ZT_AES_EXPAND_STEP(2,0x01);
+	ZT_AES_EXPAND_STEP(4,0x02);
+	ZT_AES_EXPAND_STEP(6,0x04);
+	ZT_AES_EXPAND_STEP(8,0x08);
+	ZT_AES_EXPAND_STEP(10,0x10);
+	ZT_AES_EXPAND_STEP(12,0x20);
+	ZT_AES_EXPAND_STEP(14,0x40);
+}
+
+// Powers H^1..H^n of the GHASH key, byte-reversed; H^p goes in h[16 - p]
+ZT_AES_TARGET_AESNI static void _hPowersAesni(const uint8_t rk[15][16],uint64_t h[16][2],const unsigned int n)
+{
+	__m128i k[15];
+	for(unsigned int i=0;i<15;++i)
+		k[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rk[i]));
+	__m128i p[16];
+	p[0] = _bswap(_encryptAesni(_mm_setzero_si128(),k));
+	for(unsigned int i=1;i<n;++i)
+		p[i] = _gfmul(p[i - 1],p[0]);
+	for(unsigned int i=0;i<n;++i)
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(h[15 - i]),p[i]);
+}
+
+ZT_AES_TARGET_AESNI static inline __m128i _ghashBytesAesni(__m128i x,const __m128i h,const uint8_t *p,unsigned int len)
+{
+	while (len) {
+		__m128i b;
+		if (len >= 16) {
+			b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+			p += 16;
+			len -= 16;
+		} else {
+			uint8_t tmp[16];
+			memcpy(tmp,p,len);
+			memset(tmp + len,0,16 - len);
+			b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tmp));
+			len = 0;
+		}
+		x = _gfmul(_mm_xor_si128(x,_bswap(b)),h);
+	}
+	return x;
+}
+
+// CTR encrypt/decrypt and GHASH the ciphertext, continuing from counter ctr
+// and hash x (both byte-reversed); this also handles any final partial block
+ZT_AES_TARGET_AESNI static void _gcmAesni(const __m128i k[15],const uint64_t hp[16][2],__m128i &x,__m128i &ctr,const uint8_t *in,uint8_t *out,unsigned int len,const bool encrypt)
+{
+	const __m128i h1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hp[15]));
+	const __m128i h2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hp[14]));
+	const __m128i h3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hp[13]));
+	const __m128i h4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hp[12]));
+	const __m128i one = _mm_set_epi32(0,0,0,1);
+
+	while (len >= 64) {
+		__m128i c0 = _mm_add_epi32(ctr,one);
+		__m128i c1 = _mm_add_epi32(c0,one);
+		__m128i c2 = _mm_add_epi32(c1,one);
+		__m128i c3 = _mm_add_epi32(c2,one);
+		ctr = c3;
+		c0 = _mm_xor_si128(_bswap(c0),k[0]);
+		c1 = _mm_xor_si128(_bswap(c1),k[0]);
+		c2 = _mm_xor_si128(_bswap(c2),k[0]);
+		c3 = _mm_xor_si128(_bswap(c3),k[0]);
+		for(unsigned int r=1;r<14;++r) {
+			c0 = _mm_aesenc_si128(c0,k[r]);
+			c1 = _mm_aesenc_si128(c1,k[r]);
+			c2 = _mm_aesenc_si128(c2,k[r]);
+			c3 = _mm_aesenc_si128(c3,k[r]);
+		}
+		c0 = _mm_aesenclast_si128(c0,k[14]);
+		c1 = _mm_aesenclast_si128(c1,k[14]);
+		c2 = _mm_aesenclast_si128(c2,k[14]);
+		c3 = _mm_aesenclast_si128(c3,k[14]);
+
+		const __m128i i0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+		const __m128i i1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 16));
+		const __m128i i2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 32));
+		const __m128i i3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 48));
+		c0 = _mm_xor_si128(c0,i0);
+		c1 = _mm_xor_si128(c1,i1);
+		c2 = _mm_xor_si128(c2,i2);
+		c3 = _mm_xor_si128(c3,i3);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out),c0);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16),c1);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + 32),c2);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + 48),c3);
+
+		__m128i lo = _mm_setzero_si128(),mid = _mm_setzero_si128(),hi = _mm_setzero_si128();
+		_clmulAcc(_mm_xor_si128(x,_bswap(encrypt ? c0 : i0)),h4,lo,mid,hi);
+		_clmulAcc(_bswap(encrypt ? c1 : i1),h3,lo,mid,hi);
+		_clmulAcc(_bswap(encrypt ? c2 : i2),h2,lo,mid,hi);
+		_clmulAcc(_bswap(encrypt ? c3 : i3),h1,lo,mid,hi);
+		x = _reduce(lo,mid,hi);
+
+		in += 64;
+		out += 64;
+		len -= 64;
+	}
+
+	while (len) {
+		ctr = _mm_add_epi32(ctr,one);
+		const __m128i ks = _encryptAesni(_bswap(ctr),k);
+		uint8_t tmp[16];
+		const unsigned int n = (len < 16) ? len : 16;
+		memcpy(tmp,in,n);
+		memset(tmp + n,0,16 - n);
+		const __m128i i0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tmp));
+		__m128i c0 = _mm_xor_si128(i0,ks);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(tmp),c0);
+		memcpy(out,tmp,n);
+		if (encrypt) {
+			memset(tmp + n,0,16 - n);
+			c0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tmp));
+		}
+		x = _gfmul(_mm_xor_si128(x,_bswap(encrypt ? c0 : i0)),h1);
+		in += n;
+		out += n;
+		len -= n;
+	}
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+
+//////////////////////////////////////////////////////////////////////////////
+// VAES and VPCLMULQDQ with AVX-512, sixteen blocks at a time
+
+#define ZT_AES_TARGET_VAES __attribute__((target("aes,pclmul,ssse3,sse4.1,avx2,avx512f,avx512bw,vaes,vpclmulqdq")))
+
+ZT_AES_TARGET_VAES static inline __m512i _bswap512(const __m512i x)
+{
+	return _mm512_shuffle_epi8(x,_mm512_broadcast_i32x4(_mm_set_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15)));
+}
+
+ZT_AES_TARGET_VAES static inline void _clmulAcc512(const __m512i a,const __m512i b,__m512i &lo,__m512i &mid,__m512i &hi)
+{
+	lo = _mm512_xor_si512(lo,_mm512_clmulepi64_epi128(a,b,0x00));
+	mid = _mm512_xor_si512(mid,_mm512_xor_si512(_mm512_clmulepi64_epi128(a,b,0x10),_mm512_clmulepi64_epi128(a,b,0x01)));
+	hi = _mm512_xor_si512(hi,_mm512_clmulepi64_epi128(a,b,0x11));
+}
+
+ZT_AES_TARGET_VAES static inline __m128i _xorLanes(const __m512i v)
+{
+	return _mm_xor_si128(_mm_xor_si128(_mm512_extracti32x4_epi32(v,0),_mm512_extracti32x4_epi32(v,1)),_mm_xor_si128(_mm512_extracti32x4_epi32(v,2),_mm512_extracti32x4_epi32(v,3)));
+}
+
+ZT_AES_TARGET_VAES static void _gcmVaes(const __m128i k[15],const uint64_t hp[16][2],__m128i &x,__m128i &ctr,const uint8_t *in,uint8_t *out,unsigned int len,const bool encrypt)
+{
+	if (len >= 256) {
+		__m512i kz[15];
+		for(unsigned int r=0;r<15;++r)
+			kz[r] = _mm512_broadcast_i32x4(k[r]);
+		// Lanes of hz[j] hold H^(16-4j) ... H^(13-4j), matching blocks 4j ... 4j+3
+		const __m512i hz0 = _mm512_loadu_si512(reinterpret_cast<const void *>(hp[0]));
+		const __m512i hz1 = _mm512_loadu_si512(reinterpret_cast<const void *>(hp[4]));
+		const __m512i hz2 = _mm512_loadu_si512(reinterpret_cast<const void *>(hp[8]));
+		const __m512i hz3 = _mm512_loadu_si512(reinterpret_cast<const void *>(hp[12]));
+		const __m512i four = _mm512_broadcast_i32x4(_mm_set_epi32(0,0,0,4));
+		__m512i cz = _mm512_add_epi32(_mm512_broadcast_i32x4(ctr),_mm512_set_epi32(0,0,0,4,0,0,0,3,0,0,0,2,0,0,0,1));
+
+		while (len >= 256) {
+			__m512i c0 = cz;
+			__m512i c1 = _mm512_add_epi32(c0,four);
+			__m512i c2 = _mm512_add_epi32(c1,four);
+			__m512i c3 = _mm512_add_epi32(c2,four);
+			cz = _mm512_add_epi32(c3,four);
+			c0 = _mm512_xor_si512(_bswap512(c0),kz[0]);
+			c1 = _mm512_xor_si512(_bswap512(c1),kz[0]);
+			c2 = _mm512_xor_si512(_bswap512(c2),kz[0]);
+			c3 = _mm512_xor_si512(_bswap512(c3),kz[0]);
+			for(unsigned int r=1;r<14;++r) {
+				c0 = _mm512_aesenc_epi128(c0,kz[r]);
+				c1 = _mm512_aesenc_epi128(c1,kz[r]);
+				c2 = _mm512_aesenc_epi128(c2,kz[r]);
+				c3 = _mm512_aesenc_epi128(c3,kz[r]);
+			}
+			c0 = _mm512_aesenclast_epi128(c0,kz[14]);
+			c1 = _mm512_aesenclast_epi128(c1,kz[14]);
+			c2 = _mm512_aesenclast_epi128(c2,kz[14]);
+			c3 = _mm512_aesenclast_epi128(c3,kz[14]);
+
+			const __m512i i0 = _mm512_loadu_si512(reinterpret_cast<const void *>(in));
+			const __m512i i1 = _mm512_loadu_si512(reinterpret_cast<const void *>(in + 64));
+			const __m512i i2 = _mm512_loadu_si512(reinterpret_cast<const void *>(in + 128));
+			const __m512i i3 = _mm512_loadu_si512(reinterpret_cast<const void *>(in + 192));
+			c0 = _mm512_xor_si512(c0,i0);
+			c1 = _mm512_xor_si512(c1,i1);
+			c2 = _mm512_xor_si512(c2,i2);
+			c3 = _mm512_xor_si512(c3,i3);
+			_mm512_storeu_si512(reinterpret_cast<void *>(out),c0);
+			_mm512_storeu_si512(reinterpret_cast<void *>(out + 64),c1);
+			_mm512_storeu_si512(reinterpret_cast<void *>(out + 128),c2);
+			_mm512_storeu_si512(reinterpret_cast<void *>(out + 192),c3);
+
+			__m512i lo = _mm512_setzero_si512(),mid = _mm512_setzero_si512(),hi = _mm512_setzero_si512();
+			_clmulAcc512(_mm512_xor_si512(_bswap512(encrypt ? c0 : i0),_mm512_inserti32x4(_mm512_setzero_si512(),x,0)),hz0,lo,mid,hi);
+			_clmulAcc512(_bswap512(encrypt ? c1 : i1),hz1,lo,mid,hi);
+			_clmulAcc512(_bswap512(encrypt ? c2 : i2),hz2,lo,mid,hi);
+			_clmulAcc512(_bswap512(encrypt ? c3 : i3),hz3,lo,mid,hi);
+			x = _reduce(_xorLanes(lo),_xorLanes(mid),_xorLanes(hi));
+
+			in += 256;
+			out += 256;
+			len -= 256;
+		}
+
+		ctr = _mm_sub_epi32(_mm512_extracti32x4_epi32(cz,0),_mm_set_epi32(0,0,0,1));
+	}
+	_gcmAesni(k,hp,x,ctr,in,out,len,encrypt);
+}
+
+#pragma GCC diagnostic pop
+
+ZT_AES_TARGET_AESNI static void _gcmHw(const bool vaes,const uint8_t rk[15][16],const uint64_t hp[16][2],const uint8_t *iv,const uint8_t *aad,unsigned int aadLen,const uint8_t *in,uint8_t *out,unsigned int len,const bool encrypt,uint8_t tag[16])
+{
+	__m128i k[15];
+	for(unsigned int i=0;i<15;++i)
+		k[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rk[i]));
+	const __m128i h1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hp[15]));
+
+	uint8_t j0[16];
+	memcpy(j0,iv,12);
+	j0[12] = 0; j0[13] = 0; j0[14] = 0; j0[15] = 1;
+	__m128i ctr = _bswap(_mm_loadu_si128(reinterpret_cast<const __m128i *>(j0)));
+
+	__m128i x = _ghashBytesAesni(_mm_setzero_si128(),h1,aad,aadLen);
+	if (vaes)
+		_gcmVaes(k,hp,x,ctr,in,out,len,encrypt);
+	else _gcmAesni(k,hp,x,ctr,in,out,len,encrypt);
+
+	x = _gfmul(_mm_xor_si128(x,_mm_set_epi64x((long long)aadLen * 8,(long long)len * 8)),h1);
+	x = _mm_xor_si128(_bswap(x),_encryptAesni(_mm_loadu_si128(reinterpret_cast<const __m128i *>(j0)),k));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(tag),x);
+}
+
+ZT_AES_TARGET_AESNI static void _encryptBlockAesni(const uint8_t rk[15][16],const uint8_t *in,uint8_t *out)
+{
+	__m128i k[15];
+	for(unsigned int i=0;i<15;++i)
+		k[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rk[i]));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(out),_encryptAesni(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in)),k));
+}
+
+#endif // ZT_AES_AESNI
+
+class _AESBest
+{
+public:
+	_AESBest() :
+		impl(AES::IMPL_GENERIC)
+	{
+#ifdef ZT_AES_AESNI
+		if (CPU::has(CPU::AESNI | CPU::PCLMULQDQ | CPU::SSSE3 | CPU::SSE41)) {
+			impl = AES::IMPL_AESNI;
+			if (CPU::has(CPU::AVX512F | CPU::AVX512BW | CPU::VAES | CPU::VPCLMULQDQ))
+				impl = AES::IMPL_VAES;
+		}
+#endif
+	}
+	AES::Implementation impl;
+};
+static const _AESBest _AES_BEST;
+
+} // anonymous namespace
+
+void AES::init(const void *key,Implementation impl)
+	throw()
+{
+	if (impl > _AES_BEST.impl)
+		impl = _AES_BEST.impl;
+	_impl = impl;
+#ifdef ZT_AES_AESNI
+	if (impl != IMPL_GENERIC) {
+		_expandKeyAesni(reinterpret_cast<const uint8_t *>(key),_k.rk);
+		_hPowersAesni(_k.rk,_k.h,(impl == IMPL_VAES) ? 16 : 4);
+		return;
+	}
+#endif
+	_expandKeyGeneric(reinterpret_cast<const uint8_t *>(key),_k.rk);
+	uint8_t h[16];
+	memset(h,0,16);
+	_encryptGeneric(_k.rk,h,h);
+	_k.h[15][0] = _be64(h);
+	_k.h[15][1] = _be64(h + 8);
+}
+
+void AES::encrypt(const void *in,void *out) const
+	throw()
+{
+#ifdef ZT_AES_AESNI
+	if (_impl != IMPL_GENERIC) {
+		_encryptBlockAesni(_k.rk,reinterpret_cast<const uint8_t *>(in),reinterpret_cast<uint8_t *>(out));
+		return;
+	}
+#endif
+	_encryptGeneric(_k.rk,reinterpret_cast<const uint8_t *>(in),reinterpret_cast<uint8_t *>(out));
+}
+
+void AES::gcmEncrypt(const void *iv,const void *aad,unsigned int aadLen,const void *in,void *out,unsigned int len,void *tag) const
+	throw()
+{
+	_gcm(iv,aad,aadLen,reinterpret_cast<const uint8_t *>(in),reinterpret_cast<uint8_t *>(out),len,true,reinterpret_cast<uint8_t *>(tag));
+}
+
+bool AES::gcmDecrypt(const void *iv,const void *aad,unsigned int aadLen,const void *in,void *out,unsigned int len,const void *tag,unsigned int tagLen) const
+	throw()
+{
+	uint8_t t[16];
+	_gcm(iv,aad,aadLen,reinterpret_cast<const uint8_t *>(in),reinterpret_cast<uint8_t *>(out),len,false,t);
+	if ((tagLen == 0)||(tagLen > 16)||(!Utils::secureEq(t,tag,tagLen))) {
+		// Put the ciphertext back rather than leave unauthenticated plaintext
+		uint8_t j0[16];
+		memcpy(j0,iv,12);
+		j0[12] = 0; j0[13] = 0; j0[14] = 0; j0[15] = 1;
+		_ctr(j0,reinterpret_cast<const uint8_t *>(out),reinterpret_cast<uint8_t *>(out),len);
+		return false;
+	}
+	return true;
+}
+
+AES::Implementation AES::best()
+	throw()
+{
+	return _AES_BEST.impl;
+}
+
+const char *AES::implementationName(Implementation impl)
+	throw()
+{
+	switch(impl) {
+		case IMPL_AESNI: return "aesni";
+		case IMPL_VAES: return "vaes";
+		default: return "generic";
+	}
+}
+
+void AES::_ctr(const uint8_t j0[16],const uint8_t *in,uint8_t *out,unsigned int len) const
+	throw()
+{
+	uint8_t ctr[16],ks[16];
+	memcpy(ctr,j0,16);
+	while (len) {
+		_inc32(ctr);
+		encrypt(ctr,ks);
+		const unsigned int n = (len < 16) ? len : 16;
+		for(unsigned int i=0;i<n;++i)
+			out[i] = in[i] ^ ks[i];
+		in += n;
+		out += n;
+		len -= n;
+	}
+}
+
+void AES::_gcm(const void *iv,const void *aad,unsigned int aadLen,const uint8_t *in,uint8_t *out,unsigned int len,bool encrypt,uint8_t tag[16]) const
+	throw()
+{
+#ifdef ZT_AES_AESNI
+	if (_impl != IMPL_GENERIC) {
+		_gcmHw((_impl == IMPL_VAES),_k.rk,_k.h,reinterpret_cast<const uint8_t *>(iv),reinterpret_cast<const uint8_t *>(aad),aadLen,in,out,len,encrypt,tag);
+		return;
+	}
+#endif
+
+	const unsigned int totalLen = len;
+	uint8_t j0[16],ctr[16],ks[16];
+	memcpy(j0,iv,12);
+	j0[12] = 0; j0[13] = 0; j0[14] = 0; j0[15] = 1;
+	memcpy(ctr,j0,16);
+
+	uint64_t x[2] = { 0,0 };
+	_ghashGeneric(x,_k.h[15],reinterpret_cast<const uint8_t *>(aad),aadLen);
+	while (len) {
+		_inc32(ctr);
+		_encryptGeneric(_k.rk,ctr,ks);
+		const unsigned int n = (len < 16) ? len : 16;
+		uint8_t c[16];
+		for(unsigned int i=0;i<n;++i) {
+			const uint8_t b = in[i];
+			out[i] = b ^ ks[i];
+			c[i] = (encrypt) ? out[i] : b;
+		}
+		_ghashGeneric(x,_k.h[15],c,n);
+		in += n;
+		out += n;
+		len -= n;
+	}
+
+	x[0] ^= (uint64_t)aadLen * 8;
+	x[1] ^= (uint64_t)totalLen * 8;
+	_gmulGeneric(x,_k.h[15]);
+	_encryptGeneric(_k.rk,j0,ks);
+	_putBe64(tag,x[0]);
+	_putBe64(tag + 8,x[1]);
+	for(unsigned int i=0;i<16;++i)
+		tag[i] ^= ks[i];
+}
+
+} // namespace ZeroTier
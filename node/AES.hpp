@@ -0,0 +1,152 @@
+/*
+ * ZeroTier One - Network Virtualization Everywhere
+ * Copyright (C) 2011-2016  ZeroTier, Inc.  https://www.zerotier.com/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ZT_AES_HPP
+#define ZT_AES_HPP
+
+#include <stdint.h>
+
+#include "Constants.hpp"
+#include "Utils.hpp"
+
+#define ZT_AES_KEY_LEN 32
+#define ZT_AES_BLOCK_SIZE 16
+#define ZT_AES_GCM_IV_LEN 12
+#define ZT_AES_GCM_TAG_LEN 16
+
+// AES-NI, PCLMULQDQ, and VAES kernels, selected at runtime (GCC/clang on x86_64 only)
+#if (!defined(ZT_AES_AESNI)) && (!defined(ZT_NO_AES_AESNI)) && defined(__GNUC__) && (defined(__x86_64__) || defined(__amd64__))
+#define ZT_AES_AESNI 1
+#endif
+
+namespace ZeroTier {
+
+/**
+ * AES-256 block cipher and AES-256-GCM authenticated encryption
+ *
+ * On x86_64 this uses AES-NI and PCLMULQDQ, and VAES and VPCLMULQDQ with
+ * AVX-512 where present, to work on four or sixteen blocks at a time.
+ * Elsewhere a portable implementation is used. It is much slower and uses
+ * table lookups, so it is not constant time.
+ */
+class AES
+{
+public:
+	/**
+	 * Implementations, from slowest to fastest
+	 */
+	enum Implementation
+	{
+		IMPL_GENERIC = 0,
+		IMPL_AESNI = 1,
+		IMPL_VAES = 2
+	};
+
+	AES() throw() {}
+
+	/**
+	 * @param key 256-bit key
+	 */
+	AES(const void *key) throw() { init(key,best()); }
+
+	~AES() { Utils::burn(&_k,sizeof(_k)); }
+
+	/**
+	 * Set key and choose the fastest implementation for this CPU
+	 *
+	 * @param key 256-bit key
+	 */
+	inline void init(const void *key) throw() { init(key,best()); }
+
+	/**
+	 * Set key and implementation
+	 *
+	 * @param key 256-bit key
+	 * @param impl Implementation, which must not be faster than best()
+	 */
+	void init(const void *key,Implementation impl) throw();
+
+	/**
+	 * Encrypt one 16-byte block
+	 *
+	 * @param in Input block
+	 * @param out Output block (may be the same as in)
+	 */
+	void encrypt(const void *in,void *out) const throw();
+
+	/**
+	 * Encrypt and authenticate with GCM
+	 *
+	 * @param iv 96-bit IV, which must never be used twice with the same key
+	 * @param aad Additional authenticated data or NULL
+	 * @param aadLen Length of additional authenticated data
+	 * @param in Plaintext
+	 * @param out Buffer for ciphertext (may be the same as in)
+	 * @param len Length of plaintext
+	 * @param tag Buffer for 16-byte authentication tag
+	 */
+	void gcmEncrypt(const void *iv,const void *aad,unsigned int aadLen,const void *in,void *out,unsigned int len,void *tag) const throw();
+
+	/**
+	 * Check authentication tag and decrypt with GCM
+	 *
+	 * If the tag doesn't match, out holds the ciphertext when this returns.
+	 *
+	 * @param iv 96-bit IV
+	 * @param aad Additional authenticated data or NULL
+	 * @param aadLen Length of additional authenticated data
+	 * @param in Ciphertext
+	 * @param out Buffer for plaintext (may be the same as in)
+	 * @param len Length of ciphertext
+	 * @param tag Expected authentication tag
+	 * @param tagLen Bytes of tag to check (1-16, leading bytes of the full tag)
+	 * @return True if tag matched
+	 */
+	bool gcmDecrypt(const void *iv,const void *aad,unsigned int aadLen,const void *in,void *out,unsigned int len,const void *tag,unsigned int tagLen) const throw();
+
+	/**
+	 * @return Fastest implementation this CPU supports
+	 */
+	static Implementation best() throw();
+
+	/**
+	 * @return True if this CPU has AES instructions, making AES-GCM faster than Salsa20/Poly1305
+	 */
+	static inline bool hardware() throw() { return (best() != IMPL_GENERIC); }
+
+	/**
+	 * @return Name of an implementation, e.g. "aesni" or "generic"
+	 */
+	static const char *implementationName(Implementation impl) throw();
+
+private:
+	void _ctr(const uint8_t j0[16],const uint8_t *in,uint8_t *out,unsigned int len) const throw();
+	void _gcm(const void *iv,const void *aad,unsigned int aadLen,const uint8_t *in,uint8_t *out,unsigned int len,bool encrypt,uint8_t tag[16]) const throw();
+
+	// Round keys are the same bytes for every implementation; the rest
+	// holds GHASH key powers in whatever form the implementation wants
+	struct {
+		uint8_t rk[15][16];
+		uint64_t h[16][2];
+	} _k;
+	Implementation _impl;
+};
+
+} // namespace ZeroTier
+
+#endif
@@ -57,6 +57,18 @@ public:
 #endif
 	}
 
+	/**
+	 * @return Current value
+	 */
+	inline int load() const
+	{
+#ifdef __GNUC__
+		return __sync_add_and_fetch(const_cast<int *>(&_v),0);
+#else
+		return _v.load();
+#endif
+	}
+
 private:
 #ifdef __GNUC__
 	int _v;
@@ -415,7 +415,6 @@ static inline void fe25519_pack(unsigned char r[32], const fe25519 *x)
     r[i] = y.v[i];
 }
 
-#if 0
 static int fe25519_iszero(const fe25519 *x)
 {
   int i;
@@ -427,7 +426,6 @@ static int fe25519_iszero(const fe25519 *x)
     r &= equal(t.v[i],0);
   return r;
 }
-#endif
 
 static inline int fe25519_iseq_vartime(const fe25519 *x, const fe25519 *y)
 {
@@ -2054,7 +2052,6 @@ static inline void ge25519_pack(unsigned char r[32], const ge25519_p3 *p)
   r[31] ^= fe25519_getparity(&tx) << 7;
 }
 
-#if 0
 static int ge25519_isneutral_vartime(const ge25519_p3 *p)
 {
   int ret = 1;
@@ -2062,7 +2059,6 @@ static int ge25519_isneutral_vartime(const ge25519_p3 *p)
   if(!fe25519_iseq_vartime(&p->y, &p->z)) ret = 0;
   return ret;
 }
-#endif
 
 /* computes [s1]p1 + [s2]p2 */
 static void ge25519_double_scalarmult_vartime(ge25519_p3 *r, const ge25519_p3 *p1, const sc25519 *s1, const ge25519_p3 *p2, const sc25519 *s2)
@@ -2110,6 +2106,83 @@ static void ge25519_double_scalarmult_vartime(ge25519_p3 *r, const ge25519_p3 *p
   }
 }
 
+/* Signed sliding window recoding with odd digits in -15..15 (scalar must be below 2^255) */
+static void sc25519_slide(signed char r[256], const sc25519 *s)
+{
+  int i,b,k;
+  for(i=0;i<256;++i)
+    r[i] = 1 & (s->v[i >> 3] >> (i & 7));
+  for(i=0;i<256;++i) {
+    if (r[i]) {
+      for(b=1;(b<=6)&&((i+b)<256);++b) {
+        if (r[i+b]) {
+          if ((r[i] + (r[i+b] << b)) <= 15) {
+            r[i] += r[i+b] << b;
+            r[i+b] = 0;
+          } else if ((r[i] - (r[i+b] << b)) >= -15) {
+            r[i] -= r[i+b] << b;
+            for(k=i+b;k<256;++k) {
+              if (!r[k]) {
+                r[k] = 1;
+                break;
+              }
+              r[k] = 0;
+            }
+          } else break;
+        }
+      }
+    }
+  }
+}
+
+static inline void ge25519_neg(ge25519_p3 *r, const ge25519_p3 *p)
+{
+  fe25519_neg(&r->x, &p->x);
+  r->y = p->y;
+  r->z = p->z;
+  fe25519_neg(&r->t, &p->t);
+}
+
+/* computes sum of [s[i]]p[i] for i < n using Straus' method; pre and slide
+ * are scratch space for n*8 points and n*256 digits */
+static void ge25519_multi_scalarmult_vartime(ge25519_p3 *r, const ge25519_p3 *p, const sc25519 *s, unsigned int n, ge25519_p3 *pre, signed char *slide)
+{
+  ge25519_p1p1 tp1p1;
+  ge25519_p3 t;
+  int top = -1;
+
+  /* odd multiples p, 3p, ... 15p of each point */
+  for(unsigned int j=0;j<n;++j) {
+    ge25519_p3 *const pj = pre + (j * 8);
+    pj[0] = p[j];
+    dbl_p1p1(&tp1p1, (const ge25519_p2 *)(&p[j])); p1p1_to_p3(&t, &tp1p1);
+    for(unsigned int k=1;k<8;++k) {
+      add_p1p1(&tp1p1, &pj[k-1], &t); p1p1_to_p3(&pj[k], &tp1p1);
+    }
+    sc25519_slide(slide + (j * 256), &s[j]);
+    for(int i=255;i>top;--i) {
+      if (slide[(j * 256) + i]) {
+        top = i;
+        break;
+      }
+    }
+  }
+
+  setneutral(r);
+  for(int i=top;i>=0;--i) {
+    dbl_p1p1(&tp1p1, (const ge25519_p2 *)r); p1p1_to_p3(r, &tp1p1);
+    for(unsigned int j=0;j<n;++j) {
+      const signed char d = slide[(j * 256) + i];
+      if (d > 0) {
+        add_p1p1(&tp1p1, r, &pre[(j * 8) + (d / 2)]); p1p1_to_p3(r, &tp1p1);
+      } else if (d < 0) {
+        ge25519_neg(&t, &pre[(j * 8) + ((-d) / 2)]);
+        add_p1p1(&tp1p1, r, &t); p1p1_to_p3(r, &tp1p1);
+      }
+    }
+  }
+}
+
 static inline void ge25519_scalarmult_base(ge25519_p3 *r, const sc25519 *s)
 {
   signed char b[85];
@@ -2365,6 +2438,111 @@ bool C25519::verify(const C25519::Public &their,const void *msg,unsigned int len
   return Utils::secureEq(sig,t2,32);
 }
 
+bool C25519::verifyBatch(const C25519::Public *const *their,const void *const *msg,const unsigned int *len,const void *const *signature,bool *ok,unsigned int count)
+  throw()
+{
+  // Checks that the sum of [z]R + [z*h]A - [z*s]B over a batch is zero, with
+  // a random 128-bit z for each signature. Points are decoded negated, so the
+  // sum is taken over -R, -A, and +B. Signatures with the same key share one
+  // term for A.
+  ge25519_p3 *const points = (ge25519_p3 *)malloc(sizeof(ge25519_p3) * ((ZT_C25519_BATCH_MAX * 2) + 1));
+  sc25519 *const scalars = (sc25519 *)malloc(sizeof(sc25519) * ((ZT_C25519_BATCH_MAX * 2) + 1));
+  ge25519_p3 *const pre = (ge25519_p3 *)malloc(sizeof(ge25519_p3) * 8 * ((ZT_C25519_BATCH_MAX * 2) + 1));
+  signed char *const slide = (signed char *)malloc(256 * ((ZT_C25519_BATCH_MAX * 2) + 1));
+  const unsigned char *keys[ZT_C25519_BATCH_MAX];
+  unsigned int batched[ZT_C25519_BATCH_MAX];
+  unsigned char digest[64],hram[crypto_hash_sha512_BYTES],m[96],zb[32];
+  bool allOk = true;
+
+  if ((!points)||(!scalars)||(!pre)||(!slide)) {
+    for(unsigned int i=0;i<count;++i) {
+      ok[i] = verify(*their[i],msg[i],len[i],signature[i]);
+      allOk &= ok[i];
+    }
+  } else {
+    memset(zb,0,sizeof(zb));
+    unsigned int i = 0;
+    while (i < count) {
+      // Points are [B, A..., R...]; A terms are filled from the front and
+      // R terms from the back, then R terms are moved down to follow
+      unsigned int nkeys = 0,nsigs = 0;
+      ge25519_p3 *const rPoints = points + 1 + ZT_C25519_BATCH_MAX;
+      sc25519 *const rScalars = scalars + 1 + ZT_C25519_BATCH_MAX;
+      points[0] = ge25519_base;
+      memset(&scalars[0],0,sizeof(sc25519));
+
+      for(;(i<count)&&(nsigs<ZT_C25519_BATCH_MAX);++i) {
+        const unsigned char *const sig = (const unsigned char *)signature[i];
+        const unsigned char *const pk = their[i]->data + 32;
+
+        SHA512::hash(digest,msg[i],len[i]);
+        if (!Utils::secureEq(sig + 64,digest,32)) {
+          ok[i] = false;
+          allOk = false;
+          continue;
+        }
+
+        // R must be canonical (y < p, and no sign bit if x is zero) or verify()
+        // would reject it, so leave anything unusual to verify()
+        bool rCanonical = ((sig[31] & 0x7f) != 0x7f)||(sig[0] < 0xed);
+        for(unsigned int k=1;((!rCanonical)&&(k<31));++k)
+          rCanonical = (sig[k] != 0xff);
+        if ((!rCanonical)||(ge25519_unpackneg_vartime(&rPoints[nsigs],sig))||((fe25519_iszero(&rPoints[nsigs].x))&&(sig[31] & 0x80))) {
+          ok[i] = verify(*their[i],msg[i],len[i],signature[i]);
+          allOk &= ok[i];
+          continue;
+        }
+
+        unsigned int k = 0;
+        while ((k < nkeys)&&(memcmp(keys[k],pk,32) != 0))
+          ++k;
+        if (k == nkeys) {
+          if (ge25519_unpackneg_vartime(&points[1 + k],pk)) {
+            ok[i] = false;
+            allOk = false;
+            continue;
+          }
+          keys[k] = pk;
+          memset(&scalars[1 + k],0,sizeof(sc25519));
+          ++nkeys;
+        }
+
+        sc25519 z,h,t;
+        Utils::getSecureRandom(zb,16);
+        sc25519_from32bytes(&z,zb);
+        get_hram(hram,sig,pk,m,96);
+        sc25519_from64bytes(&h,hram);
+        sc25519_mul(&t,&z,&h);
+        sc25519_add(&scalars[1 + k],&scalars[1 + k],&t);
+        sc25519_from32bytes(&t,sig + 32);
+        sc25519_mul(&t,&z,&t);
+        sc25519_add(&scalars[0],&scalars[0],&t);
+        rScalars[nsigs] = z;
+        batched[nsigs++] = i;
+      }
+
+      if (nsigs) {
+        memmove(points + 1 + nkeys,rPoints,sizeof(ge25519_p3) * nsigs);
+        memmove(scalars + 1 + nkeys,rScalars,sizeof(sc25519) * nsigs);
+        ge25519_p3 sum;
+        ge25519_multi_scalarmult_vartime(&sum,points,scalars,1 + nkeys + nsigs,pre,slide);
+        const bool batchOk = (ge25519_isneutral_vartime(&sum) != 0);
+        for(unsigned int j=0;j<nsigs;++j) {
+          const unsigned int b = batched[j];
+          ok[b] = (batchOk) ? true : verify(*their[b],msg[b],len[b],signature[b]);
+          allOk &= ok[b];
+        }
+      }
+    }
+  }
+
+  free(points);
+  free(scalars);
+  free(pre);
+  free(slide);
+  return allOk;
+}
+
 void C25519::_calcPubDH(C25519::Pair &kp)
   throw()
 {
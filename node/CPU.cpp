@@ -0,0 +1,211 @@
+/*
+ * ZeroTier One - Network Virtualization Everywhere
+ * Copyright (C) 2011-2016  ZeroTier, Inc.  https://www.zerotier.com/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "Constants.hpp"
+#include "CPU.hpp"
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define ZT_CPU_X86 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if (defined(__arm__) || defined(__aarch64__)) && defined(__linux__)
+#define ZT_CPU_ARM_LINUX 1
+#include <sys/auxv.h>
+#endif
+
+namespace ZeroTier {
+
+namespace {
+
+#ifdef ZT_CPU_X86
+
+static inline void _cpuid(uint32_t leaf,uint32_t subleaf,uint32_t r[4])
+{
+#ifdef _MSC_VER
+	int tmp[4];
+	__cpuidex(tmp,(int)leaf,(int)subleaf);
+	for(int i=0;i<4;++i) r[i] = (uint32_t)tmp[i];
+#else
+	r[0] = r[1] = r[2] = r[3] = 0;
+	__cpuid_count(leaf,subleaf,r[0],r[1],r[2],r[3]);
+#endif
+}
+
+// Which register state the OS saves on context switch (only valid if OSXSAVE is set)
+static inline uint64_t _xgetbv0()
+{
+#ifdef _MSC_VER
+	return (uint64_t)_xgetbv(0);
+#else
+	uint32_t lo,hi;
+	__asm__ __volatile__("xgetbv" : "=a"(lo),"=d"(hi) : "c"(0));
+	return (((uint64_t)hi << 32) | (uint64_t)lo);
+#endif
+}
+
+static uint32_t _probe()
+{
+	uint32_t f = 0;
+	uint32_t r[4];
+
+	_cpuid(0,0,r);
+	const uint32_t maxLeaf = r[0];
+	if (maxLeaf < 1)
+		return 0;
+
+	_cpuid(1,0,r);
+	const uint32_t ecx1 = r[2],edx1 = r[3];
+	if (edx1 & (1U << 26)) f |= CPU::SSE2;
+	if (ecx1 & (1U << 9)) f |= CPU::SSSE3;
+	if (ecx1 & (1U << 19)) f |= CPU::SSE41;
+	if (ecx1 & (1U << 25)) f |= CPU::AESNI;
+	if (ecx1 & (1U << 1)) f |= CPU::PCLMULQDQ;
+
+	// AVX registers must be saved by the OS (XMM and YMM state), and AVX-512 also needs opmask and ZMM state
+	bool osAvx = false,osAvx512 = false;
+	if ((ecx1 & (1U << 27))&&(ecx1 & (1U << 28))) {
+		const uint64_t xcr0 = _xgetbv0();
+		osAvx = ((xcr0 & 0x06) == 0x06);
+		osAvx512 = ((xcr0 & 0xe6) == 0xe6);
+	}
+
+	if (maxLeaf >= 7) {
+		_cpuid(7,0,r);
+		const uint32_t ebx7 = r[1],ecx7 = r[2];
+		if (ebx7 & (1U << 29)) f |= CPU::SHA;
+		if (osAvx) {
+			if (ebx7 & (1U << 5)) f |= CPU::AVX2;
+			if (ecx7 & (1U << 9)) f |= CPU::VAES;
+			if (ecx7 & (1U << 10)) f |= CPU::VPCLMULQDQ;
+		}
+		if (osAvx512) {
+			if (ebx7 & (1U << 16)) f |= CPU::AVX512F;
+			if (ebx7 & (1U << 30)) f |= CPU::AVX512BW;
+		}
+	}
+
+	return f;
+}
+
+#elif defined(ZT_CPU_ARM_LINUX)
+
+static uint32_t _probe()
+{
+	uint32_t f = 0;
+#ifdef __aarch64__
+	const unsigned long hwcap = getauxval(AT_HWCAP);
+	if (hwcap & (1UL << 1)) f |= CPU::NEON; // HWCAP_ASIMD
+	if (hwcap & (1UL << 3)) f |= CPU::ARM_AES;
+	if (hwcap & (1UL << 4)) f |= CPU::ARM_PMULL;
+	if (hwcap & (1UL << 6)) f |= CPU::ARM_SHA2;
+	if (hwcap & (1UL << 21)) f |= CPU::ARM_SHA512;
+#else
+	const unsigned long hwcap = getauxval(AT_HWCAP);
+	const unsigned long hwcap2 = getauxval(AT_HWCAP2);
+	if (hwcap & (1UL << 12)) f |= CPU::NEON;
+	if (hwcap2 & (1UL << 0)) f |= CPU::ARM_AES;
+	if (hwcap2 & (1UL << 1)) f |= CPU::ARM_PMULL;
+	if (hwcap2 & (1UL << 3)) f |= CPU::ARM_SHA2;
+#endif
+	return f;
+}
+
+#elif defined(__APPLE__) && defined(__aarch64__)
+
+// Every Apple ARM64 CPU has these
+static uint32_t _probe() { return (CPU::NEON | CPU::ARM_AES | CPU::ARM_PMULL | CPU::ARM_SHA2); }
+
+#else
+
+static uint32_t _probe() { return 0; }
+
+#endif
+
+static const struct { uint32_t feature; const char *name; } _CPU_FEATURE_NAMES[] = {
+	{ CPU::SSE2,"sse2" },
+	{ CPU::SSSE3,"ssse3" },
+	{ CPU::SSE41,"sse4.1" },
+	{ CPU::AVX2,"avx2" },
+	{ CPU::AVX512F,"avx512f" },
+	{ CPU::AVX512BW,"avx512bw" },
+	{ CPU::AESNI,"aes" },
+	{ CPU::PCLMULQDQ,"pclmulqdq" },
+	{ CPU::VAES,"vaes" },
+	{ CPU::VPCLMULQDQ,"vpclmulqdq" },
+	{ CPU::SHA,"sha" },
+	{ CPU::NEON,"neon" },
+	{ CPU::ARM_AES,"aes" },
+	{ CPU::ARM_PMULL,"pmull" },
+	{ CPU::ARM_SHA2,"sha2" },
+	{ CPU::ARM_SHA512,"sha512" }
+};
+
+class _CPUInfo
+{
+public:
+	_CPUInfo() :
+		features(_probe())
+	{
+		names[0] = (char)0;
+		unsigned int l = 0;
+		for(unsigned int i=0;i<(sizeof(_CPU_FEATURE_NAMES) / sizeof(_CPU_FEATURE_NAMES[0]));++i) {
+			if ((features & _CPU_FEATURE_NAMES[i].feature) != 0) {
+				const unsigned int nl = (unsigned int)strlen(_CPU_FEATURE_NAMES[i].name);
+				if ((l + nl + 2) > sizeof(names))
+					break;
+				if (l)
+					names[l++] = ' ';
+				memcpy(names + l,_CPU_FEATURE_NAMES[i].name,nl + 1);
+				l += nl;
+			}
+		}
+	}
+	const uint32_t features;
+	char names[192];
+};
+
+// Constructed on first use so that static initializers elsewhere can call CPU::features()
+static const _CPUInfo &_cpuInfo()
+{
+	static const _CPUInfo info;
+	return info;
+}
+
+} // anonymous namespace
+
+uint32_t CPU::features()
+	throw()
+{
+	return _cpuInfo().features;
+}
+
+const char *CPU::featureNames()
+	throw()
+{
+	return _cpuInfo().names;
+}
+
+} // namespace ZeroTier
@@ -0,0 +1,85 @@
+/*
+ * ZeroTier One - Network Virtualization Everywhere
+ * Copyright (C) 2011-2016  ZeroTier, Inc.  https://www.zerotier.com/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ZT_CPU_HPP
+#define ZT_CPU_HPP
+
+#include <stdint.h>
+
+#include "Constants.hpp"
+
+namespace ZeroTier {
+
+/**
+ * Instruction set features of the CPU we are running on
+ *
+ * Crypto primitives with vector or crypto instruction kernels build them
+ * into every binary and pick one at runtime based on these, so a generic
+ * build still uses AVX2, AVX-512, AES-NI, etc. where present. The CPU is
+ * probed the first time features() is called and the result is kept for
+ * the life of the process. Features that need operating system support,
+ * such as saving AVX registers, are only reported if the OS provides it.
+ */
+class CPU
+{
+public:
+	enum Feature
+	{
+		// x86 and x86_64
+		SSE2 =       0x00000001,
+		SSSE3 =      0x00000002,
+		SSE41 =      0x00000004,
+		AVX2 =       0x00000008,
+		AVX512F =    0x00000010,
+		AVX512BW =   0x00000020,
+		AESNI =      0x00000040,
+		PCLMULQDQ =  0x00000080,
+		VAES =       0x00000100,
+		VPCLMULQDQ = 0x00000200,
+		SHA =        0x00000400,
+
+		// ARM and AArch64
+		NEON =       0x00010000,
+		ARM_AES =    0x00020000,
+		ARM_PMULL =  0x00040000,
+		ARM_SHA2 =   0x00080000,
+		ARM_SHA512 = 0x00100000
+	};
+
+	/**
+	 * @return Bit mask of Feature values supported by this CPU
+	 */
+	static uint32_t features()
+		throw();
+
+	/**
+	 * @param f One or more Feature values OR'd together
+	 * @return True if all are supported
+	 */
+	static inline bool has(const uint32_t f) throw() { return ((features() & f) == f); }
+
+	/**
+	 * @return Space-separated names of supported features, e.g. "sse2 ssse3 avx2"
+	 */
+	static const char *featureNames()
+		throw();
+};
+
+} // namespace ZeroTier
+
+#endif
@@ -22,10 +22,11 @@
 #include "Topology.hpp"
 #include "Switch.hpp"
 #include "Network.hpp"
+#include "SignatureCache.hpp"
 
 namespace ZeroTier {
 
-int Capability::verify(const RuntimeEnvironment *RR) const
+int Capability::verify(const RuntimeEnvironment *RR,SignatureBatch *batch) const
 {
 	try {
 		// There must be at least one entry, and sanity check for bad chain max length
@@ -35,21 +36,25 @@ int Capability::verify(const RuntimeEnvironment *RR) const
 		// Validate all entries in chain of custody
 		Buffer<(sizeof(Capability) * 2)> tmp;
 		this->serialize(tmp,true);
+		bool queued = false;
 		for(unsigned int c=0;c<_maxCustodyChainLength;++c) {
 			if (c == 0) {
 				if ((!_custody[c].to)||(!_custody[c].from)||(_custody[c].from != Network::controllerFor(_nwid)))
 					return -1; // the first entry must be present and from the network's controller
 			} else {
 				if (!_custody[c].to)
-					return 0; // all previous entries were valid, so we are valid
+					return (queued ? 2 : 0); // all previous entries were valid (or are queued), so we are valid
 				else if ((!_custody[c].from)||(_custody[c].from != _custody[c-1].to))
 					return -1; // otherwise if we have another entry it must be from the previous holder in the chain
 			}
 
 			const Identity id(RR->topology->getIdentity(_custody[c].from));
 			if (id) {
-				if (!id.verify(tmp.data(),tmp.size(),_custody[c].signature))
-					return -1;
+				switch(RR->sigCache->verify(id.publicKey(),tmp.data(),tmp.size(),_custody[c].signature,batch)) {
+					case 0: break;
+					case 2: queued = true; break;
+					default: return -1;
+				}
 			} else {
 				RR->sw->requestWhois(_custody[c].from);
 				return 1;
@@ -57,7 +62,7 @@ int Capability::verify(const RuntimeEnvironment *RR) const
 		}
 
 		// We reached max custody chain length and everything was valid
-		return 0;
+		return (queued ? 2 : 0);
 	} catch ( ... ) {}
 	return -1;
 }
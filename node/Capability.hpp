@@ -34,6 +34,7 @@
 namespace ZeroTier {
 
 class RuntimeEnvironment;
+class SignatureBatch;
 
 /**
  * A set of grouped and signed network flow rules
@@ -159,9 +160,10 @@ public:
 	 * Verify this capability's chain of custody and signatures
 	 *
 	 * @param RR Runtime environment to provide for peer lookup, etc.
-	 * @return 0 == OK, 1 == waiting for WHOIS, -1 == BAD signature or chain
+	 * @param batch If non-NULL, queue the signature check here instead of verifying immediately
+	 * @return 0 == OK, 1 == waiting for WHOIS, -1 == BAD signature or chain, 2 == queued in batch
 	 */
-	int verify(const RuntimeEnvironment *RR) const;
+	int verify(const RuntimeEnvironment *RR,SignatureBatch *batch = (SignatureBatch *)0) const;
 
 	template<unsigned int C>
 	static inline void serializeRules(Buffer<C> &b,const ZT_VirtualNetworkRule *rules,unsigned int ruleCount)
@@ -21,6 +21,7 @@
 #include "Topology.hpp"
 #include "Switch.hpp"
 #include "Network.hpp"
+#include "SignatureCache.hpp"
 
 namespace ZeroTier {
 
@@ -207,7 +208,7 @@ bool CertificateOfMembership::sign(const Identity &with)
 	}
 }
 
-int CertificateOfMembership::verify(const RuntimeEnvironment *RR) const
+int CertificateOfMembership::verify(const RuntimeEnvironment *RR,SignatureBatch *batch) const
 {
 	if ((!_signedBy)||(_signedBy != Network::controllerFor(networkId()))||(_qualifierCount > ZT_NETWORK_COM_MAX_QUALIFIERS))
 		return -1;
@@ -225,7 +226,7 @@ int CertificateOfMembership::verify(const RuntimeEnvironment *RR) const
 		buf[ptr++] = Utils::hton(_qualifiers[i].value);
 		buf[ptr++] = Utils::hton(_qualifiers[i].maxDelta);
 	}
-	return (id.verify(buf,ptr * sizeof(uint64_t),_signature) ? 0 : -1);
+	return RR->sigCache->verify(id.publicKey(),buf,ptr * sizeof(uint64_t),_signature,batch);
 }
 
 } // namespace ZeroTier
@@ -41,6 +41,7 @@
 namespace ZeroTier {
 
 class RuntimeEnvironment;
+class SignatureBatch;
 
 /**
  * Certificate of network membership
@@ -250,9 +251,10 @@ public:
 	 * Verify this COM and its signature
 	 *
 	 * @param RR Runtime environment for looking up peers
-	 * @return 0 == OK, 1 == waiting for WHOIS, -1 == BAD signature or credential
+	 * @param batch If non-NULL, queue the signature check here instead of verifying immediately
+	 * @return 0 == OK, 1 == waiting for WHOIS, -1 == BAD signature or credential, 2 == queued in batch
 	 */
-	int verify(const RuntimeEnvironment *RR) const;
+	int verify(const RuntimeEnvironment *RR,SignatureBatch *batch = (SignatureBatch *)0) const;
 
 	/**
 	 * @return True if signed
@@ -41,6 +41,7 @@
 namespace ZeroTier {
 
 class RuntimeEnvironment;
+class SignatureBatch;
 
 /**
  * Certificate indicating ownership of a network identifier
@@ -137,9 +138,10 @@ public:
 
 	/**
 	 * @param RR Runtime environment to allow identity lookup for signedBy
-	 * @return 0 == OK, 1 == waiting for WHOIS, -1 == BAD signature
+	 * @param batch If non-NULL, queue the signature check here instead of verifying immediately
+	 * @return 0 == OK, 1 == waiting for WHOIS, -1 == BAD signature, 2 == queued in batch
 	 */
-	int verify(const RuntimeEnvironment *RR) const;
+	int verify(const RuntimeEnvironment *RR,SignatureBatch *batch = (SignatureBatch *)0) const;
 
 	template<unsigned int C>
 	inline void serialize(Buffer<C> &b,const bool forSign = false) const
@@ -162,13 +162,39 @@
 #define ZT_MAX_PACKET_FRAGMENTS 4
 
 /**
- * Size of RX queue
+ * Default size of RX queue (fragment reassembly and packets awaiting WHOIS)
  *
- * This is about 2mb, and can be decreased for small devices. A queue smaller
- * than about 4 is probably going to cause a lot of lost packets.
+ * Each entry is about 23kb, so this is about 1.5mb. It can be changed at
+ * runtime with ZT_Node_setRxQueueSize(), e.g. raised for relays that carry
+ * many fragmented packets from many peers at once.
  */
 #define ZT_RX_QUEUE_SIZE 64
 
+/**
+ * Minimum RX queue size; a queue smaller than about 4 is probably going to cause a lot of lost packets
+ */
+#define ZT_RX_QUEUE_MIN_SIZE 4
+
+/**
+ * Maximum RX queue size (about 95mb)
+ */
+#define ZT_RX_QUEUE_MAX_SIZE 4096
+
+/**
+ * Share of RX queue (1/N) a physical path keeps when the queue is full
+ *
+ * When the queue is full, a new packet from a path holding more than this
+ * recycles that path's own oldest entry instead of the oldest overall. This
+ * keeps one busy or hostile source from pushing everyone else's fragments
+ * out of the queue, while leaving free entries usable by anyone.
+ */
+#define ZT_RX_QUEUE_PER_SOURCE_DIVISOR 4
+
+/**
+ * Entries a single physical path keeps when the RX queue is full regardless of queue size (if queue is at least this big)
+ */
+#define ZT_RX_QUEUE_PER_SOURCE_MIN 8
+
 /**
  * RX queue entries older than this do not "exist"
  */
@@ -214,6 +240,27 @@
  */
 #define ZT_RECEIVE_QUEUE_TIMEOUT (ZT_WHOIS_RETRY_DELAY * (ZT_MAX_WHOIS_RETRIES + 1))
 
+/**
+ * Maximum HELLOs from unknown peers waiting for asynchronous identity validation
+ *
+ * HELLOs that arrive while this is full are dropped. Their senders will
+ * retry. Each entry holds one packet, so this costs about 6kb per entry.
+ */
+#define ZT_IDENTITY_VALIDATION_QUEUE_SIZE 32
+
+/**
+ * Maximum HELLOs from one physical address waiting for identity validation
+ *
+ * HELLOs are queued before they can be authenticated, so this keeps one
+ * source sending HELLOs for made-up addresses from filling the queue.
+ */
+#define ZT_IDENTITY_VALIDATION_QUEUE_MAX_PER_PATH 2
+
+/**
+ * HELLOs that have waited this long for identity validation are dropped
+ */
+#define ZT_IDENTITY_VALIDATION_QUEUE_EXPIRE 10000
+
 /**
  * Maximum latency to allow for OK(HELLO) before packet is discarded
  */
@@ -420,6 +467,18 @@
 #endif
 #endif
 
+/**
+ * Number of successfully verified signatures remembered by SignatureCache
+ *
+ * Each entry is 32 bytes. This is split evenly between stripes.
+ */
+#define ZT_SIGNATURE_CACHE_SIZE 8192
+
+/**
+ * Number of independently locked stripes in SignatureCache (must be a power of two)
+ */
+#define ZT_SIGNATURE_CACHE_STRIPES 16
+
 /**
  * How long is a path or peer considered to have a trust relationship with us (for e.g. relay policy) since last trusted established packet?
  */
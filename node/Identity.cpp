@@ -31,7 +31,6 @@
 // parameters of the hashcash hashing/searching algorithm.
 
 #define ZT_IDENTITY_GEN_HASHCASH_FIRST_BYTE_LESS_THAN 17
-#define ZT_IDENTITY_GEN_MEMORY 2097152
 
 namespace ZeroTier {
 
@@ -89,12 +88,18 @@ struct _Identity_generate_cond
 
 void Identity::generate()
 {
-	unsigned char digest[64];
 	char *genmem = new char[ZT_IDENTITY_GEN_MEMORY];
+	generate(genmem);
+	delete [] genmem;
+}
+
+void Identity::generate(void *genmem)
+{
+	unsigned char digest[64];
 
 	C25519::Pair kp;
 	do {
-		kp = C25519::generateSatisfying(_Identity_generate_cond(digest,genmem));
+		kp = C25519::generateSatisfying(_Identity_generate_cond(digest,(char *)genmem));
 		_address.setTo(digest + 59,ZT_ADDRESS_LENGTH); // last 5 bytes are address
 	} while (_address.isReserved());
 
@@ -102,8 +107,6 @@ void Identity::generate()
 	if (!_privateKey)
 		_privateKey = new C25519::Private();
 	*_privateKey = kp.priv;
-
-	delete [] genmem;
 }
 
 bool Identity::locallyValidate() const
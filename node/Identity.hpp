@@ -31,6 +31,13 @@
 #include "Buffer.hpp"
 #include "SHA512.hpp"
 
+/**
+ * Memory used by the memory-hard hash function that binds addresses to keys
+ *
+ * This can't be changed without a new identity type.
+ */
+#define ZT_IDENTITY_GEN_MEMORY 2097152
+
 namespace ZeroTier {
 
 /**
@@ -108,6 +115,16 @@ public:
 	 */
 	void generate();
 
+	/**
+	 * Generate a new identity using caller-supplied scratch memory
+	 *
+	 * Callers generating many identities, possibly on several threads at
+	 * once, can use this to allocate one scratch buffer per thread.
+	 *
+	 * @param genmem Scratch memory of ZT_IDENTITY_GEN_MEMORY bytes
+	 */
+	void generate(void *genmem);
+
 	/**
 	 * Check the validity of this identity's pairing of key to address
 	 *
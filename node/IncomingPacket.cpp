@@ -20,6 +20,8 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include <vector>
+
 #include "../version.h"
 #include "../include/ZeroTierOne.h"
 
@@ -41,10 +43,11 @@
 #include "Capability.hpp"
 #include "Tag.hpp"
 #include "Revocation.hpp"
+#include "SignatureBatch.hpp"
 
 namespace ZeroTier {
 
-bool IncomingPacket::tryDecode(const RuntimeEnvironment *RR)
+bool IncomingPacket::tryDecode(const RuntimeEnvironment *RR,SharedPtr<Peer> *peerCache)
 {
 	const Address sourceAddress(source());
 
@@ -68,7 +71,14 @@ bool IncomingPacket::tryDecode(const RuntimeEnvironment *RR)
 			return _doHELLO(RR,false);
 		}
 
-		const SharedPtr<Peer> peer(RR->topology->getPeer(sourceAddress));
+		SharedPtr<Peer> peer;
+		if ((peerCache)&&(*peerCache)&&((*peerCache)->address() == sourceAddress)) {
+			peer = *peerCache;
+		} else {
+			peer = RR->topology->getPeer(sourceAddress);
+			if ((peerCache)&&(peer))
+				*peerCache = peer;
+		}
 		if (peer) {
 			if (!trusted) {
 				if (!dearmor(peer->key())) {
@@ -279,6 +289,29 @@ bool IncomingPacket::_doHELLO(const RuntimeEnvironment *RR,const bool alreadyAut
 			if (!RR->node->rateGateIdentityVerification(now,_path->address()))
 				return true;
 
+			// If the host has identity validation workers, leave the slow part to
+			// them so a burst of new peers doesn't hold up everyone else's packets
+			if (RR->node->asyncIdentityValidation()) {
+				// Anyone can send these, so don't let junk take a queue slot: HELLOs are
+				// never encrypted, never carry a secret key, and whatever follows the
+				// identity in the clear must parse
+				if ((cipher() != ZT_PROTO_CIPHER_SUITE__C25519_POLY1305_NONE)||(id.hasPrivate())) {
+					TRACE("dropped HELLO from %s(%s): malformed",id.address().toString().c_str(),_path->address().toString().c_str());
+					return true;
+				}
+				if (ptr < size()) {
+					InetAddress externalSurfaceAddress;
+					externalSurfaceAddress.deserialize(*this,ptr); // throws if invalid
+				}
+
+				if (RR->sw->queueIdentityValidation(*this,now)) {
+					RR->node->requestIdentityValidation();
+				} else {
+					TRACE("dropped HELLO from %s(%s): identity validation queue full or too many from this path",id.address().toString().c_str(),_path->address().toString().c_str());
+				}
+				return true;
+			}
+
 			// Check packet integrity and MAC (this is faster than locallyValidate() so do it first to filter out total crap)
 			SharedPtr<Peer> newPeer(new Peer(RR,RR->identity,id));
 			if (!dearmor(newPeer->key())) {
@@ -316,6 +349,7 @@ bool IncomingPacket::_doHELLO(const RuntimeEnvironment *RR,const bool alreadyAut
 		}
 
 		std::vector< std::pair<uint64_t,uint64_t> > moonIdsAndTimestamps;
+		unsigned int helloFlags = 0;
 		if (ptr < size()) {
 			// Remainder of packet, if present, is encrypted
 			cryptField(peer->key(),ptr,size() - ptr);
@@ -338,6 +372,10 @@ bool IncomingPacket::_doHELLO(const RuntimeEnvironment *RR,const bool alreadyAut
 					ptr += cor.deserialize(*this,ptr);
 				} else ptr += 2;
 			}
+
+			// Flags, e.g. AES-GCM support (protocol 10+)
+			if ((protoVersion >= 10)&&(ptr < size()))
+				helloFlags = (uint8_t)(*this)[ptr++];
 		}
 
 		// Send OK(HELLO) with an echo of the packet's timestamp and some of the same
@@ -407,10 +445,12 @@ bool IncomingPacket::_doHELLO(const RuntimeEnvironment *RR,const bool alreadyAut
 		RR->topology->appendCertificateOfRepresentation(outp);
 		outp.setAt(corSizeAt,(uint16_t)(outp.size() - (corSizeAt + 2)));
 
+		outp.append((uint8_t)((AES::hardware()) ? ZT_PROTO_HELLO_FLAG_AES_GCM : 0));
+
 		outp.armor(peer->key(),true,_path->nextOutgoingCounter());
 		_path->send(RR,outp.data(),outp.size(),now);
 
-		peer->setRemoteVersion(protoVersion,vMajor,vMinor,vRevision); // important for this to go first so received() knows the version
+		peer->setRemoteVersion(protoVersion,vMajor,vMinor,vRevision,helloFlags); // important for this to go first so received() knows the version
 		peer->received(_path,hops(),pid,Packet::VERB_HELLO,0,Packet::VERB_NOP,false);
 	} catch ( ... ) {
 		TRACE("dropped HELLO from %s(%s): unexpected exception",source().toString().c_str(),_path->address().toString().c_str());
@@ -418,6 +458,37 @@ bool IncomingPacket::_doHELLO(const RuntimeEnvironment *RR,const bool alreadyAut
 	return true;
 }
 
+SharedPtr<Peer> IncomingPacket::validateHELLO(const RuntimeEnvironment *RR)
+{
+	try {
+		Identity id;
+		id.deserialize(*this,ZT_PROTO_VERB_HELLO_IDX_IDENTITY);
+
+		if (RR->topology->getPeer(id.address())) {
+			// Learned some other way while this was waiting
+			_doHELLO(RR,false);
+			return SharedPtr<Peer>();
+		}
+
+		SharedPtr<Peer> newPeer(new Peer(RR,RR->identity,id));
+		if (!dearmor(newPeer->key())) {
+			TRACE("rejected HELLO from %s(%s): packet failed authentication",id.address().toString().c_str(),_path->address().toString().c_str());
+			return SharedPtr<Peer>();
+		}
+		if (!id.locallyValidate()) {
+			TRACE("dropped HELLO from %s(%s): identity invalid",id.address().toString().c_str(),_path->address().toString().c_str());
+			return SharedPtr<Peer>();
+		}
+
+		const SharedPtr<Peer> peer(RR->topology->addPeer(newPeer));
+		_doHELLO(RR,true);
+		return peer;
+	} catch ( ... ) {
+		TRACE("dropped HELLO from %s(%s): unexpected exception",source().toString().c_str(),_path->address().toString().c_str());
+	}
+	return SharedPtr<Peer>();
+}
+
 bool IncomingPacket::_doOK(const RuntimeEnvironment *RR,const SharedPtr<Peer> &peer)
 {
 	try {
@@ -479,6 +550,11 @@ bool IncomingPacket::_doOK(const RuntimeEnvironment *RR,const SharedPtr<Peer> &p
 					} else ptr += 2;
 				}
 
+				// Flags, e.g. AES-GCM support (protocol 10+)
+				unsigned int helloFlags = 0;
+				if ((vProto >= 10)&&(ptr < size()))
+					helloFlags = (uint8_t)(*this)[ptr++];
+
 #ifdef ZT_TRACE
 				const std::string tmp1(source().toString());
 				const std::string tmp2(_path->address().toString());
@@ -487,7 +563,7 @@ bool IncomingPacket::_doOK(const RuntimeEnvironment *RR,const SharedPtr<Peer> &p
 
 				if (!hops())
 					peer->addDirectLatencyMeasurment((unsigned int)latency);
-				peer->setRemoteVersion(vProto,vMajor,vMinor,vRevision);
+				peer->setRemoteVersion(vProto,vMajor,vMinor,vRevision,helloFlags);
 
 				if ((externalSurfaceAddress)&&(hops() == 0))
 					RR->sa->iam(peer->address(),_path->localAddress(),_path->address(),externalSurfaceAddress,RR->topology->isUpstream(peer->identity()),RR->node->now());
@@ -826,6 +902,68 @@ bool IncomingPacket::_doMULTICAST_LIKE(const RuntimeEnvironment *RR,const Shared
 	return true;
 }
 
+// Credentials in NETWORK_CREDENTIALS are added in two passes: the first
+// queues their signatures in a SignatureBatch, and after the batch is checked
+// the second adds the ones that were waiting on it. Revocations need the
+// sender's address and a COM for a network we're not in goes to Multicaster.
+static inline Membership::AddCredentialResult _addNetworkCredential(const RuntimeEnvironment *RR,const Address &from,const CertificateOfMembership &com,SignatureBatch *batch)
+{
+	const SharedPtr<Network> network(RR->node->network(com.networkId()));
+	if (network)
+		return network->addCredential(com,batch);
+	RR->mc->addCredential(com,false);
+	return Membership::ADD_REJECTED;
+}
+static inline Membership::AddCredentialResult _addNetworkCredential(const RuntimeEnvironment *RR,const Address &from,const Revocation &rev,SignatureBatch *batch)
+{
+	const SharedPtr<Network> network(RR->node->network(rev.networkId()));
+	return ((network) ? network->addCredential(from,rev,batch) : Membership::ADD_REJECTED);
+}
+template<typename C>
+static inline Membership::AddCredentialResult _addNetworkCredential(const RuntimeEnvironment *RR,const Address &from,const C &cred,SignatureBatch *batch)
+{
+	const SharedPtr<Network> network(RR->node->network(cred.networkId()));
+	return ((network) ? network->addCredential(cred,batch) : Membership::ADD_REJECTED);
+}
+
+// First pass: returns false if a WHOIS is needed, in which case later credentials are not looked at
+template<typename C>
+static inline bool _queueNetworkCredentials(const RuntimeEnvironment *RR,const Address &from,const std::vector<C> &creds,SignatureBatch &batch,std::vector<const C *> &deferred,bool &trustEstablished)
+{
+	for(typename std::vector<C>::const_iterator c(creds.begin());c!=creds.end();++c) {
+		switch(_addNetworkCredential(RR,from,*c,&batch)) {
+			case Membership::ADD_REJECTED:
+				break;
+			case Membership::ADD_ACCEPTED_NEW:
+			case Membership::ADD_ACCEPTED_REDUNDANT:
+				trustEstablished = true;
+				break;
+			case Membership::ADD_DEFERRED_FOR_WHOIS:
+				return false;
+			case Membership::ADD_DEFERRED_FOR_BATCH_VERIFY:
+				deferred.push_back(&(*c));
+				break;
+		}
+	}
+	return true;
+}
+
+// Second pass, after SignatureBatch::verify(): signature results now come from the batch
+template<typename C>
+static inline void _addDeferredNetworkCredentials(const RuntimeEnvironment *RR,const Address &from,const std::vector<const C *> &deferred,SignatureBatch &batch,bool &trustEstablished)
+{
+	for(typename std::vector<const C *>::const_iterator c(deferred.begin());c!=deferred.end();++c) {
+		switch(_addNetworkCredential(RR,from,**c,&batch)) {
+			case Membership::ADD_ACCEPTED_NEW:
+			case Membership::ADD_ACCEPTED_REDUNDANT:
+				trustEstablished = true;
+				break;
+			default:
+				break;
+		}
+	}
+}
+
 bool IncomingPacket::_doNETWORK_CREDENTIALS(const RuntimeEnvironment *RR,const SharedPtr<Peer> &peer)
 {
 	try {
@@ -834,113 +972,83 @@ bool IncomingPacket::_doNETWORK_CREDENTIALS(const RuntimeEnvironment *RR,const S
 			return true;
 		}
 
-		CertificateOfMembership com;
-		Capability cap;
-		Tag tag;
-		Revocation revocation;
-		CertificateOfOwnership coo;
-		bool trustEstablished = false;
+		std::vector<CertificateOfMembership> coms;
+		std::vector<Capability> caps;
+		std::vector<Tag> tags;
+		std::vector<Revocation> revocations;
+		std::vector<CertificateOfOwnership> coos;
+		bool complete = false;
 
 		unsigned int p = ZT_PACKET_IDX_PAYLOAD;
 		while ((p < size())&&((*this)[p] != 0)) {
-			p += com.deserialize(*this,p);
-			if (com) {
-				const SharedPtr<Network> network(RR->node->network(com.networkId()));
-				if (network) {
-					switch (network->addCredential(com)) {
-						case Membership::ADD_REJECTED:
-							break;
-						case Membership::ADD_ACCEPTED_NEW:
-						case Membership::ADD_ACCEPTED_REDUNDANT:
-							trustEstablished = true;
-							break;
-						case Membership::ADD_DEFERRED_FOR_WHOIS:
-							return false;
-					}
-				} else RR->mc->addCredential(com,false);
-			}
+			coms.push_back(CertificateOfMembership());
+			p += coms.back().deserialize(*this,p);
+			if (!coms.back())
+				coms.pop_back();
 		}
 		++p; // skip trailing 0 after COMs if present
 
 		if (p < size()) { // older ZeroTier versions do not send capabilities, tags, or revocations
 			const unsigned int numCapabilities = at<uint16_t>(p); p += 2;
 			for(unsigned int i=0;i<numCapabilities;++i) {
-				p += cap.deserialize(*this,p);
-				const SharedPtr<Network> network(RR->node->network(cap.networkId()));
-				if (network) {
-					switch (network->addCredential(cap)) {
-						case Membership::ADD_REJECTED:
-							break;
-						case Membership::ADD_ACCEPTED_NEW:
-						case Membership::ADD_ACCEPTED_REDUNDANT:
-							trustEstablished = true;
-							break;
-						case Membership::ADD_DEFERRED_FOR_WHOIS:
-							return false;
-					}
-				}
+				caps.push_back(Capability());
+				p += caps.back().deserialize(*this,p);
 			}
 
-			if (p >= size()) return true;
-
-			const unsigned int numTags = at<uint16_t>(p); p += 2;
-			for(unsigned int i=0;i<numTags;++i) {
-				p += tag.deserialize(*this,p);
-				const SharedPtr<Network> network(RR->node->network(tag.networkId()));
-				if (network) {
-					switch (network->addCredential(tag)) {
-						case Membership::ADD_REJECTED:
-							break;
-						case Membership::ADD_ACCEPTED_NEW:
-						case Membership::ADD_ACCEPTED_REDUNDANT:
-							trustEstablished = true;
-							break;
-						case Membership::ADD_DEFERRED_FOR_WHOIS:
-							return false;
-					}
+			if (p < size()) {
+				const unsigned int numTags = at<uint16_t>(p); p += 2;
+				for(unsigned int i=0;i<numTags;++i) {
+					tags.push_back(Tag());
+					p += tags.back().deserialize(*this,p);
 				}
-			}
 
-			if (p >= size()) return true;
-
-			const unsigned int numRevocations = at<uint16_t>(p); p += 2;
-			for(unsigned int i=0;i<numRevocations;++i) {
-				p += revocation.deserialize(*this,p);
-				const SharedPtr<Network> network(RR->node->network(revocation.networkId()));
-				if (network) {
-					switch(network->addCredential(peer->address(),revocation)) {
-						case Membership::ADD_REJECTED:
-							break;
-						case Membership::ADD_ACCEPTED_NEW:
-						case Membership::ADD_ACCEPTED_REDUNDANT:
-							trustEstablished = true;
-							break;
-						case Membership::ADD_DEFERRED_FOR_WHOIS:
-							return false;
+				if (p < size()) {
+					const unsigned int numRevocations = at<uint16_t>(p); p += 2;
+					for(unsigned int i=0;i<numRevocations;++i) {
+						revocations.push_back(Revocation());
+						p += revocations.back().deserialize(*this,p);
 					}
-				}
-			}
-
-			if (p >= size()) return true;
 
-			const unsigned int numCoos = at<uint16_t>(p); p += 2;
-			for(unsigned int i=0;i<numCoos;++i) {
-				p += coo.deserialize(*this,p);
-				const SharedPtr<Network> network(RR->node->network(coo.networkId()));
-				if (network) {
-					switch(network->addCredential(coo)) {
-						case Membership::ADD_REJECTED:
-							break;
-						case Membership::ADD_ACCEPTED_NEW:
-						case Membership::ADD_ACCEPTED_REDUNDANT:
-							trustEstablished = true;
-							break;
-						case Membership::ADD_DEFERRED_FOR_WHOIS:
-							return false;
+					if (p < size()) {
+						const unsigned int numCoos = at<uint16_t>(p); p += 2;
+						for(unsigned int i=0;i<numCoos;++i) {
+							coos.push_back(CertificateOfOwnership());
+							p += coos.back().deserialize(*this,p);
+						}
+						complete = true;
 					}
 				}
 			}
-		}
+		} else complete = true;
+
+		SignatureBatch sigs;
+		std::vector<const CertificateOfMembership *> deferredComs;
+		std::vector<const Capability *> deferredCaps;
+		std::vector<const Tag *> deferredTags;
+		std::vector<const Revocation *> deferredRevocations;
+		std::vector<const CertificateOfOwnership *> deferredCoos;
+		bool trustEstablished = false;
+
+		const Address from(peer->address());
+		const bool noWhois = (
+			(_queueNetworkCredentials(RR,from,coms,sigs,deferredComs,trustEstablished))&&
+			(_queueNetworkCredentials(RR,from,caps,sigs,deferredCaps,trustEstablished))&&
+			(_queueNetworkCredentials(RR,from,tags,sigs,deferredTags,trustEstablished))&&
+			(_queueNetworkCredentials(RR,from,revocations,sigs,deferredRevocations,trustEstablished))&&
+			(_queueNetworkCredentials(RR,from,coos,sigs,deferredCoos,trustEstablished)) );
+
+		sigs.verify();
+
+		_addDeferredNetworkCredentials(RR,from,deferredComs,sigs,trustEstablished);
+		_addDeferredNetworkCredentials(RR,from,deferredCaps,sigs,trustEstablished);
+		_addDeferredNetworkCredentials(RR,from,deferredTags,sigs,trustEstablished);
+		_addDeferredNetworkCredentials(RR,from,deferredRevocations,sigs,trustEstablished);
+		_addDeferredNetworkCredentials(RR,from,deferredCoos,sigs,trustEstablished);
+
+		if (!noWhois)
+			return false; // credentials before the one we need a WHOIS for are added now, and again (redundantly) when this is retried
+		if (!complete)
+			return true;
 
 		peer->received(_path,hops(),packetId(),Packet::VERB_NETWORK_CREDENTIALS,0,Packet::VERB_NOP,trustEstablished);
 	} catch (std::exception &exc) {
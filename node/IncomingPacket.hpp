@@ -102,15 +102,33 @@ public:
 	 * may no longer be valid.
 	 *
 	 * @param RR Runtime environment
+	 * @param peerCache If non-NULL, a peer to use if its address matches source (updated on lookup)
 	 * @return True if decoding and processing is complete, false if caller should try again
 	 */
-	bool tryDecode(const RuntimeEnvironment *RR);
+	bool tryDecode(const RuntimeEnvironment *RR,SharedPtr<Peer> *peerCache = (SharedPtr<Peer> *)0);
+
+	/**
+	 * Finish a HELLO from an unknown peer that was parked for identity validation
+	 *
+	 * This does the slow part of learning a new peer, key agreement and
+	 * Identity::locallyValidate(), and then handles the HELLO as one from a
+	 * known peer. Like tryDecode() it must only be called once.
+	 *
+	 * @param RR Runtime environment
+	 * @return New peer or NULL if none was learned
+	 */
+	SharedPtr<Peer> validateHELLO(const RuntimeEnvironment *RR);
 
 	/**
 	 * @return Time of packet receipt / start of decode
 	 */
 	inline uint64_t receiveTime() const throw() { return _receiveTime; }
 
+	/**
+	 * @return Physical path this packet arrived on
+	 */
+	inline const SharedPtr<Path> &path() const throw() { return _path; }
+
 private:
 	// These are called internally to handle packet contents once it has
 	// been authenticated, decrypted, decompressed, and classified.
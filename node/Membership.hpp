@@ -35,6 +35,7 @@ namespace ZeroTier {
 
 class RuntimeEnvironment;
 class Network;
+class SignatureBatch;
 
 /**
  * A container for certificates of membership and other network credentials
@@ -80,7 +81,8 @@ public:
 		ADD_REJECTED,
 		ADD_ACCEPTED_NEW,
 		ADD_ACCEPTED_REDUNDANT,
-		ADD_DEFERRED_FOR_WHOIS
+		ADD_DEFERRED_FOR_WHOIS,
+		ADD_DEFERRED_FOR_BATCH_VERIFY
 	};
 
 	/**
@@ -225,28 +227,33 @@ public:
 
 	/**
 	 * Validate and add a credential if signature is okay and it's otherwise good
+	 *
+	 * If batch is non-NULL the signature check is queued there and this
+	 * returns ADD_DEFERRED_FOR_BATCH_VERIFY. Call it again with the same
+	 * batch after SignatureBatch::verify() to actually add the credential.
+	 * The same applies to the other addCredential() methods.
 	 */
-	AddCredentialResult addCredential(const RuntimeEnvironment *RR,const NetworkConfig &nconf,const CertificateOfMembership &com);
+	AddCredentialResult addCredential(const RuntimeEnvironment *RR,const NetworkConfig &nconf,const CertificateOfMembership &com,SignatureBatch *batch = (SignatureBatch *)0);
 
 	/**
 	 * Validate and add a credential if signature is okay and it's otherwise good
 	 */
-	AddCredentialResult addCredential(const RuntimeEnvironment *RR,const NetworkConfig &nconf,const Tag &tag);
+	AddCredentialResult addCredential(const RuntimeEnvironment *RR,const NetworkConfig &nconf,const Tag &tag,SignatureBatch *batch = (SignatureBatch *)0);
 
 	/**
 	 * Validate and add a credential if signature is okay and it's otherwise good
 	 */
-	AddCredentialResult addCredential(const RuntimeEnvironment *RR,const NetworkConfig &nconf,const Capability &cap);
+	AddCredentialResult addCredential(const RuntimeEnvironment *RR,const NetworkConfig &nconf,const Capability &cap,SignatureBatch *batch = (SignatureBatch *)0);
 
 	/**
 	 * Validate and add a credential if signature is okay and it's otherwise good
 	 */
-	AddCredentialResult addCredential(const RuntimeEnvironment *RR,const NetworkConfig &nconf,const Revocation &rev);
+	AddCredentialResult addCredential(const RuntimeEnvironment *RR,const NetworkConfig &nconf,const Revocation &rev,SignatureBatch *batch = (SignatureBatch *)0);
 
 	/**
 	 * Validate and add a credential if signature is okay and it's otherwise good
 	 */
-	AddCredentialResult addCredential(const RuntimeEnvironment *RR,const NetworkConfig &nconf,const CertificateOfOwnership &coo);
+	AddCredentialResult addCredential(const RuntimeEnvironment *RR,const NetworkConfig &nconf,const CertificateOfOwnership &coo,SignatureBatch *batch = (SignatureBatch *)0);
 
 private:
 	_RemoteCredential<Tag> *_newTag(const uint64_t id);
@@ -1386,14 +1386,14 @@ void Network::learnBridgedMulticastGroup(const MulticastGroup &mg,uint64_t now)
 		_sendUpdatesToMembers(&mg);
 }
 
-Membership::AddCredentialResult Network::addCredential(const CertificateOfMembership &com)
+Membership::AddCredentialResult Network::addCredential(const CertificateOfMembership &com,SignatureBatch *batch)
 {
 	if (com.networkId() != _id)
 		return Membership::ADD_REJECTED;
 	const Address a(com.issuedTo());
 	Mutex::Lock _l(_lock);
 	Membership &m = _membership(a);
-	const Membership::AddCredentialResult result = m.addCredential(RR,_config,com);
+	const Membership::AddCredentialResult result = m.addCredential(RR,_config,com,batch);
 	if ((result == Membership::ADD_ACCEPTED_NEW)||(result == Membership::ADD_ACCEPTED_REDUNDANT)) {
 		m.pushCredentials(RR,RR->node->now(),a,_config,-1,false);
 		RR->mc->addCredential(com,true);
@@ -1401,7 +1401,7 @@ Membership::AddCredentialResult Network::addCredential(const CertificateOfMember
 	return result;
 }
 
-Membership::AddCredentialResult Network::addCredential(const Address &sentFrom,const Revocation &rev)
+Membership::AddCredentialResult Network::addCredential(const Address &sentFrom,const Revocation &rev,SignatureBatch *batch)
 {
 	if (rev.networkId() != _id)
 		return Membership::ADD_REJECTED;
@@ -1409,7 +1409,7 @@ Membership::AddCredentialResult Network::addCredential(const Address &sentFrom,c
 	Mutex::Lock _l(_lock);
 	Membership &m = _membership(rev.target());
 
-	const Membership::AddCredentialResult result = m.addCredential(RR,_config,rev);
+	const Membership::AddCredentialResult result = m.addCredential(RR,_config,rev,batch);
 
 	if ((result == Membership::ADD_ACCEPTED_NEW)&&(rev.fastPropagate())) {
 		Address *a = (Address *)0;
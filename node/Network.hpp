@@ -271,45 +271,47 @@ public:
 
 	/**
 	 * Validate a credential and learn it if it passes certificate and other checks
+	 *
+	 * @param batch If non-NULL, queue the signature check (see Membership::addCredential())
 	 */
-	Membership::AddCredentialResult addCredential(const CertificateOfMembership &com);
+	Membership::AddCredentialResult addCredential(const CertificateOfMembership &com,SignatureBatch *batch = (SignatureBatch *)0);
 
 	/**
 	 * Validate a credential and learn it if it passes certificate and other checks
 	 */
-	inline Membership::AddCredentialResult addCredential(const Capability &cap)
+	inline Membership::AddCredentialResult addCredential(const Capability &cap,SignatureBatch *batch = (SignatureBatch *)0)
 	{
 		if (cap.networkId() != _id)
 			return Membership::ADD_REJECTED;
 		Mutex::Lock _l(_lock);
-		return _membership(cap.issuedTo()).addCredential(RR,_config,cap);
+		return _membership(cap.issuedTo()).addCredential(RR,_config,cap,batch);
 	}
 
 	/**
 	 * Validate a credential and learn it if it passes certificate and other checks
 	 */
-	inline Membership::AddCredentialResult addCredential(const Tag &tag)
+	inline Membership::AddCredentialResult addCredential(const Tag &tag,SignatureBatch *batch = (SignatureBatch *)0)
 	{
 		if (tag.networkId() != _id)
 			return Membership::ADD_REJECTED;
 		Mutex::Lock _l(_lock);
-		return _membership(tag.issuedTo()).addCredential(RR,_config,tag);
+		return _membership(tag.issuedTo()).addCredential(RR,_config,tag,batch);
 	}
 
 	/**
 	 * Validate a credential and learn it if it passes certificate and other checks
 	 */
-	Membership::AddCredentialResult addCredential(const Address &sentFrom,const Revocation &rev);
+	Membership::AddCredentialResult addCredential(const Address &sentFrom,const Revocation &rev,SignatureBatch *batch = (SignatureBatch *)0);
 
 	/**
 	 * Validate a credential and learn it if it passes certificate and other checks
 	 */
-	inline Membership::AddCredentialResult addCredential(const CertificateOfOwnership &coo)
+	inline Membership::AddCredentialResult addCredential(const CertificateOfOwnership &coo,SignatureBatch *batch = (SignatureBatch *)0)
 	{
 		if (coo.networkId() != _id)
 			return Membership::ADD_REJECTED;
 		Mutex::Lock _l(_lock);
-		return _membership(coo.issuedTo()).addCredential(RR,_config,coo);
+		return _membership(coo.issuedTo()).addCredential(RR,_config,coo,batch);
 	}
 
 	/**
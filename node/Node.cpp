@@ -21,6 +21,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <stdint.h>
+#include <stddef.h>
 
 #include "../version.h"
 
@@ -36,6 +37,11 @@
 #include "Address.hpp"
 #include "Identity.hpp"
 #include "SelfAwareness.hpp"
+#include "SignatureCache.hpp"
+#include "CPU.hpp"
+#include "Salsa20.hpp"
+#include "Poly1305.hpp"
+#include "AES.hpp"
 #include "Cluster.hpp"
 
 const struct sockaddr_storage ZT_SOCKADDR_NULL = {0};
@@ -55,12 +61,23 @@ Node::Node(void *uptr,const struct ZT_Node_Callbacks *callbacks,uint64_t now) :
 	_lastPingCheck(0),
 	_lastHousekeepingRun(0)
 {
-	if (callbacks->version != 0)
+	if ((callbacks->version != 0)&&(callbacks->version != 1))
 		throw std::runtime_error("callbacks struct version mismatch");
-	memcpy(&_cb,callbacks,sizeof(ZT_Node_Callbacks));
+	memset(&_cb,0,sizeof(ZT_Node_Callbacks));
+	memcpy(&_cb,callbacks,(callbacks->version == 0) ? offsetof(ZT_Node_Callbacks,identityValidationRequestFunction) : sizeof(ZT_Node_Callbacks));
 
 	_online = false;
 
+	// Probe the CPU now rather than on the first packet; crypto primitives choose their kernels from this
+	CPU::features();
+	_cryptoImplementations = "salsa20=";
+	_cryptoImplementations.append(Salsa20::implementation());
+	_cryptoImplementations.append(" poly1305=");
+	_cryptoImplementations.append(Poly1305::implementation());
+	_cryptoImplementations.append(" aes=");
+	_cryptoImplementations.append(AES::implementationName(AES::best()));
+	_cryptoImplementations.append(" sha512=generic c25519=generic");
+
 	memset(_expectingRepliesToBucketPtr,0,sizeof(_expectingRepliesToBucketPtr));
 	memset(_expectingRepliesTo,0,sizeof(_expectingRepliesTo));
 	memset(_lastIdentityVerification,0,sizeof(_lastIdentityVerification));
@@ -89,6 +106,7 @@ Node::Node(void *uptr,const struct ZT_Node_Callbacks *callbacks,uint64_t now) :
 	}
 
 	try {
+		RR->sigCache = new SignatureCache();
 		RR->sw = new Switch(RR);
 		RR->mc = new Multicaster(RR);
 		RR->topology = new Topology(RR);
@@ -98,6 +116,7 @@ Node::Node(void *uptr,const struct ZT_Node_Callbacks *callbacks,uint64_t now) :
 		delete RR->topology;
 		delete RR->mc;
 		delete RR->sw;
+		delete RR->sigCache;
 		throw;
 	}
 
@@ -114,6 +133,7 @@ Node::~Node()
 	delete RR->topology;
 	delete RR->mc;
 	delete RR->sw;
+	delete RR->sigCache;
 
 #ifdef ZT_ENABLE_CLUSTER
 	delete RR->cluster;
@@ -133,6 +153,23 @@ ZT_ResultCode Node::processWirePacket(
 	return ZT_RESULT_OK;
 }
 
+ZT_ResultCode Node::processWirePackets(
+	uint64_t now,
+	const ZT_WirePacket *packets,
+	unsigned int packetCount,
+	volatile uint64_t *nextBackgroundTaskDeadline)
+{
+	_now = now;
+	RR->sw->onRemotePackets(packets,packetCount);
+	return ZT_RESULT_OK;
+}
+
+unsigned int Node::processIdentityValidations(uint64_t now,unsigned int max)
+{
+	_now = now;
+	return RR->sw->doIdentityValidations(now,max);
+}
+
 ZT_ResultCode Node::processVirtualNetworkFrame(
 	uint64_t now,
 	uint64_t nwid,
@@ -365,6 +402,11 @@ void Node::status(ZT_NodeStatus *status) const
 	status->publicIdentity = RR->publicIdentityStr.c_str();
 	status->secretIdentity = RR->secretIdentityStr.c_str();
 	status->online = _online ? 1 : 0;
+	status->signatureCacheHits = RR->sigCache->hits();
+	status->signatureCacheMisses = RR->sigCache->misses();
+	status->cpuFeatures = CPU::featureNames();
+	status->cryptoImplementations = _cryptoImplementations.c_str();
+	RR->sw->rxQueueStatus(status);
 }
 
 ZT_PeerList *Node::peers() const
@@ -688,6 +730,7 @@ void Node::postTrace(const char *module,unsigned int line,const char *fmt,...)
 
 uint64_t Node::prng()
 {
+	Mutex::Lock _l(_prng_m); // can be called from tap threads and wire packet threads at the same time
 	unsigned int p = (++_prngStreamPtr % ZT_NODE_PRNG_BUF_SIZE);
 	if (!p)
 		_prng.crypt12(_prngStream,_prngStream,sizeof(_prngStream));
@@ -713,6 +756,11 @@ void Node::setTrustedPaths(const struct sockaddr_storage *networks,const uint64_
 	RR->topology->setTrustedPaths(reinterpret_cast<const InetAddress *>(networks),ids,count);
 }
 
+void Node::setRxQueueSize(unsigned int size)
+{
+	RR->sw->setRxQueueSize(size);
+}
+
 World Node::planet() const
 {
 	return RR->topology->planet();
@@ -875,6 +923,31 @@ enum ZT_ResultCode ZT_Node_processWirePacket(
 	}
 }
 
+enum ZT_ResultCode ZT_Node_processWirePackets(
+	ZT_Node *node,
+	uint64_t now,
+	const ZT_WirePacket *packets,
+	unsigned int packetCount,
+	volatile uint64_t *nextBackgroundTaskDeadline)
+{
+	try {
+		return reinterpret_cast<ZeroTier::Node *>(node)->processWirePackets(now,packets,packetCount,nextBackgroundTaskDeadline);
+	} catch (std::bad_alloc &exc) {
+		return ZT_RESULT_FATAL_ERROR_OUT_OF_MEMORY;
+	} catch ( ... ) {
+		return ZT_RESULT_OK; // "OK" since invalid packets are simply dropped, but the system is still up
+	}
+}
+
+unsigned int ZT_Node_processIdentityValidations(ZT_Node *node,uint64_t now,unsigned int max)
+{
+	try {
+		return reinterpret_cast<ZeroTier::Node *>(node)->processIdentityValidations(now,max);
+	} catch ( ... ) {
+		return 0;
+	}
+}
+
 enum ZT_ResultCode ZT_Node_processVirtualNetworkFrame(
 	ZT_Node *node,
 	uint64_t now,
@@ -1120,6 +1193,13 @@ void ZT_Node_setTrustedPaths(ZT_Node *node,const struct sockaddr_storage *networ
 	} catch ( ... ) {}
 }
 
+void ZT_Node_setRxQueueSize(ZT_Node *node,unsigned int size)
+{
+	try {
+		reinterpret_cast<ZeroTier::Node *>(node)->setRxQueueSize(size);
+	} catch ( ... ) {}
+}
+
 void ZT_version(int *major,int *minor,int *revision)
 {
 	if (major) *major = ZEROTIER_ONE_VERSION_MAJOR;
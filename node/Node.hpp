@@ -83,6 +83,11 @@ public:
 		const void *packetData,
 		unsigned int packetLength,
 		volatile uint64_t *nextBackgroundTaskDeadline);
+	ZT_ResultCode processWirePackets(
+		uint64_t now,
+		const ZT_WirePacket *packets,
+		unsigned int packetCount,
+		volatile uint64_t *nextBackgroundTaskDeadline);
 	ZT_ResultCode processVirtualNetworkFrame(
 		uint64_t now,
 		uint64_t nwid,
@@ -93,6 +98,7 @@ public:
 		const void *frameData,
 		unsigned int frameLength,
 		volatile uint64_t *nextBackgroundTaskDeadline);
+	unsigned int processIdentityValidations(uint64_t now,unsigned int max);
 	ZT_ResultCode processBackgroundTasks(uint64_t now,volatile uint64_t *nextBackgroundTaskDeadline);
 	ZT_ResultCode join(uint64_t nwid,void *uptr);
 	ZT_ResultCode leave(uint64_t nwid,void **uptr);
@@ -202,6 +208,9 @@ public:
 
 	inline bool online() const throw() { return _online; }
 
+	inline bool asyncIdentityValidation() const throw() { return (_cb.identityValidationRequestFunction != 0); }
+	inline void requestIdentityValidation() { _cb.identityValidationRequestFunction(reinterpret_cast<ZT_Node *>(this),_uPtr); }
+
 #ifdef ZT_TRACE
 	void postTrace(const char *module,unsigned int line,const char *fmt,...);
 #endif
@@ -212,6 +221,7 @@ public:
 	uint64_t prng();
 	void postCircuitTestReport(const ZT_CircuitTestReport *report);
 	void setTrustedPaths(const struct sockaddr_storage *networks,const uint64_t *ids,unsigned int count);
+	void setRxQueueSize(unsigned int size);
 
 	World planet() const;
 	std::vector<World> moons() const;
@@ -306,10 +316,13 @@ private:
 	std::vector<InetAddress> _directPaths;
 	Mutex _directPaths_m;
 
+	std::string _cryptoImplementations; // for ZT_NodeStatus
+
 	Mutex _backgroundTasksLock;
 
 	unsigned int _prngStreamPtr;
 	Salsa20 _prng;
+	Mutex _prng_m;
 	uint64_t _prngStream[ZT_NODE_PRNG_BUF_SIZE]; // repeatedly encrypted with _prng to yield a high-quality non-crypto PRNG stream
 
 	uint64_t _now;
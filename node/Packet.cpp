@@ -1062,7 +1062,7 @@ const char *Packet::errorString(ErrorCode e)
 
 #endif // ZT_TRACE
 
-void Packet::armor(const void *key,bool encryptPayload,unsigned int counter)
+void Packet::armor(const void *key,bool encryptPayload,unsigned int counter,bool aesGcm)
 {
 	uint8_t mangledKey[32],macKey[32],mac[16];
 	uint8_t *const data = reinterpret_cast<uint8_t *>(unsafeData());
@@ -1070,6 +1070,12 @@ void Packet::armor(const void *key,bool encryptPayload,unsigned int counter)
 	// Mask least significant 3 bits of packet ID with counter to embed packet send counter for QoS use
 	data[7] = (data[7] & 0xf8) | (uint8_t)(counter & 0x07);
 
+	if ((encryptPayload)&&(aesGcm)) {
+		setCipher(ZT_PROTO_CIPHER_SUITE__C25519_AES256_GCM);
+		_aesGcmArmor(key);
+		return;
+	}
+
 	// Set flag now, since it affects key mangle function
 	setCipher(encryptPayload ? ZT_PROTO_CIPHER_SUITE__C25519_POLY1305_SALSA2012 : ZT_PROTO_CIPHER_SUITE__C25519_POLY1305_NONE);
 
@@ -1082,9 +1088,23 @@ void Packet::armor(const void *key,bool encryptPayload,unsigned int counter)
 
 	uint8_t *const payload = data + ZT_PACKET_IDX_VERB;
 	const unsigned int payloadLen = size() - ZT_PACKET_IDX_VERB;
-	if (encryptPayload)
+	if (encryptPayload) {
+#ifdef ZT_NO_FUSED_ARMOR
 		s20.crypt12(payload,payload,payloadLen);
-	Poly1305::compute(mac,payload,payloadLen,macKey);
+		Poly1305::compute(mac,payload,payloadLen,macKey);
+#else
+		// Encrypt and MAC each chunk while it's still in L1 cache
+		Poly1305 p1305(macKey);
+		for(unsigned int i=0;i<payloadLen;i+=ZT_PACKET_ARMOR_CHUNK) {
+			const unsigned int n = ((payloadLen - i) < ZT_PACKET_ARMOR_CHUNK) ? (payloadLen - i) : ZT_PACKET_ARMOR_CHUNK;
+			s20.crypt12(payload + i,payload + i,n);
+			p1305.update(payload + i,n);
+		}
+		p1305.finish(mac);
+#endif
+	} else {
+		Poly1305::compute(mac,payload,payloadLen,macKey);
+	}
 	memcpy(data + ZT_PACKET_IDX_MAC,mac,8);
 }
 
@@ -1101,6 +1121,28 @@ bool Packet::dearmor(const void *key)
 		Salsa20 s20(mangledKey,256,data + ZT_PACKET_IDX_IV);
 
 		s20.crypt12(ZERO_KEY,macKey,sizeof(macKey));
+
+#ifndef ZT_NO_FUSED_ARMOR
+		if (cs == ZT_PROTO_CIPHER_SUITE__C25519_POLY1305_SALSA2012) {
+			// MAC and decrypt each chunk while it's still in L1 cache, then put
+			// the ciphertext back if the MAC turns out to be wrong
+			const Salsa20 s20Start(s20);
+			Poly1305 p1305(macKey);
+			for(unsigned int i=0;i<payloadLen;i+=ZT_PACKET_ARMOR_CHUNK) {
+				const unsigned int n = ((payloadLen - i) < ZT_PACKET_ARMOR_CHUNK) ? (payloadLen - i) : ZT_PACKET_ARMOR_CHUNK;
+				p1305.update(payload + i,n);
+				s20.crypt12(payload + i,payload + i,n);
+			}
+			p1305.finish(mac);
+			if (!Utils::secureEq(mac,data + ZT_PACKET_IDX_MAC,8)) {
+				Salsa20 s20Undo(s20Start);
+				s20Undo.crypt12(payload,payload,payloadLen);
+				return false; // MAC failed, packet is corrupt, modified, or is not from the sender
+			}
+			return true;
+		}
+#endif
+
 		Poly1305::compute(mac,payload,payloadLen,macKey);
 		if (!Utils::secureEq(mac,data + ZT_PACKET_IDX_MAC,8))
 			return false; // MAC failed, packet is corrupt, modified, or is not from the sender
@@ -1109,11 +1151,144 @@ bool Packet::dearmor(const void *key)
 			s20.crypt12(payload,payload,payloadLen);
 
 		return true;
+	} else if (cs == ZT_PROTO_CIPHER_SUITE__C25519_AES256_GCM) {
+		return _aesGcmDearmor(key);
 	} else {
 		return false; // unrecognized cipher suite
 	}
 }
 
+void Packet::_aesGcmArmor(const void *key)
+{
+	uint8_t mangledKey[32],iv[ZT_AES_GCM_IV_LEN],tag[ZT_AES_GCM_TAG_LEN];
+	uint8_t *const data = reinterpret_cast<uint8_t *>(unsafeData());
+	_salsa20MangleKey((const unsigned char *)key,mangledKey);
+	memcpy(iv,data + ZT_PACKET_IDX_IV,8);
+	memset(iv + 8,0,4);
+	AES aes(mangledKey);
+	aes.gcmEncrypt(iv,(const void *)0,0,data + ZT_PACKET_IDX_VERB,data + ZT_PACKET_IDX_VERB,size() - ZT_PACKET_IDX_VERB,tag);
+	memcpy(data + ZT_PACKET_IDX_MAC,tag,8);
+}
+
+bool Packet::_aesGcmDearmor(const void *key)
+{
+	uint8_t mangledKey[32],iv[ZT_AES_GCM_IV_LEN];
+	uint8_t *const data = reinterpret_cast<uint8_t *>(unsafeData());
+	_salsa20MangleKey((const unsigned char *)key,mangledKey);
+	memcpy(iv,data + ZT_PACKET_IDX_IV,8);
+	memset(iv + 8,0,4);
+	AES aes(mangledKey);
+	return aes.gcmDecrypt(iv,(const void *)0,0,data + ZT_PACKET_IDX_VERB,data + ZT_PACKET_IDX_VERB,size() - ZT_PACKET_IDX_VERB,data + ZT_PACKET_IDX_MAC,8);
+}
+
+void Packet::armorMany(Packet *const *packets,const void *const *keys,bool encryptPayload,const unsigned int *counters,unsigned int count,bool aesGcm)
+{
+	if ((encryptPayload)&&(aesGcm)) {
+		// AES-GCM has no Salsa20/12 key stream to batch, so armor one at a time
+		for(unsigned int i=0;i<count;++i)
+			packets[i]->armor(keys[i],true,counters[i],true);
+		return;
+	}
+
+	uint8_t mangledKey[32],macKeys[ZT_SALSA20_MAX_PARALLEL][32],mac[16];
+	Salsa20 s20[ZT_SALSA20_MAX_PARALLEL];
+	Salsa20 *s20p[ZT_SALSA20_MAX_PARALLEL];
+	const void *in[ZT_SALSA20_MAX_PARALLEL];
+	void *out[ZT_SALSA20_MAX_PARALLEL];
+	unsigned int len[ZT_SALSA20_MAX_PARALLEL];
+
+	while (count) {
+		const unsigned int n = (count < ZT_SALSA20_MAX_PARALLEL) ? count : ZT_SALSA20_MAX_PARALLEL;
+
+		for(unsigned int i=0;i<n;++i) {
+			Packet &p = *(packets[i]);
+			uint8_t *const data = reinterpret_cast<uint8_t *>(p.unsafeData());
+			data[7] = (data[7] & 0xf8) | (uint8_t)(counters[i] & 0x07);
+			p.setCipher(encryptPayload ? ZT_PROTO_CIPHER_SUITE__C25519_POLY1305_SALSA2012 : ZT_PROTO_CIPHER_SUITE__C25519_POLY1305_NONE);
+			p._salsa20MangleKey((const unsigned char *)keys[i],mangledKey);
+			s20[i].init(mangledKey,256,data + ZT_PACKET_IDX_IV);
+			s20p[i] = &(s20[i]);
+			in[i] = ZERO_KEY;
+			out[i] = macKeys[i];
+			len[i] = 32;
+		}
+		Salsa20::crypt12Many(s20p,in,out,len,n);
+
+		for(unsigned int i=0;i<n;++i) {
+			out[i] = reinterpret_cast<uint8_t *>(packets[i]->unsafeData()) + ZT_PACKET_IDX_VERB;
+			in[i] = out[i];
+			len[i] = packets[i]->size() - ZT_PACKET_IDX_VERB;
+		}
+		if (encryptPayload)
+			Salsa20::crypt12Many(s20p,in,out,len,n);
+
+		for(unsigned int i=0;i<n;++i) {
+			Poly1305::compute(mac,out[i],len[i],macKeys[i]);
+			memcpy(reinterpret_cast<uint8_t *>(packets[i]->unsafeData()) + ZT_PACKET_IDX_MAC,mac,8);
+		}
+
+		packets += n;
+		keys += n;
+		counters += n;
+		count -= n;
+	}
+}
+
+void Packet::dearmorMany(Packet *const *packets,const void *const *keys,bool *ok,unsigned int count)
+{
+	uint8_t mangledKey[32],macKeys[ZT_SALSA20_MAX_PARALLEL][32],mac[16];
+	Salsa20 s20[ZT_SALSA20_MAX_PARALLEL];
+	Salsa20 *s20p[ZT_SALSA20_MAX_PARALLEL];
+	const void *in[ZT_SALSA20_MAX_PARALLEL];
+	void *out[ZT_SALSA20_MAX_PARALLEL];
+	unsigned int len[ZT_SALSA20_MAX_PARALLEL];
+	unsigned int idx[ZT_SALSA20_MAX_PARALLEL];
+
+	unsigned int next = 0;
+	while (next < count) {
+		// Gather Salsa20/12 and Poly1305 packets; AES-GCM packets are dearmored
+		// one at a time and others fail as in dearmor()
+		unsigned int n = 0;
+		while ((next < count)&&(n < ZT_SALSA20_MAX_PARALLEL)) {
+			Packet &p = *(packets[next]);
+			const unsigned int cs = p.cipher();
+			if ((cs == ZT_PROTO_CIPHER_SUITE__C25519_POLY1305_NONE)||(cs == ZT_PROTO_CIPHER_SUITE__C25519_POLY1305_SALSA2012)) {
+				p._salsa20MangleKey((const unsigned char *)keys[next],mangledKey);
+				s20[n].init(mangledKey,256,reinterpret_cast<uint8_t *>(p.unsafeData()) + ZT_PACKET_IDX_IV);
+				s20p[n] = &(s20[n]);
+				in[n] = ZERO_KEY;
+				out[n] = macKeys[n];
+				len[n] = 32;
+				idx[n++] = next;
+			} else if (cs == ZT_PROTO_CIPHER_SUITE__C25519_AES256_GCM) {
+				ok[next] = p._aesGcmDearmor(keys[next]);
+			} else {
+				ok[next] = false;
+			}
+			++next;
+		}
+		Salsa20::crypt12Many(s20p,in,out,len,n);
+
+		// Decrypt only packets that pass MAC check and are encrypted
+		unsigned int d = 0;
+		for(unsigned int i=0;i<n;++i) {
+			Packet &p = *(packets[idx[i]]);
+			uint8_t *const data = reinterpret_cast<uint8_t *>(p.unsafeData());
+			uint8_t *const payload = data + ZT_PACKET_IDX_VERB;
+			const unsigned int payloadLen = p.size() - ZT_PACKET_IDX_VERB;
+			Poly1305::compute(mac,payload,payloadLen,macKeys[i]);
+			ok[idx[i]] = Utils::secureEq(mac,data + ZT_PACKET_IDX_MAC,8);
+			if ((ok[idx[i]])&&(p.cipher() == ZT_PROTO_CIPHER_SUITE__C25519_POLY1305_SALSA2012)) {
+				s20p[d] = s20p[i];
+				in[d] = payload;
+				out[d] = payload;
+				len[d++] = payloadLen;
+			}
+		}
+		Salsa20::crypt12Many(s20p,in,out,len,d);
+	}
+}
+
 void Packet::cryptField(const void *key,unsigned int start,unsigned int len)
 {
 	uint8_t *const data = reinterpret_cast<uint8_t *>(unsafeData());
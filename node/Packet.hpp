@@ -29,6 +29,7 @@
 #include "Constants.hpp"
 
 #include "Address.hpp"
+#include "AES.hpp"
 #include "Poly1305.hpp"
 #include "Salsa20.hpp"
 #include "Utils.hpp"
@@ -66,10 +67,12 @@
  *   + Tags and Capabilities
  *   + Inline push of CertificateOfMembership deprecated
  *   + Certificates of representation for federation and mesh
- * 9 - 1.2.0 ... CURRENT
+ * 9 - 1.2.0 ... 1.2.2
  *   + In-band encoding of packet counter for link quality measurement
+ * 10 - 1.2.3 ... CURRENT
+ *   + AES-256-GCM cipher suite, offered via a flags field in HELLO
  */
-#define ZT_PROTO_VERSION 9
+#define ZT_PROTO_VERSION 10
 
 /**
  * Minimum supported protocol version
@@ -119,6 +122,30 @@
  */
 #define ZT_PROTO_CIPHER_SUITE__NO_CRYPTO_TRUSTED_PATH 2
 
+/**
+ * Cipher suite: Curve25519/AES-256-GCM
+ *
+ * The payload is encrypted and authenticated with AES-256-GCM. The key is
+ * the agreed key mangled per packet exactly as for Salsa20/12, the IV is
+ * the 64-bit packet ID followed by four zero bytes, and the MAC field holds
+ * the first 8 bytes of the GCM tag. This is only sent to peers that set
+ * ZT_PROTO_HELLO_FLAG_AES_GCM, and only by nodes with AES hardware.
+ */
+#define ZT_PROTO_CIPHER_SUITE__C25519_AES256_GCM 3
+
+/**
+ * HELLO and OK(HELLO) flag: this node can receive AES-256-GCM and would prefer it
+ */
+#define ZT_PROTO_HELLO_FLAG_AES_GCM 0x01
+
+/**
+ * Bytes armor() and dearmor() encrypt and MAC at a time in one pass over the payload
+ *
+ * This must be a multiple of 64 (the Salsa20 block size). Define
+ * ZT_NO_FUSED_ARMOR to encrypt and MAC in two separate passes instead.
+ */
+#define ZT_PACKET_ARMOR_CHUNK 512
+
 /**
  * DEPRECATED payload encrypted flag, may be re-used in the future.
  *
@@ -559,6 +586,7 @@ public:
 		 *   [... additional moon type/ID/timestamp tuples ...]
 		 *   <[2] 16-bit length of certificate of representation>
 		 *   [... certificate of representation ...]
+		 *   [<[1] 8-bit flags (ZT_PROTO_HELLO_FLAG_*), protocol 10+>]
 		 *
 		 * HELLO is sent in the clear as it is how peers share their identity
 		 * public keys. A few additional fields are sent in the clear too, but
@@ -582,6 +610,7 @@ public:
 		 *   [[...] updates to planets and/or moons]
 		 *   <[2] 16-bit length of certificate of representation>
 		 *   [... certificate of representation ...]
+		 *   [<[1] 8-bit flags (ZT_PROTO_HELLO_FLAG_*), protocol 10+>]
 		 *
 		 * With the exception of the timestamp, the other fields pertain to the
 		 * respondent who is sending OK and are not echoes.
@@ -1355,8 +1384,9 @@ public:
 	 * @param key 32-byte key
 	 * @param encryptPayload If true, encrypt packet payload, else just MAC
 	 * @param counter Packet send counter for destination peer -- only least significant 3 bits are used
+	 * @param aesGcm If true and encryptPayload is true, use AES-256-GCM instead of Salsa20/12 and Poly1305
 	 */
-	void armor(const void *key,bool encryptPayload,unsigned int counter);
+	void armor(const void *key,bool encryptPayload,unsigned int counter,bool aesGcm = false);
 
 	/**
 	 * Verify and (if encrypted) decrypt packet
@@ -1370,6 +1400,38 @@ public:
 	 */
 	bool dearmor(const void *key);
 
+	/**
+	 * Armor several packets for transport
+	 *
+	 * This gives the same result as calling armor() on each packet, but
+	 * computes several packets' Salsa20/12 key streams at once where the
+	 * CPU supports it (see Salsa20::crypt12Many()). AES-GCM packets are
+	 * armored one at a time.
+	 *
+	 * @param packets Packets to armor (must be distinct)
+	 * @param keys 32-byte key for each packet
+	 * @param encryptPayload If true, encrypt packet payloads, else just MAC
+	 * @param counters Packet send counter for each packet
+	 * @param count Number of packets
+	 * @param aesGcm If true and encryptPayload is true, use AES-256-GCM instead of Salsa20/12 and Poly1305
+	 */
+	static void armorMany(Packet *const *packets,const void *const *keys,bool encryptPayload,const unsigned int *counters,unsigned int count,bool aesGcm = false);
+
+	/**
+	 * Verify and (if encrypted) decrypt several packets
+	 *
+	 * This gives the same result as calling dearmor() on each packet, but
+	 * computes several packets' Salsa20/12 key streams at once where the
+	 * CPU supports it (see Salsa20::crypt12Many()). Packets may use any
+	 * cipher suite; AES-GCM packets are dearmored one at a time.
+	 *
+	 * @param packets Packets to verify and decrypt (must be distinct)
+	 * @param keys 32-byte key for each packet
+	 * @param ok Set for each packet to the result dearmor() would have returned
+	 * @param count Number of packets
+	 */
+	static void dearmorMany(Packet *const *packets,const void *const *keys,bool *ok,unsigned int count);
+
 	/**
 	 * Encrypt/decrypt a separately armored portion of a packet
 	 *
@@ -1416,6 +1478,10 @@ public:
 private:
 	static const unsigned char ZERO_KEY[32];
 
+	// AES-256-GCM suite: key is mangled as for Salsa20/12, IV is packet ID + 4 zero bytes
+	void _aesGcmArmor(const void *key);
+	bool _aesGcmDearmor(const void *key);
+
 	/**
 	 * Deterministically mangle a 256-bit crypto key based on packet
 	 *
@@ -112,6 +112,7 @@ public:
 		_incomingLinkQualitySlowLogCounter(-64), // discard first fast log
 		_incomingLinkQualityPreviousPacketCounter(0),
 		_outgoingPacketCounter(0),
+		_rxQueueEntries(0),
 		_addr(),
 		_localAddress(),
 		_ipScope(InetAddress::IP_SCOPE_NONE)
@@ -129,6 +130,7 @@ public:
 		_incomingLinkQualitySlowLogCounter(-64), // discard first fast log
 		_incomingLinkQualityPreviousPacketCounter(0),
 		_outgoingPacketCounter(0),
+		_rxQueueEntries(0),
 		_addr(addr),
 		_localAddress(localAddress),
 		_ipScope(addr.ipScope())
@@ -297,6 +299,17 @@ public:
 	 */
 	inline unsigned int nextOutgoingCounter() { return _outgoingPacketCounter++; }
 
+	/**
+	 * @return Number of Switch RX queue entries held by packets that arrived on this path
+	 */
+	inline unsigned int rxQueueEntries() const { return _rxQueueEntries; }
+
+	/**
+	 * Count an RX queue entry taken or given back (Switch calls these with its RX queue locked)
+	 */
+	inline void rxQueueEntryAdded() { ++_rxQueueEntries; }
+	inline void rxQueueEntryRemoved() { --_rxQueueEntries; }
+
 private:
 	volatile uint64_t _lastOut;
 	volatile uint64_t _lastIn;
@@ -306,6 +319,7 @@ private:
 	volatile signed int _incomingLinkQualitySlowLogCounter;
 	volatile unsigned int _incomingLinkQualityPreviousPacketCounter;
 	volatile unsigned int _outgoingPacketCounter;
+	unsigned int _rxQueueEntries;
 	InetAddress _addr;
 	InetAddress _localAddress;
 	InetAddress::IpScope _ipScope; // memoize this since it's a computed value checked often
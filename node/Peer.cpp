@@ -37,7 +37,7 @@
 
 namespace ZeroTier {
 
-Peer::Peer(const RuntimeEnvironment *renv,const Identity &myIdentity,const Identity &peerIdentity) :
+Peer::Peer(const RuntimeEnvironment *renv,const Identity &myIdentity,const Identity &peerIdentity,const void *key) :
 	RR(renv),
 	_lastReceive(0),
 	_lastNontrivialReceive(0),
@@ -56,6 +56,7 @@ Peer::Peer(const RuntimeEnvironment *renv,const Identity &myIdentity,const Ident
 	_vMajor(0),
 	_vMinor(0),
 	_vRevision(0),
+	_vFlags(0),
 	_id(peerIdentity),
 	_numPaths(0),
 	_latency(0),
@@ -63,7 +64,9 @@ Peer::Peer(const RuntimeEnvironment *renv,const Identity &myIdentity,const Ident
 	_credentialsCutoffCount(0)
 {
 	memset(_remoteClusterOptimal6,0,sizeof(_remoteClusterOptimal6));
-	if (!myIdentity.agree(peerIdentity,_key,ZT_PEER_SECRET_KEY_LENGTH))
+	if (key)
+		memcpy(_key,key,ZT_PEER_SECRET_KEY_LENGTH);
+	else if (!myIdentity.agree(peerIdentity,_key,ZT_PEER_SECRET_KEY_LENGTH))
 		throw std::runtime_error("new peer identity key agreement failed");
 }
 
@@ -165,33 +168,38 @@ void Peer::received(
 			if (verb == Packet::VERB_OK) {
 				Mutex::Lock _l(_paths_m);
 
-				// Since this is a new path, figure out where to put it (possibly replacing an old/dead one)
-				unsigned int slot;
-				if (_numPaths < ZT_MAX_PEER_NETWORK_PATHS) {
-					slot = _numPaths++;
-				} else {
-					// First try to replace the worst within the same address family, if possible
-					int worstSlot = -1;
-					uint64_t worstScore = 0xffffffffffffffffULL;
-					for(unsigned int p=0;p<_numPaths;++p) {
-						if (_paths[p].path->address().ss_family == path->address().ss_family) {
-							const uint64_t s = _pathScore(p,now);
-							if (s < worstScore) {
-								worstScore = s;
-								worstSlot = (int)p;
-							}
-						}
-					}
-					if (worstSlot >= 0) {
-						slot = (unsigned int)worstSlot;
+				// Since this is a new path, figure out where to put it (possibly replacing an old/dead one).
+				// Another thread may have added it since we looked above, in which case just update it.
+				unsigned int slot = 0;
+				while ((slot < _numPaths)&&(_paths[slot].path->address() != path->address()))
+					++slot;
+				if (slot >= _numPaths) {
+					if (_numPaths < ZT_MAX_PEER_NETWORK_PATHS) {
+						slot = _numPaths++;
 					} else {
-						// If we can't find one with the same family, replace the worst of any family
-						slot = ZT_MAX_PEER_NETWORK_PATHS - 1;
+						// First try to replace the worst within the same address family, if possible
+						int worstSlot = -1;
+						uint64_t worstScore = 0xffffffffffffffffULL;
 						for(unsigned int p=0;p<_numPaths;++p) {
-							const uint64_t s = _pathScore(p,now);
-							if (s < worstScore) {
-								worstScore = s;
-								slot = p;
+							if (_paths[p].path->address().ss_family == path->address().ss_family) {
+								const uint64_t s = _pathScore(p,now);
+								if (s < worstScore) {
+									worstScore = s;
+									worstSlot = (int)p;
+								}
+							}
+						}
+						if (worstSlot >= 0) {
+							slot = (unsigned int)worstSlot;
+						} else {
+							// If we can't find one with the same family, replace the worst of any family
+							slot = ZT_MAX_PEER_NETWORK_PATHS - 1;
+							for(unsigned int p=0;p<_numPaths;++p) {
+								const uint64_t s = _pathScore(p,now);
+								if (s < worstScore) {
+									worstScore = s;
+									slot = p;
+								}
 							}
 						}
 					}
@@ -381,6 +389,8 @@ void Peer::sendHELLO(const InetAddress &localAddr,const InetAddress &atAddress,u
 	RR->topology->appendCertificateOfRepresentation(outp);
 	outp.setAt(corSizeAt,(uint16_t)(outp.size() - (corSizeAt + 2)));
 
+	outp.append((uint8_t)((AES::hardware()) ? ZT_PROTO_HELLO_FLAG_AES_GCM : 0));
+
 	outp.cryptField(_key,startCryptedPortionAt,outp.size() - startCryptedPortionAt);
 
 	RR->node->expectReplyTo(outp.packetId());
@@ -64,9 +64,10 @@ public:
 	 * @param renv Runtime environment
 	 * @param myIdentity Identity of THIS node (for key agreement)
 	 * @param peerIdentity Identity of peer
+	 * @param key If non-NULL, previously agreed secret key to use instead of performing key agreement
 	 * @throws std::runtime_error Key agreement with peer's identity failed
 	 */
-	Peer(const RuntimeEnvironment *renv,const Identity &myIdentity,const Identity &peerIdentity);
+	Peer(const RuntimeEnvironment *renv,const Identity &myIdentity,const Identity &peerIdentity,const void *key = (const void *)0);
 
 	/**
 	 * @return This peer's ZT address (short for identity().address())
@@ -308,13 +309,15 @@ public:
 	 * @param vmaj Major version
 	 * @param vmin Minor version
 	 * @param vrev Revision
+	 * @param vflags Flags from HELLO or OK(HELLO) (ZT_PROTO_HELLO_FLAG_*), 0 if none were sent
 	 */
-	inline void setRemoteVersion(unsigned int vproto,unsigned int vmaj,unsigned int vmin,unsigned int vrev)
+	inline void setRemoteVersion(unsigned int vproto,unsigned int vmaj,unsigned int vmin,unsigned int vrev,unsigned int vflags)
 	{
 		_vProto = (uint16_t)vproto;
 		_vMajor = (uint16_t)vmaj;
 		_vMinor = (uint16_t)vmin;
 		_vRevision = (uint16_t)vrev;
+		_vFlags = (uint8_t)vflags;
 	}
 
 	inline unsigned int remoteVersionProtocol() const { return _vProto; }
@@ -324,6 +327,11 @@ public:
 
 	inline bool remoteVersionKnown() const { return ((_vMajor > 0)||(_vMinor > 0)||(_vRevision > 0)); }
 
+	/**
+	 * @return True if encrypted packets to this peer should use AES-256-GCM (both sides have AES hardware)
+	 */
+	inline bool aesGcm() const { return ((_vProto >= 10)&&((_vFlags & ZT_PROTO_HELLO_FLAG_AES_GCM) != 0)&&(AES::hardware())); }
+
 	/**
 	 * @return True if peer has received a trust established packet (e.g. common network membership) in the past ZT_TRUST_EXPIRATION ms
 	 */
@@ -465,6 +473,7 @@ private:
 	uint16_t _vMajor;
 	uint16_t _vMinor;
 	uint16_t _vRevision;
+	uint8_t _vFlags;
 
 	Identity _id;
 
@@ -0,0 +1,151 @@
+/*
+ * ZeroTier One - Network Virtualization Everywhere
+ * Copyright (C) 2011-2016  ZeroTier, Inc.  https://www.zerotier.com/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ZT_PEERKEYCACHE_HPP
+#define ZT_PEERKEYCACHE_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+#include "Constants.hpp"
+#include "Identity.hpp"
+#include "Salsa20.hpp"
+#include "Poly1305.hpp"
+#include "SHA512.hpp"
+#include "Utils.hpp"
+#include "NonCopyable.hpp"
+
+/**
+ * Size of a sealed peer key: format byte, IV, encrypted key, and MAC
+ */
+#define ZT_PEER_KEY_CACHE_SEALED_LENGTH (1 + 8 + ZT_PEER_SECRET_KEY_LENGTH + 16)
+
+namespace ZeroTier {
+
+/**
+ * Seals and opens peer secret keys for storage alongside peer identities
+ *
+ * Agreeing on a key with a peer takes a C25519 key agreement, which adds up
+ * quickly when a busy node restarts and hears from all its peers again. The
+ * agreed key can be stored instead, encrypted with Salsa20/12 and
+ * authenticated with Poly1305 under a key derived from our own secret
+ * identity. The MAC also covers the peer's address and public key, so a
+ * sealed key only opens for the identity it was agreed with.
+ */
+class PeerKeyCache : NonCopyable
+{
+public:
+	/**
+	 * @param myIdentity Our identity (must have private key)
+	 */
+	PeerKeyCache(const Identity &myIdentity)
+	{
+		uint8_t tmp[ZT_SHA512_DIGEST_LEN + 16];
+		if (myIdentity.sha512PrivateKey(tmp)) {
+			memcpy(tmp + ZT_SHA512_DIGEST_LEN,"peer key cache\0\0",16);
+			uint8_t k[ZT_SHA512_DIGEST_LEN];
+			SHA512::hash(k,tmp,sizeof(tmp));
+			memcpy(_key,k,sizeof(_key));
+			Utils::burn(k,sizeof(k));
+			_enabled = true;
+		} else {
+			memset(_key,0,sizeof(_key));
+			_enabled = false;
+		}
+		Utils::burn(tmp,sizeof(tmp));
+	}
+
+	~PeerKeyCache() { Utils::burn(_key,sizeof(_key)); }
+
+	/**
+	 * Seal a peer's secret key
+	 *
+	 * @param peer Peer identity
+	 * @param key Secret key agreed with peer (ZT_PEER_SECRET_KEY_LENGTH bytes)
+	 * @return Sealed key or empty string if we have no private key
+	 */
+	inline std::string seal(const Identity &peer,const void *key) const
+	{
+		if (!_enabled)
+			return std::string();
+
+		uint8_t s[ZT_PEER_KEY_CACHE_SEALED_LENGTH];
+		s[0] = 1; // format
+		Utils::getSecureRandom(s + 1,8);
+
+		uint8_t macKey[32];
+		Salsa20 s20(_key,256,s + 1);
+		memset(macKey,0,sizeof(macKey));
+		s20.crypt12(macKey,macKey,sizeof(macKey));
+		s20.crypt12(key,s + 9,ZT_PEER_SECRET_KEY_LENGTH);
+
+		_mac(peer,s,macKey,s + 9 + ZT_PEER_SECRET_KEY_LENGTH);
+		Utils::burn(macKey,sizeof(macKey));
+
+		return std::string(reinterpret_cast<const char *>(s),sizeof(s));
+	}
+
+	/**
+	 * Open a sealed peer key
+	 *
+	 * @param peer Peer identity
+	 * @param sealed Sealed key as returned by seal()
+	 * @param key Buffer to receive key (ZT_PEER_SECRET_KEY_LENGTH bytes)
+	 * @return True if key was sealed by us for this peer and has not been altered
+	 */
+	inline bool open(const Identity &peer,const std::string &sealed,void *key) const
+	{
+		if ((!_enabled)||(sealed.length() != ZT_PEER_KEY_CACHE_SEALED_LENGTH)||(sealed[0] != 1))
+			return false;
+		const uint8_t *const s = reinterpret_cast<const uint8_t *>(sealed.data());
+
+		uint8_t macKey[32];
+		Salsa20 s20(_key,256,s + 1);
+		memset(macKey,0,sizeof(macKey));
+		s20.crypt12(macKey,macKey,sizeof(macKey));
+
+		uint8_t mac[16];
+		_mac(peer,s,macKey,mac);
+		Utils::burn(macKey,sizeof(macKey));
+		if (!Utils::secureEq(mac,s + 9 + ZT_PEER_SECRET_KEY_LENGTH,16))
+			return false;
+
+		s20.crypt12(s + 9,key,ZT_PEER_SECRET_KEY_LENGTH);
+		return true;
+	}
+
+private:
+	// MAC covers peer address and public key followed by format, IV, and encrypted key
+	static inline void _mac(const Identity &peer,const uint8_t *s,const uint8_t *macKey,uint8_t *mac)
+	{
+		uint8_t tmp[ZT_ADDRESS_LENGTH + ZT_C25519_PUBLIC_KEY_LEN + 9 + ZT_PEER_SECRET_KEY_LENGTH];
+		peer.address().copyTo(tmp,ZT_ADDRESS_LENGTH);
+		memcpy(tmp + ZT_ADDRESS_LENGTH,peer.publicKey().data,ZT_C25519_PUBLIC_KEY_LEN);
+		memcpy(tmp + ZT_ADDRESS_LENGTH + ZT_C25519_PUBLIC_KEY_LEN,s,9 + ZT_PEER_SECRET_KEY_LENGTH);
+		Poly1305::compute(mac,tmp,sizeof(tmp),macKey);
+	}
+
+	uint8_t _key[32];
+	bool _enabled;
+};
+
+} // namespace ZeroTier
+
+#endif
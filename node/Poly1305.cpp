@@ -6,12 +6,17 @@ Public domain.
 
 #include "Constants.hpp"
 #include "Poly1305.hpp"
+#include "CPU.hpp"
 
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__GNUC__) && (defined(__amd64__) || defined(__x86_64__)) && !defined(ZT_NO_POLY1305_AVX2)
+#include <immintrin.h>
+#endif
+
 #ifdef __WINDOWS__
 #pragma warning(disable: 4146)
 #endif
@@ -181,6 +186,7 @@ typedef struct poly1305_state_internal_t {
   size_t leftover;
   unsigned char buffer[poly1305_block_size];
   unsigned char final;
+  unsigned char generic; /* nonzero to skip vector kernels */
 } poly1305_state_internal_t;
 
 /* interpret eight 8 bit unsigned integers as a 64 bit unsigned integer in little endian */
@@ -210,6 +216,178 @@ U64TO8(unsigned char *p, unsigned long long v) {
   p[7] = (v >> 56) & 0xff;
 }
 
+#if defined(__GNUC__) && !defined(ZT_NO_POLY1305_AVX2)
+
+//////////////////////////////////////////////////////////////////////////////
+// AVX2 kernel: four blocks per iteration, selected at runtime
+
+#define ZT_POLY1305_AVX2 1
+
+// Below this many bytes of full blocks the scalar code is faster than setting up r^2..r^4
+#define ZT_POLY1305_AVX2_MIN_BYTES 256
+
+/* a *= b mod p, 44-bit limbs, result carried so limbs fit in 44/44/42(+1) bits */
+static inline void
+poly1305_mul44(unsigned long long a[3], const unsigned long long b[3]) {
+  const unsigned long long s1 = b[1] * (5 << 2),s2 = b[2] * (5 << 2);
+  unsigned long long c;
+  uint128_t d0,d1,d2,d;
+
+  MUL(d0, a[0], b[0]); MUL(d, a[1], s2); ADD(d0, d); MUL(d, a[2], s1); ADD(d0, d);
+  MUL(d1, a[0], b[1]); MUL(d, a[1], b[0]); ADD(d1, d); MUL(d, a[2], s2); ADD(d1, d);
+  MUL(d2, a[0], b[2]); MUL(d, a[1], b[1]); ADD(d2, d); MUL(d, a[2], b[0]); ADD(d2, d);
+
+                c = SHR(d0, 44); a[0] = LO(d0) & 0xfffffffffff;
+  ADDLO(d1, c); c = SHR(d1, 44); a[1] = LO(d1) & 0xfffffffffff;
+  ADDLO(d2, c); c = SHR(d2, 42); a[2] = LO(d2) & 0x3ffffffffff;
+  a[0] += c * 5; c = (a[0] >> 44); a[0] &= 0xfffffffffff;
+  a[1] += c;     c = (a[1] >> 44); a[1] &= 0xfffffffffff;
+  a[2] += c;
+}
+
+/* 44-bit limbs to 26-bit limbs */
+static inline void
+poly1305_to26(const unsigned long long x[3], unsigned long long l[5]) {
+  l[0] = x[0] & 0x3ffffff;
+  l[1] = ((x[0] >> 26) | (x[1] << 18)) & 0x3ffffff;
+  l[2] = (x[1] >> 8) & 0x3ffffff;
+  l[3] = ((x[1] >> 34) | (x[2] << 10)) & 0x3ffffff;
+  l[4] = (x[2] >> 16);
+}
+
+#define ZT_P1305_MASK26 _mm256_set1_epi64x(0x3ffffff)
+
+/* h *= r (both 26-bit limbs, one value per 64-bit lane), with s = 5 * r[1..4], then partially reduce */
+#define ZT_P1305_MULR(h0,h1,h2,h3,h4,r0,r1,r2,r3,r4,s1,s2,s3,s4) { \
+  __m256i d0 = _mm256_add_epi64(_mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(h0,r0),_mm256_mul_epu32(h1,s4)),_mm256_add_epi64(_mm256_mul_epu32(h2,s3),_mm256_mul_epu32(h3,s2))),_mm256_mul_epu32(h4,s1)); \
+  __m256i d1 = _mm256_add_epi64(_mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(h0,r1),_mm256_mul_epu32(h1,r0)),_mm256_add_epi64(_mm256_mul_epu32(h2,s4),_mm256_mul_epu32(h3,s3))),_mm256_mul_epu32(h4,s2)); \
+  __m256i d2 = _mm256_add_epi64(_mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(h0,r2),_mm256_mul_epu32(h1,r1)),_mm256_add_epi64(_mm256_mul_epu32(h2,r0),_mm256_mul_epu32(h3,s4))),_mm256_mul_epu32(h4,s3)); \
+  __m256i d3 = _mm256_add_epi64(_mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(h0,r3),_mm256_mul_epu32(h1,r2)),_mm256_add_epi64(_mm256_mul_epu32(h2,r1),_mm256_mul_epu32(h3,r0))),_mm256_mul_epu32(h4,s4)); \
+  __m256i d4 = _mm256_add_epi64(_mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(h0,r4),_mm256_mul_epu32(h1,r3)),_mm256_add_epi64(_mm256_mul_epu32(h2,r2),_mm256_mul_epu32(h3,r1))),_mm256_mul_epu32(h4,r0)); \
+  __m256i c; \
+  c = _mm256_srli_epi64(d0,26); h0 = _mm256_and_si256(d0,ZT_P1305_MASK26); d1 = _mm256_add_epi64(d1,c); \
+  c = _mm256_srli_epi64(d1,26); h1 = _mm256_and_si256(d1,ZT_P1305_MASK26); d2 = _mm256_add_epi64(d2,c); \
+  c = _mm256_srli_epi64(d2,26); h2 = _mm256_and_si256(d2,ZT_P1305_MASK26); d3 = _mm256_add_epi64(d3,c); \
+  c = _mm256_srli_epi64(d3,26); h3 = _mm256_and_si256(d3,ZT_P1305_MASK26); d4 = _mm256_add_epi64(d4,c); \
+  c = _mm256_srli_epi64(d4,26); h4 = _mm256_and_si256(d4,ZT_P1305_MASK26); \
+  h0 = _mm256_add_epi64(h0,_mm256_add_epi64(c,_mm256_slli_epi64(c,2))); \
+  c = _mm256_srli_epi64(h0,26); h0 = _mm256_and_si256(h0,ZT_P1305_MASK26); h1 = _mm256_add_epi64(h1,c); \
+}
+
+/* Add four blocks at m to h0..h4 (26-bit limbs); lanes get blocks 0, 2, 1, 3 in that order */
+#define ZT_P1305_ADDBLOCKS(h0,h1,h2,h3,h4,m) { \
+  const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(m)); \
+  const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>((m) + 32)); \
+  const __m256i lo = _mm256_unpacklo_epi64(a,b); \
+  const __m256i hi = _mm256_unpackhi_epi64(a,b); \
+  h0 = _mm256_add_epi64(h0,_mm256_and_si256(lo,ZT_P1305_MASK26)); \
+  h1 = _mm256_add_epi64(h1,_mm256_and_si256(_mm256_srli_epi64(lo,26),ZT_P1305_MASK26)); \
+  h2 = _mm256_add_epi64(h2,_mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(lo,52),_mm256_slli_epi64(hi,12)),ZT_P1305_MASK26)); \
+  h3 = _mm256_add_epi64(h3,_mm256_and_si256(_mm256_srli_epi64(hi,14),ZT_P1305_MASK26)); \
+  h4 = _mm256_add_epi64(h4,_mm256_or_si256(_mm256_srli_epi64(hi,40),_mm256_set1_epi64x(1 << 24))); \
+}
+
+/* h = (h + m[0]) * r^n + ... + m[n-1] * r for a multiple of four blocks (h and r in 44-bit limbs) */
+__attribute__((target("avx2")))
+static void
+poly1305_blocks_avx2(unsigned long long h[3], const unsigned long long r[3], const unsigned char *m, size_t bytes) {
+  unsigned long long rp[4][3],l[4][5]; /* r^1..r^4 */
+  for (int i = 0; i < 3; i++)
+    rp[0][i] = rp[1][i] = r[i];
+  poly1305_mul44(rp[1], r);
+  for (int i = 0; i < 3; i++)
+    rp[2][i] = rp[3][i] = rp[1][i];
+  poly1305_mul44(rp[2], r);
+  poly1305_mul44(rp[3], rp[1]);
+  for (int i = 0; i < 4; i++)
+    poly1305_to26(rp[i], l[i]);
+
+  /* r^4 in every lane for the loop */
+  const __m256i r0 = _mm256_set1_epi64x((long long)l[3][0]);
+  const __m256i r1 = _mm256_set1_epi64x((long long)l[3][1]);
+  const __m256i r2 = _mm256_set1_epi64x((long long)l[3][2]);
+  const __m256i r3 = _mm256_set1_epi64x((long long)l[3][3]);
+  const __m256i r4 = _mm256_set1_epi64x((long long)l[3][4]);
+  const __m256i s1 = _mm256_set1_epi64x((long long)(l[3][1] * 5));
+  const __m256i s2 = _mm256_set1_epi64x((long long)(l[3][2] * 5));
+  const __m256i s3 = _mm256_set1_epi64x((long long)(l[3][3] * 5));
+  const __m256i s4 = _mm256_set1_epi64x((long long)(l[3][4] * 5));
+
+  /* lane 0 starts with the current h */
+  unsigned long long hl[5];
+  poly1305_to26(h, hl);
+  __m256i h0 = _mm256_set_epi64x(0,0,0,(long long)hl[0]);
+  __m256i h1 = _mm256_set_epi64x(0,0,0,(long long)hl[1]);
+  __m256i h2 = _mm256_set_epi64x(0,0,0,(long long)hl[2]);
+  __m256i h3 = _mm256_set_epi64x(0,0,0,(long long)hl[3]);
+  __m256i h4 = _mm256_set_epi64x(0,0,0,(long long)hl[4]);
+
+  ZT_P1305_ADDBLOCKS(h0,h1,h2,h3,h4,m);
+  m += 64;
+  bytes -= 64;
+  while (bytes) {
+    ZT_P1305_MULR(h0,h1,h2,h3,h4,r0,r1,r2,r3,r4,s1,s2,s3,s4);
+    ZT_P1305_ADDBLOCKS(h0,h1,h2,h3,h4,m);
+    m += 64;
+    bytes -= 64;
+  }
+
+  /* last multiply is by r^4, r^2, r^3, r^1 to match the order of blocks in lanes */
+  {
+    const __m256i f0 = _mm256_set_epi64x((long long)l[0][0],(long long)l[2][0],(long long)l[1][0],(long long)l[3][0]);
+    const __m256i f1 = _mm256_set_epi64x((long long)l[0][1],(long long)l[2][1],(long long)l[1][1],(long long)l[3][1]);
+    const __m256i f2 = _mm256_set_epi64x((long long)l[0][2],(long long)l[2][2],(long long)l[1][2],(long long)l[3][2]);
+    const __m256i f3 = _mm256_set_epi64x((long long)l[0][3],(long long)l[2][3],(long long)l[1][3],(long long)l[3][3]);
+    const __m256i f4 = _mm256_set_epi64x((long long)l[0][4],(long long)l[2][4],(long long)l[1][4],(long long)l[3][4]);
+    const __m256i g1 = _mm256_add_epi64(f1,_mm256_slli_epi64(f1,2));
+    const __m256i g2 = _mm256_add_epi64(f2,_mm256_slli_epi64(f2,2));
+    const __m256i g3 = _mm256_add_epi64(f3,_mm256_slli_epi64(f3,2));
+    const __m256i g4 = _mm256_add_epi64(f4,_mm256_slli_epi64(f4,2));
+    ZT_P1305_MULR(h0,h1,h2,h3,h4,f0,f1,f2,f3,f4,g1,g2,g3,g4);
+  }
+
+  /* sum lanes and carry */
+  unsigned long long v[5][4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(v[0]),h0);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(v[1]),h1);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(v[2]),h2);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(v[3]),h3);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(v[4]),h4);
+  unsigned long long t[5],c;
+  for (int i = 0; i < 5; i++)
+    t[i] = v[i][0] + v[i][1] + v[i][2] + v[i][3];
+               c = t[0] >> 26; t[0] &= 0x3ffffff;
+  t[1] += c;   c = t[1] >> 26; t[1] &= 0x3ffffff;
+  t[2] += c;   c = t[2] >> 26; t[2] &= 0x3ffffff;
+  t[3] += c;   c = t[3] >> 26; t[3] &= 0x3ffffff;
+  t[4] += c;   c = t[4] >> 26; t[4] &= 0x3ffffff;
+  t[0] += c * 5; c = t[0] >> 26; t[0] &= 0x3ffffff;
+  t[1] += c;
+
+  /* back to 44-bit limbs */
+  unsigned long long x;
+  x = t[0] + (t[1] << 26);                   h[0] = x & 0xfffffffffff; c = x >> 44;
+  x = c + (t[2] << 8) + (t[3] << 34);        h[1] = x & 0xfffffffffff; c = x >> 44;
+  h[2] = c + (t[4] << 16);
+}
+
+namespace {
+class _poly1305avx2
+{
+public:
+  _poly1305avx2()
+  {
+    enabled = CPU::has(CPU::AVX2);
+  }
+  bool enabled;
+};
+static const _poly1305avx2 _POLY1305AVX2;
+} // anonymous namespace
+
+//////////////////////////////////////////////////////////////////////////////
+
+#endif // __GNUC__ && !ZT_NO_POLY1305_AVX2
+
 static inline void
 poly1305_init(poly1305_context *ctx, const unsigned char key[32]) {
   poly1305_state_internal_t *st = (poly1305_state_internal_t *)ctx;
@@ -234,6 +412,7 @@ poly1305_init(poly1305_context *ctx, const unsigned char key[32]) {
 
   st->leftover = 0;
   st->final = 0;
+  st->generic = 0;
 }
 
 static inline void
@@ -249,13 +428,22 @@ poly1305_blocks(poly1305_state_internal_t *st, const unsigned char *m, size_t by
   r1 = st->r[1];
   r2 = st->r[2];
 
-  h0 = st->h[0];
-  h1 = st->h[1];
-  h2 = st->h[2];
+#ifdef ZT_POLY1305_AVX2
+  if ((bytes >= ZT_POLY1305_AVX2_MIN_BYTES)&&(_POLY1305AVX2.enabled)&&(!st->final)&&(!st->generic)) {
+    const size_t vbytes = bytes & ~((size_t)63);
+    poly1305_blocks_avx2(st->h, st->r, m, vbytes);
+    m += vbytes;
+    bytes -= vbytes;
+  }
+#endif
 
   s1 = r1 * (5 << 2);
   s2 = r2 * (5 << 2);
 
+  h0 = st->h[0];
+  h1 = st->h[1];
+  h2 = st->h[2];
+
   while (bytes >= poly1305_block_size) {
     unsigned long long t0,t1;
 
@@ -625,4 +813,45 @@ void Poly1305::compute(void *auth,const void *data,unsigned int len,const void *
   poly1305_finish(&ctx,reinterpret_cast<unsigned char *>(auth));
 }
 
+void Poly1305::computeGeneric(void *auth,const void *data,unsigned int len,const void *key)
+  throw()
+{
+  poly1305_context ctx;
+  poly1305_init(&ctx,reinterpret_cast<const unsigned char *>(key));
+#ifdef ZT_POLY1305_AVX2
+  ((poly1305_state_internal_t *)&ctx)->generic = 1;
+#endif
+  poly1305_update(&ctx,reinterpret_cast<const unsigned char *>(data),(size_t)len);
+  poly1305_finish(&ctx,reinterpret_cast<unsigned char *>(auth));
+}
+
+void Poly1305::init(const void *key)
+  throw()
+{
+  static_assert(sizeof(poly1305_context) <= sizeof(_ctx),"Poly1305 context does not fit");
+  poly1305_init(reinterpret_cast<poly1305_context *>(_ctx),reinterpret_cast<const unsigned char *>(key));
+}
+
+void Poly1305::update(const void *data,unsigned int len)
+  throw()
+{
+  poly1305_update(reinterpret_cast<poly1305_context *>(_ctx),reinterpret_cast<const unsigned char *>(data),(size_t)len);
+}
+
+void Poly1305::finish(void *auth)
+  throw()
+{
+  poly1305_finish(reinterpret_cast<poly1305_context *>(_ctx),reinterpret_cast<unsigned char *>(auth));
+}
+
+const char *Poly1305::implementation()
+  throw()
+{
+#ifdef ZT_POLY1305_AVX2
+  if (_POLY1305AVX2.enabled)
+    return "avx2";
+#endif
+  return "generic";
+}
+
 } // namespace ZeroTier
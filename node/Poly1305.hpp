@@ -19,6 +19,8 @@
 #ifndef ZT_POLY1305_HPP
 #define ZT_POLY1305_HPP
 
+#include <stdint.h>
+
 namespace ZeroTier {
 
 #define ZT_POLY1305_KEY_LEN 32
@@ -48,6 +50,52 @@ public:
 	 */
 	static void compute(void *auth,const void *data,unsigned int len,const void *key)
 		throw();
+
+	/**
+	 * Compute a one-time authentication code without vector kernels
+	 *
+	 * This gives the same result as compute() and exists to test it.
+	 */
+	static void computeGeneric(void *auth,const void *data,unsigned int len,const void *key)
+		throw();
+
+	/**
+	 * @return Name of block kernel compute() uses on this CPU, e.g. "avx2" or "generic"
+	 */
+	static const char *implementation()
+		throw();
+
+	Poly1305() {}
+
+	/**
+	 * @param key 32-byte one-time use key to authenticate data (must not be reused)
+	 */
+	Poly1305(const void *key) throw() { init(key); }
+
+	/**
+	 * Begin computing a code incrementally
+	 *
+	 * init(), any number of update() calls, and finish() give the same result
+	 * as compute() on the concatenated data. Updates whose length is a
+	 * multiple of 16 are the fastest.
+	 *
+	 * @param key 32-byte one-time use key to authenticate data (must not be reused)
+	 */
+	void init(const void *key) throw();
+
+	/**
+	 * @param data Next data to authenticate
+	 * @param len Length of data in bytes
+	 */
+	void update(const void *data,unsigned int len) throw();
+
+	/**
+	 * @param auth Buffer to receive code -- MUST be 16 bytes in length
+	 */
+	void finish(void *auth) throw();
+
+private:
+	uint64_t _ctx[18];
 };
 
 } // namespace ZeroTier
@@ -40,6 +40,7 @@
 namespace ZeroTier {
 
 class RuntimeEnvironment;
+class SignatureBatch;
 
 /**
  * Revocation certificate to instantaneously revoke a COM, capability, or tag
@@ -113,9 +114,10 @@ public:
 	 * Verify this revocation's signature
 	 *
 	 * @param RR Runtime environment to provide for peer lookup, etc.
-	 * @return 0 == OK, 1 == waiting for WHOIS, -1 == BAD signature or chain
+	 * @param batch If non-NULL, queue the signature check here instead of verifying immediately
+	 * @return 0 == OK, 1 == waiting for WHOIS, -1 == BAD signature or chain, 2 == queued in batch
 	 */
-	int verify(const RuntimeEnvironment *RR) const;
+	int verify(const RuntimeEnvironment *RR,SignatureBatch *batch = (SignatureBatch *)0) const;
 
 	template<unsigned int C>
 	inline void serialize(Buffer<C> &b,const bool forSign = false) const
@@ -35,6 +35,7 @@ class Multicaster;
 class NetworkController;
 class SelfAwareness;
 class Cluster;
+class SignatureCache;
 
 /**
  * Holds global state for an instance of ZeroTier::Node
@@ -46,6 +47,7 @@ public:
 		node(n)
 		,identity()
 		,localNetworkController((NetworkController *)0)
+		,sigCache((SignatureCache *)0)
 		,sw((Switch *)0)
 		,mc((Multicaster *)0)
 		,topology((Topology *)0)
@@ -75,6 +77,7 @@ public:
 	 * These are constant and never null after startup unless indicated.
 	 */
 
+	SignatureCache *sigCache;
 	Switch *sw;
 	Multicaster *mc;
 	Topology *topology;
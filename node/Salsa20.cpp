@@ -9,6 +9,17 @@
 
 #include "Constants.hpp"
 #include "Salsa20.hpp"
+#include "CPU.hpp"
+
+#ifdef ZT_SALSA20_MULTI
+#include <immintrin.h>
+#endif
+
+#ifdef ZT_SALSA20_SSE
+#define ZT_SALSA20_SINGLE_IMPL "sse2"
+#else
+#define ZT_SALSA20_SINGLE_IMPL "generic"
+#endif
 
 #define ROTATE(v,c) (((v) << (c)) | ((v) >> (32 - (c))))
 #define XOR(v,w) ((v) ^ (w))
@@ -64,6 +75,240 @@ public:
 static const _s20sseconsts _S20SSECONSTANTS;
 #endif
 
+#ifdef ZT_SALSA20_MULTI
+
+// Salsa20 quarter round and double round over vectors of lanes, one lane per key stream
+#define ZT_S20M_QR(a,b,c,d,ADD,XOR,ROTL) \
+	b = XOR(b,ROTL(ADD(a,d),7)); \
+	c = XOR(c,ROTL(ADD(b,a),9)); \
+	d = XOR(d,ROTL(ADD(c,b),13)); \
+	a = XOR(a,ROTL(ADD(d,c),18))
+#define ZT_S20M_DOUBLEROUND(x,ADD,XOR,ROTL) \
+	ZT_S20M_QR(x[0],x[4],x[8],x[12],ADD,XOR,ROTL); \
+	ZT_S20M_QR(x[5],x[9],x[13],x[1],ADD,XOR,ROTL); \
+	ZT_S20M_QR(x[10],x[14],x[2],x[6],ADD,XOR,ROTL); \
+	ZT_S20M_QR(x[15],x[3],x[7],x[11],ADD,XOR,ROTL); \
+	ZT_S20M_QR(x[0],x[1],x[2],x[3],ADD,XOR,ROTL); \
+	ZT_S20M_QR(x[5],x[6],x[7],x[4],ADD,XOR,ROTL); \
+	ZT_S20M_QR(x[10],x[11],x[8],x[9],ADD,XOR,ROTL); \
+	ZT_S20M_QR(x[15],x[12],x[13],x[14],ADD,XOR,ROTL)
+
+#define ZT_S20M_ADD8(a,b) _mm256_add_epi32((a),(b))
+#define ZT_S20M_XOR8(a,b) _mm256_xor_si256((a),(b))
+#define ZT_S20M_ROTL8(v,n) _mm256_or_si256(_mm256_slli_epi32((v),(n)),_mm256_srli_epi32((v),32 - (n)))
+#define ZT_S20M_ADD16(a,b) _mm512_add_epi32((a),(b))
+#define ZT_S20M_XOR16(a,b) _mm512_xor_si512((a),(b))
+#define ZT_S20M_ROTL16(v,n) _mm512_rol_epi32((v),(n))
+
+namespace {
+
+// Standard Salsa20 state words, word-major: st[word][lane]
+typedef uint32_t _S20MultiState[16][ZT_SALSA20_MAX_PARALLEL];
+
+// Number of lanes that still have data at block b
+static inline unsigned int _s20MultiActive(const unsigned int *bytes,const unsigned int n,const unsigned int b)
+{
+	unsigned int active = 0;
+	for(unsigned int l=0;l<n;++l) {
+		if (bytes[l] > (b * 64))
+			++active;
+	}
+	return active;
+}
+
+// Counter words for block b of each lane
+static inline void _s20MultiCounters(const _S20MultiState &st,const unsigned int b,uint32_t *lo,uint32_t *hi)
+{
+	for(unsigned int l=0;l<ZT_SALSA20_MAX_PARALLEL;++l) {
+		const uint64_t ctr = ((uint64_t)st[8][l] | ((uint64_t)st[9][l] << 32)) + (uint64_t)b;
+		lo[l] = (uint32_t)ctr;
+		hi[l] = (uint32_t)(ctr >> 32);
+	}
+}
+
+// XOR the tail of a message with part of a key stream block
+static inline void _s20MultiXorTail(const uint8_t *ks,const uint8_t *in,uint8_t *out,const unsigned int len)
+{
+	for(unsigned int i=0;i<len;++i)
+		out[i] = in[i] ^ ks[i];
+}
+
+/*
+ * Kernels run blocks while at least two lanes still have data and return
+ * the number of blocks run. Lanes beyond n compute key stream nobody uses.
+ */
+
+__attribute__((target("avx2")))
+static unsigned int _s20crypt12x8(const _S20MultiState &st,const uint8_t *const *in,uint8_t *const *out,const unsigned int *bytes,const unsigned int n)
+{
+	__m256i j[16];
+	for(unsigned int w=0;w<16;++w)
+		j[w] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(st[w]));
+
+	unsigned int b = 0;
+	while (_s20MultiActive(bytes,n,b) >= 2) {
+		uint32_t lo[ZT_SALSA20_MAX_PARALLEL],hi[ZT_SALSA20_MAX_PARALLEL];
+		_s20MultiCounters(st,b,lo,hi);
+		j[8] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lo));
+		j[9] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hi));
+
+		__m256i x[16];
+		for(unsigned int w=0;w<16;++w)
+			x[w] = j[w];
+		for(unsigned int r=0;r<6;++r) {
+			ZT_S20M_DOUBLEROUND(x,ZT_S20M_ADD8,ZT_S20M_XOR8,ZT_S20M_ROTL8);
+		}
+		for(unsigned int w=0;w<16;++w)
+			x[w] = _mm256_add_epi32(x[w],j[w]);
+
+		// Transpose each half (words 0-7 and 8-15) so k[h][l] is 32 bytes of lane l's block
+		__m256i k[2][8];
+		for(unsigned int h=0;h<2;++h) {
+			const __m256i *const r = x + (h * 8);
+			const __m256i t0 = _mm256_unpacklo_epi32(r[0],r[1]),t1 = _mm256_unpackhi_epi32(r[0],r[1]);
+			const __m256i t2 = _mm256_unpacklo_epi32(r[2],r[3]),t3 = _mm256_unpackhi_epi32(r[2],r[3]);
+			const __m256i t4 = _mm256_unpacklo_epi32(r[4],r[5]),t5 = _mm256_unpackhi_epi32(r[4],r[5]);
+			const __m256i t6 = _mm256_unpacklo_epi32(r[6],r[7]),t7 = _mm256_unpackhi_epi32(r[6],r[7]);
+			const __m256i u0 = _mm256_unpacklo_epi64(t0,t2),u1 = _mm256_unpackhi_epi64(t0,t2);
+			const __m256i u2 = _mm256_unpacklo_epi64(t1,t3),u3 = _mm256_unpackhi_epi64(t1,t3);
+			const __m256i u4 = _mm256_unpacklo_epi64(t4,t6),u5 = _mm256_unpackhi_epi64(t4,t6);
+			const __m256i u6 = _mm256_unpacklo_epi64(t5,t7),u7 = _mm256_unpackhi_epi64(t5,t7);
+			k[h][0] = _mm256_permute2x128_si256(u0,u4,0x20);
+			k[h][1] = _mm256_permute2x128_si256(u1,u5,0x20);
+			k[h][2] = _mm256_permute2x128_si256(u2,u6,0x20);
+			k[h][3] = _mm256_permute2x128_si256(u3,u7,0x20);
+			k[h][4] = _mm256_permute2x128_si256(u0,u4,0x31);
+			k[h][5] = _mm256_permute2x128_si256(u1,u5,0x31);
+			k[h][6] = _mm256_permute2x128_si256(u2,u6,0x31);
+			k[h][7] = _mm256_permute2x128_si256(u3,u7,0x31);
+		}
+
+		const unsigned int off = b * 64;
+		for(unsigned int l=0;l<n;++l) {
+			if (bytes[l] <= off)
+				continue;
+			const unsigned int len = bytes[l] - off;
+			const uint8_t *const m = in[l] + off;
+			uint8_t *const c = out[l] + off;
+			if (len >= 64) {
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(c),_mm256_xor_si256(k[0][l],_mm256_loadu_si256(reinterpret_cast<const __m256i *>(m))));
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(c + 32),_mm256_xor_si256(k[1][l],_mm256_loadu_si256(reinterpret_cast<const __m256i *>(m + 32))));
+			} else {
+				uint8_t ks[64];
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(ks),k[0][l]);
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(ks + 32),k[1][l]);
+				_s20MultiXorTail(ks,m,c,len);
+			}
+		}
+
+		++b;
+	}
+
+	return b;
+}
+
+// GCC 12 wrongly warns about _mm512_undefined_epi32() inside AVX-512 intrinsics
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+__attribute__((target("avx512f")))
+static unsigned int _s20crypt12x16(const _S20MultiState &st,const uint8_t *const *in,uint8_t *const *out,const unsigned int *bytes,const unsigned int n)
+{
+	__m512i j[16];
+	for(unsigned int w=0;w<16;++w)
+		j[w] = _mm512_loadu_si512(reinterpret_cast<const void *>(st[w]));
+
+	unsigned int b = 0;
+	while (_s20MultiActive(bytes,n,b) >= 2) {
+		uint32_t lo[ZT_SALSA20_MAX_PARALLEL],hi[ZT_SALSA20_MAX_PARALLEL];
+		_s20MultiCounters(st,b,lo,hi);
+		j[8] = _mm512_loadu_si512(reinterpret_cast<const void *>(lo));
+		j[9] = _mm512_loadu_si512(reinterpret_cast<const void *>(hi));
+
+		__m512i x[16];
+		for(unsigned int w=0;w<16;++w)
+			x[w] = j[w];
+		for(unsigned int r=0;r<6;++r) {
+			ZT_S20M_DOUBLEROUND(x,ZT_S20M_ADD16,ZT_S20M_XOR16,ZT_S20M_ROTL16);
+		}
+		for(unsigned int w=0;w<16;++w)
+			x[w] = _mm512_add_epi32(x[w],j[w]);
+
+		// Transpose 16x16 so k[l] is lane l's whole block
+		__m512i t[16],u[16],k[16];
+		for(unsigned int i=0;i<16;i+=2) {
+			t[i] = _mm512_unpacklo_epi32(x[i],x[i + 1]);
+			t[i + 1] = _mm512_unpackhi_epi32(x[i],x[i + 1]);
+		}
+		for(unsigned int i=0;i<16;i+=4) {
+			u[i] = _mm512_unpacklo_epi64(t[i],t[i + 2]);
+			u[i + 1] = _mm512_unpackhi_epi64(t[i],t[i + 2]);
+			u[i + 2] = _mm512_unpacklo_epi64(t[i + 1],t[i + 3]);
+			u[i + 3] = _mm512_unpackhi_epi64(t[i + 1],t[i + 3]);
+		}
+		// 128-bit chunk c of u[4g+i] now holds words 4g..4g+3 of lane 4c+i
+		for(unsigned int i=0;i<4;++i) {
+			const __m512i s0 = _mm512_shuffle_i32x4(u[i],u[4 + i],0x44);
+			const __m512i s1 = _mm512_shuffle_i32x4(u[i],u[4 + i],0xee);
+			const __m512i s2 = _mm512_shuffle_i32x4(u[8 + i],u[12 + i],0x44);
+			const __m512i s3 = _mm512_shuffle_i32x4(u[8 + i],u[12 + i],0xee);
+			k[i] = _mm512_shuffle_i32x4(s0,s2,0x88);
+			k[4 + i] = _mm512_shuffle_i32x4(s0,s2,0xdd);
+			k[8 + i] = _mm512_shuffle_i32x4(s1,s3,0x88);
+			k[12 + i] = _mm512_shuffle_i32x4(s1,s3,0xdd);
+		}
+
+		const unsigned int off = b * 64;
+		for(unsigned int l=0;l<n;++l) {
+			if (bytes[l] <= off)
+				continue;
+			const unsigned int len = bytes[l] - off;
+			const uint8_t *const m = in[l] + off;
+			uint8_t *const c = out[l] + off;
+			if (len >= 64) {
+				_mm512_storeu_si512(reinterpret_cast<void *>(c),_mm512_xor_si512(k[l],_mm512_loadu_si512(reinterpret_cast<const void *>(m))));
+			} else {
+				uint8_t ks[64];
+				_mm512_storeu_si512(reinterpret_cast<void *>(ks),k[l]);
+				_s20MultiXorTail(ks,m,c,len);
+			}
+		}
+
+		++b;
+	}
+
+	return b;
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// Kernel for this CPU, chosen once at startup
+class _s20multi
+{
+public:
+	_s20multi() :
+		kernel((unsigned int (*)(const _S20MultiState &,const uint8_t *const *,uint8_t *const *,const unsigned int *,const unsigned int))0),
+		lanes(1)
+	{
+		if (ZeroTier::CPU::has(ZeroTier::CPU::AVX512F)) {
+			kernel = _s20crypt12x16;
+			lanes = 16;
+		} else if (ZeroTier::CPU::has(ZeroTier::CPU::AVX2)) {
+			kernel = _s20crypt12x8;
+			lanes = 8;
+		}
+	}
+	unsigned int (*kernel)(const _S20MultiState &,const uint8_t *const *,uint8_t *const *,const unsigned int *,const unsigned int);
+	unsigned int lanes;
+};
+static const _s20multi _S20MULTI;
+
+} // anonymous namespace
+
+#endif // ZT_SALSA20_MULTI
+
 namespace ZeroTier {
 
 void Salsa20::init(const void *key,unsigned int kbits,const void *iv)
@@ -1355,4 +1600,80 @@ void Salsa20::crypt20(const void *in,void *out,unsigned int bytes)
 	}
 }
 
+void Salsa20::crypt12Many(Salsa20 *const *s,const void *const *in,void *const *out,const unsigned int *bytes,unsigned int count)
+	throw()
+{
+#ifdef ZT_SALSA20_MULTI
+	// Word i of each cipher's state is standard Salsa20 state word sw[i]
+#ifdef ZT_SALSA20_SSE
+	static const unsigned int sw[16] = { 0,5,10,15,4,9,14,3,8,13,2,7,12,1,6,11 };
+#else
+	static const unsigned int sw[16] = { 0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15 };
+#endif
+	if (_S20MULTI.kernel) {
+		while (count >= 2) {
+			const unsigned int n = (count < _S20MULTI.lanes) ? count : _S20MULTI.lanes;
+
+			_S20MultiState st;
+			memset(st,0,sizeof(st));
+			for(unsigned int l=0;l<n;++l) {
+				for(unsigned int i=0;i<16;++i)
+					st[sw[i]][l] = s[l]->_state.i[i];
+			}
+
+			const unsigned int blocks = _S20MULTI.kernel(st,reinterpret_cast<const uint8_t *const *>(in),reinterpret_cast<uint8_t *const *>(out),bytes,n);
+
+			for(unsigned int l=0;l<n;++l) {
+				if (!bytes[l])
+					continue;
+				Salsa20 &c = *(s[l]);
+				uint64_t ctr = (uint64_t)st[8][l] | ((uint64_t)st[9][l] << 32);
+				unsigned int done = blocks * 64;
+				if (done > bytes[l])
+					done = bytes[l];
+				ctr += (uint64_t)((done + 63) / 64);
+				st[8][l] = (uint32_t)ctr;
+				st[9][l] = (uint32_t)(ctr >> 32);
+				for(unsigned int i=0;i<16;++i)
+					c._state.i[i] = st[sw[i]][l];
+				if (done < bytes[l]) // at most one lane is left with data
+					c.crypt12(reinterpret_cast<const uint8_t *>(in[l]) + done,reinterpret_cast<uint8_t *>(out[l]) + done,bytes[l] - done);
+			}
+
+			Utils::burn(st,sizeof(st));
+			s += n;
+			in += n;
+			out += n;
+			bytes += n;
+			count -= n;
+		}
+	}
+#endif
+
+	for(unsigned int i=0;i<count;++i)
+		s[i]->crypt12(in[i],out[i],bytes[i]);
+}
+
+unsigned int Salsa20::parallelism()
+	throw()
+{
+#ifdef ZT_SALSA20_MULTI
+	return _S20MULTI.lanes;
+#else
+	return 1;
+#endif
+}
+
+const char *Salsa20::implementation()
+	throw()
+{
+#ifdef ZT_SALSA20_MULTI
+	if (_S20MULTI.lanes == 16)
+		return ZT_SALSA20_SINGLE_IMPL "+avx512x16";
+	if (_S20MULTI.lanes == 8)
+		return ZT_SALSA20_SINGLE_IMPL "+avx2x8";
+#endif
+	return ZT_SALSA20_SINGLE_IMPL;
+}
+
 } // namespace ZeroTier
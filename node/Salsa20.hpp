@@ -22,6 +22,16 @@
 #include <emmintrin.h>
 #endif // ZT_SALSA20_SSE
 
+// Multi-buffer AVX2/AVX-512 kernels, selected at runtime (GCC/clang on x86 only)
+#if (!defined(ZT_SALSA20_MULTI)) && (!defined(ZT_NO_SALSA20_MULTI)) && defined(__GNUC__) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#define ZT_SALSA20_MULTI 1
+#endif
+
+/**
+ * Maximum number of messages crypt12Many() works on at once
+ */
+#define ZT_SALSA20_MAX_PARALLEL 16
+
 namespace ZeroTier {
 
 /**
@@ -75,6 +85,35 @@ public:
 	void crypt20(const void *in,void *out,unsigned int bytes)
 		throw();
 
+	/**
+	 * Encrypt/decrypt several independent messages using Salsa20/12
+	 *
+	 * The result is the same as calling crypt12() for each message with its
+	 * own cipher, but on CPUs with AVX2 or AVX-512 up to 8 or 16 key streams
+	 * are computed at once, one in each vector lane. Messages of similar
+	 * length benefit most.
+	 *
+	 * @param s Ciphers, one per message (must be distinct)
+	 * @param in Input data for each message
+	 * @param out Output buffer for each message (may equal input)
+	 * @param bytes Length of each message
+	 * @param count Number of messages
+	 */
+	static void crypt12Many(Salsa20 *const *s,const void *const *in,void *const *out,const unsigned int *bytes,unsigned int count)
+		throw();
+
+	/**
+	 * @return Number of messages crypt12Many() works on in parallel on this CPU (1 if no multi-buffer support)
+	 */
+	static unsigned int parallelism()
+		throw();
+
+	/**
+	 * @return Name of kernels in use, e.g. "sse2" or "sse2+avx2x8" (single message, then multi-buffer if any)
+	 */
+	static const char *implementation()
+		throw();
+
 private:
 	union {
 #ifdef ZT_SALSA20_SSE
@@ -0,0 +1,128 @@
+/*
+ * ZeroTier One - Network Virtualization Everywhere
+ * Copyright (C) 2011-2016  ZeroTier, Inc.  https://www.zerotier.com/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ZT_SIGNATUREBATCH_HPP
+#define ZT_SIGNATUREBATCH_HPP
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "Constants.hpp"
+#include "C25519.hpp"
+
+namespace ZeroTier {
+
+/**
+ * A queue of signatures to be checked together with C25519::verifyBatch()
+ *
+ * Credentials' verify() methods take an optional batch, which SignatureCache
+ * uses for anything it doesn't already know about. The first time a
+ * signature is seen it is queued and check() returns 2. Once verify() has
+ * run, the same check() returns the result. A caller can make one pass over
+ * a set of credentials to queue their signatures, call verify(), and then
+ * make a second pass to act on the results.
+ *
+ * This class is not thread safe.
+ */
+class SignatureBatch
+{
+public:
+	SignatureBatch() : _pending(0) {}
+
+	/**
+	 * Look up or queue a signature
+	 *
+	 * @param signer Signer's public key
+	 * @param data Signed data
+	 * @param len Length of signed data
+	 * @param signature Signature
+	 * @return 0 == valid, -1 == invalid, 2 == queued for verify()
+	 */
+	inline int check(const C25519::Public &signer,const void *data,unsigned int len,const C25519::Signature &signature)
+	{
+		for(std::vector<_Entry>::const_iterator e(_entries.begin());e!=_entries.end();++e) {
+			if ((e->signature == signature)&&(e->key == signer)&&(e->data.length() == len)&&(!memcmp(e->data.data(),data,len)))
+				return e->result;
+		}
+		_entries.push_back(_Entry());
+		_Entry &e = _entries.back();
+		e.key = signer;
+		e.signature = signature;
+		e.data.assign(reinterpret_cast<const char *>(data),len);
+		e.result = 2;
+		++_pending;
+		return 2;
+	}
+
+	/**
+	 * Verify all queued signatures
+	 *
+	 * @return Number of signatures checked
+	 */
+	inline unsigned int verify()
+	{
+		if (!_pending)
+			return 0;
+		std::vector<_Entry *> q;
+		for(std::vector<_Entry>::iterator e(_entries.begin());e!=_entries.end();++e) {
+			if (e->result == 2)
+				q.push_back(&(*e));
+		}
+		const unsigned int n = (unsigned int)q.size();
+		std::vector<const C25519::Public *> keys(n);
+		std::vector<const void *> msgs(n);
+		std::vector<unsigned int> lens(n);
+		std::vector<const void *> sigs(n);
+		bool *const ok = new bool[n];
+		for(unsigned int i=0;i<n;++i) {
+			keys[i] = &(q[i]->key);
+			msgs[i] = q[i]->data.data();
+			lens[i] = (unsigned int)q[i]->data.length();
+			sigs[i] = q[i]->signature.data;
+		}
+		C25519::verifyBatch(&(keys[0]),&(msgs[0]),&(lens[0]),&(sigs[0]),ok,n);
+		for(unsigned int i=0;i<n;++i)
+			q[i]->result = (ok[i]) ? 0 : -1;
+		delete [] ok;
+		_pending = 0;
+		return n;
+	}
+
+	/**
+	 * @return Number of signatures waiting for verify()
+	 */
+	inline unsigned int pending() const { return _pending; }
+
+private:
+	struct _Entry
+	{
+		C25519::Public key;
+		C25519::Signature signature;
+		std::string data;
+		int result;
+	};
+
+	std::vector<_Entry> _entries;
+	unsigned int _pending;
+};
+
+} // namespace ZeroTier
+
+#endif
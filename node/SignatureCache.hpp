@@ -0,0 +1,159 @@
+/*
+ * ZeroTier One - Network Virtualization Everywhere
+ * Copyright (C) 2011-2016  ZeroTier, Inc.  https://www.zerotier.com/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ZT_SIGNATURECACHE_HPP
+#define ZT_SIGNATURECACHE_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include "Constants.hpp"
+#include "C25519.hpp"
+#include "SHA512.hpp"
+#include "Mutex.hpp"
+#include "Utils.hpp"
+#include "NonCopyable.hpp"
+#include "SignatureBatch.hpp"
+
+#define ZT_SIGNATURE_CACHE_STRIPE_SIZE (ZT_SIGNATURE_CACHE_SIZE / ZT_SIGNATURE_CACHE_STRIPES)
+
+namespace ZeroTier {
+
+/**
+ * A bounded cache of signatures that have already been verified
+ *
+ * Peers re-send the same credentials every time they push them, so most
+ * signature checks are for something we have checked before. Entries are a
+ * salted SHA-512 hash of signer, signature, and signed data, so a hit means
+ * the exact same signature over the exact same bytes. Only valid signatures
+ * are remembered. The cache is split into independently locked stripes,
+ * each of which is direct mapped, so a new entry simply replaces whatever
+ * was in its slot.
+ */
+class SignatureCache : NonCopyable
+{
+public:
+	SignatureCache()
+	{
+		for(unsigned int i=0;i<ZT_SIGNATURE_CACHE_STRIPES;++i) {
+			_stripes[i].hits = 0;
+			_stripes[i].misses = 0;
+			memset(_stripes[i].entries,0,sizeof(_stripes[i].entries));
+		}
+		Utils::getSecureRandom(_salt,sizeof(_salt));
+	}
+
+	~SignatureCache() { Utils::burn(_salt,sizeof(_salt)); }
+
+	/**
+	 * Check a signature, using the cache if possible
+	 *
+	 * @param signer Signer's public key
+	 * @param data Signed data
+	 * @param len Length of signed data
+	 * @param signature Signature
+	 * @param batch If non-NULL, queue signatures not in the cache here instead of verifying them now
+	 * @return 0 == valid, -1 == invalid, 2 == queued in batch
+	 */
+	inline int verify(const C25519::Public &signer,const void *data,unsigned int len,const C25519::Signature &signature,SignatureBatch *batch = (SignatureBatch *)0)
+	{
+		uint8_t key[64];
+		_key(signer,data,len,signature,key);
+		_Stripe &s = _stripes[key[0] & (ZT_SIGNATURE_CACHE_STRIPES - 1)];
+		uint8_t *const slot = s.entries[((((unsigned int)key[1]) << 16) | (((unsigned int)key[2]) << 8) | (unsigned int)key[3]) % ZT_SIGNATURE_CACHE_STRIPE_SIZE];
+
+		{
+			Mutex::Lock _l(s.lock);
+			if (!memcmp(slot,key + 32,32)) {
+				++s.hits;
+				return 0;
+			}
+		}
+
+		int r;
+		if (batch) {
+			r = batch->check(signer,data,len,signature);
+			if (r == 2) {
+				Mutex::Lock _l(s.lock);
+				++s.misses;
+			}
+		} else {
+			r = (C25519::verify(signer,data,len,signature)) ? 0 : -1;
+			Mutex::Lock _l(s.lock);
+			++s.misses;
+		}
+
+		if (r == 0) {
+			Mutex::Lock _l(s.lock);
+			memcpy(slot,key + 32,32);
+		}
+		return r;
+	}
+
+	/**
+	 * @return Number of signature checks answered from the cache
+	 */
+	inline uint64_t hits() const
+	{
+		uint64_t n = 0;
+		for(unsigned int i=0;i<ZT_SIGNATURE_CACHE_STRIPES;++i) {
+			Mutex::Lock _l(_stripes[i].lock);
+			n += _stripes[i].hits;
+		}
+		return n;
+	}
+
+	/**
+	 * @return Number of signatures that had to be verified
+	 */
+	inline uint64_t misses() const
+	{
+		uint64_t n = 0;
+		for(unsigned int i=0;i<ZT_SIGNATURE_CACHE_STRIPES;++i) {
+			Mutex::Lock _l(_stripes[i].lock);
+			n += _stripes[i].misses;
+		}
+		return n;
+	}
+
+private:
+	inline void _key(const C25519::Public &signer,const void *data,unsigned int len,const C25519::Signature &signature,uint8_t key[64]) const
+	{
+		uint8_t tmp[sizeof(_salt) + ZT_C25519_PUBLIC_KEY_LEN + ZT_C25519_SIGNATURE_LEN + 64];
+		memcpy(tmp,_salt,sizeof(_salt));
+		memcpy(tmp + sizeof(_salt),signer.data,ZT_C25519_PUBLIC_KEY_LEN);
+		memcpy(tmp + sizeof(_salt) + ZT_C25519_PUBLIC_KEY_LEN,signature.data,ZT_C25519_SIGNATURE_LEN);
+		SHA512::hash(tmp + sizeof(_salt) + ZT_C25519_PUBLIC_KEY_LEN + ZT_C25519_SIGNATURE_LEN,data,len);
+		SHA512::hash(key,tmp,sizeof(tmp));
+	}
+
+	struct _Stripe
+	{
+		Mutex lock;
+		uint64_t hits;
+		uint64_t misses;
+		uint8_t entries[ZT_SIGNATURE_CACHE_STRIPE_SIZE][32];
+	};
+
+	_Stripe _stripes[ZT_SIGNATURE_CACHE_STRIPES];
+	uint8_t _salt[16];
+};
+
+} // namespace ZeroTier
+
+#endif
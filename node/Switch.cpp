@@ -60,16 +60,61 @@ Switch::Switch(const RuntimeEnvironment *renv) :
 	RR(renv),
 	_lastBeaconResponse(0),
 	_outstandingWhoisRequests(32),
+	_rxQueue((RXQueueEntry *)0),
+	_rxQueueBuckets((unsigned int *)0),
+	_rxQueueEvictions(0),
+	_rxQueueSourceLimitEvictions(0),
+	_rxQueueExpirations(0),
 	_lastUniteAttempt(8) // only really used on root servers and upstreams, and it'll grow there just fine
 {
+	Utils::getSecureRandom(&_rxQueueHashMultiplier,sizeof(_rxQueueHashMultiplier));
+	_rxQueueHashMultiplier |= 1;
+	_allocateRXQueue(ZT_RX_QUEUE_SIZE);
+}
+
+Switch::~Switch()
+{
+	delete [] _rxQueue;
+	delete [] _rxQueueBuckets;
+}
+
+// Packet ID (IV) at the start of both packet heads and fragments, big-endian and not necessarily aligned
+static inline uint64_t _wirePacketId(const uint8_t *d)
+{
+	return (
+		(((uint64_t)d[0]) << 56) |
+		(((uint64_t)d[1]) << 48) |
+		(((uint64_t)d[2]) << 40) |
+		(((uint64_t)d[3]) << 32) |
+		(((uint64_t)d[4]) << 24) |
+		(((uint64_t)d[5]) << 16) |
+		(((uint64_t)d[6]) << 8) |
+		((uint64_t)d[7])
+	);
 }
 
 void Switch::onRemotePacket(const InetAddress &localAddr,const InetAddress &fromAddr,const void *data,unsigned int len)
 {
-	try {
-		const uint64_t now = RR->node->now();
+	SharedPtr<Path> path;
+	SharedPtr<Peer> peer;
+	_onRemotePacket(RR->node->now(),path,peer,localAddr,fromAddr,data,len);
+}
+
+void Switch::onRemotePackets(const ZT_WirePacket *packets,unsigned int count)
+{
+	const uint64_t now = RR->node->now();
+	SharedPtr<Path> path;
+	SharedPtr<Peer> peer;
+	for(unsigned int i=0;i<count;++i)
+		_onRemotePacket(now,path,peer,*(reinterpret_cast<const InetAddress *>(packets[i].localAddress)),*(reinterpret_cast<const InetAddress *>(packets[i].remoteAddress)),packets[i].packetData,packets[i].packetLength);
+}
 
-		SharedPtr<Path> path(RR->topology->getPath(localAddr,fromAddr));
+void Switch::_onRemotePacket(const uint64_t now,SharedPtr<Path> &path,SharedPtr<Peer> &peer,const InetAddress &localAddr,const InetAddress &fromAddr,const void *data,unsigned int len)
+{
+	try {
+		// Runs of packets from the same origin (e.g. from a batched receive) reuse the last path
+		if ((!path)||(path->address() != fromAddr)||(path->localAddress() != localAddr))
+			path = RR->topology->getPath(localAddr,fromAddr);
 		path->received(now);
 
 		if (len == 13) {
@@ -97,8 +142,9 @@ void Switch::onRemotePacket(const InetAddress &localAddr,const InetAddress &from
 			if (reinterpret_cast<const uint8_t *>(data)[ZT_PACKET_FRAGMENT_IDX_FRAGMENT_INDICATOR] == ZT_PACKET_FRAGMENT_INDICATOR) {
 				// Handle fragment ----------------------------------------------------
 
-				Packet::Fragment fragment(data,len);
-				const Address destination(fragment.destination());
+				// Fragments are parsed in place; only relayed ones are copied (to increment hops)
+				const uint8_t *const d = reinterpret_cast<const uint8_t *>(data);
+				const Address destination(d + ZT_PACKET_FRAGMENT_IDX_DEST,ZT_ADDRESS_LENGTH);
 
 				if (destination != RR->identity.address()) {
 #ifdef ZT_ENABLE_CLUSTER
@@ -110,12 +156,13 @@ void Switch::onRemotePacket(const InetAddress &localAddr,const InetAddress &from
 					if ( (!RR->topology->amRoot()) && (!path->trustEstablished(now)) && (!isClusterFrontplane) )
 						return;
 
-					if (fragment.hops() < ZT_RELAY_MAX_HOPS) {
+					if (d[ZT_PACKET_FRAGMENT_IDX_HOPS] < ZT_RELAY_MAX_HOPS) {
+						Packet::Fragment fragment(data,len);
 						fragment.incrementHops();
 
 						// Note: we don't bother initiating NAT-t for fragments, since heads will set that off.
 						// It wouldn't hurt anything, just redundant and unnecessary.
-						SharedPtr<Peer> relayTo = RR->topology->getPeer(destination);
+						SharedPtr<Peer> relayTo = _getPeer(destination,peer);
 						if ((!relayTo)||(!relayTo->sendDirect(fragment.data(),fragment.size(),now,false))) {
 #ifdef ZT_ENABLE_CLUSTER
 							if ((RR->cluster)&&(!isClusterFrontplane)) {
@@ -134,45 +181,52 @@ void Switch::onRemotePacket(const InetAddress &localAddr,const InetAddress &from
 					}
 				} else {
 					// Fragment looks like ours
-					const uint64_t fragmentPacketId = fragment.packetId();
-					const unsigned int fragmentNumber = fragment.fragmentNumber();
-					const unsigned int totalFragments = fragment.totalFragments();
+					const uint64_t fragmentPacketId = _wirePacketId(d);
+					const unsigned int fragmentNumber = ((unsigned int)d[ZT_PACKET_FRAGMENT_IDX_FRAGMENT_NO] & 0xf);
+					const unsigned int totalFragments = (((unsigned int)d[ZT_PACKET_FRAGMENT_IDX_FRAGMENT_NO] >> 4) & 0xf);
+					const uint8_t *const payload = d + ZT_PACKET_FRAGMENT_IDX_PAYLOAD;
+					const unsigned int payloadLength = len - ZT_PACKET_FRAGMENT_IDX_PAYLOAD;
 
-					if ((totalFragments <= ZT_MAX_PACKET_FRAGMENTS)&&(fragmentNumber < ZT_MAX_PACKET_FRAGMENTS)&&(fragmentNumber > 0)&&(totalFragments > 1)) {
+					if ((totalFragments <= ZT_MAX_PACKET_FRAGMENTS)&&(fragmentNumber < ZT_MAX_PACKET_FRAGMENTS)&&(fragmentNumber > 0)&&(totalFragments > 1)&&(len <= ZT_PROTO_MAX_PACKET_LENGTH)) {
 						// Fragment appears basically sane. Its fragment number must be
 						// 1 or more, since a Packet with fragmented bit set is fragment 0.
 						// Total fragments must be more than 1, otherwise why are we
 						// seeing a Packet::Fragment?
 
 						Mutex::Lock _l(_rxQueue_m);
-						RXQueueEntry *const rq = _findRXQueueEntry(now,fragmentPacketId);
+						RXQueueEntry *rq = _findRXQueueEntry(now,fragmentPacketId);
 
-						if ((!rq->timestamp)||(rq->packetId != fragmentPacketId)) {
+						if (!rq) {
 							// No packet found, so we received a fragment without its head.
 							//TRACE("fragment (%u/%u) of %.16llx from %s",fragmentNumber + 1,totalFragments,fragmentPacketId,fromAddr.toString().c_str());
 
-							rq->timestamp = now;
-							rq->packetId = fragmentPacketId;
-							rq->frags[fragmentNumber - 1] = fragment;
+							rq = _newRXQueueEntry(now,fragmentPacketId,path);
+							rq->frags[fragmentNumber - 1].len = payloadLength;
+							memcpy(rq->frags[fragmentNumber - 1].data,payload,payloadLength);
 							rq->totalFragments = totalFragments; // total fragment count is known
+							rq->assembledFragments = 0;
 							rq->haveFragments = 1 << fragmentNumber; // we have only this fragment
 							rq->complete = false;
 						} else if (!(rq->haveFragments & (1 << fragmentNumber))) {
 							// We have other fragments and maybe the head, so add this one and check
 							//TRACE("fragment (%u/%u) of %.16llx from %s",fragmentNumber + 1,totalFragments,fragmentPacketId,fromAddr.toString().c_str());
 
-							rq->frags[fragmentNumber - 1] = fragment;
+							if (fragmentNumber == rq->assembledFragments) {
+								rq->frag0.append(payload,payloadLength);
+								++rq->assembledFragments;
+							} else {
+								rq->frags[fragmentNumber - 1].len = payloadLength;
+								memcpy(rq->frags[fragmentNumber - 1].data,payload,payloadLength);
+							}
+							rq->haveFragments |= (1 << fragmentNumber);
 							rq->totalFragments = totalFragments;
 
-							if (Utils::countBits(rq->haveFragments |= (1 << fragmentNumber)) == totalFragments) {
-								// We have all fragments -- assemble and process full Packet
-								//TRACE("packet %.16llx is complete, assembling and processing...",fragmentPacketId);
-
-								for(unsigned int f=1;f<totalFragments;++f)
-									rq->frag0.append(rq->frags[f - 1].payload(),rq->frags[f - 1].payloadLength());
+							if (_assembleRXQueueEntry(rq)) {
+								// We have all fragments -- process full Packet
+								//TRACE("packet %.16llx is complete, processing...",fragmentPacketId);
 
 								if (rq->frag0.tryDecode(RR)) {
-									rq->timestamp = 0; // packet decoded, free entry
+									_freeRXQueueEntry(rq); // packet decoded, free entry
 								} else {
 									rq->complete = true; // set complete flag but leave entry since it probably needs WHOIS or something
 								}
@@ -212,7 +266,7 @@ void Switch::onRemotePacket(const InetAddress &localAddr,const InetAddress &from
 						packet.incrementHops();
 #endif
 
-						SharedPtr<Peer> relayTo = RR->topology->getPeer(destination);
+						SharedPtr<Peer> relayTo = _getPeer(destination,peer);
 						if ((relayTo)&&(relayTo->sendDirect(packet.data(),packet.size(),now,false))) {
 							if ((source != RR->identity.address())&&(_shouldUnite(now,source,destination))) { // don't send RENDEZVOUS for cluster frontplane relays
 								const InetAddress *hintToSource = (InetAddress *)0;
@@ -286,67 +340,48 @@ void Switch::onRemotePacket(const InetAddress &localAddr,const InetAddress &from
 				} else if ((reinterpret_cast<const uint8_t *>(data)[ZT_PACKET_IDX_FLAGS] & ZT_PROTO_FLAG_FRAGMENTED) != 0) {
 					// Packet is the head of a fragmented packet series
 
-					const uint64_t packetId = (
-						(((uint64_t)reinterpret_cast<const uint8_t *>(data)[0]) << 56) |
-						(((uint64_t)reinterpret_cast<const uint8_t *>(data)[1]) << 48) |
-						(((uint64_t)reinterpret_cast<const uint8_t *>(data)[2]) << 40) |
-						(((uint64_t)reinterpret_cast<const uint8_t *>(data)[3]) << 32) |
-						(((uint64_t)reinterpret_cast<const uint8_t *>(data)[4]) << 24) |
-						(((uint64_t)reinterpret_cast<const uint8_t *>(data)[5]) << 16) |
-						(((uint64_t)reinterpret_cast<const uint8_t *>(data)[6]) << 8) |
-						((uint64_t)reinterpret_cast<const uint8_t *>(data)[7])
-					);
+					const uint64_t packetId = _wirePacketId(reinterpret_cast<const uint8_t *>(data));
 
 					Mutex::Lock _l(_rxQueue_m);
-					RXQueueEntry *const rq = _findRXQueueEntry(now,packetId);
+					RXQueueEntry *rq = _findRXQueueEntry(now,packetId);
 
-					if ((!rq->timestamp)||(rq->packetId != packetId)) {
+					if (!rq) {
 						// If we have no other fragments yet, create an entry and save the head
 						//TRACE("fragment (0/?) of %.16llx from %s",pid,fromAddr.toString().c_str());
 
-						rq->timestamp = now;
-						rq->packetId = packetId;
+						rq = _newRXQueueEntry(now,packetId,path);
 						rq->frag0.init(data,len,path,now);
 						rq->totalFragments = 0;
+						rq->assembledFragments = 1;
 						rq->haveFragments = 1;
 						rq->complete = false;
 					} else if (!(rq->haveFragments & 1)) {
-						// If we have other fragments but no head, see if we are complete with the head
+						// If we have other fragments but no head, add the head and see if we are complete
 
-						if ((rq->totalFragments > 1)&&(Utils::countBits(rq->haveFragments |= 1) == rq->totalFragments)) {
-							// We have all fragments -- assemble and process full Packet
-							//TRACE("packet %.16llx is complete, assembling and processing...",pid);
+						rq->frag0.init(data,len,path,now);
+						rq->assembledFragments = 1;
+						rq->haveFragments |= 1;
 
-							rq->frag0.init(data,len,path,now);
-							for(unsigned int f=1;f<rq->totalFragments;++f)
-								rq->frag0.append(rq->frags[f - 1].payload(),rq->frags[f - 1].payloadLength());
+						if (_assembleRXQueueEntry(rq)) {
+							// We have all fragments -- process full Packet
+							//TRACE("packet %.16llx is complete, processing...",pid);
 
 							if (rq->frag0.tryDecode(RR)) {
-								rq->timestamp = 0; // packet decoded, free entry
+								_freeRXQueueEntry(rq); // packet decoded, free entry
 							} else {
 								rq->complete = true; // set complete flag but leave entry since it probably needs WHOIS or something
 							}
-						} else {
-							// Still waiting on more fragments, but keep the head
-							rq->frag0.init(data,len,path,now);
 						}
 					} // else this is a duplicate head, ignore
 				} else {
 					// Packet is unfragmented, so just process it
 					IncomingPacket packet(data,len,path,now);
-					if (!packet.tryDecode(RR)) {
+					if (!packet.tryDecode(RR,&peer)) {
 						Mutex::Lock _l(_rxQueue_m);
-						RXQueueEntry *rq = &(_rxQueue[ZT_RX_QUEUE_SIZE - 1]);
-						unsigned long i = ZT_RX_QUEUE_SIZE - 1;
-						while ((i)&&(rq->timestamp)) {
-							RXQueueEntry *tmp = &(_rxQueue[--i]);
-							if (tmp->timestamp < rq->timestamp)
-								rq = tmp;
-						}
-						rq->timestamp = now;
-						rq->packetId = packet.packetId();
+						RXQueueEntry *const rq = _newRXQueueEntry(now,packet.packetId(),path);
 						rq->frag0 = packet;
 						rq->totalFragments = 1;
+						rq->assembledFragments = 1;
 						rq->haveFragments = 1;
 						rq->complete = true;
 					}
@@ -656,13 +691,12 @@ void Switch::doAnythingWaitingForPeer(const SharedPtr<Peer> &peer)
 
 	{	// finish processing any packets waiting on peer's public key / identity
 		Mutex::Lock _l(_rxQueue_m);
-		unsigned long i = ZT_RX_QUEUE_SIZE;
-		while (i) {
-			RXQueueEntry *rq = &(_rxQueue[--i]);
-			if ((rq->timestamp)&&(rq->complete)) {
-				if (rq->frag0.tryDecode(RR))
-					rq->timestamp = 0;
-			}
+		unsigned int i = _rxQueueOldest;
+		while (i != ZT_RX_QUEUE_NIL) {
+			RXQueueEntry *const rq = &(_rxQueue[i]);
+			i = rq->newer;
+			if ((rq->complete)&&(rq->frag0.tryDecode(RR)))
+				_freeRXQueueEntry(rq);
 		}
 	}
 
@@ -678,6 +712,71 @@ void Switch::doAnythingWaitingForPeer(const SharedPtr<Peer> &peer)
 	}
 }
 
+bool Switch::queueIdentityValidation(const IncomingPacket &hello,uint64_t now)
+{
+	const Address source(hello.source());
+	const InetAddress &from = hello.path()->address();
+	unsigned int fromSamePath = 0;
+	Mutex::Lock _l(_idvQueue_m);
+	IdentityValidationEntry *e = (IdentityValidationEntry *)0;
+	for(unsigned int i=0;i<ZT_IDENTITY_VALIDATION_QUEUE_SIZE;++i) {
+		IdentityValidationEntry *const q = &(_idvQueue[i]);
+		if ((q->timestamp)&&((q->inProgress)||((now - q->timestamp) < ZT_IDENTITY_VALIDATION_QUEUE_EXPIRE))) {
+			if (q->source == source)
+				return false;
+			if ((q->hello.path()->address() == from)&&(++fromSamePath >= ZT_IDENTITY_VALIDATION_QUEUE_MAX_PER_PATH))
+				return false;
+		} else if (!e) {
+			e = q;
+		}
+	}
+	if (!e)
+		return false;
+	e->timestamp = now;
+	e->source = source;
+	e->inProgress = false;
+	e->hello = hello;
+	return true;
+}
+
+unsigned int Switch::doIdentityValidations(uint64_t now,unsigned int max)
+{
+	unsigned int count = 0;
+	while (count < max) {
+		IdentityValidationEntry *e = (IdentityValidationEntry *)0;
+		{
+			Mutex::Lock _l(_idvQueue_m);
+			for(unsigned int i=0;i<ZT_IDENTITY_VALIDATION_QUEUE_SIZE;++i) {
+				IdentityValidationEntry *const q = &(_idvQueue[i]);
+				if ((q->timestamp)&&(!q->inProgress)) {
+					if ((now - q->timestamp) >= ZT_IDENTITY_VALIDATION_QUEUE_EXPIRE) {
+						q->timestamp = 0;
+					} else if ((!e)||(q->timestamp < e->timestamp)) {
+						e = q;
+					}
+				}
+			}
+			if (!e)
+				break;
+			e->inProgress = true;
+		}
+
+		// Entries that are in progress are left alone by everyone else, so this
+		// can be done without holding the lock
+		const SharedPtr<Peer> peer(e->hello.validateHELLO(RR));
+		if (peer)
+			doAnythingWaitingForPeer(peer);
+
+		{
+			Mutex::Lock _l(_idvQueue_m);
+			e->timestamp = 0;
+			e->inProgress = false;
+		}
+		++count;
+	}
+	return count;
+}
+
 unsigned long Switch::doTimerTasks(uint64_t now)
 {
 	unsigned long nextDelay = 0xffffffff; // ceiling delay, caller will cap to minimum
@@ -718,6 +817,11 @@ unsigned long Switch::doTimerTasks(uint64_t now)
 		}
 	}
 
+	{	// Time out RX queue entries that never got all their fragments or WHOIS replies
+		Mutex::Lock _l(_rxQueue_m);
+		_expireRXQueueEntries(now);
+	}
+
 	{	// Remove really old last unite attempt entries to keep table size controlled
 		Mutex::Lock _l(_lastUniteAttempt_m);
 		Hashtable< _LastUniteKey,uint64_t >::Iterator i(_lastUniteAttempt);
@@ -732,6 +836,22 @@ unsigned long Switch::doTimerTasks(uint64_t now)
 	return nextDelay;
 }
 
+void Switch::setRxQueueSize(unsigned int size)
+{
+	Mutex::Lock _l(_rxQueue_m);
+	_allocateRXQueue(size);
+}
+
+void Switch::rxQueueStatus(ZT_NodeStatus *status)
+{
+	Mutex::Lock _l(_rxQueue_m);
+	status->rxQueueSize = _rxQueueSize;
+	status->rxQueueInUse = _rxQueueInUse;
+	status->rxQueueEvictions = _rxQueueEvictions;
+	status->rxQueueSourceLimitEvictions = _rxQueueSourceLimitEvictions;
+	status->rxQueueExpirations = _rxQueueExpirations;
+}
+
 bool Switch::_shouldUnite(const uint64_t now,const Address &source,const Address &destination)
 {
 	Mutex::Lock _l(_lastUniteAttempt_m);
@@ -832,14 +952,14 @@ bool Switch::_trySend(Packet &packet,bool encrypt)
 	if (trustedPathId) {
 		packet.setTrusted(trustedPathId);
 	} else {
-		packet.armor((clusterMostRecentMemberId >= 0) ? clusterPeerSecret : peer->key(),encrypt,(viaPath) ? viaPath->nextOutgoingCounter() : 0);
+		packet.armor((clusterMostRecentMemberId >= 0) ? clusterPeerSecret : peer->key(),encrypt,(viaPath) ? viaPath->nextOutgoingCounter() : 0,((clusterMostRecentMemberId < 0)&&(peer->aesGcm())));
 	}
 #else
 	const uint64_t trustedPathId = RR->topology->getOutboundPathTrust(viaPath->address());
 	if (trustedPathId) {
 		packet.setTrusted(trustedPathId);
 	} else {
-		packet.armor(peer->key(),encrypt,viaPath->nextOutgoingCounter());
+		packet.armor(peer->key(),encrypt,viaPath->nextOutgoingCounter(),peer->aesGcm());
 	}
 #endif
 
@@ -877,4 +997,149 @@ bool Switch::_trySend(Packet &packet,bool encrypt)
 	return true;
 }
 
+// Entries are timestamped by whichever thread received them, so a slightly older "now" must not expire them
+static inline bool _rxQueueEntryExpired(const uint64_t now,const uint64_t timestamp)
+{
+	return ((now > timestamp)&&((now - timestamp) >= ZT_RX_QUEUE_EXPIRE));
+}
+
+Switch::RXQueueEntry *Switch::_findRXQueueEntry(uint64_t now,uint64_t packetId)
+{
+	unsigned int i = _rxQueueBuckets[_rxQueueBucket(packetId)];
+	while (i != ZT_RX_QUEUE_NIL) {
+		RXQueueEntry *const rq = &(_rxQueue[i]);
+		if (rq->packetId == packetId) {
+			if (!_rxQueueEntryExpired(now,rq->timestamp))
+				return rq;
+			++_rxQueueExpirations;
+			_freeRXQueueEntry(rq);
+			break;
+		}
+		i = rq->hashNext;
+	}
+	return (RXQueueEntry *)0;
+}
+
+Switch::RXQueueEntry *Switch::_newRXQueueEntry(uint64_t now,uint64_t packetId,const SharedPtr<Path> &source)
+{
+	_expireRXQueueEntries(now);
+
+	if (_rxQueueFree == ZT_RX_QUEUE_NIL) {
+		// Something has to go. If this path already holds its share of the
+		// queue it gives up its own oldest entry, otherwise the oldest goes.
+		if ((source)&&(source->rxQueueEntries() >= _rxQueuePerSourceLimit)) {
+			unsigned int i = _rxQueueOldest;
+			while (i != ZT_RX_QUEUE_NIL) {
+				if (_rxQueue[i].source == source) {
+					++_rxQueueSourceLimitEvictions;
+					_freeRXQueueEntry(&(_rxQueue[i]));
+					break;
+				}
+				i = _rxQueue[i].newer;
+			}
+		}
+		if (_rxQueueFree == ZT_RX_QUEUE_NIL) {
+			++_rxQueueEvictions;
+			_freeRXQueueEntry(&(_rxQueue[_rxQueueOldest]));
+		}
+	}
+
+	const unsigned int i = _rxQueueFree;
+	RXQueueEntry *const rq = &(_rxQueue[i]);
+	_rxQueueFree = rq->hashNext;
+
+	rq->timestamp = now;
+	rq->packetId = packetId;
+	rq->source = source;
+	if (source)
+		source->rxQueueEntryAdded();
+
+	const unsigned int b = _rxQueueBucket(packetId);
+	rq->hashNext = _rxQueueBuckets[b];
+	_rxQueueBuckets[b] = i;
+
+	rq->older = _rxQueueNewest;
+	rq->newer = ZT_RX_QUEUE_NIL;
+	if (_rxQueueNewest != ZT_RX_QUEUE_NIL)
+		_rxQueue[_rxQueueNewest].newer = i;
+	else _rxQueueOldest = i;
+	_rxQueueNewest = i;
+
+	++_rxQueueInUse;
+	return rq;
+}
+
+void Switch::_freeRXQueueEntry(RXQueueEntry *rq)
+{
+	const unsigned int i = (unsigned int)(rq - _rxQueue);
+
+	unsigned int *p = &(_rxQueueBuckets[_rxQueueBucket(rq->packetId)]);
+	while (*p != i)
+		p = &(_rxQueue[*p].hashNext);
+	*p = rq->hashNext;
+
+	if (rq->older != ZT_RX_QUEUE_NIL)
+		_rxQueue[rq->older].newer = rq->newer;
+	else _rxQueueOldest = rq->newer;
+	if (rq->newer != ZT_RX_QUEUE_NIL)
+		_rxQueue[rq->newer].older = rq->older;
+	else _rxQueueNewest = rq->older;
+
+	if (rq->source) {
+		rq->source->rxQueueEntryRemoved();
+		rq->source.zero();
+	}
+	rq->timestamp = 0;
+
+	rq->hashNext = _rxQueueFree;
+	_rxQueueFree = i;
+	--_rxQueueInUse;
+}
+
+void Switch::_expireRXQueueEntries(uint64_t now)
+{
+	while ((_rxQueueOldest != ZT_RX_QUEUE_NIL)&&(_rxQueueEntryExpired(now,_rxQueue[_rxQueueOldest].timestamp))) {
+		++_rxQueueExpirations;
+		_freeRXQueueEntry(&(_rxQueue[_rxQueueOldest]));
+	}
+}
+
+void Switch::_allocateRXQueue(unsigned int size)
+{
+	size = std::max(std::min(size,(unsigned int)ZT_RX_QUEUE_MAX_SIZE),(unsigned int)ZT_RX_QUEUE_MIN_SIZE);
+	unsigned int bucketBits = 1;
+	while ((1U << bucketBits) < (size * 2))
+		++bucketBits;
+	const unsigned int bucketCount = 1U << bucketBits;
+
+	RXQueueEntry *const q = new RXQueueEntry[size];
+	unsigned int *const b = new unsigned int[bucketCount];
+
+	if (_rxQueue) {
+		unsigned int i = _rxQueueOldest;
+		while (i != ZT_RX_QUEUE_NIL) {
+			if (_rxQueue[i].source)
+				_rxQueue[i].source->rxQueueEntryRemoved();
+			i = _rxQueue[i].newer;
+		}
+		delete [] _rxQueue;
+		delete [] _rxQueueBuckets;
+	}
+
+	_rxQueue = q;
+	_rxQueueBuckets = b;
+	_rxQueueSize = size;
+	_rxQueueBucketShift = 64 - bucketBits;
+	_rxQueuePerSourceLimit = std::max(size / ZT_RX_QUEUE_PER_SOURCE_DIVISOR,std::min((unsigned int)ZT_RX_QUEUE_PER_SOURCE_MIN,size));
+	for(unsigned int i=0;i<bucketCount;++i)
+		_rxQueueBuckets[i] = ZT_RX_QUEUE_NIL;
+	for(unsigned int i=0;i<size;++i)
+		_rxQueue[i].hashNext = i + 1;
+	_rxQueue[size - 1].hashNext = ZT_RX_QUEUE_NIL;
+	_rxQueueFree = 0;
+	_rxQueueOldest = ZT_RX_QUEUE_NIL;
+	_rxQueueNewest = ZT_RX_QUEUE_NIL;
+	_rxQueueInUse = 0;
+}
+
 } // namespace ZeroTier
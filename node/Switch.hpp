@@ -38,6 +38,9 @@
 #include "IncomingPacket.hpp"
 #include "Hashtable.hpp"
 
+// End of list in RX queue entry links
+#define ZT_RX_QUEUE_NIL 0xffffffffU
+
 namespace ZeroTier {
 
 class RuntimeEnvironment;
@@ -55,6 +58,7 @@ class Switch : NonCopyable
 {
 public:
 	Switch(const RuntimeEnvironment *renv);
+	~Switch();
 
 	/**
 	 * Called when a packet is received from the real network
@@ -66,6 +70,17 @@ public:
 	 */
 	void onRemotePacket(const InetAddress &localAddr,const InetAddress &fromAddr,const void *data,unsigned int len);
 
+	/**
+	 * Called with a batch of packets received from the real network
+	 *
+	 * Packets are processed in order. Path and peer lookups are reused
+	 * across consecutive packets with the same origin.
+	 *
+	 * @param packets Received packets
+	 * @param count Number of packets
+	 */
+	void onRemotePackets(const ZT_WirePacket *packets,unsigned int count);
+
 	/**
 	 * Called when a packet comes from a local Ethernet tap
 	 *
@@ -112,6 +127,26 @@ public:
 	 */
 	void doAnythingWaitingForPeer(const SharedPtr<Peer> &peer);
 
+	/**
+	 * Park a HELLO from an unknown peer until a worker can validate its identity
+	 *
+	 * @param hello HELLO packet, not yet authenticated
+	 * @param now Current time
+	 * @return False if the queue is full, a HELLO from the same address is already waiting, or its physical path has too many waiting
+	 */
+	bool queueIdentityValidation(const IncomingPacket &hello,uint64_t now);
+
+	/**
+	 * Validate identities and finish HELLOs parked by queueIdentityValidation()
+	 *
+	 * This is called via Node::processIdentityValidations() from host worker threads.
+	 *
+	 * @param now Current time
+	 * @param max Maximum number of HELLOs to process
+	 * @return Number of HELLOs processed
+	 */
+	unsigned int doIdentityValidations(uint64_t now,unsigned int max);
+
 	/**
 	 * Perform retries and other periodic timer tasks
 	 *
@@ -123,7 +158,34 @@ public:
 	 */
 	unsigned long doTimerTasks(uint64_t now);
 
+	/**
+	 * Resize the RX queue used for fragment reassembly and packets awaiting WHOIS
+	 *
+	 * Packets in the queue when it is resized are discarded.
+	 *
+	 * @param size New number of entries (clamped to ZT_RX_QUEUE_MIN_SIZE..ZT_RX_QUEUE_MAX_SIZE)
+	 */
+	void setRxQueueSize(unsigned int size);
+
+	/**
+	 * Fill RX queue size, usage, and counters in a node status structure
+	 *
+	 * @param status Status to fill (only rxQueue* fields are set)
+	 */
+	void rxQueueStatus(ZT_NodeStatus *status);
+
 private:
+	void _onRemotePacket(const uint64_t now,SharedPtr<Path> &path,SharedPtr<Peer> &peer,const InetAddress &localAddr,const InetAddress &fromAddr,const void *data,unsigned int len);
+	inline SharedPtr<Peer> _getPeer(const Address &addr,SharedPtr<Peer> &cache)
+	{
+		if ((!cache)||(cache->address() != addr)) {
+			SharedPtr<Peer> p(RR->topology->getPeer(addr));
+			if (p)
+				cache = p;
+			return p;
+		}
+		return cache;
+	}
 	bool _shouldUnite(const uint64_t now,const Address &source,const Address &destination);
 	Address _sendWhoisRequest(const Address &addr,const Address *peersAlreadyConsulted,unsigned int numPeersAlreadyConsulted);
 	bool _trySend(Packet &packet,bool encrypt); // packet is modified if return is true
@@ -142,40 +204,97 @@ private:
 	Hashtable< Address,WhoisRequest > _outstandingWhoisRequests;
 	Mutex _outstandingWhoisRequests_m;
 
-	// Packets waiting for WHOIS replies or other decode info or missing fragments
+	// Payload of a fragment that arrived before the fragments that precede it
+	struct RXFragment
+	{
+		unsigned int len;
+		uint8_t data[ZT_PROTO_MAX_PACKET_LENGTH - ZT_PROTO_MIN_FRAGMENT_LENGTH];
+	};
+
+	/*
+	 * Packets waiting for WHOIS replies or other decode info or missing fragments
+	 *
+	 * Fragments are assembled into frag0 as they arrive. A fragment that is
+	 * next in line is appended straight from the wire, so with in-order
+	 * delivery each byte is copied only once on its way to tryDecode().
+	 * Anything else waits in frags[] until its predecessors show up.
+	 *
+	 * Entries live in a fixed arena and are found by packet ID through a
+	 * hash table chained through hashNext. Entries in use are also on a list
+	 * ordered by age, so expiring and evicting the oldest are O(1). Unused
+	 * entries are chained through hashNext on a free list.
+	 */
 	struct RXQueueEntry
 	{
 		RXQueueEntry() : timestamp(0) {}
 		uint64_t timestamp; // 0 if entry is not in use
 		uint64_t packetId;
-		IncomingPacket frag0; // head of packet
-		Packet::Fragment frags[ZT_MAX_PACKET_FRAGMENTS - 1]; // later fragments (if any)
+		SharedPtr<Path> source; // physical path this packet's first fragment or head came in on
+		unsigned int hashNext; // next in hash bucket or free list, or ZT_RX_QUEUE_NIL
+		unsigned int older,newer; // neighbors in age list, or ZT_RX_QUEUE_NIL
+		IncomingPacket frag0; // head of packet followed by assembledFragments-1 fragments
+		RXFragment frags[ZT_MAX_PACKET_FRAGMENTS - 1]; // out of order fragments waiting to be appended to frag0
 		unsigned int totalFragments; // 0 if only frag0 received, waiting for frags
+		unsigned int assembledFragments; // number of fragments (including head) in frag0, 0 if no head yet
 		uint32_t haveFragments; // bit mask, LSB to MSB
 		bool complete; // if true, packet is complete
 	};
-	RXQueueEntry _rxQueue[ZT_RX_QUEUE_SIZE];
+	RXQueueEntry *_rxQueue; // arena of _rxQueueSize entries
+	unsigned int *_rxQueueBuckets; // hash buckets, 2^(64-_rxQueueBucketShift) of them
+	unsigned int _rxQueueSize;
+	unsigned int _rxQueueBucketShift;
+	unsigned int _rxQueuePerSourceLimit;
+	unsigned int _rxQueueFree; // head of free list
+	unsigned int _rxQueueOldest,_rxQueueNewest; // ends of age list
+	unsigned int _rxQueueInUse;
+	uint64_t _rxQueueHashMultiplier; // random and odd, see _rxQueueBucket()
+	uint64_t _rxQueueEvictions;
+	uint64_t _rxQueueSourceLimitEvictions;
+	uint64_t _rxQueueExpirations;
 	Mutex _rxQueue_m;
 
-	/* Returns the matching or oldest entry. Caller must check timestamp and
-	 * packet ID to determine which. */
-	inline RXQueueEntry *_findRXQueueEntry(uint64_t now,uint64_t packetId)
+	// HELLOs from unknown peers waiting for a worker to validate their identities
+	struct IdentityValidationEntry
+	{
+		IdentityValidationEntry() : timestamp(0),inProgress(false) {}
+		uint64_t timestamp; // 0 if entry is not in use
+		Address source;
+		bool inProgress; // a worker has taken this entry but isn't done with it yet
+		IncomingPacket hello;
+	};
+	IdentityValidationEntry _idvQueue[ZT_IDENTITY_VALIDATION_QUEUE_SIZE];
+	Mutex _idvQueue_m;
+
+	/* Appends any waiting fragments that are now next in line and returns
+	 * true if the packet is fully assembled. _rxQueue_m must be locked. */
+	static inline bool _assembleRXQueueEntry(RXQueueEntry *rq)
 	{
-		RXQueueEntry *rq;
-		RXQueueEntry *oldest = &(_rxQueue[ZT_RX_QUEUE_SIZE - 1]);
-		unsigned long i = ZT_RX_QUEUE_SIZE;
-		while (i) {
-			rq = &(_rxQueue[--i]);
-			if ((rq->packetId == packetId)&&(rq->timestamp))
-				return rq;
-			if ((now - rq->timestamp) >= ZT_RX_QUEUE_EXPIRE)
-				rq->timestamp = 0;
-			if (rq->timestamp < oldest->timestamp)
-				oldest = rq;
+		if (!rq->assembledFragments)
+			return false;
+		while ((rq->assembledFragments < rq->totalFragments)&&((rq->haveFragments & (1 << rq->assembledFragments)) != 0)) {
+			const RXFragment &f = rq->frags[rq->assembledFragments - 1];
+			rq->frag0.append(f.data,f.len);
+			++rq->assembledFragments;
 		}
-		return oldest;
+		return ((rq->totalFragments > 1)&&(rq->assembledFragments == rq->totalFragments)&&(Utils::countBits(rq->haveFragments) == rq->totalFragments));
 	}
 
+	/* Multiply-shift hash: the bucket comes from the high bits of the product,
+	 * which depend on every bit of the packet ID. Packet IDs are chosen by
+	 * senders and fragments aren't authenticated, but without knowing the
+	 * random multiplier a sender can't pick IDs that share a bucket. */
+	inline unsigned int _rxQueueBucket(const uint64_t packetId) const
+	{
+		return (unsigned int)((packetId * _rxQueueHashMultiplier) >> _rxQueueBucketShift);
+	}
+
+	// These require _rxQueue_m to be locked
+	RXQueueEntry *_findRXQueueEntry(uint64_t now,uint64_t packetId); // NULL if not found
+	RXQueueEntry *_newRXQueueEntry(uint64_t now,uint64_t packetId,const SharedPtr<Path> &source); // evicts if needed, caller fills in packet fields
+	void _freeRXQueueEntry(RXQueueEntry *rq);
+	void _expireRXQueueEntries(uint64_t now);
+	void _allocateRXQueue(unsigned int size);
+
 	// ZeroTier-layer TX queue entry
 	struct TXQueueEntry
 	{
@@ -22,10 +22,11 @@
 #include "Topology.hpp"
 #include "Switch.hpp"
 #include "Network.hpp"
+#include "SignatureCache.hpp"
 
 namespace ZeroTier {
 
-int Tag::verify(const RuntimeEnvironment *RR) const
+int Tag::verify(const RuntimeEnvironment *RR,SignatureBatch *batch) const
 {
 	if ((!_signedBy)||(_signedBy != Network::controllerFor(_networkId)))
 		return -1;
@@ -37,7 +38,7 @@ int Tag::verify(const RuntimeEnvironment *RR) const
 	try {
 		Buffer<(sizeof(Tag) * 2)> tmp;
 		this->serialize(tmp,true);
-		return (id.verify(tmp.data(),tmp.size(),_signature) ? 0 : -1);
+		return RR->sigCache->verify(id.publicKey(),tmp.data(),tmp.size(),_signature,batch);
 	} catch ( ... ) {
 		return -1;
 	}
@@ -33,6 +33,7 @@
 namespace ZeroTier {
 
 class RuntimeEnvironment;
+class SignatureBatch;
 
 /**
  * A tag that can be associated with members and matched in rules
@@ -105,9 +106,10 @@ public:
 	 * Check this tag's signature
 	 *
 	 * @param RR Runtime environment to allow identity lookup for signedBy
-	 * @return 0 == OK, 1 == waiting for WHOIS, -1 == BAD signature or tag
+	 * @param batch If non-NULL, queue the signature check here instead of verifying immediately
+	 * @return 0 == OK, 1 == waiting for WHOIS, -1 == BAD signature or tag, 2 == queued in batch
 	 */
-	int verify(const RuntimeEnvironment *RR) const;
+	int verify(const RuntimeEnvironment *RR,SignatureBatch *batch = (SignatureBatch *)0) const;
 
 	template<unsigned int C>
 	inline void serialize(Buffer<C> &b,const bool forSign = false) const
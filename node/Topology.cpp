@@ -57,6 +57,7 @@ static const unsigned char ZT_DEFAULT_WORLD[ZT_DEFAULT_WORLD_LENGTH] = {0x01,0x0
 
 Topology::Topology(const RuntimeEnvironment *renv) :
 	RR(renv),
+	_peerKeyCache(renv->identity),
 	_trustedPathCount(0),
 	_amRoot(false)
 {
@@ -90,15 +91,20 @@ SharedPtr<Peer> Topology::addPeer(const SharedPtr<Peer> &peer)
 #endif
 
 	SharedPtr<Peer> np;
+	bool added = false;
 	{
 		Mutex::Lock _l(_peers_m);
 		SharedPtr<Peer> &hp = _peers[peer->address()];
-		if (!hp)
+		if (!hp) {
 			hp = peer;
+			added = true;
+		}
 		np = hp;
 	}
 
 	saveIdentity(np->identity());
+	if (added)
+		_savePeerKey(*np);
 
 	return np;
 }
@@ -120,7 +126,7 @@ SharedPtr<Peer> Topology::getPeer(const Address &zta)
 	try {
 		Identity id(_getIdentity(zta));
 		if (id) {
-			SharedPtr<Peer> np(new Peer(RR,RR->identity,id));
+			SharedPtr<Peer> np(_newPeer(id));
 			{
 				Mutex::Lock _l(_peers_m);
 				SharedPtr<Peer> &ap = _peers[zta];
@@ -290,7 +296,7 @@ bool Topology::addWorld(const World &newWorld,bool alwaysAcceptNew)
 	}
 
 	if (existing) {
-		if (existing->shouldBeReplacedBy(newWorld))
+		if (existing->shouldBeReplacedBy(newWorld,RR->sigCache))
 			*existing = newWorld;
 		else return false;
 	} else if (newWorld.type() == World::TYPE_MOON) {
@@ -428,6 +434,31 @@ Identity Topology::_getIdentity(const Address &zta)
 	return Identity();
 }
 
+Peer *Topology::_newPeer(const Identity &id)
+{
+	char p[128];
+	Utils::snprintf(p,sizeof(p),"iddb.d/%.10llx.key",(unsigned long long)id.address().toInt());
+	uint8_t key[ZT_PEER_SECRET_KEY_LENGTH];
+	if (_peerKeyCache.open(id,RR->node->dataStoreGet(p),key)) {
+		Peer *const np = new Peer(RR,RR->identity,id,key);
+		Utils::burn(key,sizeof(key));
+		return np;
+	}
+	Peer *const np = new Peer(RR,RR->identity,id);
+	_savePeerKey(*np);
+	return np;
+}
+
+void Topology::_savePeerKey(const Peer &peer)
+{
+	const std::string sealed(_peerKeyCache.seal(peer.identity(),peer.key()));
+	if (sealed.length() > 0) {
+		char p[128];
+		Utils::snprintf(p,sizeof(p),"iddb.d/%.10llx.key",(unsigned long long)peer.address().toInt());
+		RR->node->dataStorePut(p,sealed,true);
+	}
+}
+
 void Topology::_memoizeUpstreams()
 {
 	// assumes _upstreams_m and _peers_m are locked
@@ -441,7 +472,7 @@ void Topology::_memoizeUpstreams()
 			_upstreamAddresses.push_back(i->identity.address());
 			SharedPtr<Peer> &hp = _peers[i->identity.address()];
 			if (!hp) {
-				hp = new Peer(RR,RR->identity,i->identity);
+				hp = _newPeer(i->identity);
 				saveIdentity(i->identity);
 			}
 		}
@@ -455,7 +486,7 @@ void Topology::_memoizeUpstreams()
 				_upstreamAddresses.push_back(i->identity.address());
 				SharedPtr<Peer> &hp = _peers[i->identity.address()];
 				if (!hp) {
-					hp = new Peer(RR,RR->identity,i->identity);
+					hp = _newPeer(i->identity);
 					saveIdentity(i->identity);
 				}
 			}
@@ -39,6 +39,7 @@
 #include "Hashtable.hpp"
 #include "World.hpp"
 #include "CertificateOfRepresentation.hpp"
+#include "PeerKeyCache.hpp"
 
 namespace ZeroTier {
 
@@ -421,9 +422,12 @@ public:
 
 private:
 	Identity _getIdentity(const Address &zta);
+	Peer *_newPeer(const Identity &id);
+	void _savePeerKey(const Peer &peer);
 	void _memoizeUpstreams();
 
 	const RuntimeEnvironment *const RR;
+	const PeerKeyCache _peerKeyCache;
 
 	uint64_t _trustedPathIds[ZT_MAX_TRUSTED_PATHS];
 	InetAddress _trustedPathNetworks[ZT_MAX_TRUSTED_PATHS];
@@ -27,6 +27,7 @@
 #include "Identity.hpp"
 #include "Buffer.hpp"
 #include "C25519.hpp"
+#include "SignatureCache.hpp"
 
 /**
  * Maximum number of roots (sanity limit, okay to increase)
@@ -149,15 +150,18 @@ public:
 	 * Check whether a world update should replace this one
 	 *
 	 * @param update Candidate update
+	 * @param sigCache If non-NULL, check the update's signature through this cache
 	 * @return True if update is newer than current, matches its ID and type, and is properly signed (or if current is NULL)
 	 */
-	inline bool shouldBeReplacedBy(const World &update)
+	inline bool shouldBeReplacedBy(const World &update,SignatureCache *sigCache = (SignatureCache *)0)
 	{
 		if ((_id == 0)||(_type == TYPE_NULL))
 			return true;
 		if ((_id == update._id)&&(_ts < update._ts)&&(_type == update._type)) {
 			Buffer<ZT_WORLD_MAX_SERIALIZED_LENGTH> tmp;
 			update.serialize(tmp,true);
+			if (sigCache)
+				return (sigCache->verify(_updatesMustBeSignedBy,tmp.data(),tmp.size(),update._signature) == 0);
 			return C25519::verify(_updatesMustBeSignedBy,tmp.data(),tmp.size(),update._signature);
 		}
 		return false;
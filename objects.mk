@@ -1,11 +1,13 @@
 OBJS=\
 	controller/EmbeddedNetworkController.o \
 	controller/JSONDB.o \
+	node/AES.o \
 	node/C25519.o \
 	node/Capability.o \
 	node/CertificateOfMembership.o \
 	node/CertificateOfOwnership.o \
 	node/Cluster.o \
+	node/CPU.o \
 	node/Identity.o \
 	node/IncomingPacket.o \
 	node/InetAddress.o \
@@ -56,6 +56,7 @@
 #endif
 
 #include <string>
+#include <vector>
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
@@ -69,6 +70,7 @@
 #include "node/NetworkController.hpp"
 #include "node/Buffer.hpp"
 #include "node/World.hpp"
+#include "node/Mutex.hpp"
 
 #include "osdep/OSUtils.hpp"
 #include "osdep/Http.hpp"
@@ -622,7 +624,8 @@ static void idtoolPrintHelp(FILE *out,const char *pn)
 		COPYRIGHT_NOTICE ZT_EOL_S
 		LICENSE_GRANT ZT_EOL_S);
 	fprintf(out,"Usage: %s <command> [<args>]" ZT_EOL_S"" ZT_EOL_S"Commands:" ZT_EOL_S,pn);
-	fprintf(out,"  generate [<identity.secret>] [<identity.public>] [<vanity>]" ZT_EOL_S);
+	fprintf(out,"  generate [-j<threads>] [<identity.secret>] [<identity.public>] [<vanity>]" ZT_EOL_S);
+	fprintf(out,"  generate-batch [-j<threads>] <count> [<output file>] [<vanity>]" ZT_EOL_S);
 	fprintf(out,"  validate <identity.secret/public>" ZT_EOL_S);
 	fprintf(out,"  getpublic <identity.secret>" ZT_EOL_S);
 	fprintf(out,"  sign <identity.secret> <file>" ZT_EOL_S);
@@ -647,6 +650,148 @@ static Identity getIdFromArg(char *arg)
 	return Identity();
 }
 
+// Shared state for threads generating identities
+struct IdtoolGenerator
+{
+	IdtoolGenerator(unsigned long w,uint64_t v,int vb) : wanted(w),vanity(v),vanityBits(vb),tried(0),foundTotal(0) {}
+
+	const unsigned long wanted;
+	const uint64_t vanity;
+	const int vanityBits;
+
+	Mutex lock;
+	uint64_t tried;
+	std::vector<Identity> found; // drained by main thread
+	unsigned long foundTotal;
+};
+
+struct IdtoolGeneratorThread
+{
+	IdtoolGeneratorThread(IdtoolGenerator *g) : gen(g) {}
+
+	void threadMain()
+		throw()
+	{
+		char *const genmem = new char[ZT_IDENTITY_GEN_MEMORY]; // reused for every identity this thread generates
+		Identity id;
+		for(;;) {
+			id.generate(genmem);
+			Mutex::Lock _l(gen->lock);
+			if (gen->foundTotal >= gen->wanted)
+				break;
+			++gen->tried;
+			if ((id.address().toInt() >> (40 - gen->vanityBits)) == gen->vanity) {
+				gen->found.push_back(id);
+				++gen->foundTotal;
+			}
+		}
+		delete [] genmem;
+	}
+
+	IdtoolGenerator *const gen;
+	Thread thread;
+};
+
+static unsigned int idtoolCpuCount()
+{
+#ifdef __WINDOWS__
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	const long n = (long)si.dwNumberOfProcessors;
+#else
+	const long n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return (n > 0) ? (unsigned int)n : 1;
+}
+
+/**
+ * Generate identities on several threads, handing each one to a callback as it is found
+ *
+ * Progress is reported on stderr about once per second.
+ *
+ * @param count Number of identities to generate
+ * @param vanity Address prefix (right-aligned)
+ * @param vanityBits Number of bits in vanity prefix, 0 for none
+ * @param threads Number of threads
+ * @param handler Called in main thread with each identity found, returns false on error to stop
+ * @param arg First argument to handler
+ * @return False if handler returned false
+ */
+static bool idtoolGenerate(unsigned long count,uint64_t vanity,int vanityBits,unsigned int threads,bool (*handler)(void *,const Identity &),void *arg)
+{
+	IdtoolGenerator gen(count,vanity,vanityBits);
+	std::vector<IdtoolGeneratorThread *> workers;
+	for(unsigned int i=0;i<threads;++i) {
+		workers.push_back(new IdtoolGeneratorThread(&gen));
+		workers.back()->thread = Thread::start(workers.back());
+	}
+
+	const uint64_t start = OSUtils::now();
+	uint64_t lastReport = start;
+	unsigned long handled = 0;
+	bool ok = true;
+	while ((handled < count)&&(ok)) {
+		Thread::sleep(100);
+		std::vector<Identity> found;
+		uint64_t tried;
+		{
+			Mutex::Lock _l(gen.lock);
+			found.swap(gen.found);
+			tried = gen.tried;
+		}
+		for(std::vector<Identity>::const_iterator id(found.begin());id!=found.end();++id) {
+			if (handled < count) {
+				if (!handler(arg,*id)) {
+					ok = false;
+					break;
+				}
+				++handled;
+			}
+		}
+		const uint64_t now = OSUtils::now();
+		if (((now - lastReport) >= 1000)&&(handled < count)&&(ok)) {
+			lastReport = now;
+			if (vanityBits > 0)
+				fprintf(stderr,"tried %llu identities (%.1f/second on %u threads), found %lu of %lu with first %d bits of %.10llx" ZT_EOL_S,(unsigned long long)tried,(double)tried / ((double)(now - start) / 1000.0),threads,handled,count,vanityBits,(unsigned long long)(vanity << (40 - vanityBits)));
+			else fprintf(stderr,"generated %llu identities (%.1f/second on %u threads), %lu remaining" ZT_EOL_S,(unsigned long long)tried,(double)tried / ((double)(now - start) / 1000.0),threads,count - handled);
+		}
+	}
+
+	{
+		Mutex::Lock _l(gen.lock);
+		gen.foundTotal = count; // stop workers if handler failed
+	}
+	for(std::vector<IdtoolGeneratorThread *>::const_iterator w(workers.begin());w!=workers.end();++w) {
+		Thread::join((*w)->thread);
+		delete *w;
+	}
+
+	return ok;
+}
+
+static bool idtoolGenerateHandler(void *arg,const Identity &id)
+{
+	*reinterpret_cast<Identity *>(arg) = id;
+	return true;
+}
+
+static bool idtoolGenerateBatchHandler(void *arg,const Identity &id)
+{
+	FILE *const out = reinterpret_cast<FILE *>(arg);
+	fprintf(out,"%s" ZT_EOL_S,id.toString(true).c_str());
+	fflush(out);
+	return (ferror(out) == 0);
+}
+
+// Parses a vanity prefix of up to 10 hex digits
+static void idtoolParseVanity(const char *s,uint64_t &vanity,int &vanityBits)
+{
+	vanity = Utils::hexStrToU64(s) & 0xffffffffffULL;
+	vanityBits = 4 * (int)strlen(s);
+	if (vanityBits > 40)
+		vanityBits = 40;
+}
+
 #ifdef __WINDOWS__
 static int idtool(int argc, _TCHAR* argv[])
 #else
@@ -658,29 +803,66 @@ static int idtool(int argc,char **argv)
 		return 1;
 	}
 
-	if (!strcmp(argv[1],"generate")) {
-		uint64_t vanity = 0;
-		int vanityBits = 0;
-		if (argc >= 5) {
-			vanity = Utils::hexStrToU64(argv[4]) & 0xffffffffffULL;
-			vanityBits = 4 * (int)strlen(argv[4]);
-			if (vanityBits > 40)
-				vanityBits = 40;
+	if ((!strcmp(argv[1],"generate"))||(!strcmp(argv[1],"generate-batch"))) {
+		// Pull -j<threads> out of the arguments so the rest keep their positions
+		unsigned int threads = idtoolCpuCount();
+		int nargc = 0;
+		for(int i=0;i<argc;++i) {
+			if ((i >= 2)&&(argv[i][0] == '-')&&(argv[i][1] == 'j')) {
+				threads = (unsigned int)Utils::strToUInt(argv[i] + 2);
+				if (threads < 1)
+					threads = 1;
+			} else argv[nargc++] = argv[i];
 		}
+		argc = nargc;
 
-		Identity id;
-		for(;;) {
-			id.generate();
-			if ((id.address().toInt() >> (40 - vanityBits)) == vanity) {
-				if (vanityBits > 0) {
-					fprintf(stderr,"vanity address: found %.10llx !\n",(unsigned long long)id.address().toInt());
+		if (!strcmp(argv[1],"generate-batch")) {
+			if (argc < 3) {
+				idtoolPrintHelp(stdout,argv[0]);
+				return 1;
+			}
+			const unsigned long count = (unsigned long)Utils::strToU64(argv[2]);
+			if (!count) {
+				idtoolPrintHelp(stdout,argv[0]);
+				return 1;
+			}
+			uint64_t vanity = 0;
+			int vanityBits = 0;
+			if (argc >= 5)
+				idtoolParseVanity(argv[4],vanity,vanityBits);
+
+			FILE *out = stdout;
+			if ((argc >= 4)&&(strcmp(argv[3],"-"))) {
+				out = fopen(argv[3],"w");
+				if (!out) {
+					fprintf(stderr,"Error writing to %s" ZT_EOL_S,argv[3]);
+					return 1;
 				}
-				break;
-			} else {
-				fprintf(stderr,"vanity address: tried %.10llx looking for first %d bits of %.10llx\n",(unsigned long long)id.address().toInt(),vanityBits,(unsigned long long)(vanity << (40 - vanityBits)));
 			}
+
+			const uint64_t start = OSUtils::now();
+			const bool ok = idtoolGenerate(count,vanity,vanityBits,threads,&idtoolGenerateBatchHandler,(void *)out);
+			const uint64_t end = OSUtils::now();
+			if (out != stdout)
+				fclose(out);
+			if (!ok) {
+				fprintf(stderr,"Error writing to %s" ZT_EOL_S,(out != stdout) ? argv[3] : "stdout");
+				return 1;
+			}
+			fprintf(stderr,"generated %lu identities in %.1f seconds" ZT_EOL_S,count,(double)(end - start) / 1000.0);
+			return 0;
 		}
 
+		uint64_t vanity = 0;
+		int vanityBits = 0;
+		if (argc >= 5)
+			idtoolParseVanity(argv[4],vanity,vanityBits);
+
+		Identity id;
+		idtoolGenerate(1,vanity,vanityBits,threads,&idtoolGenerateHandler,(void *)&id);
+		if (vanityBits > 0)
+			fprintf(stderr,"vanity address: found %.10llx !" ZT_EOL_S,(unsigned long long)id.address().toInt());
+
 		std::string idser = id.toString(true);
 		if (argc >= 3) {
 			if (!OSUtils::writeFile(argv[2],idser)) {
@@ -53,10 +53,12 @@
 #include "../node/NonCopyable.hpp"
 #include "../node/InetAddress.hpp"
 #include "../node/Mutex.hpp"
+#include "../node/AtomicCounter.hpp"
 #include "../node/Utils.hpp"
 
 #include "Phy.hpp"
 #include "OSUtils.hpp"
+#include "Thread.hpp"
 
 /**
  * Period between binder rescans/refreshes
@@ -65,6 +67,16 @@
  */
 #define ZT_BINDER_REFRESH_PERIOD 30000
 
+/**
+ * Maximum number of packets held in a thread's send queue before it is flushed early
+ */
+#define ZT_BINDER_SEND_QUEUE_SIZE 64
+
+/**
+ * Packets larger than this are always sent immediately instead of queued
+ */
+#define ZT_BINDER_SEND_QUEUE_MAX_PACKET_SIZE 2048
+
 namespace ZeroTier {
 
 /**
@@ -86,15 +98,55 @@ private:
 		_Binding() :
 			udpSock((PhySocket *)0),
 			tcpListenSock((PhySocket *)0),
-			address() {}
+			address(),
+			device() {}
 
 		PhySocket *udpSock;
 		PhySocket *tcpListenSock;
 		InetAddress address;
+		std::string device;
+	};
+
+	struct _QueuedSend
+	{
+		Binder *binder; // NULL once sent
+		InetAddress local; // null to send from every binding of the remote's family
+		InetAddress remote;
+		unsigned int len;
+		char data[ZT_BINDER_SEND_QUEUE_MAX_PACKET_SIZE];
+	};
+
+	// Packets queued by one thread between beginSendBatch() and flushSendBatch()
+	struct _SendQueue
+	{
+		_SendQueue() : depth(0),len(0) {}
+
+		unsigned int depth;
+		unsigned int len;
+		std::vector<_QueuedSend> q;
+		std::vector< std::pair<PhySocket *,_QueuedSend *> > sends; // sockets to send each entry from, rebuilt by every flush
 	};
 
+	static inline _SendQueue &_threadSendQueue()
+	{
+		static thread_local _SendQueue sq;
+		return sq;
+	}
+
 public:
-	Binder() {}
+	Binder() :
+		_reusePort(false) {}
+
+	/**
+	 * Set whether UDP sockets should be bound with SO_REUSEPORT
+	 *
+	 * This must be set before the first call to refresh() if refreshWorker()
+	 * is going to be used, since the kernel only allows additional sockets on
+	 * a port if every socket on it has SO_REUSEPORT set.
+	 *
+	 * @param rp If true, bind with SO_REUSEPORT
+	 */
+	inline void setReusePort(bool rp) { _reusePort = rp; }
 
 	/**
 	 * Close all bound ports
@@ -108,10 +160,12 @@ public:
 	void closeAll(Phy<PHY_HANDLER_TYPE> &phy)
 	{
 		Mutex::Lock _l(_lock);
+		_waitForSends();
 		for(typename std::vector<_Binding>::const_iterator i(_bindings.begin());i!=_bindings.end();++i) {
 			phy.close(i->udpSock,false);
 			phy.close(i->tcpListenSock,false);
 		}
+		_bindings.clear(); // so packets queued by other threads aren't sent on closed sockets
 	}
 
 	/**
@@ -136,6 +190,8 @@ public:
 		//PhySocket *tcps;
 		Mutex::Lock _l(_lock);
 
+		_waitForSends(); // we may be about to close sockets other threads are sending on
+
 #ifdef __WINDOWS__
 
 		char aabuf[32768];
@@ -338,13 +394,13 @@ public:
 			}
 
 			if (bi == _bindings.end()) {
-				udps = phy.udpBind(reinterpret_cast<const struct sockaddr *>(&(ii->first)),(void *)0,ZT_UDP_DESIRED_BUF_SIZE);
+				udps = phy.udpBind(reinterpret_cast<const struct sockaddr *>(&(ii->first)),(void *)0,ZT_UDP_DESIRED_BUF_SIZE,_reusePort,(_reusePort) ? ii->second.c_str() : (const char *)0);
 				if (udps) {
 					//tcps = phy.tcpListen(reinterpret_cast<const struct sockaddr *>(&ii),(void *)0);
 					//if (tcps) {
 #ifdef __LINUX__
 						// Bind Linux sockets to their device so routes tha we manage do not override physical routes (wish all platforms had this!)
-						if (ii->second.length() > 0) {
+						if ((ii->second.length() > 0)&&(!_reusePort)) {
 							int fd = (int)Phy<PHY_HANDLER_TYPE>::getDescriptor(udps);
 							char tmp[256];
 							Utils::scopy(tmp,sizeof(tmp),ii->second.c_str());
@@ -359,6 +415,7 @@ public:
 						newBindings.back().udpSock = udps;
 						//newBindings.back().tcpListenSock = tcps;
 						newBindings.back().address = ii->first;
+						newBindings.back().device = ii->second;
 					//} else {
 					//	phy.close(udps,false);
 					//}
@@ -370,6 +427,61 @@ public:
 		_bindings.swap(newBindings);
 	}
 
+	/**
+	 * Bind another set of UDP sockets to the current bindings for a receive worker
+	 *
+	 * Each receive worker runs its own Phy<> and calls this from its own thread
+	 * after refresh() to open SO_REUSEPORT sockets for new bindings and close
+	 * those for bindings that have gone away. The kernel then spreads incoming
+	 * packets across the sockets sharing a port. Worker sockets are used only
+	 * to receive; udpSend() always uses the main sockets.
+	 *
+	 * @param phy Worker's physical interface
+	 * @param workerSockets Worker's sockets by local address (updated)
+	 * @param uptr User pointer for new sockets
+	 * @tparam PHY_HANDLER_TYPE Type for Phy<> template
+	 */
+	template<typename PHY_HANDLER_TYPE>
+	void refreshWorker(Phy<PHY_HANDLER_TYPE> &phy,std::vector< std::pair<InetAddress,PhySocket *> > &workerSockets,void *uptr)
+	{
+		std::vector< std::pair<InetAddress,std::string> > want;
+		{
+			Mutex::Lock _l(_lock);
+			for(typename std::vector<_Binding>::const_iterator bi(_bindings.begin());bi!=_bindings.end();++bi)
+				want.push_back(std::pair<InetAddress,std::string>(bi->address,bi->device));
+		}
+
+		std::vector< std::pair<InetAddress,PhySocket *> > newSockets;
+		for(std::vector< std::pair<InetAddress,PhySocket *> >::const_iterator ws(workerSockets.begin());ws!=workerSockets.end();++ws) {
+			bool keep = false;
+			for(std::vector< std::pair<InetAddress,std::string> >::const_iterator w(want.begin());w!=want.end();++w) {
+				if (w->first == ws->first) {
+					keep = true;
+					break;
+				}
+			}
+			if (keep)
+				newSockets.push_back(*ws);
+			else phy.close(ws->second,false);
+		}
+
+		for(std::vector< std::pair<InetAddress,std::string> >::const_iterator w(want.begin());w!=want.end();++w) {
+			std::vector< std::pair<InetAddress,PhySocket *> >::const_iterator ws(newSockets.begin());
+			while (ws != newSockets.end()) {
+				if (ws->first == w->first)
+					break;
+				++ws;
+			}
+			if (ws == newSockets.end()) {
+				PhySocket *const udps = phy.udpBind(reinterpret_cast<const struct sockaddr *>(&(w->first)),uptr,ZT_UDP_DESIRED_BUF_SIZE,true,w->second.c_str());
+				if (udps)
+					newSockets.push_back(std::pair<InetAddress,PhySocket *>(w->first,udps));
+			}
+		}
+
+		workerSockets.swap(newSockets);
+	}
+
 	/**
 	 * Send a UDP packet from the specified local interface, or all
 	 *
@@ -389,6 +501,10 @@ public:
 	 * In any case on most hosts there's only one or two interfaces that we
 	 * will use, so none of this is particularly costly.
 	 *
+	 * Between beginSendBatch() and flushSendBatch() on the calling thread,
+	 * packets without a TTL override are copied into that thread's queue
+	 * without taking any lock, and this returns true immediately.
+	 *
 	 * @param local Local interface address or null address for 'all'
 	 * @param remote Remote address
 	 * @param data Data to send
@@ -396,18 +512,32 @@ public:
 	 * @param v4ttl If non-zero, send this packet with the specified IP TTL (IPv4 only)
 	 */
 	template<typename PHY_HANDLER_TYPE>
-	inline bool udpSend(Phy<PHY_HANDLER_TYPE> &phy,const InetAddress &local,const InetAddress &remote,const void *data,unsigned int len,unsigned int v4ttl = 0) const
+	inline bool udpSend(Phy<PHY_HANDLER_TYPE> &phy,const InetAddress &local,const InetAddress &remote,const void *data,unsigned int len,unsigned int v4ttl = 0)
 	{
+		if ((!v4ttl)&&(len <= ZT_BINDER_SEND_QUEUE_MAX_PACKET_SIZE)) {
+			_SendQueue &sq = _threadSendQueue();
+			if (sq.depth) {
+				if (sq.len >= ZT_BINDER_SEND_QUEUE_SIZE)
+					_flushSendQueue(phy,sq);
+				if (sq.q.size() < ZT_BINDER_SEND_QUEUE_SIZE)
+					sq.q.resize(ZT_BINDER_SEND_QUEUE_SIZE);
+				_QueuedSend &qs = sq.q[sq.len++];
+				qs.binder = this;
+				qs.local = local;
+				qs.remote = remote;
+				qs.len = len;
+				memcpy(qs.data,data,len);
+				return true;
+			}
+		}
+
 		Mutex::Lock _l(_lock);
 		if (local) {
 			for(typename std::vector<_Binding>::const_iterator i(_bindings.begin());i!=_bindings.end();++i) {
 				if (i->address == local) {
 					if ((v4ttl)&&(local.ss_family == AF_INET))
-						phy.setIp4UdpTtl(i->udpSock,v4ttl);
-					const bool result = phy.udpSend(i->udpSock,reinterpret_cast<const struct sockaddr *>(&remote),data,len);
-					if ((v4ttl)&&(local.ss_family == AF_INET))
-						phy.setIp4UdpTtl(i->udpSock,255);
-					return result;
+						return phy.udpSendWithIp4Ttl(i->udpSock,reinterpret_cast<const struct sockaddr *>(&remote),data,len,v4ttl);
+					return phy.udpSend(i->udpSock,reinterpret_cast<const struct sockaddr *>(&remote),data,len);
 				}
 			}
 			return false;
@@ -416,16 +546,47 @@ public:
 			for(typename std::vector<_Binding>::const_iterator i(_bindings.begin());i!=_bindings.end();++i) {
 				if (i->address.ss_family == remote.ss_family) {
 					if ((v4ttl)&&(remote.ss_family == AF_INET))
-						phy.setIp4UdpTtl(i->udpSock,v4ttl);
-					result |= phy.udpSend(i->udpSock,reinterpret_cast<const struct sockaddr *>(&remote),data,len);
-					if ((v4ttl)&&(remote.ss_family == AF_INET))
-						phy.setIp4UdpTtl(i->udpSock,255);
+						result |= phy.udpSendWithIp4Ttl(i->udpSock,reinterpret_cast<const struct sockaddr *>(&remote),data,len,v4ttl);
+					else result |= phy.udpSend(i->udpSock,reinterpret_cast<const struct sockaddr *>(&remote),data,len);
 				}
 			}
 			return result;
 		}
 	}
 
+	/**
+	 * Start queueing packets sent with udpSend() on the calling thread
+	 *
+	 * This is used around processing of a batch of received packets or tap
+	 * frames so that replies and relayed packets go out together via
+	 * Phy<>::udpSendBatch(). Each thread has its own queue, which covers
+	 * every Binder and is only touched by that thread, so threads batching
+	 * at once don't contend with each other. Other threads' sends are not
+	 * affected. Batches on one thread nest, and every flush sends whatever
+	 * has been queued so far.
+	 */
+	static inline void beginSendBatch()
+	{
+		++_threadSendQueue().depth;
+	}
+
+	/**
+	 * Send the calling thread's queued packets and end the batch started by beginSendBatch()
+	 *
+	 * Each Binder's lock is held only long enough to look up the sockets to
+	 * send from, and not while sending.
+	 *
+	 * @param phy Physical interface
+	 */
+	template<typename PHY_HANDLER_TYPE>
+	static inline void flushSendBatch(Phy<PHY_HANDLER_TYPE> &phy)
+	{
+		_SendQueue &sq = _threadSendQueue();
+		if (sq.depth)
+			--sq.depth;
+		_flushSendQueue(phy,sq);
+	}
+
 	/**
 	 * @return All currently bound local interface addresses
 	 */
@@ -439,7 +600,68 @@ public:
 	}
 
 private:
+	template<typename PHY_HANDLER_TYPE>
+	static inline void _flushSendQueue(Phy<PHY_HANDLER_TYPE> &phy,_SendQueue &sq)
+	{
+		for(unsigned int i=0;i<sq.len;++i) {
+			if (sq.q[i].binder)
+				sq.q[i].binder->_sendQueued(phy,sq,i);
+		}
+		sq.len = 0;
+	}
+
+	// Send the entries in sq from 'first' on that were queued for this Binder
+	template<typename PHY_HANDLER_TYPE>
+	inline void _sendQueued(Phy<PHY_HANDLER_TYPE> &phy,_SendQueue &sq,unsigned int first)
+	{
+		sq.sends.clear();
+		{
+			Mutex::Lock _l(_lock);
+			for(unsigned int k=first;k<sq.len;++k) {
+				_QueuedSend &qs = sq.q[k];
+				if (qs.binder != this)
+					continue;
+				qs.binder = (Binder *)0;
+				for(typename std::vector<_Binding>::const_iterator i(_bindings.begin());i!=_bindings.end();++i) {
+					if ((qs.local) ? (i->address == qs.local) : (i->address.ss_family == qs.remote.ss_family)) {
+						sq.sends.push_back(std::pair<PhySocket *,_QueuedSend *>(i->udpSock,&qs));
+						if (qs.local)
+							break;
+					}
+				}
+			}
+			++_sendsInFlight; // keeps refresh() and closeAll() from closing these sockets until we're done
+		}
+
+		PhyDatagram datagrams[ZT_BINDER_SEND_QUEUE_SIZE];
+		unsigned int i = 0;
+		while (i < (unsigned int)sq.sends.size()) {
+			// Send each run of packets for the same socket as one batch
+			PhySocket *const sock = sq.sends[i].first;
+			unsigned int count = 0;
+			while ((i < (unsigned int)sq.sends.size())&&(sq.sends[i].first == sock)&&(count < ZT_BINDER_SEND_QUEUE_SIZE)) {
+				_QueuedSend &qs = *(sq.sends[i++].second);
+				datagrams[count].addr = reinterpret_cast<const struct sockaddr *>(&(qs.remote));
+				datagrams[count].data = qs.data;
+				datagrams[count].len = qs.len;
+				++count;
+			}
+			phy.udpSendBatch(sock,datagrams,count);
+		}
+
+		--_sendsInFlight;
+	}
+
+	// Wait for other threads to finish sending on our sockets; _lock must be held so that no new sends can start
+	inline void _waitForSends()
+	{
+		while (_sendsInFlight.load() > 0)
+			Thread::sleep(1);
+	}
+
 	std::vector<_Binding> _bindings;
+	AtomicCounter _sendsInFlight;
+	bool _reusePort;
 	Mutex _lock;
 };
 
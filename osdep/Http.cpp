@@ -76,6 +76,7 @@ struct HttpPhyHandler
 {
 	// not used
 	inline void phyOnDatagram(PhySocket *sock,void **uptr,const struct sockaddr *localAddr,const struct sockaddr *from,void *data,unsigned long len) {}
+	inline void phyOnDatagramBatch(PhySocket *sock,void **uptr,const struct sockaddr *localAddr,const PhyDatagram *datagrams,unsigned int count) {}
 	inline void phyOnTcpAccept(PhySocket *sockL,PhySocket *sockN,void **uptrL,void **uptrN,const struct sockaddr *from) {}
 
 	inline void phyOnTcpConnect(PhySocket *sock,void **uptr,bool success)
@@ -27,8 +27,8 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
-#include <sys/wait.h>
 #include <sys/select.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <net/if_arp.h>
 #include <arpa/inet.h>
@@ -36,7 +36,6 @@
 #include <linux/if_tun.h>
 #include <linux/if_addr.h>
 #include <linux/if_ether.h>
-#include <ifaddrs.h>
 
 #include <algorithm>
 #include <utility>
@@ -46,11 +45,38 @@
 #include "../node/Mutex.hpp"
 #include "../node/Dictionary.hpp"
 #include "OSUtils.hpp"
+#include "LinuxNetLink.hpp"
 #include "LinuxEthernetTap.hpp"
 
 // ff:ff:ff:ff:ff:ff with no ADI
 static const ZeroTier::MulticastGroup _blindWildcardMulticastGroup(ZeroTier::MAC(0xff),0);
 
+// Legacy virtio_net_hdr used with IFF_VNET_HDR, repeated here because
+// linux/virtio_net.h has a struct member named "class" and won't build as C++
+struct _VirtioNetHdr
+{
+	uint8_t flags;
+	uint8_t gso_type;
+	uint16_t hdr_len;
+	uint16_t gso_size;
+	uint16_t csum_start;
+	uint16_t csum_offset;
+};
+#define ZT_VIRTIO_NET_HDR_F_NEEDS_CSUM 1
+#define ZT_VIRTIO_NET_HDR_GSO_NONE 0
+#define ZT_VIRTIO_NET_HDR_GSO_TCPV4 1
+#define ZT_VIRTIO_NET_HDR_GSO_TCPV6 4
+#define ZT_VIRTIO_NET_HDR_GSO_ECN 0x80
+
+// virtio_net_hdr plus the largest frame a TSO device can hand us or take
+#define ZT_LINUX_TAP_VNET_BUF_SIZE (sizeof(struct _VirtioNetHdr) + 14 + 65535)
+
+// Largest read without offload; longer frames are cut to MTU + 14
+#define ZT_LINUX_TAP_READ_SIZE 8194
+
+// Buffer each reader thread fills with frames before handing them on
+#define ZT_LINUX_TAP_READ_ARENA_SIZE 262144
+
 namespace ZeroTier {
 
 static Mutex __tapCreateLock;
@@ -63,14 +89,30 @@ LinuxEthernetTap::LinuxEthernetTap(
 	uint64_t nwid,
 	const char *friendlyName,
 	void (*handler)(void *,uint64_t,const MAC &,const MAC &,unsigned int,unsigned int,const void *,unsigned int),
-	void *arg) :
+	void *arg,
+	unsigned int queues,
+	bool offload,
+	void (*batchHandler)(void *,uint64_t,const Frame *,unsigned int)) :
 	_handler(handler),
+	_batchHandler(batchHandler),
 	_arg(arg),
 	_nwid(nwid),
 	_homePath(homePath),
+	_netLinkGeneration(0),
+	_ifindex(0),
 	_mtu(mtu),
 	_fd(0),
-	_enabled(true)
+	_queueCount(1),
+	_enabled(true),
+	_vnetHdr(false),
+	_putBatch(0),
+	_coalesceBuf((uint8_t *)0),
+	_coalesceLen(0),
+	_coalesceL3Len(0),
+	_coalesceSegSize(0),
+	_coalesceSegs(0),
+	_coalesceNextSeq(0),
+	_coalesceFd(0)
 {
 	char procpath[128],nwids[32];
 	struct stat sbuf;
@@ -81,6 +123,10 @@ LinuxEthernetTap::LinuxEthernetTap(
 
 	if (mtu > 2800)
 		throw std::runtime_error("max tap MTU is 2800");
+	if (queues < 1)
+		queues = 1;
+	else if (queues > ZT_LINUX_TAP_MAX_QUEUES)
+		queues = ZT_LINUX_TAP_MAX_QUEUES;
 
 	_fd = ::open("/dev/net/tun",O_RDWR);
 	if (_fd <= 0) {
@@ -119,16 +165,27 @@ LinuxEthernetTap::LinuxEthernetTap(
 		} while (stat(procpath,&sbuf) == 0); // try zt#++ until we find one that does not exist
 	}
 
-	ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+	const short tapFlags = IFF_TAP | IFF_NO_PI | (offload ? IFF_VNET_HDR : 0);
+	ifr.ifr_flags = tapFlags | ((queues > 1) ? IFF_MULTI_QUEUE : 0);
 	if (ioctl(_fd,TUNSETIFF,(void *)&ifr) < 0) {
-		::close(_fd);
-		throw std::runtime_error("unable to configure TUN/TAP device for TAP operation");
+		// Kernel may not support IFF_MULTI_QUEUE, so try again with just one queue
+		ifr.ifr_flags = tapFlags;
+		if ((queues <= 1)||(ioctl(_fd,TUNSETIFF,(void *)&ifr) < 0)) {
+			::close(_fd);
+			throw std::runtime_error("unable to configure TUN/TAP device for TAP operation");
+		}
+		queues = 1;
 	}
 
 	_dev = ifr.ifr_name;
+	_vnetHdr = offload;
 
 	::ioctl(_fd,TUNSETPERSIST,0); // valgrind may generate a false alarm here
 
+	// If this fails frames still carry a virtio_net_hdr, the kernel just never uses it
+	if (_vnetHdr)
+		::ioctl(_fd,TUNSETOFFLOAD,(unsigned int)(TUN_F_CSUM | TUN_F_TSO4 | TUN_F_TSO6));
+
 	// Open an arbitrary socket to talk to netlink
 	int sock = socket(AF_INET,SOCK_DGRAM,0);
 	if (sock <= 0) {
@@ -136,6 +193,10 @@ LinuxEthernetTap::LinuxEthernetTap(
 		throw std::runtime_error("unable to open netlink socket");
 	}
 
+	if (ioctl(sock,SIOCGIFINDEX,(void *)&ifr) == 0)
+		_ifindex = (unsigned int)ifr.ifr_ifindex;
+	LinuxNetLink::instance(); // start tracking addresses before we add any
+
 	// Set MAC address
 	ifr.ifr_ifru.ifru_hwaddr.sa_family = ARPHRD_ETHER;
 	mac.copyTo(ifr.ifr_ifru.ifru_hwaddr.sa_data,6);
@@ -154,7 +215,8 @@ LinuxEthernetTap::LinuxEthernetTap(
 		throw std::runtime_error("unable to configure TAP MTU");
 	}
 
-	if (fcntl(_fd,F_SETFL,fcntl(_fd,F_GETFL) & ~O_NONBLOCK) == -1) {
+	// Non-blocking so reader threads can drain the queue; tap writes never block anyway
+	if (fcntl(_fd,F_SETFL,fcntl(_fd,F_GETFL) | O_NONBLOCK) == -1) {
 		::close(_fd);
 		throw std::runtime_error("unable to set flags on file descriptor for TAP device");
 	}
@@ -176,23 +238,48 @@ LinuxEthernetTap::LinuxEthernetTap(
 
 	// Set close-on-exec so that devices cannot persist if we fork/exec for update
 	::fcntl(_fd,F_SETFD,fcntl(_fd,F_GETFD) | FD_CLOEXEC);
+	_queues[0].fd = _fd;
+
+	// Attach any additional queues; if some can't be attached we just use fewer
+	while (_queueCount < queues) {
+		const int qfd = ::open("/dev/net/tun",O_RDWR);
+		if (qfd <= 0)
+			break;
+		ifr.ifr_flags = tapFlags | IFF_MULTI_QUEUE;
+		if (ioctl(qfd,TUNSETIFF,(void *)&ifr) < 0) {
+			::close(qfd);
+			break;
+		}
+		::fcntl(qfd,F_SETFL,fcntl(qfd,F_GETFL) | O_NONBLOCK);
+		::fcntl(qfd,F_SETFD,fcntl(qfd,F_GETFD) | FD_CLOEXEC);
+		_queues[_queueCount++].fd = qfd;
+	}
 
 	(void)::pipe(_shutdownSignalPipe);
 
+	if (_vnetHdr)
+		_coalesceBuf = new uint8_t[ZT_LINUX_TAP_VNET_BUF_SIZE];
+
 	devmap.erase(nwids);
 	devmap.add(nwids,_dev.c_str());
 	OSUtils::writeFile((_homePath + ZT_PATH_SEPARATOR_S + "devicemap").c_str(),(const void *)devmap.data(),devmap.sizeBytes());
 
-	_thread = Thread::start(this);
+	for(unsigned int q=0;q<_queueCount;++q) {
+		_queues[q].tap = this;
+		_queues[q].thread = Thread::start(&(_queues[q]));
+	}
 }
 
 LinuxEthernetTap::~LinuxEthernetTap()
 {
-	(void)::write(_shutdownSignalPipe[1],"\0",1); // causes thread to exit
-	Thread::join(_thread);
-	::close(_fd);
+	(void)::write(_shutdownSignalPipe[1],"\0",1); // causes threads to exit
+	for(unsigned int q=0;q<_queueCount;++q) {
+		Thread::join(_queues[q].thread);
+		::close(_queues[q].fd);
+	}
 	::close(_shutdownSignalPipe[0]);
 	::close(_shutdownSignalPipe[1]);
+	delete [] _coalesceBuf;
 }
 
 void LinuxEthernetTap::setEnabled(bool en)
@@ -205,21 +292,6 @@ bool LinuxEthernetTap::enabled() const
 	return _enabled;
 }
 
-static bool ___removeIp(const std::string &_dev,const InetAddress &ip)
-{
-	long cpid = (long)vfork();
-	if (cpid == 0) {
-		OSUtils::redirectUnixOutputs("/dev/null",(const char *)0);
-		setenv("PATH", "/sbin:/bin:/usr/sbin:/usr/bin", 1);
-		::execlp("ip","ip","addr","del",ip.toString().c_str(),"dev",_dev.c_str(),(const char *)0);
-		::_exit(-1);
-	} else {
-		int exitcode = -1;
-		::waitpid(cpid,&exitcode,0);
-		return (exitcode == 0);
-	}
-}
-
 #ifdef __SYNOLOGY__
 bool LinuxEthernetTap::addIpSyn(std::vector<InetAddress> ips)
 {
@@ -228,48 +300,35 @@ bool LinuxEthernetTap::addIpSyn(std::vector<InetAddress> ips)
 	std::string cfg_contents = "DEVICE="+_dev+"\nBOOTPROTO=static";
 	int ip4=0,ip6=0,ip4_tot=0,ip6_tot=0;
 
-	long cpid = (long)vfork();
-	if (cpid == 0) {
-		OSUtils::redirectUnixOutputs("/dev/null",(const char *)0);
-		setenv("PATH", "/sbin:/bin:/usr/sbin:/usr/bin", 1);
-		// We must know if there is at least (one) of each protocol version so we 
-		// can properly enumerate address/netmask combinations in the ifcfg-dev file
-		for(int i=0; i<(int)ips.size(); i++) {
-			if (ips[i].isV4())
-				ip4_tot++;
-			else
-				ip6_tot++;
-		}
-		// Assemble and write contents of ifcfg-dev file
-		for(int i=0; i<(int)ips.size(); i++) {
-			if (ips[i].isV4()) {
-				std::string numstr4 = ip4_tot > 1 ? std::to_string(ip4) : "";
-				cfg_contents += "\nIPADDR"+numstr4+"="+ips[i].toIpString()
-					+ "\nNETMASK"+numstr4+"="+ips[i].netmask().toIpString()+"\n";
-				ip4++;
-			}
-			else {
-				std::string numstr6 = ip6_tot > 1 ? std::to_string(ip6) : "";
-				cfg_contents += "\nIPV6ADDR"+numstr6+"="+ips[i].toIpString()
-					+ "\nNETMASK"+numstr6+"="+ips[i].netmask().toIpString()+"\n";
-				ip6++;
-			}
+	// We must know if there is at least (one) of each protocol version so we
+	// can properly enumerate address/netmask combinations in the ifcfg-dev file
+	for(int i=0; i<(int)ips.size(); i++) {
+		if (ips[i].isV4())
+			ip4_tot++;
+		else
+			ip6_tot++;
+	}
+	// Assemble and write contents of ifcfg-dev file
+	for(int i=0; i<(int)ips.size(); i++) {
+		if (ips[i].isV4()) {
+			std::string numstr4 = ip4_tot > 1 ? std::to_string(ip4) : "";
+			cfg_contents += "\nIPADDR"+numstr4+"="+ips[i].toIpString()
+				+ "\nNETMASK"+numstr4+"="+ips[i].netmask().toIpString()+"\n";
+			ip4++;
 		}
-		OSUtils::writeFile(filepath.c_str(), cfg_contents.c_str(), cfg_contents.length());
-		// Finaly, add IPs
-		for(int i=0; i<(int)ips.size(); i++){
-			if (ips[i].isV4())
-				::execlp("ip","ip","addr","add",ips[i].toString().c_str(),"broadcast",ips[i].broadcast().toIpString().c_str(),"dev",_dev.c_str(),(const char *)0);
-			else
-				::execlp("ip","ip","addr","add",ips[i].toString().c_str(),"dev",_dev.c_str(),(const char *)0);			
+		else {
+			std::string numstr6 = ip6_tot > 1 ? std::to_string(ip6) : "";
+			cfg_contents += "\nIPV6ADDR"+numstr6+"="+ips[i].toIpString()
+				+ "\nNETMASK"+numstr6+"="+ips[i].netmask().toIpString()+"\n";
+			ip6++;
 		}
-		::_exit(-1);
-	} else if (cpid > 0) {
-		int exitcode = -1;
-		::waitpid(cpid,&exitcode,0);
-		return (exitcode == 0);
 	}
-	return true;
+	OSUtils::writeFile(filepath.c_str(), cfg_contents.c_str(), cfg_contents.length());
+	// Finaly, add IPs
+	bool ok = true;
+	for(int i=0; i<(int)ips.size(); i++)
+		ok &= addIp(ips[i]);
+	return ok;
 }
 #endif // __SYNOLOGY__
 
@@ -283,28 +342,13 @@ bool LinuxEthernetTap::addIp(const InetAddress &ip)
 		return true;
 
 	// Remove and reconfigure if address is the same but netmask is different
+	LinuxNetLink &nl = LinuxNetLink::instance();
 	for(std::vector<InetAddress>::iterator i(allIps.begin());i!=allIps.end();++i) {
 		if (i->ipsEqual(ip))
-			___removeIp(_dev,*i);
-	}
-
-	long cpid = (long)vfork();
-	if (cpid == 0) {
-		OSUtils::redirectUnixOutputs("/dev/null",(const char *)0);
-		setenv("PATH", "/sbin:/bin:/usr/sbin:/usr/bin", 1);
-		if (ip.isV4()) {
-			::execlp("ip","ip","addr","add",ip.toString().c_str(),"broadcast",ip.broadcast().toIpString().c_str(),"dev",_dev.c_str(),(const char *)0);
-		} else {
-			::execlp("ip","ip","addr","add",ip.toString().c_str(),"dev",_dev.c_str(),(const char *)0);
-		}
-		::_exit(-1);
-	} else if (cpid > 0) {
-		int exitcode = -1;
-		::waitpid(cpid,&exitcode,0);
-		return (exitcode == 0);
+			nl.removeAddress(_ifindex,*i);
 	}
 
-	return false;
+	return nl.addAddress(_ifindex,ip);
 }
 
 bool LinuxEthernetTap::removeIp(const InetAddress &ip)
@@ -313,7 +357,7 @@ bool LinuxEthernetTap::removeIp(const InetAddress &ip)
 		return true;
 	std::vector<InetAddress> allIps(ips());
 	if (std::find(allIps.begin(),allIps.end(),ip) != allIps.end()) {
-		if (___removeIp(_dev,ip))
+		if (LinuxNetLink::instance().removeAddress(_ifindex,ip))
 			return true;
 	}
 	return false;
@@ -321,53 +365,316 @@ bool LinuxEthernetTap::removeIp(const InetAddress &ip)
 
 std::vector<InetAddress> LinuxEthernetTap::ips() const
 {
-	struct ifaddrs *ifa = (struct ifaddrs *)0;
-	if (getifaddrs(&ifa))
-		return std::vector<InetAddress>();
-
-	std::vector<InetAddress> r;
-
-	struct ifaddrs *p = ifa;
-	while (p) {
-		if ((!strcmp(p->ifa_name,_dev.c_str()))&&(p->ifa_addr)&&(p->ifa_netmask)&&(p->ifa_addr->sa_family == p->ifa_netmask->sa_family)) {
-			switch(p->ifa_addr->sa_family) {
-				case AF_INET: {
-					struct sockaddr_in *sin = (struct sockaddr_in *)p->ifa_addr;
-					struct sockaddr_in *nm = (struct sockaddr_in *)p->ifa_netmask;
-					r.push_back(InetAddress(&(sin->sin_addr.s_addr),4,Utils::countBits((uint32_t)nm->sin_addr.s_addr)));
-				}	break;
-				case AF_INET6: {
-					struct sockaddr_in6 *sin = (struct sockaddr_in6 *)p->ifa_addr;
-					struct sockaddr_in6 *nm = (struct sockaddr_in6 *)p->ifa_netmask;
-					uint32_t b[4];
-					memcpy(b,nm->sin6_addr.s6_addr,sizeof(b));
-					r.push_back(InetAddress(sin->sin6_addr.s6_addr,16,Utils::countBits(b[0]) + Utils::countBits(b[1]) + Utils::countBits(b[2]) + Utils::countBits(b[3])));
-				}	break;
-			}
-		}
-		p = p->ifa_next;
+	return LinuxNetLink::instance().ips(_ifindex);
+}
+
+// Hashes IP addresses and TCP/UDP ports, or MACs for anything else, so all frames of a flow take the same queue
+static unsigned int _flowHash(const MAC &from,const MAC &to,unsigned int etherType,const uint8_t *data,unsigned int len)
+{
+	const uint8_t *f = (const uint8_t *)0;
+	unsigned int fl = 0;
+	uint32_t h = 2166136261U;
+	if ((etherType == ZT_ETHERTYPE_IPV4)&&(len >= 20)) {
+		const unsigned int hl = (unsigned int)(data[0] & 0xf) * 4;
+		f = data + 12;
+		fl = 8;
+		if (((data[9] == 6)||(data[9] == 17))&&((data[6] & 0x3f) == 0)&&(data[7] == 0)&&(len >= (hl + 4)))
+			h = (h ^ ((uint32_t)data[hl] << 24 | (uint32_t)data[hl + 1] << 16 | (uint32_t)data[hl + 2] << 8 | (uint32_t)data[hl + 3])) * 16777619U; // not a fragment, so ports are there
+	} else if ((etherType == ZT_ETHERTYPE_IPV6)&&(len >= 40)) {
+		f = data + 8;
+		fl = 32;
+		if (((data[6] == 6)||(data[6] == 17))&&(len >= 44))
+			h = (h ^ ((uint32_t)data[40] << 24 | (uint32_t)data[41] << 16 | (uint32_t)data[42] << 8 | (uint32_t)data[43])) * 16777619U;
+	} else {
+		const uint64_t m = from.toInt() ^ to.toInt();
+		h = (h ^ (uint32_t)m ^ (uint32_t)(m >> 32)) * 16777619U;
+	}
+	for(unsigned int i=0;i<fl;++i)
+		h = (h ^ f[i]) * 16777619U;
+	return (unsigned int)(h ^ (h >> 16));
+}
+
+static inline void _setBe16(uint8_t *p,unsigned int v)
+{
+	p[0] = (uint8_t)(v >> 8);
+	p[1] = (uint8_t)v;
+}
+
+static inline uint32_t _getBe32(const uint8_t *p)
+{
+	return (((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3]);
+}
+
+// Internet checksum: add big-endian words to a running sum, then fold with _csumFold()
+static inline uint64_t _csumAdd(uint64_t sum,const uint8_t *p,unsigned int len)
+{
+	while (len >= 4) {
+		sum += _getBe32(p);
+		p += 4;
+		len -= 4;
+	}
+	if (len >= 2) {
+		sum += ((uint32_t)p[0] << 8) | (uint32_t)p[1];
+		p += 2;
+		len -= 2;
 	}
+	if (len)
+		sum += (uint32_t)p[0] << 8;
+	return sum;
+}
 
-	if (ifa)
-		freeifaddrs(ifa);
+static inline unsigned int _csumFold(uint64_t sum)
+{
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return (unsigned int)sum;
+}
 
-	std::sort(r.begin(),r.end());
-	r.erase(std::unique(r.begin(),r.end()),r.end());
+static inline void _setIpv4HeaderChecksum(uint8_t *ip,unsigned int hdrLen)
+{
+	ip[10] = 0;
+	ip[11] = 0;
+	_setBe16(ip + 10,~_csumFold(_csumAdd(0,ip,hdrLen)));
+}
 
-	return r;
+static inline uint64_t _tcpPseudoHeaderSum(const uint8_t *ip,bool v6,unsigned int tcpLen)
+{
+	return (v6 ? _csumAdd(0,ip + 8,32) : _csumAdd(0,ip + 12,8)) + 6 + tcpLen;
 }
 
 void LinuxEthernetTap::put(const MAC &from,const MAC &to,unsigned int etherType,const void *data,unsigned int len)
 {
-	char putBuf[8194];
 	if ((_fd > 0)&&(len <= _mtu)&&(_enabled)) {
-		to.copyTo(putBuf,6);
-		from.copyTo(putBuf + 6,6);
-		*((uint16_t *)(putBuf + 12)) = htons((uint16_t)etherType);
-		memcpy(putBuf + 14,data,len);
-		len += 14;
-		(void)::write(_fd,putBuf,len);
+		const int fd = (_queueCount > 1) ? _queues[_flowHash(from,to,etherType,reinterpret_cast<const uint8_t *>(data),len) % _queueCount].fd : _fd;
+
+		// Ethernet header and payload go out as separate iovecs so the payload is never copied
+		struct _VirtioNetHdr vh;
+		uint8_t eh[14];
+		struct iovec iov[3];
+		to.copyTo(eh,6);
+		from.copyTo(eh + 6,6);
+		_setBe16(eh + 12,etherType);
+		iov[0].iov_base = &vh;
+		iov[0].iov_len = sizeof(vh);
+		iov[1].iov_base = eh;
+		iov[1].iov_len = 14;
+		iov[2].iov_base = const_cast<void *>(data);
+		iov[2].iov_len = len;
+
+		if (_vnetHdr) {
+			Mutex::Lock _l(_putLock);
+			if ((_putBatch > 0)&&(_coalesce(fd,from,to,etherType,reinterpret_cast<const uint8_t *>(data),len)))
+				return;
+			_flushCoalesced(); // keep frames in order
+			memset(&vh,0,sizeof(vh));
+			(void)::writev(fd,iov,3);
+		} else {
+			(void)::writev(fd,iov + 1,2);
+		}
+	}
+}
+
+void LinuxEthernetTap::beginPutBatch()
+{
+	if (_vnetHdr) {
+		Mutex::Lock _l(_putLock);
+		++_putBatch;
+	}
+}
+
+void LinuxEthernetTap::flushPutBatch()
+{
+	if (_vnetHdr) {
+		Mutex::Lock _l(_putLock);
+		if (_putBatch > 0)
+			--_putBatch;
+		_flushCoalesced();
+	}
+}
+
+bool LinuxEthernetTap::_coalesce(int fd,const MAC &from,const MAC &to,unsigned int etherType,const uint8_t *data,unsigned int len)
+{
+	// Only option-free IPv4 or extension-free IPv6 TCP segments that carry
+	// data and have no flags other than ACK (and PSH, which ends a run)
+	bool v6;
+	unsigned int ipHdrLen;
+	if ((etherType == ZT_ETHERTYPE_IPV4)&&(len >= 40)&&(data[0] == 0x45)&&(data[9] == 6)&&((data[6] & 0x3f) == 0)&&(data[7] == 0)&&((((unsigned int)data[2] << 8) | (unsigned int)data[3]) == len)) {
+		v6 = false;
+		ipHdrLen = 20;
+	} else if ((etherType == ZT_ETHERTYPE_IPV6)&&(len >= 60)&&((data[0] >> 4) == 6)&&(data[6] == 6)&&(((((unsigned int)data[4] << 8) | (unsigned int)data[5]) + 40) == len)) {
+		v6 = true;
+		ipHdrLen = 40;
+	} else return false;
+	const uint8_t *const tcp = data + ipHdrLen;
+	const unsigned int l3Len = ipHdrLen + ((unsigned int)(tcp[12] >> 4) * 4);
+	if ((l3Len < (ipHdrLen + 20))||(l3Len >= len)||((tcp[13] & 0xf7) != 0x10))
+		return false;
+	const unsigned int payloadLen = len - l3Len;
+	const uint32_t seq = _getBe32(tcp + 4);
+	const bool push = ((tcp[13] & 0x08) != 0);
+
+	if (_coalesceLen) {
+		uint8_t *const pf = _coalesceBuf + sizeof(struct _VirtioNetHdr);
+		const uint8_t *const pip = pf + 14;
+		uint8_t *const ptcp = pf + 14 + ipHdrLen;
+		if ( (_coalesceFd == fd) &&
+		     (_coalesceL3Len == l3Len) &&
+		     (_coalesceNextSeq == seq) &&
+		     (payloadLen <= _coalesceSegSize) &&
+		     ((_coalesceLen - (sizeof(struct _VirtioNetHdr) + 14) + payloadLen) <= 65535) &&
+		     (to == MAC(pf,6)) &&
+		     (from == MAC(pf + 6,6)) &&
+		     (pip[0] == data[0]) &&
+		     ((v6) ? ((memcmp(pip,data,4) == 0)&&(memcmp(pip + 6,data + 6,34) == 0)) : ((memcmp(pip,data,2) == 0)&&(memcmp(pip + 6,data + 6,4) == 0)&&(memcmp(pip + 12,data + 12,8) == 0))) &&
+		     (memcmp(ptcp,tcp,4) == 0) && // ports
+		     (memcmp(ptcp + 8,tcp + 8,6) == 0) && // ack, offset, flags
+		     (memcmp(ptcp + 14,tcp + 14,2) == 0) && // window
+		     (memcmp(ptcp + 18,tcp + 18,l3Len - (ipHdrLen + 18)) == 0) ) { // urgent pointer, options
+			memcpy(_coalesceBuf + _coalesceLen,data + l3Len,payloadLen);
+			_coalesceLen += payloadLen;
+			_coalesceNextSeq += payloadLen;
+			++_coalesceSegs;
+			if ((push)||(payloadLen < _coalesceSegSize)||((_coalesceLen - (sizeof(struct _VirtioNetHdr) + 14) + _coalesceSegSize) > 65535)) {
+				ptcp[13] = tcp[13];
+				_flushCoalesced();
+			}
+			return true;
+		}
+		_flushCoalesced();
+	}
+
+	if (push)
+		return false;
+	uint8_t *const pf = _coalesceBuf + sizeof(struct _VirtioNetHdr);
+	to.copyTo(pf,6);
+	from.copyTo(pf + 6,6);
+	_setBe16(pf + 12,etherType);
+	memcpy(pf + 14,data,len);
+	_coalesceLen = sizeof(struct _VirtioNetHdr) + 14 + len;
+	_coalesceL3Len = l3Len;
+	_coalesceSegSize = payloadLen;
+	_coalesceSegs = 1;
+	_coalesceNextSeq = seq + payloadLen;
+	_coalesceFd = fd;
+	return true;
+}
+
+void LinuxEthernetTap::_flushCoalesced()
+{
+	if (!_coalesceLen)
+		return;
+
+	struct _VirtioNetHdr vh;
+	memset(&vh,0,sizeof(vh));
+	if (_coalesceSegs > 1) {
+		// Fix up lengths and hand the kernel a TSO frame as if we were a NIC
+		// doing receive offload. The TCP checksum field gets the pseudo-header
+		// sum and is completed by the kernel only if the frame leaves the box.
+		uint8_t *const ip = _coalesceBuf + sizeof(vh) + 14;
+		const unsigned int ipLen = _coalesceLen - (sizeof(vh) + 14);
+		const bool v6 = ((ip[0] >> 4) == 6);
+		const unsigned int ipHdrLen = (v6) ? 40 : 20;
+		if (v6) {
+			_setBe16(ip + 4,ipLen - 40);
+		} else {
+			_setBe16(ip + 2,ipLen);
+			_setIpv4HeaderChecksum(ip,20);
+		}
+		_setBe16(ip + ipHdrLen + 16,_csumFold(_tcpPseudoHeaderSum(ip,v6,ipLen - ipHdrLen)));
+		vh.flags = ZT_VIRTIO_NET_HDR_F_NEEDS_CSUM;
+		vh.gso_type = (v6) ? ZT_VIRTIO_NET_HDR_GSO_TCPV6 : ZT_VIRTIO_NET_HDR_GSO_TCPV4;
+		vh.hdr_len = (uint16_t)(14 + _coalesceL3Len);
+		vh.gso_size = (uint16_t)_coalesceSegSize;
+		vh.csum_start = (uint16_t)(14 + ipHdrLen);
+		vh.csum_offset = 16;
+	}
+	memcpy(_coalesceBuf,&vh,sizeof(vh));
+	(void)::write(_coalesceFd,_coalesceBuf,_coalesceLen);
+	_coalesceLen = 0;
+}
+
+void LinuxEthernetTap::_deliver(const Frame *frames,unsigned int count)
+{
+	if ((count)&&(_enabled)) {
+		if (_batchHandler) {
+			_batchHandler(_arg,_nwid,frames,count);
+		} else {
+			for(unsigned int i=0;i<count;++i)
+				_handler(_arg,_nwid,frames[i].from,frames[i].to,frames[i].etherType,frames[i].vlanId,frames[i].data,frames[i].len);
+		}
+	}
+}
+
+void LinuxEthernetTap::_segment(unsigned int gsoType,unsigned int gsoSize,const uint8_t *frame,unsigned int frameLen,uint8_t *segBuf,Frame *frames)
+{
+	// Cut a TCP super-frame into gso_size segments with their own headers and
+	// checksums, built one after another in segBuf and handed on in batches
+	const unsigned int etherType = ((unsigned int)frame[12] << 8) | (unsigned int)frame[13];
+	const bool v6 = (gsoType == ZT_VIRTIO_NET_HDR_GSO_TCPV6);
+	if (!(((gsoType == ZT_VIRTIO_NET_HDR_GSO_TCPV4)&&(etherType == ZT_ETHERTYPE_IPV4))||((v6)&&(etherType == ZT_ETHERTYPE_IPV6))))
+		return; // we never advertise UDP offloads
+	const uint8_t *const ip = frame + 14;
+	const unsigned int ipLen = frameLen - 14;
+	unsigned int ipHdrLen;
+	if (v6) {
+		if ((ipLen < 60)||(ip[6] != 6))
+			return;
+		ipHdrLen = 40;
+	} else {
+		ipHdrLen = (unsigned int)(ip[0] & 0xf) * 4;
+		if ((ipHdrLen < 20)||(ipLen < (ipHdrLen + 20))||(ip[9] != 6))
+			return;
 	}
+	const unsigned int hdrLen = ipHdrLen + ((unsigned int)(ip[ipHdrLen + 12] >> 4) * 4);
+	const unsigned int mss = gsoSize;
+	if ((hdrLen < (ipHdrLen + 20))||(hdrLen >= ipLen)||(mss == 0))
+		return;
+	const MAC to(frame,6),from(frame + 6,6);
+	const uint32_t seq = _getBe32(ip + ipHdrLen + 4);
+	const unsigned int ipId = ((unsigned int)ip[4] << 8) | (unsigned int)ip[5];
+
+	unsigned int count = 0,used = 0;
+	for(unsigned int off=hdrLen,i=0;off<ipLen;off+=mss,++i) {
+		const unsigned int segLen = hdrLen + std::min(mss,ipLen - off);
+		if ((count == ZT_LINUX_TAP_READ_BATCH)||((used + segLen) > (ZT_LINUX_TAP_VNET_BUF_SIZE * 2))) {
+			_deliver(frames,count);
+			count = 0;
+			used = 0;
+		}
+		uint8_t *const seg = segBuf + used;
+		memcpy(seg,ip,hdrLen);
+		memcpy(seg + hdrLen,ip + off,segLen - hdrLen);
+		if (v6) {
+			_setBe16(seg + 4,segLen - 40);
+		} else {
+			_setBe16(seg + 2,segLen);
+			_setBe16(seg + 4,ipId + i);
+			_setIpv4HeaderChecksum(seg,ipHdrLen);
+		}
+		uint8_t *const tcp = seg + ipHdrLen;
+		const uint32_t s = seq + (off - hdrLen);
+		tcp[4] = (uint8_t)(s >> 24);
+		tcp[5] = (uint8_t)(s >> 16);
+		tcp[6] = (uint8_t)(s >> 8);
+		tcp[7] = (uint8_t)s;
+		if (i > 0)
+			tcp[13] &= 0x7f; // CWR only on the first segment
+		if ((off + mss) < ipLen)
+			tcp[13] &= 0xf6; // FIN and PSH only on the last
+		tcp[16] = 0;
+		tcp[17] = 0;
+		_setBe16(tcp + 16,~_csumFold(_csumAdd(_tcpPseudoHeaderSum(seg,v6,segLen - ipHdrLen),tcp,segLen - ipHdrLen)));
+
+		Frame &f = frames[count++];
+		f.from = from;
+		f.to = to;
+		f.etherType = etherType;
+		f.vlanId = 0;
+		f.data = seg;
+		f.len = segLen;
+		used += (segLen + 7) & ~7U;
+	}
+	_deliver(frames,count);
 }
 
 std::string LinuxEthernetTap::deviceName() const
@@ -381,35 +688,18 @@ void LinuxEthernetTap::setFriendlyName(const char *friendlyName)
 
 void LinuxEthernetTap::scanMulticastGroups(std::vector<MulticastGroup> &added,std::vector<MulticastGroup> &removed)
 {
-	char *ptr,*ptr2;
-	unsigned char mac[6];
-	std::vector<MulticastGroup> newGroups;
+	LinuxNetLink &nl = LinuxNetLink::instance();
+	const uint64_t g = nl.generation(_ifindex,OSUtils::now());
+	if (g == _netLinkGeneration)
+		return; // no IP or multicast membership changes since last time
+	_netLinkGeneration = g;
 
-	int fd = ::open("/proc/net/dev_mcast",O_RDONLY);
-	if (fd > 0) {
-		char buf[131072];
-		int n = (int)::read(fd,buf,sizeof(buf));
-		if ((n > 0)&&(n < (int)sizeof(buf))) {
-			buf[n] = (char)0;
-			for(char *l=strtok_r(buf,"\r\n",&ptr);(l);l=strtok_r((char *)0,"\r\n",&ptr)) {
-				int fno = 0;
-				char *devname = (char *)0;
-				char *mcastmac = (char *)0;
-				for(char *f=strtok_r(l," \t",&ptr2);(f);f=strtok_r((char *)0," \t",&ptr2)) {
-					if (fno == 1)
-						devname = f;
-					else if (fno == 4)
-						mcastmac = f;
-					++fno;
-				}
-				if ((devname)&&(!strcmp(devname,_dev.c_str()))&&(mcastmac)&&(Utils::unhex(mcastmac,mac,6) == 6))
-					newGroups.push_back(MulticastGroup(MAC(mac,6),0));
-			}
-		}
-		::close(fd);
-	}
+	std::vector<MulticastGroup> newGroups;
+	std::vector<MAC> macs(nl.multicastMacs(_ifindex));
+	for(std::vector<MAC>::iterator m(macs.begin());m!=macs.end();++m)
+		newGroups.push_back(MulticastGroup(*m,0));
 
-	std::vector<InetAddress> allIps(ips());
+	std::vector<InetAddress> allIps(nl.ips(_ifindex));
 	for(std::vector<InetAddress>::iterator ip(allIps.begin());ip!=allIps.end();++ip)
 		newGroups.push_back(MulticastGroup::deriveMulticastGroupForAddressResolution(*ip));
 
@@ -428,56 +718,98 @@ void LinuxEthernetTap::scanMulticastGroups(std::vector<MulticastGroup> &added,st
 	_multicastGroups.swap(newGroups);
 }
 
-void LinuxEthernetTap::threadMain()
+void LinuxEthernetTap::_Queue::threadMain()
 	throw()
 {
 	fd_set readfds,nullfds;
-	MAC to,from;
-	int n,nfds,r;
-	char getBuf[8194];
+	int n,nfds;
+	Frame frames[ZT_LINUX_TAP_READ_BATCH];
+	const int shutdownFd = tap->_shutdownSignalPipe[0];
+	const bool vnet = tap->_vnetHdr;
+	const unsigned int readSize = (vnet) ? (unsigned int)ZT_LINUX_TAP_VNET_BUF_SIZE : (unsigned int)ZT_LINUX_TAP_READ_SIZE;
+	uint8_t *const arena = new uint8_t[ZT_LINUX_TAP_READ_ARENA_SIZE];
+	uint8_t *const segBuf = (vnet) ? new uint8_t[ZT_LINUX_TAP_VNET_BUF_SIZE * 2] : (uint8_t *)0;
 
 	Thread::sleep(500);
 
 	FD_ZERO(&readfds);
 	FD_ZERO(&nullfds);
-	nfds = (int)std::max(_shutdownSignalPipe[0],_fd) + 1;
+	nfds = (int)std::max(shutdownFd,fd) + 1;
 
-	r = 0;
 	for(;;) {
-		FD_SET(_shutdownSignalPipe[0],&readfds);
-		FD_SET(_fd,&readfds);
+		FD_SET(shutdownFd,&readfds);
+		FD_SET(fd,&readfds);
 		select(nfds,&readfds,&nullfds,&nullfds,(struct timeval *)0);
 
-		if (FD_ISSET(_shutdownSignalPipe[0],&readfds)) // writes to shutdown pipe terminate thread
+		if (FD_ISSET(shutdownFd,&readfds)) // writes to shutdown pipe terminate all queue threads
 			break;
 
-		if (FD_ISSET(_fd,&readfds)) {
-			n = (int)::read(_fd,getBuf + r,sizeof(getBuf) - r);
-			if (n < 0) {
-				if ((errno != EINTR)&&(errno != ETIMEDOUT))
+		if (FD_ISSET(fd,&readfds)) {
+			// Read until the queue is empty, handing frames on whenever the batch or arena fills
+			unsigned int count = 0,used = 0;
+			bool dead = false;
+			for(;;) {
+				if ((count == ZT_LINUX_TAP_READ_BATCH)||((ZT_LINUX_TAP_READ_ARENA_SIZE - used) < readSize)) {
+					tap->_deliver(frames,count);
+					count = 0;
+					used = 0;
+				}
+
+				uint8_t *const b = arena + used;
+				n = (int)::read(fd,b,readSize);
+				if (n < 0) {
+					dead = ((errno != EAGAIN)&&(errno != EWOULDBLOCK)&&(errno != EINTR)&&(errno != ETIMEDOUT));
 					break;
-			} else {
-				// Some tap drivers like to send the ethernet frame and the
-				// payload in two chunks, so handle that by accumulating
-				// data until we have at least a frame.
-				r += n;
-				if (r > 14) {
-					if (r > ((int)_mtu + 14)) // sanity check for weird TAP behavior on some platforms
-						r = _mtu + 14;
-
-					if (_enabled) {
-						to.setTo(getBuf,6);
-						from.setTo(getBuf + 6,6);
-						unsigned int etherType = ntohs(((const uint16_t *)getBuf)[6]);
-						// TODO: VLAN support
-						_handler(_arg,_nwid,from,to,etherType,0,(const void *)(getBuf + 14),r - 14);
-					}
+				}
 
-					r = 0;
+				uint8_t *frame = b;
+				unsigned int frameLen = (unsigned int)n;
+				if (vnet) {
+					if (frameLen <= (sizeof(struct _VirtioNetHdr) + 14))
+						continue;
+					struct _VirtioNetHdr vh;
+					memcpy(&vh,b,sizeof(vh));
+					frame += sizeof(vh);
+					frameLen -= sizeof(vh);
+					if (vh.gso_type != ZT_VIRTIO_NET_HDR_GSO_NONE) {
+						tap->_deliver(frames,count); // keep frames in order
+						count = 0;
+						used = 0;
+						tap->_segment(vh.gso_type & ~ZT_VIRTIO_NET_HDR_GSO_ECN,vh.gso_size,frame,frameLen,segBuf,frames);
+						continue;
+					}
+					if ((vh.flags & ZT_VIRTIO_NET_HDR_F_NEEDS_CSUM) != 0) {
+						// Checksum field holds the pseudo-header sum, so sum from csum_start on and store
+						const unsigned int cs = vh.csum_start;
+						const unsigned int co = cs + vh.csum_offset;
+						if ((co + 2) > frameLen)
+							continue;
+						_setBe16(frame + co,~_csumFold(_csumAdd(0,frame + cs,frameLen - cs)));
+					}
+				} else {
+					if (frameLen <= 14)
+						continue;
+					if (frameLen > (tap->_mtu + 14)) // sanity check for weird TAP behavior on some platforms
+						frameLen = tap->_mtu + 14;
 				}
+
+				Frame &f = frames[count++];
+				f.to.setTo(frame,6);
+				f.from.setTo(frame + 6,6);
+				f.etherType = ((unsigned int)frame[12] << 8) | (unsigned int)frame[13];
+				f.vlanId = 0; // TODO: VLAN support
+				f.data = frame + 14;
+				f.len = frameLen - 14;
+				used += ((unsigned int)n + 7) & ~7U;
 			}
+			tap->_deliver(frames,count);
+			if (dead)
+				break;
 		}
 	}
+
+	delete [] segBuf;
+	delete [] arena;
 }
 
 } // namespace ZeroTier
@@ -27,16 +27,58 @@
 #include <stdexcept>
 
 #include "../node/MulticastGroup.hpp"
+#include "../node/Mutex.hpp"
 #include "Thread.hpp"
 
+/**
+ * Maximum number of tap queues (each with its own reader thread) per device
+ */
+#define ZT_LINUX_TAP_MAX_QUEUES 64
+
+/**
+ * Maximum number of frames handed to the batch handler at once
+ */
+#define ZT_LINUX_TAP_READ_BATCH 64
+
 namespace ZeroTier {
 
 /**
  * Linux Ethernet tap using kernel tun/tap driver
+ *
+ * With more than one queue the device is created with IFF_MULTI_QUEUE and
+ * each queue is read by its own thread. The kernel hashes flows onto
+ * queues, so frames within a flow reach the handler in order from one
+ * thread. put() likewise picks a queue by flow hash. Kernels without
+ * multiqueue tap support (before 3.8) get a single queue.
+ *
+ * With offload enabled the device is created with IFF_VNET_HDR and tells
+ * the kernel it can take unchecksummed and TSO frames. Reader threads then
+ * complete checksums and cut TCP super-frames of up to 64KB into MSS sized
+ * segments before handing them on. Between beginPutBatch() and
+ * flushPutBatch() put() merges consecutive in-sequence TCP segments of
+ * the same flow into one super-frame, so the kernel sees one large write
+ * instead of many small ones.
+ *
+ * Reader threads drain every frame waiting on their queue before going
+ * back to select(). If a batch handler is given, frames read together are
+ * passed to it in one call, otherwise the frame handler gets each one.
  */
 class LinuxEthernetTap
 {
 public:
+	/**
+	 * A frame read from the tap, valid only for the duration of the batch handler call
+	 */
+	struct Frame
+	{
+		MAC from;
+		MAC to;
+		unsigned int etherType;
+		unsigned int vlanId;
+		const void *data;
+		unsigned int len;
+	};
+
 	LinuxEthernetTap(
 		const char *homePath,
 		const MAC &mac,
@@ -45,7 +87,10 @@ public:
 		uint64_t nwid,
 		const char *friendlyName,
 		void (*handler)(void *,uint64_t,const MAC &,const MAC &,unsigned int,unsigned int,const void *,unsigned int),
-		void *arg);
+		void *arg,
+		unsigned int queues = 1,
+		bool offload = false,
+		void (*batchHandler)(void *,uint64_t,const Frame *,unsigned int) = 0);
 
 	~LinuxEthernetTap();
 
@@ -62,21 +107,73 @@ public:
 	void setFriendlyName(const char *friendlyName);
 	void scanMulticastGroups(std::vector<MulticastGroup> &added,std::vector<MulticastGroup> &removed);
 
-	void threadMain()
-		throw();
+	/**
+	 * @return Number of tap queues actually in use
+	 */
+	inline unsigned int queueCount() const { return _queueCount; }
+
+	/**
+	 * @return True if the device was created with checksum and TSO offload
+	 */
+	inline bool offloadEnabled() const { return _vnetHdr; }
+
+	/**
+	 * Begin a batch of put() calls whose TCP segments may be coalesced
+	 *
+	 * Batches nest and may overlap across threads. Segments are only held
+	 * back while at least one batch is open, and every flush writes out
+	 * whatever is pending. Without offload this does nothing.
+	 */
+	void beginPutBatch();
+
+	/**
+	 * End a batch begun with beginPutBatch() and write any pending frame
+	 */
+	void flushPutBatch();
 
 private:
+	struct _Queue
+	{
+		LinuxEthernetTap *tap;
+		int fd;
+		Thread thread;
+
+		void threadMain()
+			throw();
+	};
+
+	void _deliver(const Frame *frames,unsigned int count);
+	void _segment(unsigned int gsoType,unsigned int gsoSize,const uint8_t *frame,unsigned int frameLen,uint8_t *segBuf,Frame *frames);
+	bool _coalesce(int fd,const MAC &from,const MAC &to,unsigned int etherType,const uint8_t *data,unsigned int len);
+	void _flushCoalesced();
+
 	void (*_handler)(void *,uint64_t,const MAC &,const MAC &,unsigned int,unsigned int,const void *,unsigned int);
+	void (*_batchHandler)(void *,uint64_t,const Frame *,unsigned int);
 	void *_arg;
 	uint64_t _nwid;
-	Thread _thread;
 	std::string _homePath;
 	std::string _dev;
 	std::vector<MulticastGroup> _multicastGroups;
+	uint64_t _netLinkGeneration; // LinuxNetLink generation _multicastGroups was computed for
+	unsigned int _ifindex;
 	unsigned int _mtu;
-	int _fd;
+	int _fd; // first queue, also used to configure the device
+	_Queue _queues[ZT_LINUX_TAP_MAX_QUEUES];
+	unsigned int _queueCount;
 	int _shutdownSignalPipe[2];
 	volatile bool _enabled;
+	bool _vnetHdr; // frames carry a virtio_net_hdr and may be TSO super-frames
+
+	// TCP segments being merged by put(), guarded by _putLock
+	Mutex _putLock;
+	unsigned int _putBatch;
+	uint8_t *_coalesceBuf; // virtio_net_hdr followed by Ethernet frame, NULL without offload
+	unsigned int _coalesceLen; // 0 if nothing is pending
+	unsigned int _coalesceL3Len; // IP + TCP header length
+	unsigned int _coalesceSegSize;
+	unsigned int _coalesceSegs;
+	uint32_t _coalesceNextSeq;
+	int _coalesceFd;
 };
 
 } // namespace ZeroTier
@@ -0,0 +1,518 @@
+/*
+ * ZeroTier One - Network Virtualization Everywhere
+ * Copyright (C) 2011-2016  ZeroTier, Inc.  https://www.zerotier.com/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <ifaddrs.h>
+
+#include <algorithm>
+#include <string>
+
+#include "../node/Utils.hpp"
+#include "LinuxNetLink.hpp"
+
+// Big enough for any single netlink message the kernel sends us
+#define ZT_LINUX_NETLINK_BUF_SIZE 65536
+
+// Queued requests are sent once this much has built up, well under the socket send buffer
+#define ZT_LINUX_NETLINK_MAX_PENDING 32768
+
+namespace ZeroTier {
+
+namespace {
+
+// An address or route request with room for its attributes
+struct _NlRequest
+{
+	_NlRequest(uint16_t type,uint16_t flags,const void *body,unsigned int len)
+	{
+		memset(buf,0,sizeof(buf));
+		nh()->nlmsg_len = NLMSG_LENGTH(len);
+		nh()->nlmsg_type = type;
+		nh()->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | flags;
+		memcpy(NLMSG_DATA(nh()),body,len);
+	}
+
+	inline struct nlmsghdr *nh() { return reinterpret_cast<struct nlmsghdr *>(buf); }
+
+	inline void attr(uint16_t type,const void *data,unsigned int len)
+	{
+		struct rtattr *const rta = reinterpret_cast<struct rtattr *>(reinterpret_cast<char *>(buf) + NLMSG_ALIGN(nh()->nlmsg_len));
+		rta->rta_type = type;
+		rta->rta_len = RTA_LENGTH(len);
+		memcpy(RTA_DATA(rta),data,len);
+		nh()->nlmsg_len = NLMSG_ALIGN(nh()->nlmsg_len) + RTA_ALIGN(rta->rta_len);
+	}
+
+	uint64_t buf[32];
+};
+
+static inline unsigned int _ipLen(const InetAddress &ip) { return ((ip.ss_family == AF_INET6) ? 16 : 4); }
+
+} // anonymous namespace
+
+LinuxNetLink &LinuxNetLink::instance()
+{
+	static LinuxNetLink nl;
+	return nl;
+}
+
+LinuxNetLink::LinuxNetLink() :
+	_fd(-1),
+	_requestFd(-1),
+	_seq(0),
+	_lastGeneration(0),
+	_lastMulticastScan(0),
+	_batch(0),
+	_batchFailures(0)
+{
+	_fd = ::socket(AF_NETLINK,SOCK_RAW | SOCK_CLOEXEC,NETLINK_ROUTE);
+	_requestFd = ::socket(AF_NETLINK,SOCK_RAW | SOCK_CLOEXEC,NETLINK_ROUTE);
+	if ((_fd >= 0)&&(_requestFd >= 0)) {
+		// Notifications only queue up between queries, but a burst of changes shouldn't force a full dump
+		int rcvbuf = 1048576;
+		::setsockopt(_fd,SOL_SOCKET,SO_RCVBUF,&rcvbuf,sizeof(rcvbuf));
+		struct timeval tv;
+		tv.tv_sec = 5;
+		tv.tv_usec = 0;
+		::setsockopt(_requestFd,SOL_SOCKET,SO_RCVTIMEO,&tv,sizeof(tv));
+
+		struct sockaddr_nl sa;
+		memset(&sa,0,sizeof(sa));
+		sa.nl_family = AF_NETLINK;
+		sa.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+		if (::bind(_fd,(const struct sockaddr *)&sa,sizeof(sa)) == 0) {
+			// Subscribe first so nothing is missed between the dump and the first notification
+			_dump();
+			return;
+		}
+	}
+	if (_fd >= 0)
+		::close(_fd);
+	if (_requestFd >= 0)
+		::close(_requestFd);
+	_fd = -1;
+	_requestFd = -1;
+}
+
+LinuxNetLink::~LinuxNetLink()
+{
+	if (_fd >= 0)
+		::close(_fd);
+	if (_requestFd >= 0)
+		::close(_requestFd);
+}
+
+std::vector<InetAddress> LinuxNetLink::ips(unsigned int ifindex)
+{
+	if (_fd < 0) {
+		// No netlink, so do it the slow way
+		char dev[IF_NAMESIZE];
+		std::vector<InetAddress> r;
+		struct ifaddrs *ifa = (struct ifaddrs *)0;
+		if ((!if_indextoname(ifindex,dev))||(getifaddrs(&ifa)))
+			return r;
+		for(struct ifaddrs *p=ifa;(p);p=p->ifa_next) {
+			if ((!strcmp(p->ifa_name,dev))&&(p->ifa_addr)&&(p->ifa_netmask)&&(p->ifa_addr->sa_family == p->ifa_netmask->sa_family)) {
+				switch(p->ifa_addr->sa_family) {
+					case AF_INET: {
+						struct sockaddr_in *sin = (struct sockaddr_in *)p->ifa_addr;
+						struct sockaddr_in *nm = (struct sockaddr_in *)p->ifa_netmask;
+						r.push_back(InetAddress(&(sin->sin_addr.s_addr),4,Utils::countBits((uint32_t)nm->sin_addr.s_addr)));
+					}	break;
+					case AF_INET6: {
+						struct sockaddr_in6 *sin = (struct sockaddr_in6 *)p->ifa_addr;
+						struct sockaddr_in6 *nm = (struct sockaddr_in6 *)p->ifa_netmask;
+						uint32_t b[4];
+						memcpy(b,nm->sin6_addr.s6_addr,sizeof(b));
+						r.push_back(InetAddress(sin->sin6_addr.s6_addr,16,Utils::countBits(b[0]) + Utils::countBits(b[1]) + Utils::countBits(b[2]) + Utils::countBits(b[3])));
+					}	break;
+				}
+			}
+		}
+		freeifaddrs(ifa);
+		std::sort(r.begin(),r.end());
+		r.erase(std::unique(r.begin(),r.end()),r.end());
+		return r;
+	}
+
+	Mutex::Lock _l(_lock);
+	_drain();
+	std::map< unsigned int,_Interface >::const_iterator i(_interfaces.find(ifindex));
+	return ((i == _interfaces.end()) ? std::vector<InetAddress>() : i->second.ips);
+}
+
+std::vector<MAC> LinuxNetLink::multicastMacs(unsigned int ifindex)
+{
+	Mutex::Lock _l(_lock);
+	std::map< unsigned int,_Interface >::const_iterator i(_interfaces.find(ifindex));
+	return ((i == _interfaces.end()) ? std::vector<MAC>() : i->second.multicastMacs);
+}
+
+uint64_t LinuxNetLink::generation(unsigned int ifindex,uint64_t now)
+{
+	Mutex::Lock _l(_lock);
+	if ((now - _lastMulticastScan) >= ZT_LINUX_NETLINK_MULTICAST_SCAN_INTERVAL) {
+		_lastMulticastScan = now;
+		_scanMulticast();
+	}
+	if (_fd < 0)
+		return ++_lastGeneration; // can't tell when IPs change, so always assume they did
+	_drain();
+	std::map< unsigned int,_Interface >::const_iterator i(_interfaces.find(ifindex));
+	return ((i == _interfaces.end()) ? 0 : i->second.generation);
+}
+
+bool LinuxNetLink::addAddress(unsigned int ifindex,const InetAddress &ip)
+{
+	struct ifaddrmsg ifa;
+	memset(&ifa,0,sizeof(ifa));
+	ifa.ifa_family = (unsigned char)ip.ss_family;
+	ifa.ifa_prefixlen = (unsigned char)ip.netmaskBits();
+	ifa.ifa_scope = RT_SCOPE_UNIVERSE;
+	ifa.ifa_index = ifindex;
+	_NlRequest r(RTM_NEWADDR,NLM_F_CREATE | NLM_F_REPLACE,&ifa,sizeof(ifa));
+	r.attr(IFA_LOCAL,ip.rawIpData(),_ipLen(ip));
+	r.attr(IFA_ADDRESS,ip.rawIpData(),_ipLen(ip));
+	if (ip.ss_family == AF_INET) {
+		const InetAddress bc(ip.broadcast());
+		r.attr(IFA_BROADCAST,bc.rawIpData(),4);
+	}
+	return _submit(r.buf,false);
+}
+
+bool LinuxNetLink::removeAddress(unsigned int ifindex,const InetAddress &ip)
+{
+	struct ifaddrmsg ifa;
+	memset(&ifa,0,sizeof(ifa));
+	ifa.ifa_family = (unsigned char)ip.ss_family;
+	ifa.ifa_prefixlen = (unsigned char)ip.netmaskBits();
+	ifa.ifa_index = ifindex;
+	_NlRequest r(RTM_DELADDR,0,&ifa,sizeof(ifa));
+	r.attr(IFA_LOCAL,ip.rawIpData(),_ipLen(ip));
+	return _submit(r.buf,true);
+}
+
+bool LinuxNetLink::replaceRoute(const InetAddress &target,const InetAddress &via,unsigned int ifindex)
+{
+	if ((!via)&&(!ifindex))
+		return false;
+	struct rtmsg rtm;
+	memset(&rtm,0,sizeof(rtm));
+	rtm.rtm_family = (unsigned char)target.ss_family;
+	rtm.rtm_dst_len = (unsigned char)target.netmaskBits();
+	rtm.rtm_table = RT_TABLE_MAIN;
+	rtm.rtm_protocol = RTPROT_BOOT; // same as ip route
+	rtm.rtm_scope = (via) ? RT_SCOPE_UNIVERSE : RT_SCOPE_LINK;
+	rtm.rtm_type = RTN_UNICAST;
+	_NlRequest r(RTM_NEWROUTE,NLM_F_CREATE | NLM_F_REPLACE,&rtm,sizeof(rtm));
+	const InetAddress dst(target.network());
+	r.attr(RTA_DST,dst.rawIpData(),_ipLen(dst));
+	if (via)
+		r.attr(RTA_GATEWAY,via.rawIpData(),_ipLen(via));
+	if (ifindex) {
+		const uint32_t oif = (uint32_t)ifindex;
+		r.attr(RTA_OIF,&oif,sizeof(oif));
+	}
+	return _submit(r.buf,false);
+}
+
+bool LinuxNetLink::removeRoute(const InetAddress &target,const InetAddress &via,unsigned int ifindex)
+{
+	struct rtmsg rtm;
+	memset(&rtm,0,sizeof(rtm));
+	rtm.rtm_family = (unsigned char)target.ss_family;
+	rtm.rtm_dst_len = (unsigned char)target.netmaskBits();
+	rtm.rtm_table = RT_TABLE_MAIN;
+	rtm.rtm_scope = RT_SCOPE_NOWHERE; // matches any scope
+	_NlRequest r(RTM_DELROUTE,0,&rtm,sizeof(rtm));
+	const InetAddress dst(target.network());
+	r.attr(RTA_DST,dst.rawIpData(),_ipLen(dst));
+	if (via)
+		r.attr(RTA_GATEWAY,via.rawIpData(),_ipLen(via));
+	if (ifindex) {
+		const uint32_t oif = (uint32_t)ifindex;
+		r.attr(RTA_OIF,&oif,sizeof(oif));
+	}
+	return _submit(r.buf,true);
+}
+
+void LinuxNetLink::beginBatch()
+{
+	Mutex::Lock _l(_lock);
+	++_batch;
+}
+
+unsigned int LinuxNetLink::flushBatch()
+{
+	Mutex::Lock _l(_lock);
+	if ((_batch == 0)||(--_batch > 0))
+		return 0;
+	const unsigned int failures = _batchFailures + _send();
+	_batchFailures = 0;
+	return failures;
+}
+
+bool LinuxNetLink::_submit(void *msg,bool removal)
+{
+	Mutex::Lock _l(_lock);
+	if (_requestFd < 0)
+		return false;
+	struct nlmsghdr *const nh = reinterpret_cast<struct nlmsghdr *>(msg);
+	nh->nlmsg_seq = ++_seq;
+	_pending.append(reinterpret_cast<const char *>(msg),NLMSG_ALIGN(nh->nlmsg_len));
+	_pendingSeqs.push_back(std::pair<uint32_t,bool>(nh->nlmsg_seq,removal));
+	if (_batch > 0) {
+		if (_pending.length() >= ZT_LINUX_NETLINK_MAX_PENDING)
+			_batchFailures += _send();
+		return true;
+	}
+	return (_send() == 0);
+}
+
+unsigned int LinuxNetLink::_send()
+{
+	// The kernel handles each request in order and acks every one, even after a failure
+	if (_pendingSeqs.empty())
+		return 0;
+	unsigned int failures = 0;
+	if (::send(_requestFd,_pending.data(),_pending.length(),0) != (long)_pending.length()) {
+		failures = (unsigned int)_pendingSeqs.size();
+	} else {
+		std::vector< std::pair<uint32_t,bool> >::const_iterator next(_pendingSeqs.begin());
+		uint64_t buf[ZT_LINUX_NETLINK_BUF_SIZE / 8];
+		while (next != _pendingSeqs.end()) {
+			const long n = (long)::recv(_requestFd,buf,sizeof(buf),0);
+			if (n <= 0) {
+				if ((n < 0)&&(errno == EINTR))
+					continue;
+				failures += (unsigned int)(_pendingSeqs.end() - next);
+				break;
+			}
+			int len = (int)n;
+			for(struct nlmsghdr *nh=(struct nlmsghdr *)buf;NLMSG_OK(nh,len);nh=NLMSG_NEXT(nh,len)) {
+				if ((nh->nlmsg_type != NLMSG_ERROR)||(next == _pendingSeqs.end())||(nh->nlmsg_seq != next->first))
+					continue;
+				const int err = -(reinterpret_cast<const struct nlmsgerr *>(NLMSG_DATA(nh))->error);
+				// Removing something that is already gone is not a failure
+				if ((err != 0)&&(!((next->second)&&((err == ESRCH)||(err == ENOENT)||(err == EADDRNOTAVAIL)||(err == ENODEV)))))
+					++failures;
+				++next;
+			}
+		}
+	}
+	_pending.clear();
+	_pendingSeqs.clear();
+	return failures;
+}
+
+void LinuxNetLink::_drain()
+{
+	uint64_t buf[ZT_LINUX_NETLINK_BUF_SIZE / 8];
+	for(;;) {
+		const long n = (long)::recv(_fd,buf,sizeof(buf),MSG_DONTWAIT);
+		if (n > 0) {
+			_processMessages(buf,(unsigned long)n,(std::map< unsigned int,std::vector<InetAddress> > *)0);
+		} else if (n < 0) {
+			if (errno == ENOBUFS) // notifications were dropped, so start over
+				_dump();
+			else if (errno != EINTR)
+				break;
+		} else break;
+	}
+}
+
+void LinuxNetLink::_dump()
+{
+	struct {
+		struct nlmsghdr nh;
+		struct ifaddrmsg ifa;
+	} req;
+	memset(&req,0,sizeof(req));
+	req.nh.nlmsg_len = sizeof(req);
+	req.nh.nlmsg_type = RTM_GETADDR;
+	req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.nh.nlmsg_seq = ++_seq;
+	req.ifa.ifa_family = AF_UNSPEC;
+	if (::send(_requestFd,&req,sizeof(req),0) != (long)sizeof(req))
+		return;
+
+	std::map< unsigned int,std::vector<InetAddress> > dump;
+	uint64_t buf[ZT_LINUX_NETLINK_BUF_SIZE / 8];
+	bool done = false;
+	while (!done) {
+		const long n = (long)::recv(_requestFd,buf,sizeof(buf),0);
+		if (n <= 0) {
+			if ((n < 0)&&(errno == EINTR))
+				continue;
+			return;
+		}
+		int len = (int)n;
+		for(struct nlmsghdr *nh=(struct nlmsghdr *)buf;NLMSG_OK(nh,len);nh=NLMSG_NEXT(nh,len)) {
+			if ((nh->nlmsg_seq == _seq)&&((nh->nlmsg_type == NLMSG_DONE)||(nh->nlmsg_type == NLMSG_ERROR)))
+				done = true;
+		}
+		_processMessages(buf,(unsigned long)n,&dump);
+	}
+
+	for(std::map< unsigned int,std::vector<InetAddress> >::iterator d(dump.begin());d!=dump.end();++d) {
+		std::sort(d->second.begin(),d->second.end());
+		d->second.erase(std::unique(d->second.begin(),d->second.end()),d->second.end());
+	}
+	for(std::map< unsigned int,_Interface >::iterator i(_interfaces.begin());i!=_interfaces.end();++i) {
+		std::map< unsigned int,std::vector<InetAddress> >::iterator d(dump.find(i->first));
+		if (d == dump.end()) {
+			if (!i->second.ips.empty()) {
+				i->second.ips.clear();
+				_changed(i->second);
+			}
+		} else {
+			if (i->second.ips != d->second) {
+				i->second.ips.swap(d->second);
+				_changed(i->second);
+			}
+			dump.erase(d);
+		}
+	}
+	for(std::map< unsigned int,std::vector<InetAddress> >::iterator d(dump.begin());d!=dump.end();++d) {
+		_Interface &i = _interfaces[d->first];
+		i.ips.swap(d->second);
+		_changed(i);
+	}
+}
+
+void LinuxNetLink::_processMessages(const void *buf,unsigned long len,std::map< unsigned int,std::vector<InetAddress> > *dump)
+{
+	int remaining = (int)len;
+	for(const struct nlmsghdr *nh=(const struct nlmsghdr *)buf;NLMSG_OK(nh,remaining);nh=NLMSG_NEXT(nh,remaining)) {
+		switch(nh->nlmsg_type) {
+			case RTM_NEWADDR:
+			case RTM_DELADDR: {
+				const struct ifaddrmsg *ifa = (const struct ifaddrmsg *)NLMSG_DATA(nh);
+				if ((ifa->ifa_family != AF_INET)&&(ifa->ifa_family != AF_INET6))
+					break;
+				const void *addr = (const void *)0;
+				const void *local = (const void *)0;
+				int rtl = (int)IFA_PAYLOAD(nh);
+				for(const struct rtattr *rta=IFA_RTA(ifa);RTA_OK(rta,rtl);rta=RTA_NEXT(rta,rtl)) {
+					if (rta->rta_type == IFA_ADDRESS)
+						addr = RTA_DATA(rta);
+					else if (rta->rta_type == IFA_LOCAL)
+						local = RTA_DATA(rta);
+				}
+				if (local) // on point to point links IFA_ADDRESS is the other end
+					addr = local;
+				if (!addr)
+					break;
+				const InetAddress ip(addr,(ifa->ifa_family == AF_INET) ? 4 : 16,ifa->ifa_prefixlen);
+
+				if (dump) {
+					if (nh->nlmsg_type == RTM_NEWADDR)
+						(*dump)[ifa->ifa_index].push_back(ip);
+					break;
+				}
+
+				_Interface &i = _interfaces[ifa->ifa_index];
+				std::vector<InetAddress>::iterator existing(std::lower_bound(i.ips.begin(),i.ips.end(),ip));
+				const bool have = ((existing != i.ips.end())&&(*existing == ip));
+				if ((nh->nlmsg_type == RTM_NEWADDR)&&(!have)) {
+					i.ips.insert(existing,ip);
+					_changed(i);
+				} else if ((nh->nlmsg_type == RTM_DELADDR)&&(have)) {
+					i.ips.erase(existing);
+					_changed(i);
+				}
+			}	break;
+
+			case RTM_DELLINK:
+				if (!dump)
+					_interfaces.erase((unsigned int)((const struct ifinfomsg *)NLMSG_DATA(nh))->ifi_index);
+				break;
+		}
+	}
+}
+
+void LinuxNetLink::_scanMulticast()
+{
+	// Lines are: ifindex name users global-users address
+	std::string buf;
+	int fd = ::open("/proc/net/dev_mcast",O_RDONLY);
+	if (fd < 0)
+		return;
+	char tmp[16384];
+	for(;;) {
+		const long n = (long)::read(fd,tmp,sizeof(tmp));
+		if (n <= 0)
+			break;
+		buf.append(tmp,(std::string::size_type)n);
+	}
+	::close(fd);
+
+	std::map< unsigned int,std::vector<MAC> > scanned;
+	char *saveptr = (char *)0;
+	unsigned char mac[6];
+	for(char *l=strtok_r(const_cast<char *>(buf.c_str()),"\r\n",&saveptr);(l);l=strtok_r((char *)0,"\r\n",&saveptr)) {
+		unsigned int ifindex = 0;
+		char mcastmac[32];
+		if ((sscanf(l,"%u %*s %*d %*d %31s",&ifindex,mcastmac) == 2)&&(Utils::unhex(mcastmac,mac,6) == 6))
+			scanned[ifindex].push_back(MAC(mac,6));
+	}
+
+	for(std::map< unsigned int,std::vector<MAC> >::iterator s(scanned.begin());s!=scanned.end();++s) {
+		std::sort(s->second.begin(),s->second.end());
+		s->second.erase(std::unique(s->second.begin(),s->second.end()),s->second.end());
+	}
+	for(std::map< unsigned int,_Interface >::iterator i(_interfaces.begin());i!=_interfaces.end();++i) {
+		std::map< unsigned int,std::vector<MAC> >::iterator s(scanned.find(i->first));
+		if (s == scanned.end()) {
+			if (!i->second.multicastMacs.empty()) {
+				i->second.multicastMacs.clear();
+				_changed(i->second);
+			}
+		} else {
+			if (i->second.multicastMacs != s->second) {
+				i->second.multicastMacs.swap(s->second);
+				_changed(i->second);
+			}
+			scanned.erase(s);
+		}
+	}
+	for(std::map< unsigned int,std::vector<MAC> >::iterator s(scanned.begin());s!=scanned.end();++s) {
+		_Interface &i = _interfaces[s->first];
+		i.multicastMacs.swap(s->second);
+		_changed(i);
+	}
+}
+
+void LinuxNetLink::_changed(_Interface &i)
+{
+	i.generation = ++_lastGeneration;
+}
+
+} // namespace ZeroTier
@@ -0,0 +1,168 @@
+/*
+ * ZeroTier One - Network Virtualization Everywhere
+ * Copyright (C) 2011-2016  ZeroTier, Inc.  https://www.zerotier.com/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ZT_LINUXNETLINK_HPP
+#define ZT_LINUXNETLINK_HPP
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+
+#include "../node/InetAddress.hpp"
+#include "../node/MAC.hpp"
+#include "../node/Mutex.hpp"
+#include "../node/NonCopyable.hpp"
+
+/**
+ * Minimum time between reads of /proc/net/dev_mcast
+ */
+#define ZT_LINUX_NETLINK_MULTICAST_SCAN_INTERVAL 1000
+
+namespace ZeroTier {
+
+/**
+ * Process-wide view of Linux interface addresses and multicast memberships
+ *
+ * Addresses are tracked from rtnetlink RTM_NEWADDR/RTM_DELADDR notifications.
+ * Pending notifications are applied whenever this is queried, so results
+ * include every change the kernel made before the call. If netlink can't be
+ * used, addresses are read with getifaddrs() on every query instead.
+ *
+ * The kernel sends no notification when link-layer multicast memberships
+ * change, so those are read from /proc/net/dev_mcast for all interfaces at
+ * once, at most every ZT_LINUX_NETLINK_MULTICAST_SCAN_INTERVAL ms.
+ *
+ * Addresses and routes are also changed through here. Between beginBatch()
+ * and flushBatch() changes are queued and then sent to the kernel together,
+ * which applies them in order. Batches are shared by all threads.
+ */
+class LinuxNetLink : NonCopyable
+{
+public:
+	/**
+	 * @return Shared instance, opened on first use
+	 */
+	static LinuxNetLink &instance();
+
+	/**
+	 * @param ifindex Interface index
+	 * @return Interface IPs with netmask bits in port, sorted
+	 */
+	std::vector<InetAddress> ips(unsigned int ifindex);
+
+	/**
+	 * @param ifindex Interface index
+	 * @return Link-layer multicast addresses joined on interface, sorted
+	 */
+	std::vector<MAC> multicastMacs(unsigned int ifindex);
+
+	/**
+	 * Get a value that changes whenever an interface's IPs or multicast memberships change
+	 *
+	 * This also rereads multicast memberships if they are due to be read.
+	 *
+	 * @param ifindex Interface index
+	 * @param now Current time
+	 * @return Generation, 0 if nothing is known about this interface
+	 */
+	uint64_t generation(unsigned int ifindex,uint64_t now);
+
+	/**
+	 * Add an address with netmask bits in port to an interface
+	 *
+	 * @return True on success or if queued in a batch
+	 */
+	bool addAddress(unsigned int ifindex,const InetAddress &ip);
+
+	/**
+	 * Remove an address from an interface
+	 *
+	 * @return True on success (including if it was already gone) or if queued in a batch
+	 */
+	bool removeAddress(unsigned int ifindex,const InetAddress &ip);
+
+	/**
+	 * Add or replace a route in the main table
+	 *
+	 * @param target Route target with netmask bits in port
+	 * @param via Gateway or NULL address to route straight to interface
+	 * @param ifindex Interface index, or 0 to let the kernel pick one for the gateway
+	 * @return True on success or if queued in a batch
+	 */
+	bool replaceRoute(const InetAddress &target,const InetAddress &via,unsigned int ifindex);
+
+	/**
+	 * Remove a route from the main table
+	 *
+	 * @return True on success (including if it was already gone) or if queued in a batch
+	 */
+	bool removeRoute(const InetAddress &target,const InetAddress &via,unsigned int ifindex);
+
+	/**
+	 * Begin queueing address and route changes (batches nest)
+	 */
+	void beginBatch();
+
+	/**
+	 * End a batch and send queued changes if it was the outermost one
+	 *
+	 * @return Number of queued changes the kernel refused
+	 */
+	unsigned int flushBatch();
+
+private:
+	LinuxNetLink();
+	~LinuxNetLink();
+
+	struct _Interface
+	{
+		_Interface() : generation(0) {}
+		std::vector<InetAddress> ips;
+		std::vector<MAC> multicastMacs;
+		uint64_t generation;
+	};
+
+	void _drain();
+	void _dump();
+	void _processMessages(const void *buf,unsigned long len,std::map< unsigned int,std::vector<InetAddress> > *dump);
+	void _scanMulticast();
+	void _changed(_Interface &i);
+	bool _submit(void *msg,bool removal);
+	unsigned int _send();
+
+	std::map< unsigned int,_Interface > _interfaces;
+	Mutex _lock;
+	int _fd; // subscribed to address and link notifications
+	int _requestFd; // dumps and requests, so replies don't mix with notifications
+	uint32_t _seq;
+	uint64_t _lastGeneration;
+	uint64_t _lastMulticastScan;
+
+	// Requests waiting to be sent, and for each its sequence number and whether it removes something
+	std::string _pending;
+	std::vector< std::pair<uint32_t,bool> > _pendingSeqs;
+	unsigned int _batch;
+	unsigned int _batchFailures;
+};
+
+} // namespace ZeroTier
+
+#endif
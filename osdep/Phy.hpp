@@ -59,18 +59,119 @@
 #ifndef IPV6_DONTFRAG
 #define IPV6_DONTFRAG 62
 #endif
+// Use epoll() instead of select() on Linux unless told otherwise
+#if !defined(ZT_PHY_USE_SELECT) && !defined(ZT_PHY_USE_EPOLL)
+#define ZT_PHY_USE_EPOLL 1
+#endif
+// Use recvmmsg() and sendmmsg() to move many UDP datagrams per system call
+#ifndef ZT_PHY_NO_MMSG
+#define ZT_PHY_HAVE_MMSG 1
+#endif
+// Use UDP_SEGMENT (GSO) and UDP_GRO to move trains of equal sized datagrams as one skb
+#if defined(ZT_PHY_HAVE_MMSG) && !defined(ZT_PHY_NO_UDP_GSO)
+#include <netinet/udp.h>
+#if defined(UDP_SEGMENT) && defined(UDP_GRO)
+#define ZT_PHY_HAVE_UDP_GSO 1
+#endif
+#endif
+#endif
+
+#ifdef ZT_PHY_USE_EPOLL
+#include <stdint.h>
+#include <sys/epoll.h>
+#endif
+
+// io_uring can be turned on at runtime for UDP sockets with enableIoUring()
+#if defined(ZT_PHY_USE_EPOLL) && defined(ZT_PHY_HAVE_MMSG) && !defined(ZT_PHY_NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#if defined(IORING_RECV_MULTISHOT) && defined(__NR_io_uring_setup)
+#define ZT_PHY_HAVE_IO_URING 1
+#include <pthread.h>
+#include <sys/mman.h>
+#endif
+#endif
 #endif
 
 #define ZT_PHY_SOCKFD_TYPE int
 #define ZT_PHY_SOCKFD_NULL (-1)
 #define ZT_PHY_SOCKFD_VALID(s) ((s) > -1)
 #define ZT_PHY_CLOSE_SOCKET(s) ::close(s)
+#ifdef ZT_PHY_USE_EPOLL
+// epoll has no FD_SETSIZE limit, so the practical limit is ulimit -n
+#define ZT_PHY_MAX_SOCKETS 1048576
+// Maximum number of events returned by one epoll_wait() in poll()
+#define ZT_PHY_EPOLL_MAX_EVENTS 256
+#else
 #define ZT_PHY_MAX_SOCKETS (FD_SETSIZE)
+#endif
+#ifdef ZT_PHY_HAVE_MMSG
+#include <sys/uio.h>
+#endif
 #define ZT_PHY_MAX_INTERCEPTS ZT_PHY_MAX_SOCKETS
 #define ZT_PHY_SOCKADDR_STORAGE_TYPE struct sockaddr_storage
 
 #endif // Windows or not
 
+/**
+ * Maximum number of UDP datagrams read or written per batch
+ */
+#define ZT_PHY_UDP_BATCH_SIZE 32
+
+/**
+ * Maximum number of UDP batches read from one socket each time poll() finds it readable
+ *
+ * This keeps a flood on one socket from starving other sockets and the
+ * caller's own work between calls to poll().
+ */
+#define ZT_PHY_UDP_MAX_BATCHES_PER_POLL 8
+
+/**
+ * Size of each receive buffer in a UDP batch (larger datagrams are dropped)
+ */
+#define ZT_PHY_UDP_BATCH_BUFFER_SIZE 16384
+
+/**
+ * Size of each receive buffer in a UDP batch for sockets with UDP GRO enabled
+ */
+#define ZT_PHY_UDP_GRO_BUFFER_SIZE 65536
+
+/**
+ * Maximum number of datagrams sent as one UDP GSO super-packet (kernel limit is 64)
+ */
+#define ZT_PHY_UDP_GSO_MAX_SEGMENTS 64
+
+/**
+ * Maximum total payload of one UDP GSO super-packet
+ */
+#define ZT_PHY_UDP_GSO_MAX_BYTES 65000
+
+/**
+ * Number of submission queue entries in each io_uring (the completion queue is twice this)
+ */
+#define ZT_PHY_IO_URING_ENTRIES 256
+
+/**
+ * Number of buffers in the io_uring provided receive buffer ring (must be a power of two)
+ */
+#define ZT_PHY_IO_URING_RECV_BUFFERS 512
+
+/**
+ * Size of each io_uring receive buffer including recvmsg header and source address (larger datagrams are dropped)
+ */
+#define ZT_PHY_IO_URING_RECV_BUFFER_SIZE 4096
+
+/**
+ * Number of outstanding asynchronous sends per io_uring enabled Phy<>
+ */
+#define ZT_PHY_IO_URING_SEND_SLOTS 256
+
+/**
+ * Maximum size of a datagram sent asynchronously via io_uring (larger ones are sent directly)
+ */
+#define ZT_PHY_IO_URING_SEND_BUFFER_SIZE 2048
+
 namespace ZeroTier {
 
 /**
@@ -78,6 +179,187 @@ namespace ZeroTier {
  */
 typedef void PhySocket;
 
+/**
+ * One UDP datagram in a batch passed to or from Phy<>
+ */
+struct PhyDatagram
+{
+	const struct sockaddr *addr; // source address on receive, destination on send
+	void *data;
+	unsigned long len;
+};
+
+#ifdef ZT_PHY_HAVE_IO_URING
+/**
+ * Minimal io_uring submission and completion queue pair used by Phy<>
+ *
+ * This talks to the kernel directly rather than via liburing to avoid a
+ * build dependency. Only one thread at a time may use an instance.
+ */
+class PhyIoUring
+{
+public:
+	PhyIoUring() :
+		fd(-1),
+		_ring(MAP_FAILED),
+		_sqes((struct io_uring_sqe *)MAP_FAILED) {}
+
+	~PhyIoUring() { destroy(); }
+
+	/**
+	 * @param entries Number of submission queue entries
+	 * @return True if io_uring is available and was set up
+	 */
+	inline bool init(unsigned int entries)
+	{
+		struct io_uring_params p;
+		memset(&p,0,sizeof(p));
+		fd = (int)::syscall(__NR_io_uring_setup,entries,&p);
+		if (fd < 0)
+			return false;
+		if ((p.features & IORING_FEAT_SINGLE_MMAP) == 0) { // kernel too old for anything else we need anyway
+			destroy();
+			return false;
+		}
+
+		_ringSize = p.sq_off.array + (p.sq_entries * sizeof(unsigned int));
+		if ((p.cq_off.cqes + (p.cq_entries * sizeof(struct io_uring_cqe))) > _ringSize)
+			_ringSize = p.cq_off.cqes + (p.cq_entries * sizeof(struct io_uring_cqe));
+		_ring = ::mmap((void *)0,_ringSize,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_SQ_RING);
+		if (_ring == MAP_FAILED) {
+			destroy();
+			return false;
+		}
+		_sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+		_sqes = (struct io_uring_sqe *)::mmap((void *)0,_sqesSize,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_SQES);
+		if ((void *)_sqes == MAP_FAILED) {
+			destroy();
+			return false;
+		}
+
+		char *const r = reinterpret_cast<char *>(_ring);
+		_sqHead = reinterpret_cast<unsigned int *>(r + p.sq_off.head);
+		_sqTail = reinterpret_cast<unsigned int *>(r + p.sq_off.tail);
+		_sqFlags = reinterpret_cast<unsigned int *>(r + p.sq_off.flags);
+		_sqArray = reinterpret_cast<unsigned int *>(r + p.sq_off.array);
+		_sqMask = *reinterpret_cast<unsigned int *>(r + p.sq_off.ring_mask);
+		_sqEntries = p.sq_entries;
+		_cqHead = reinterpret_cast<unsigned int *>(r + p.cq_off.head);
+		_cqTail = reinterpret_cast<unsigned int *>(r + p.cq_off.tail);
+		_cqMask = *reinterpret_cast<unsigned int *>(r + p.cq_off.ring_mask);
+		_cqes = reinterpret_cast<struct io_uring_cqe *>(r + p.cq_off.cqes);
+		_sqeTail = *_sqTail;
+
+		return true;
+	}
+
+	inline void destroy()
+	{
+		if ((void *)_sqes != MAP_FAILED)
+			::munmap((void *)_sqes,_sqesSize);
+		_sqes = (struct io_uring_sqe *)MAP_FAILED;
+		if (_ring != MAP_FAILED)
+			::munmap(_ring,_ringSize);
+		_ring = MAP_FAILED;
+		if (fd >= 0)
+			::close(fd);
+		fd = -1;
+	}
+
+	/**
+	 * @return Zeroed submission queue entry or NULL if the queue is full
+	 */
+	inline struct io_uring_sqe *getSqe()
+	{
+		if ((_sqeTail - __atomic_load_n(_sqHead,__ATOMIC_ACQUIRE)) >= _sqEntries)
+			return (struct io_uring_sqe *)0;
+		const unsigned int idx = _sqeTail++ & _sqMask;
+		_sqArray[idx] = idx;
+		memset(&(_sqes[idx]),0,sizeof(struct io_uring_sqe));
+		return &(_sqes[idx]);
+	}
+
+	/**
+	 * @return Number of entries obtained with getSqe() but not yet submitted
+	 */
+	inline unsigned int unsubmitted() const { return (_sqeTail - *_sqTail); }
+
+	/**
+	 * Submit queued entries and optionally wait for completions
+	 *
+	 * @param waitFor Minimum number of completions to wait for
+	 * @return Result of io_uring_enter() or 0 if there was nothing to do
+	 */
+	inline int submit(unsigned int waitFor = 0)
+	{
+		const unsigned int n = _sqeTail - *_sqTail;
+		__atomic_store_n(_sqTail,_sqeTail,__ATOMIC_RELEASE);
+		if ((!n)&&(!waitFor)&&((__atomic_load_n(_sqFlags,__ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW) == 0))
+			return 0;
+		for(;;) {
+			const int r = (int)::syscall(__NR_io_uring_enter,fd,n,waitFor,((waitFor)||(!n)) ? IORING_ENTER_GETEVENTS : 0,(void *)0,0);
+			if ((r < 0)&&(errno == EINTR))
+				continue;
+			return r;
+		}
+	}
+
+	/**
+	 * @return Next completion or NULL if none (call seen() when done with it)
+	 */
+	inline struct io_uring_cqe *peek() const
+	{
+		const unsigned int head = *_cqHead;
+		if (head == __atomic_load_n(_cqTail,__ATOMIC_ACQUIRE))
+			return (struct io_uring_cqe *)0;
+		return &(_cqes[head & _cqMask]);
+	}
+	inline void seen() { __atomic_store_n(_cqHead,*_cqHead + 1,__ATOMIC_RELEASE); }
+
+	/**
+	 * @return True if completions were held back because the completion queue filled up
+	 */
+	inline bool overflowed() const { return ((__atomic_load_n(_sqFlags,__ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW) != 0); }
+
+	/**
+	 * Register a provided buffer ring (kernel 5.19+)
+	 *
+	 * @param br Page aligned buffer ring
+	 * @param entries Number of entries (power of two)
+	 * @param bgid Buffer group ID
+	 * @return True on success
+	 */
+	inline bool registerBufferRing(struct io_uring_buf_ring *br,unsigned int entries,unsigned int bgid)
+	{
+		struct io_uring_buf_reg reg;
+		memset(&reg,0,sizeof(reg));
+		reg.ring_addr = (uint64_t)((uintptr_t)br);
+		reg.ring_entries = entries;
+		reg.bgid = (uint16_t)bgid;
+		return (::syscall(__NR_io_uring_register,fd,IORING_REGISTER_PBUF_RING,&reg,1) == 0);
+	}
+
+	int fd;
+
+private:
+	void *_ring;
+	size_t _ringSize;
+	struct io_uring_sqe *_sqes;
+	size_t _sqesSize;
+	unsigned int *_sqHead;
+	unsigned int *_sqTail;
+	unsigned int *_sqFlags;
+	unsigned int *_sqArray;
+	unsigned int _sqMask;
+	unsigned int _sqEntries;
+	unsigned int _sqeTail;
+	unsigned int *_cqHead;
+	unsigned int *_cqTail;
+	unsigned int _cqMask;
+	struct io_uring_cqe *_cqes;
+};
+#endif
+
 /**
  * Simple templated non-blocking sockets implementation
  *
@@ -90,6 +372,7 @@ typedef void PhySocket;
  * For all platforms:
  *
  * phyOnDatagram(PhySocket *sock,void **uptr,const struct sockaddr *localAddr,const struct sockaddr *from,void *data,unsigned long len)
+ * phyOnDatagramBatch(PhySocket *sock,void **uptr,const struct sockaddr *localAddr,const PhyDatagram *datagrams,unsigned int count)
  * phyOnTcpConnect(PhySocket *sock,void **uptr,bool success)
  * phyOnTcpAccept(PhySocket *sockL,PhySocket *sockN,void **uptrL,void **uptrN,const struct sockaddr *from)
  * phyOnTcpClose(PhySocket *sock,void **uptr)
@@ -108,6 +391,19 @@ typedef void PhySocket;
  * avoid the call overhead of indirection, which is surprisingly high for high
  * bandwidth applications pushing a lot of packets.
  *
+ * phyOnDatagramBatch() is called instead of phyOnDatagram() when more than
+ * one datagram was read from a socket at once, which currently happens only
+ * on Linux where recvmmsg() is used. The datagrams and their addresses are
+ * only valid for the duration of the call.
+ *
+ * Where the kernel supports it, Linux UDP sockets also use UDP_GRO to take
+ * runs of coalesced datagrams from the same sender in one read, and these
+ * are split back into their original datagrams in place before being
+ * passed to the handler. On send udpSendBatch() merges runs of datagrams
+ * to the same destination (e.g. a packet and its fragments) into single
+ * UDP_SEGMENT sends. Since the kernel refuses GSO on sockets with checksums
+ * disabled, noCheck is ignored for sockets on which GSO is available.
+ *
  * The 'sock' pointer above is an opaque pointer to a socket. Each socket
  * has a 'uptr' user-settable/modifiable pointer associated with it, which
  * can be set on bind/connect calls and is passed as a void ** to permit
@@ -122,6 +418,15 @@ typedef void PhySocket;
  * handler, and in that case close() can be told not to call handlers to
  * prevent recursion.
  *
+ * On Linux the event loop uses epoll() by default. All sockets are watched
+ * level-triggered, and each time a UDP socket is found readable up to
+ * ZT_PHY_UDP_MAX_BATCHES_PER_POLL batches are read from it. Anything left
+ * is picked up by the next poll(), so a busy socket can't starve the others
+ * or keep poll() from returning. Define
+ * ZT_PHY_USE_SELECT at build time to fall back to select(), which is what
+ * is used on all other platforms. UDP sockets can optionally be serviced by
+ * io_uring instead; see enableIoUring().
+ *
  * This isn't thread-safe with the exception of whack(), which is safe to
  * call from another thread to abort poll().
  */
@@ -150,15 +455,63 @@ private:
 		ZT_PHY_SOCKFD_TYPE sock;
 		void *uptr; // user-settable pointer
 		ZT_PHY_SOCKADDR_STORAGE_TYPE saddr; // remote for TCP_OUT and TCP_IN, local for TCP_LISTEN, RAW, and UDP
+#ifdef ZT_PHY_USE_EPOLL
+		uint32_t events; // epoll interest set, 0 if not currently registered
+#endif
+#ifdef ZT_PHY_HAVE_UDP_GSO
+		bool gsoCapable; // kernel supports UDP_SEGMENT on this socket
+		bool gso; // merge datagram trains into UDP_SEGMENT sends
+		bool gro; // UDP_GRO is enabled, so reads may return coalesced datagrams
+#endif
+#ifdef ZT_PHY_HAVE_IO_URING
+		unsigned int uring; // ZT_PHY_URING_* state, ZT_PHY_URING_OFF if this socket uses epoll
+#endif
+	};
+
+#ifdef ZT_PHY_HAVE_IO_URING
+#define ZT_PHY_URING_OFF 0
+#define ZT_PHY_URING_ARMED 1 // multishot recvmsg is pending, so this can't be freed yet even if closed
+#define ZT_PHY_URING_REARM 2 // multishot recvmsg ended (e.g. out of buffers) and must be submitted again
+
+	struct _IoUringSendSlot
+	{
+		struct msghdr msg;
+		struct iovec iov;
+		struct sockaddr_storage addr;
+		char data[ZT_PHY_IO_URING_SEND_BUFFER_SIZE];
 	};
 
+	struct _IoUring
+	{
+		PhyIoUring recv; // multishot receives, used only by the thread calling poll()
+		PhyIoUring send; // asynchronous sends, used by any thread holding sendLock
+		struct io_uring_buf_ring *bufRing;
+		char *bufs;
+		unsigned int bufTail;
+		struct msghdr recvMsg; // template for multishot recvmsg, tells the kernel how much room to leave for the address
+		bool rearm;
+		bool noMultishot; // kernel supports io_uring but not multishot recvmsg (pre-6.0)
+		pthread_mutex_t sendLock;
+		pthread_t pollThread;
+		volatile bool inPoll;
+		unsigned int sendFreeCount;
+		unsigned int sendFree[ZT_PHY_IO_URING_SEND_SLOTS];
+		_IoUringSendSlot sendSlots[ZT_PHY_IO_URING_SEND_SLOTS];
+	};
+#endif
+
 	std::list<PhySocketImpl> _socks;
+#ifdef ZT_PHY_USE_EPOLL
+	int _epfd;
+	bool _haveClosed; // true if there are CLOSED entries in _socks to be erased
+#else
 	fd_set _readfds;
 	fd_set _writefds;
 #if defined(_WIN32) || defined(_WIN64)
 	fd_set _exceptfds;
 #endif
 	long _nfds;
+#endif
 
 	ZT_PHY_SOCKFD_TYPE _whackReceiveSocket;
 	ZT_PHY_SOCKFD_TYPE _whackSendSocket;
@@ -166,6 +519,560 @@ private:
 	bool _noDelay;
 	bool _noCheck;
 
+#ifdef ZT_PHY_HAVE_MMSG
+	char *_udpBatchBuf; // ZT_PHY_UDP_BATCH_SIZE buffers of _udpBatchBufSlotSize for recvmmsg(), allocated on first UDP read
+	unsigned long _udpBatchBufSlotSize;
+#endif
+
+#ifdef ZT_PHY_HAVE_IO_URING
+	_IoUring *_uring; // NULL unless enableIoUring() succeeded
+#endif
+
+	/*
+	 * Set whether we want readable and/or writable events for a socket. With
+	 * epoll this adds, modifies, or removes the socket's registration as
+	 * needed. The socket's type and descriptor must be set first. Returns
+	 * false if the backend refused the socket.
+	 */
+	inline bool _watch(PhySocketImpl &sws,bool readable,bool writable)
+	{
+#ifdef ZT_PHY_HAVE_IO_URING
+		if (sws.uring != ZT_PHY_URING_OFF)
+			return true; // reads are done by a multishot recvmsg on the io_uring instead
+#endif
+#ifdef ZT_PHY_USE_EPOLL
+		uint32_t events = 0;
+		if (readable)
+			events |= EPOLLIN;
+		if (writable)
+			events |= EPOLLOUT;
+		if (events == sws.events)
+			return true;
+		struct epoll_event ev;
+		memset(&ev,0,sizeof(ev));
+		ev.events = events;
+		ev.data.ptr = (void *)&sws;
+		if (::epoll_ctl(_epfd,(sws.events) ? ((events) ? EPOLL_CTL_MOD : EPOLL_CTL_DEL) : EPOLL_CTL_ADD,sws.sock,&ev) != 0)
+			return false;
+		sws.events = events;
+#else
+		if ((long)sws.sock > _nfds)
+			_nfds = (long)sws.sock;
+		if (readable)
+			FD_SET(sws.sock,&_readfds);
+		else FD_CLR(sws.sock,&_readfds);
+		if (writable)
+			FD_SET(sws.sock,&_writefds);
+		else FD_CLR(sws.sock,&_writefds);
+#endif
+		return true;
+	}
+
+	inline bool _watchingRead(const PhySocketImpl &sws) const
+	{
+#ifdef ZT_PHY_USE_EPOLL
+		return ((sws.events & EPOLLIN) != 0);
+#else
+		return (FD_ISSET(sws.sock,&_readfds) != 0);
+#endif
+	}
+
+	inline bool _watchingWrite(const PhySocketImpl &sws) const
+	{
+#ifdef ZT_PHY_USE_EPOLL
+		return ((sws.events & EPOLLOUT) != 0);
+#else
+		return (FD_ISSET(sws.sock,&_writefds) != 0);
+#endif
+	}
+
+#ifdef ZT_PHY_HAVE_UDP_GSO
+	static inline bool _sameAddress(const struct sockaddr *a,const struct sockaddr *b)
+	{
+		if (a->sa_family != b->sa_family)
+			return false;
+		return (memcmp(a,b,(a->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in)) == 0);
+	}
+#endif
+
+#ifdef ZT_PHY_HAVE_MMSG
+	inline void _dispatchDatagrams(PhySocketImpl *s,const PhyDatagram *datagrams,unsigned int count)
+	{
+		try {
+			if (count == 1)
+				_handler->phyOnDatagram((PhySocket *)&(*s),&(s->uptr),(const struct sockaddr *)&(s->saddr),datagrams[0].addr,datagrams[0].data,datagrams[0].len);
+			else if (count > 1)
+				_handler->phyOnDatagramBatch((PhySocket *)&(*s),&(s->uptr),(const struct sockaddr *)&(s->saddr),datagrams,count);
+		} catch ( ... ) {}
+	}
+#endif
+
+#ifdef ZT_PHY_HAVE_IO_URING
+	/*
+	 * Submit (or queue for resubmission) a multishot recvmsg for a UDP
+	 * socket. Entries are submitted on the next call to submit().
+	 */
+	inline void _uringArm(PhySocketImpl &sws)
+	{
+		struct io_uring_sqe *sqe = _uring->recv.getSqe();
+		if (!sqe) {
+			_uring->recv.submit();
+			sqe = _uring->recv.getSqe();
+		}
+		if (!sqe) {
+			sws.uring = ZT_PHY_URING_REARM;
+			_uring->rearm = true;
+			return;
+		}
+		sqe->opcode = IORING_OP_RECVMSG;
+		sqe->fd = sws.sock;
+		sqe->addr = (uint64_t)((uintptr_t)&(_uring->recvMsg));
+		sqe->len = 1;
+		sqe->flags = IOSQE_BUFFER_SELECT;
+		sqe->buf_group = 0;
+		sqe->ioprio = IORING_RECV_MULTISHOT;
+		sqe->user_data = (uint64_t)((uintptr_t)&sws);
+		sws.uring = ZT_PHY_URING_ARMED;
+	}
+
+	inline void _uringReturnBuffer(unsigned int bid)
+	{
+		// Not bufRing->bufs[], since in C++ some kernel headers' flexible array declaration puts it at the wrong offset
+		struct io_uring_buf &b = reinterpret_cast<struct io_uring_buf *>(_uring->bufRing)[_uring->bufTail++ & (ZT_PHY_IO_URING_RECV_BUFFERS - 1)];
+		b.addr = (uint64_t)((uintptr_t)(_uring->bufs + ((unsigned long)bid * ZT_PHY_IO_URING_RECV_BUFFER_SIZE)));
+		b.len = ZT_PHY_IO_URING_RECV_BUFFER_SIZE;
+		b.bid = (uint16_t)bid;
+	}
+
+	/*
+	 * Handle all available receive completions, dispatching datagrams to
+	 * handlers in batches by socket and returning buffers afterwards.
+	 */
+	inline void _uringProcess()
+	{
+		PhyDatagram datagrams[ZT_PHY_UDP_BATCH_SIZE];
+		struct sockaddr_storage from[ZT_PHY_UDP_BATCH_SIZE];
+		unsigned int bids[ZT_PHY_UDP_BATCH_SIZE];
+		PhySocketImpl *batchSock = (PhySocketImpl *)0;
+		unsigned int count = 0;
+
+		for(;;) {
+			struct io_uring_cqe *cqe = _uring->recv.peek();
+			if (!cqe) {
+				if (_uring->recv.overflowed()) {
+					_uring->recv.submit(); // flushes held back completions into the queue
+					cqe = _uring->recv.peek();
+				}
+				if (!cqe)
+					break;
+			}
+			PhySocketImpl *const s = reinterpret_cast<PhySocketImpl *>((uintptr_t)cqe->user_data);
+			const int res = cqe->res;
+			const unsigned int flags = cqe->flags;
+			_uring->recv.seen();
+			if (!s)
+				continue; // cancellation
+
+			if ((s != batchSock)||(count == ZT_PHY_UDP_BATCH_SIZE)) {
+				if ((batchSock)&&(batchSock->type == ZT_PHY_SOCKET_UDP))
+					_dispatchDatagrams(batchSock,datagrams,count);
+				for(unsigned int i=0;i<count;++i)
+					_uringReturnBuffer(bids[i]);
+				count = 0;
+				batchSock = s;
+			}
+
+			if ((flags & IORING_CQE_F_BUFFER) != 0) {
+				const unsigned int bid = flags >> IORING_CQE_BUFFER_SHIFT;
+				char *const buf = _uring->bufs + ((unsigned long)bid * ZT_PHY_IO_URING_RECV_BUFFER_SIZE);
+				const struct io_uring_recvmsg_out *const out = reinterpret_cast<const struct io_uring_recvmsg_out *>(buf);
+				if ((res >= (int)(sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_storage)))&&((out->flags & MSG_TRUNC) == 0)&&(out->payloadlen > 0)&&(s->type == ZT_PHY_SOCKET_UDP)) {
+					// Addresses are compared as whole sockaddr_storage structures elsewhere, so copy and zero-pad
+					const unsigned int namelen = (out->namelen < sizeof(struct sockaddr_storage)) ? out->namelen : (unsigned int)sizeof(struct sockaddr_storage);
+					memcpy(&(from[count]),buf + sizeof(struct io_uring_recvmsg_out),namelen);
+					memset(reinterpret_cast<char *>(&(from[count])) + namelen,0,sizeof(struct sockaddr_storage) - namelen);
+					datagrams[count].addr = (const struct sockaddr *)&(from[count]);
+					datagrams[count].data = buf + sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_storage);
+					datagrams[count].len = out->payloadlen;
+					bids[count++] = bid;
+				} else {
+					_uringReturnBuffer(bid);
+				}
+			}
+
+			if ((flags & IORING_CQE_F_MORE) == 0) {
+				if (s->type == ZT_PHY_SOCKET_CLOSED) {
+					s->uring = ZT_PHY_URING_OFF;
+					_haveClosed = true; // can be erased now
+				} else if ((res >= 0)||(res == -ENOBUFS)) {
+					s->uring = ZT_PHY_URING_REARM;
+					_uring->rearm = true;
+				} else {
+					// Multishot recvmsg isn't supported or the socket is in a bad state, so let epoll handle it
+					if ((res == -EINVAL)||(res == -EOPNOTSUPP))
+						_uring->noMultishot = true;
+					s->uring = ZT_PHY_URING_OFF;
+					_watch(*s,true,false);
+				}
+			}
+		}
+
+		if ((batchSock)&&(batchSock->type == ZT_PHY_SOCKET_UDP))
+			_dispatchDatagrams(batchSock,datagrams,count);
+		for(unsigned int i=0;i<count;++i)
+			_uringReturnBuffer(bids[i]);
+		__atomic_store_n(&(_uring->bufRing->tail),(uint16_t)_uring->bufTail,__ATOMIC_RELEASE);
+
+		if (_uring->rearm) {
+			_uring->rearm = false;
+			for(typename std::list<PhySocketImpl>::iterator s(_socks.begin());s!=_socks.end();++s) {
+				if ((s->type == ZT_PHY_SOCKET_UDP)&&(s->uring == ZT_PHY_URING_REARM))
+					_uringArm(*s);
+			}
+		}
+		_uring->recv.submit();
+	}
+
+	// sendLock must be held
+	inline void _uringReapSends()
+	{
+		struct io_uring_cqe *cqe;
+		while ((cqe = _uring->send.peek())) {
+			_uring->sendFree[_uring->sendFreeCount++] = (unsigned int)cqe->user_data;
+			_uring->send.seen();
+		}
+	}
+
+	/*
+	 * Queue a datagram to be sent asynchronously. Returns false if it can't
+	 * be queued (too big or no free slots), in which case the caller should
+	 * just send it directly.
+	 */
+	inline bool _uringSend(PhySocketImpl &sws,const struct sockaddr *remoteAddress,const void *data,unsigned long len)
+	{
+		if (len > ZT_PHY_IO_URING_SEND_BUFFER_SIZE)
+			return false;
+		pthread_mutex_lock(&(_uring->sendLock));
+		_uringReapSends();
+		struct io_uring_sqe *sqe = (_uring->sendFreeCount) ? _uring->send.getSqe() : (struct io_uring_sqe *)0;
+		if (!sqe) {
+			_uring->send.submit();
+			_uringReapSends();
+			sqe = (_uring->sendFreeCount) ? _uring->send.getSqe() : (struct io_uring_sqe *)0;
+			if (!sqe) {
+				pthread_mutex_unlock(&(_uring->sendLock));
+				return false;
+			}
+		}
+
+		const unsigned int slotNo = _uring->sendFree[--_uring->sendFreeCount];
+		_IoUringSendSlot &slot = _uring->sendSlots[slotNo];
+		const socklen_t alen = (remoteAddress->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+		memcpy(&(slot.addr),remoteAddress,alen);
+		memcpy(slot.data,data,len);
+		memset(&(slot.msg),0,sizeof(slot.msg));
+		slot.iov.iov_base = slot.data;
+		slot.iov.iov_len = len;
+		slot.msg.msg_name = (void *)&(slot.addr);
+		slot.msg.msg_namelen = alen;
+		slot.msg.msg_iov = &(slot.iov);
+		slot.msg.msg_iovlen = 1;
+
+		sqe->opcode = IORING_OP_SENDMSG;
+		sqe->fd = sws.sock;
+		sqe->addr = (uint64_t)((uintptr_t)&(slot.msg));
+		sqe->len = 1;
+		sqe->user_data = (uint64_t)slotNo;
+
+		// Sends made by handlers during poll() are submitted together when it's done
+		if ((!_uring->inPoll)||(!pthread_equal(_uring->pollThread,pthread_self())))
+			_uring->send.submit();
+
+		pthread_mutex_unlock(&(_uring->sendLock));
+		return true;
+	}
+
+	/*
+	 * Cancel a socket's pending multishot recvmsg. Closing the descriptor
+	 * does not end it, so the socket stays ARMED until its final completion.
+	 */
+	inline void _uringCancel(PhySocketImpl &sws)
+	{
+		struct io_uring_sqe *sqe = _uring->recv.getSqe();
+		if (!sqe) {
+			_uring->recv.submit();
+			sqe = _uring->recv.getSqe();
+			if (!sqe)
+				return;
+		}
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->addr = (uint64_t)((uintptr_t)&sws);
+		sqe->user_data = 0; // NULL identifies cancellations in _uringProcess()
+		_uring->recv.submit();
+	}
+
+	inline void _uringSubmitSends()
+	{
+		pthread_mutex_lock(&(_uring->sendLock));
+		if (_uring->send.unsubmitted())
+			_uring->send.submit();
+		pthread_mutex_unlock(&(_uring->sendLock));
+	}
+#endif
+
+	/*
+	 * Handle readiness on one socket; called by poll() for whichever event
+	 * backend is in use. Handlers may close the socket, which marks it
+	 * CLOSED but leaves it in _socks until poll() erases it.
+	 */
+	inline void _process(PhySocketImpl *s,bool readable,bool writable,char *buf,unsigned long bufSize)
+	{
+		struct sockaddr_storage ss;
+
+		switch (s->type) {
+
+			case ZT_PHY_SOCKET_TCP_OUT_PENDING:
+				if (writable) {
+					socklen_t slen = sizeof(ss);
+					if (::getpeername(s->sock,(struct sockaddr *)&ss,&slen) != 0) {
+						this->close((PhySocket *)&(*s),true);
+					} else {
+						s->type = ZT_PHY_SOCKET_TCP_OUT_CONNECTED;
+						_watch(*s,true,false);
+#if defined(_WIN32) || defined(_WIN64)
+						FD_CLR(s->sock,&_exceptfds);
+#endif
+						try {
+							_handler->phyOnTcpConnect((PhySocket *)&(*s),&(s->uptr),true);
+						} catch ( ... ) {}
+					}
+				}
+				break;
+
+			case ZT_PHY_SOCKET_TCP_OUT_CONNECTED:
+			case ZT_PHY_SOCKET_TCP_IN: {
+				if (readable) {
+					long n = (long)::recv(s->sock,buf,bufSize,0);
+					if (n <= 0) {
+						this->close((PhySocket *)&(*s),true);
+					} else {
+						try {
+							_handler->phyOnTcpData((PhySocket *)&(*s),&(s->uptr),(void *)buf,(unsigned long)n);
+						} catch ( ... ) {}
+					}
+				}
+				if ((writable)&&(_watchingWrite(*s))) {
+					try {
+						_handler->phyOnTcpWritable((PhySocket *)&(*s),&(s->uptr));
+					} catch ( ... ) {}
+				}
+			}	break;
+
+			case ZT_PHY_SOCKET_TCP_LISTEN:
+				if (readable) {
+					memset(&ss,0,sizeof(ss));
+					socklen_t slen = sizeof(ss);
+					ZT_PHY_SOCKFD_TYPE newSock = ::accept(s->sock,(struct sockaddr *)&ss,&slen);
+					if (ZT_PHY_SOCKFD_VALID(newSock)) {
+						if (_socks.size() >= ZT_PHY_MAX_SOCKETS) {
+							ZT_PHY_CLOSE_SOCKET(newSock);
+						} else {
+#if defined(_WIN32) || defined(_WIN64)
+							{ BOOL f = (_noDelay ? TRUE : FALSE); setsockopt(newSock,IPPROTO_TCP,TCP_NODELAY,(char *)&f,sizeof(f)); }
+							{ u_long iMode=1; ioctlsocket(newSock,FIONBIO,&iMode); }
+#else
+							{ int f = (_noDelay ? 1 : 0); setsockopt(newSock,IPPROTO_TCP,TCP_NODELAY,(char *)&f,sizeof(f)); }
+							fcntl(newSock,F_SETFL,O_NONBLOCK);
+#endif
+							_socks.push_back(PhySocketImpl());
+							PhySocketImpl &sws = _socks.back();
+							sws.type = ZT_PHY_SOCKET_TCP_IN;
+							sws.sock = newSock;
+							if (!_watch(sws,true,false)) {
+								_socks.pop_back();
+								ZT_PHY_CLOSE_SOCKET(newSock);
+								break;
+							}
+							sws.uptr = (void *)0;
+							memcpy(&(sws.saddr),&ss,sizeof(struct sockaddr_storage));
+							try {
+								_handler->phyOnTcpAccept((PhySocket *)&(*s),(PhySocket *)&(_socks.back()),&(s->uptr),&(sws.uptr),(const struct sockaddr *)&(sws.saddr));
+							} catch ( ... ) {}
+						}
+					}
+				}
+				break;
+
+			case ZT_PHY_SOCKET_UDP:
+				if (readable) {
+#ifdef ZT_PHY_HAVE_MMSG
+#ifdef ZT_PHY_HAVE_UDP_GSO
+					const unsigned long slotSize = (s->gro) ? ZT_PHY_UDP_GRO_BUFFER_SIZE : ZT_PHY_UDP_BATCH_BUFFER_SIZE;
+					char control[ZT_PHY_UDP_BATCH_SIZE][CMSG_SPACE(sizeof(int))];
+#else
+					const unsigned long slotSize = ZT_PHY_UDP_BATCH_BUFFER_SIZE;
+#endif
+					if (_udpBatchBufSlotSize < slotSize) {
+						delete [] _udpBatchBuf;
+						_udpBatchBuf = new char[ZT_PHY_UDP_BATCH_SIZE * slotSize];
+						_udpBatchBufSlotSize = slotSize;
+					}
+					struct mmsghdr msgs[ZT_PHY_UDP_BATCH_SIZE];
+					struct iovec iov[ZT_PHY_UDP_BATCH_SIZE];
+					struct sockaddr_storage from[ZT_PHY_UDP_BATCH_SIZE];
+					PhyDatagram datagrams[ZT_PHY_UDP_BATCH_SIZE];
+					memset(msgs,0,sizeof(msgs));
+					memset(from,0,sizeof(from));
+					for(unsigned int i=0;i<ZT_PHY_UDP_BATCH_SIZE;++i) {
+						iov[i].iov_base = _udpBatchBuf + (i * _udpBatchBufSlotSize);
+						iov[i].iov_len = slotSize;
+						msgs[i].msg_hdr.msg_iov = &(iov[i]);
+						msgs[i].msg_hdr.msg_iovlen = 1;
+						msgs[i].msg_hdr.msg_name = (void *)&(from[i]);
+					}
+					for(unsigned int batches=0;((batches<ZT_PHY_UDP_MAX_BATCHES_PER_POLL)&&(s->type == ZT_PHY_SOCKET_UDP));++batches) { // stop if a handler closes the socket
+						for(unsigned int i=0;i<ZT_PHY_UDP_BATCH_SIZE;++i) {
+							msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+							msgs[i].msg_hdr.msg_flags = 0;
+#ifdef ZT_PHY_HAVE_UDP_GSO
+							msgs[i].msg_hdr.msg_control = (s->gro) ? (void *)control[i] : (void *)0;
+							msgs[i].msg_hdr.msg_controllen = (s->gro) ? sizeof(control[i]) : 0;
+#endif
+						}
+						const int n = ::recvmmsg(s->sock,msgs,ZT_PHY_UDP_BATCH_SIZE,0,(struct timespec *)0);
+						if (n <= 0) {
+							if ((n < 0)&&(errno == EINTR))
+								continue;
+							break;
+						}
+						unsigned int count = 0;
+						for(int i=0;((i<n)&&(s->type == ZT_PHY_SOCKET_UDP));++i) {
+							// Addresses are compared as whole sockaddr_storage structures elsewhere, so clear anything left from the previous datagram in this slot
+							if (msgs[i].msg_hdr.msg_namelen < sizeof(struct sockaddr_storage))
+								memset(reinterpret_cast<char *>(&(from[i])) + msgs[i].msg_hdr.msg_namelen,0,sizeof(struct sockaddr_storage) - msgs[i].msg_hdr.msg_namelen);
+							if ((msgs[i].msg_len > 0)&&((msgs[i].msg_hdr.msg_flags & MSG_TRUNC) == 0)) {
+								unsigned long segSize = (unsigned long)msgs[i].msg_len;
+#ifdef ZT_PHY_HAVE_UDP_GSO
+								if (s->gro) {
+									for(struct cmsghdr *cm=CMSG_FIRSTHDR(&(msgs[i].msg_hdr));cm;cm=CMSG_NXTHDR(&(msgs[i].msg_hdr),cm)) {
+										if ((cm->cmsg_level == SOL_UDP)&&(cm->cmsg_type == UDP_GRO)) {
+											int gs = 0;
+											memcpy(&gs,CMSG_DATA(cm),sizeof(gs));
+											if (gs > 0)
+												segSize = (unsigned long)gs;
+										}
+									}
+								}
+#endif
+								// Split coalesced (GRO) reads back into the datagrams that were sent
+								char *p = reinterpret_cast<char *>(iov[i].iov_base);
+								unsigned long remaining = (unsigned long)msgs[i].msg_len;
+								while (remaining) {
+									if (count == ZT_PHY_UDP_BATCH_SIZE) {
+										_dispatchDatagrams(s,datagrams,count);
+										count = 0;
+										if (s->type != ZT_PHY_SOCKET_UDP)
+											break;
+									}
+									const unsigned long l = (remaining > segSize) ? segSize : remaining;
+									datagrams[count].addr = (const struct sockaddr *)&(from[i]);
+									datagrams[count].data = p;
+									datagrams[count].len = l;
+									++count;
+									p += l;
+									remaining -= l;
+								}
+							}
+						}
+						if (s->type == ZT_PHY_SOCKET_UDP)
+							_dispatchDatagrams(s,datagrams,count);
+						if (n < ZT_PHY_UDP_BATCH_SIZE)
+							break; // socket is empty
+					}
+#else
+					for(unsigned int reads=0;((reads<(ZT_PHY_UDP_BATCH_SIZE * ZT_PHY_UDP_MAX_BATCHES_PER_POLL))&&(s->type == ZT_PHY_SOCKET_UDP));++reads) {
+						memset(&ss,0,sizeof(ss));
+						socklen_t slen = sizeof(ss);
+						long n = (long)::recvfrom(s->sock,buf,bufSize,0,(struct sockaddr *)&ss,&slen);
+						if (n > 0) {
+							try {
+								_handler->phyOnDatagram((PhySocket *)&(*s),&(s->uptr),(const struct sockaddr *)&(s->saddr),(const struct sockaddr *)&ss,(void *)buf,(unsigned long)n);
+							} catch ( ... ) {}
+						} else if (n < 0) {
+							if (errno == EINTR)
+								continue;
+							break;
+						}
+					}
+#endif // ZT_PHY_HAVE_MMSG
+				}
+				break;
+
+			case ZT_PHY_SOCKET_UNIX_IN: {
+#ifdef __UNIX_LIKE__
+				if ((writable)&&(_watchingWrite(*s))) {
+					try {
+						_handler->phyOnUnixWritable((PhySocket *)&(*s),&(s->uptr),false);
+					} catch ( ... ) {}
+				}
+				if ((readable)&&(s->type != ZT_PHY_SOCKET_CLOSED)) {
+					long n = (long)::read(s->sock,buf,bufSize);
+					if (n <= 0) {
+						this->close((PhySocket *)&(*s),true);
+					} else {
+						try {
+							_handler->phyOnUnixData((PhySocket *)&(*s),&(s->uptr),(void *)buf,(unsigned long)n);
+						} catch ( ... ) {}
+					}
+				}
+#endif // __UNIX_LIKE__
+			}	break;
+
+			case ZT_PHY_SOCKET_UNIX_LISTEN:
+#ifdef __UNIX_LIKE__
+				if (readable) {
+					memset(&ss,0,sizeof(ss));
+					socklen_t slen = sizeof(ss);
+					ZT_PHY_SOCKFD_TYPE newSock = ::accept(s->sock,(struct sockaddr *)&ss,&slen);
+					if (ZT_PHY_SOCKFD_VALID(newSock)) {
+						if (_socks.size() >= ZT_PHY_MAX_SOCKETS) {
+							ZT_PHY_CLOSE_SOCKET(newSock);
+						} else {
+							fcntl(newSock,F_SETFL,O_NONBLOCK);
+							_socks.push_back(PhySocketImpl());
+							PhySocketImpl &sws = _socks.back();
+							sws.type = ZT_PHY_SOCKET_UNIX_IN;
+							sws.sock = newSock;
+							if (!_watch(sws,true,false)) {
+								_socks.pop_back();
+								ZT_PHY_CLOSE_SOCKET(newSock);
+								break;
+							}
+							sws.uptr = (void *)0;
+							memcpy(&(sws.saddr),&ss,sizeof(struct sockaddr_storage));
+							try {
+								//_handler->phyOnUnixAccept((PhySocket *)&(*s),(PhySocket *)&(_socks.back()),&(s->uptr),&(sws.uptr));
+							} catch ( ... ) {}
+						}
+					}
+				}
+#endif // __UNIX_LIKE__
+				break;
+
+			case ZT_PHY_SOCKET_FD: {
+				if (((readable)&&(_watchingRead(*s)))||((writable)&&(_watchingWrite(*s)))) {
+					try {
+						//_handler->phyOnFileDescriptorActivity((PhySocket *)&(*s),&(s->uptr),readable,writable);
+					} catch ( ... ) {}
+				}
+			}	break;
+
+			default:
+				break;
+
+		}
+	}
+
 public:
 	/**
 	 * @param handler Pointer of type HANDLER_PTR_TYPE to handler
@@ -175,8 +1082,10 @@ public:
 	Phy(HANDLER_PTR_TYPE handler,bool noDelay,bool noCheck) :
 		_handler(handler)
 	{
+#ifndef ZT_PHY_USE_EPOLL
 		FD_ZERO(&_readfds);
 		FD_ZERO(&_writefds);
+#endif
 
 #if defined(_WIN32) || defined(_WIN64)
 		FD_ZERO(&_exceptfds);
@@ -212,11 +1121,35 @@ public:
 			throw std::runtime_error("unable to create pipes for select() abort");
 #endif // Windows or not
 
+#ifdef ZT_PHY_USE_EPOLL
+		_epfd = ::epoll_create1(EPOLL_CLOEXEC);
+		if (_epfd < 0) {
+			::close(pipes[0]);
+			::close(pipes[1]);
+			throw std::runtime_error("unable to create epoll instance");
+		}
+		{
+			struct epoll_event ev;
+			memset(&ev,0,sizeof(ev));
+			ev.events = EPOLLIN;
+			ev.data.ptr = (void *)0; // NULL identifies the whack pipe in poll()
+			::epoll_ctl(_epfd,EPOLL_CTL_ADD,pipes[0],&ev);
+		}
+		_haveClosed = false;
+#else
 		_nfds = (pipes[0] > pipes[1]) ? (long)pipes[0] : (long)pipes[1];
+#endif
 		_whackReceiveSocket = pipes[0];
 		_whackSendSocket = pipes[1];
 		_noDelay = noDelay;
 		_noCheck = noCheck;
+#ifdef ZT_PHY_HAVE_MMSG
+		_udpBatchBuf = (char *)0;
+		_udpBatchBufSlotSize = 0;
+#endif
+#ifdef ZT_PHY_HAVE_IO_URING
+		_uring = (_IoUring *)0;
+#endif
 	}
 
 	~Phy()
@@ -225,8 +1158,42 @@ public:
 			if (s->type != ZT_PHY_SOCKET_CLOSED)
 				this->close((PhySocket *)&(*s),true);
 		}
+#ifdef ZT_PHY_HAVE_IO_URING
+		if (_uring) {
+			// The kernel may still write to receive buffers and read send slots until the cancelled and in-flight operations complete
+			for(unsigned int tries=0;tries<1000;++tries) {
+				bool armed = false;
+				for(typename std::list<PhySocketImpl>::const_iterator s(_socks.begin());s!=_socks.end();++s) {
+					if (s->uring == ZT_PHY_URING_ARMED)
+						armed = true;
+				}
+				if (!armed)
+					break;
+				_uring->recv.submit(1);
+				_uringProcess();
+			}
+			pthread_mutex_lock(&(_uring->sendLock));
+			for(unsigned int tries=0;((tries<1000)&&(_uring->sendFreeCount < ZT_PHY_IO_URING_SEND_SLOTS));++tries) {
+				_uring->send.submit(1);
+				_uringReapSends();
+			}
+			pthread_mutex_unlock(&(_uring->sendLock));
+			_uring->recv.destroy();
+			_uring->send.destroy();
+			::munmap((void *)_uring->bufRing,sizeof(struct io_uring_buf) * ZT_PHY_IO_URING_RECV_BUFFERS);
+			delete [] _uring->bufs;
+			pthread_mutex_destroy(&(_uring->sendLock));
+			delete _uring;
+		}
+#endif
 		ZT_PHY_CLOSE_SOCKET(_whackReceiveSocket);
 		ZT_PHY_CLOSE_SOCKET(_whackSendSocket);
+#ifdef ZT_PHY_USE_EPOLL
+		::close(_epfd);
+#endif
+#ifdef ZT_PHY_HAVE_MMSG
+		delete [] _udpBatchBuf;
+#endif
 	}
 
 	/**
@@ -235,6 +1202,78 @@ public:
 	 */
 	static inline ZT_PHY_SOCKFD_TYPE getDescriptor(PhySocket *s) throw() { return reinterpret_cast<PhySocketImpl *>(s)->sock; }
 
+	/**
+	 * Use io_uring for UDP sockets bound after this call (Linux only)
+	 *
+	 * Each such socket gets a multishot recvmsg that stays armed and fills
+	 * buffers from a provided buffer ring, so receiving datagrams takes no
+	 * system calls beyond the one poll() waits in. Single datagrams passed
+	 * to udpSend() are copied and sent asynchronously, and those sent from
+	 * handlers are submitted together at the end of poll(). udpSendBatch()
+	 * still uses sendmmsg() so GSO keeps working. Sockets fall back to
+	 * epoll if the kernel lacks multishot recvmsg (before 6.0). Handlers
+	 * are called exactly as they are otherwise.
+	 *
+	 * This should be called before poll() is first called.
+	 *
+	 * @return True if io_uring is available and will be used
+	 */
+	inline bool enableIoUring()
+	{
+#ifdef ZT_PHY_HAVE_IO_URING
+		if (_uring)
+			return true;
+		_IoUring *const u = new _IoUring();
+		u->bufs = (char *)0;
+		u->bufRing = (struct io_uring_buf_ring *)MAP_FAILED;
+		if ((u->recv.init(ZT_PHY_IO_URING_ENTRIES))&&(u->send.init(ZT_PHY_IO_URING_ENTRIES))) {
+			u->bufRing = (struct io_uring_buf_ring *)::mmap((void *)0,sizeof(struct io_uring_buf) * ZT_PHY_IO_URING_RECV_BUFFERS,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+			if ((void *)u->bufRing != MAP_FAILED) {
+				if (u->recv.registerBufferRing(u->bufRing,ZT_PHY_IO_URING_RECV_BUFFERS,0)) {
+					struct epoll_event ev;
+					memset(&ev,0,sizeof(ev));
+					ev.events = EPOLLIN;
+					ev.data.ptr = (void *)u; // identifies the receive ring in poll()
+					if (::epoll_ctl(_epfd,EPOLL_CTL_ADD,u->recv.fd,&ev) == 0) {
+						u->bufs = new char[(unsigned long)ZT_PHY_IO_URING_RECV_BUFFERS * ZT_PHY_IO_URING_RECV_BUFFER_SIZE];
+						u->bufTail = 0;
+						memset(&(u->recvMsg),0,sizeof(u->recvMsg));
+						u->recvMsg.msg_namelen = sizeof(struct sockaddr_storage);
+						u->rearm = false;
+						u->noMultishot = false;
+						pthread_mutex_init(&(u->sendLock),(const pthread_mutexattr_t *)0);
+						u->pollThread = pthread_self();
+						u->inPoll = false;
+						u->sendFreeCount = ZT_PHY_IO_URING_SEND_SLOTS;
+						for(unsigned int i=0;i<ZT_PHY_IO_URING_SEND_SLOTS;++i)
+							u->sendFree[i] = i;
+						_uring = u;
+						for(unsigned int i=0;i<ZT_PHY_IO_URING_RECV_BUFFERS;++i)
+							_uringReturnBuffer(i);
+						__atomic_store_n(&(_uring->bufRing->tail),(uint16_t)_uring->bufTail,__ATOMIC_RELEASE);
+						return true;
+					}
+				}
+				::munmap((void *)u->bufRing,sizeof(struct io_uring_buf) * ZT_PHY_IO_URING_RECV_BUFFERS);
+			}
+		}
+		delete u;
+#endif
+		return false;
+	}
+
+	/**
+	 * @return True if enableIoUring() has succeeded
+	 */
+	inline bool ioUringEnabled() const
+	{
+#ifdef ZT_PHY_HAVE_IO_URING
+		return (_uring != (_IoUring *)0);
+#else
+		return false;
+#endif
+	}
+
 	/**
 	 * @param s Socket object
 	 * @return Pointer to user object
@@ -297,11 +1336,12 @@ public:
 			return (PhySocket *)0;
 		}
 		PhySocketImpl &sws = _socks.back();
-		if ((long)fd > _nfds)
-			_nfds = (long)fd;
-		FD_SET(fd,&_readfds);
 		sws.type = ZT_PHY_SOCKET_UNIX_IN; /* TODO: Type was changed to allow for CBs with new RPC model */
 		sws.sock = fd;
+		if (!_watch(sws,true,false)) {
+			_socks.pop_back();
+			return (PhySocket *)0;
+		}
 		sws.uptr = uptr;
 		memset(&(sws.saddr),0,sizeof(struct sockaddr_storage));
 		// no sockaddr for this socket type, leave saddr null
@@ -314,9 +1354,11 @@ public:
 	 * @param localAddress Local endpoint address and port
 	 * @param uptr Initial value of user pointer associated with this socket (default: NULL)
 	 * @param bufferSize Desired socket receive/send buffer size -- will set as close to this as possible (default: 0, leave alone)
+	 * @param reusePort If true, set SO_REUSEPORT so several sockets (e.g. one per thread) can share this address (where supported)
+	 * @param device If non-NULL, bind to this device before binding address (Linux only, failure is ignored)
 	 * @return Socket or NULL on failure to bind
 	 */
-	inline PhySocket *udpBind(const struct sockaddr *localAddress,void *uptr = (void *)0,int bufferSize = 0)
+	inline PhySocket *udpBind(const struct sockaddr *localAddress,void *uptr = (void *)0,int bufferSize = 0,bool reusePort = false,const char *device = (const char *)0)
 	{
 		if (_socks.size() >= ZT_PHY_MAX_SOCKETS)
 			return (PhySocket *)0;
@@ -325,6 +1367,15 @@ public:
 		if (!ZT_PHY_SOCKFD_VALID(s))
 			return (PhySocket *)0;
 
+#ifdef ZT_PHY_HAVE_UDP_GSO
+		bool gsoCapable;
+		{
+			int gs = 0;
+			socklen_t gsl = sizeof(gs);
+			gsoCapable = (::getsockopt(s,SOL_UDP,UDP_SEGMENT,(void *)&gs,&gsl) == 0);
+		}
+#endif
+
 		if (bufferSize > 0) {
 			int bs = bufferSize;
 			while (bs >= 65536) {
@@ -366,6 +1417,16 @@ public:
 			}
 			f = 0; setsockopt(s,SOL_SOCKET,SO_REUSEADDR,(void *)&f,sizeof(f));
 			f = 1; setsockopt(s,SOL_SOCKET,SO_BROADCAST,(void *)&f,sizeof(f));
+#ifdef SO_REUSEPORT
+			if (reusePort) {
+				f = 1; setsockopt(s,SOL_SOCKET,SO_REUSEPORT,(void *)&f,sizeof(f));
+			}
+#endif
+#ifdef SO_BINDTODEVICE
+			// This must precede bind() since changing it afterwards takes a socket out of its SO_REUSEPORT group
+			if ((device)&&(device[0]))
+				setsockopt(s,SOL_SOCKET,SO_BINDTODEVICE,device,(socklen_t)strlen(device));
+#endif
 #ifdef IP_DONTFRAG
 			f = 0; setsockopt(s,IPPROTO_IP,IP_DONTFRAG,&f,sizeof(f));
 #endif
@@ -375,8 +1436,14 @@ public:
 #ifdef SO_NO_CHECK
 			// For now at least we only set SO_NO_CHECK on IPv4 sockets since some
 			// IPv6 stacks incorrectly discard zero checksum packets. May remove
-			// this restriction later once broken stuff dies more.
-			if ((localAddress->sa_family == AF_INET)&&(_noCheck)) {
+			// this restriction later once broken stuff dies more. It's also not
+			// set where GSO is available since the kernel refuses GSO without it.
+			bool noCheck = ((localAddress->sa_family == AF_INET)&&(_noCheck));
+#ifdef ZT_PHY_HAVE_UDP_GSO
+			if (gsoCapable)
+				noCheck = false;
+#endif
+			if (noCheck) {
 				f = 1; setsockopt(s,SOL_SOCKET,SO_NO_CHECK,(void *)&f,sizeof(f));
 			}
 #endif
@@ -402,18 +1469,61 @@ public:
 		}
 		PhySocketImpl &sws = _socks.back();
 
-		if ((long)s > _nfds)
-			_nfds = (long)s;
-		FD_SET(s,&_readfds);
 		sws.type = ZT_PHY_SOCKET_UDP;
 		sws.sock = s;
+#ifdef ZT_PHY_HAVE_IO_URING
+		if ((_uring)&&(!_uring->noMultishot))
+			sws.uring = ZT_PHY_URING_REARM; // armed below instead of being watched by epoll
+#endif
+		if (!_watch(sws,true,false)) {
+			_socks.pop_back();
+			ZT_PHY_CLOSE_SOCKET(s);
+			return (PhySocket *)0;
+		}
 		sws.uptr = uptr;
 		memset(&(sws.saddr),0,sizeof(struct sockaddr_storage));
 		memcpy(&(sws.saddr),localAddress,(localAddress->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+#ifdef ZT_PHY_HAVE_UDP_GSO
+		sws.gsoCapable = gsoCapable;
+		setUdpOffload((PhySocket *)&sws,true);
+#endif
+#ifdef ZT_PHY_HAVE_IO_URING
+		if (sws.uring != ZT_PHY_URING_OFF) {
+			_uringArm(sws);
+			_uring->recv.submit();
+		}
+#endif
 
 		return (PhySocket *)&sws;
 	}
 
+	/**
+	 * Enable or disable UDP segmentation and receive coalescing (GSO/GRO)
+	 *
+	 * These are enabled by default on UDP sockets where the kernel supports
+	 * them. On platforms without UDP GSO this does nothing and returns false.
+	 *
+	 * @param sock UDP socket
+	 * @param enabled True to enable, false to disable
+	 * @return True if GSO is now in use for sends on this socket
+	 */
+	inline bool setUdpOffload(PhySocket *sock,bool enabled)
+	{
+#ifdef ZT_PHY_HAVE_UDP_GSO
+		PhySocketImpl &sws = *(reinterpret_cast<PhySocketImpl *>(sock));
+		int f = (enabled) ? 1 : 0;
+#ifdef ZT_PHY_HAVE_IO_URING
+		if (sws.uring != ZT_PHY_URING_OFF)
+			f = 0; // io_uring receive buffers are too small for coalesced reads
+#endif
+		sws.gso = ((enabled)&&(sws.gsoCapable));
+		sws.gro = ((::setsockopt(sws.sock,SOL_UDP,UDP_GRO,(void *)&f,sizeof(f)) == 0)&&(f));
+		return sws.gso;
+#else
+		return false;
+#endif
+	}
+
 	/**
 	 * Set the IP TTL for the next outgoing packet (for IPv4 UDP sockets only)
 	 *
@@ -444,6 +1554,10 @@ public:
 	inline bool udpSend(PhySocket *sock,const struct sockaddr *remoteAddress,const void *data,unsigned long len)
 	{
 		PhySocketImpl &sws = *(reinterpret_cast<PhySocketImpl *>(sock));
+#ifdef ZT_PHY_HAVE_IO_URING
+		if ((_uring)&&(sws.uring != ZT_PHY_URING_OFF)&&(_uringSend(sws,remoteAddress,data,len)))
+			return true;
+#endif
 #if defined(_WIN32) || defined(_WIN64)
 		return ((long)::sendto(sws.sock,reinterpret_cast<const char *>(data),len,0,remoteAddress,(remoteAddress->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in)) == (long)len);
 #else
@@ -451,6 +1565,141 @@ public:
 #endif
 	}
 
+	/**
+	 * Send a UDP packet right away with a specific IPv4 TTL
+	 *
+	 * The TTL is set on the socket for this send only, so this never goes
+	 * through io_uring: a queued send would be submitted after the TTL was
+	 * put back.
+	 *
+	 * @param sock IPv4 UDP socket
+	 * @param remoteAddress Destination address
+	 * @param data Data to send
+	 * @param len Length of packet
+	 * @param ttl IP TTL for this packet
+	 * @return True if packet appears to have been sent successfully
+	 */
+	inline bool udpSendWithIp4Ttl(PhySocket *sock,const struct sockaddr *remoteAddress,const void *data,unsigned long len,unsigned int ttl)
+	{
+		PhySocketImpl &sws = *(reinterpret_cast<PhySocketImpl *>(sock));
+		setIp4UdpTtl(sock,ttl);
+#if defined(_WIN32) || defined(_WIN64)
+		const bool result = ((long)::sendto(sws.sock,reinterpret_cast<const char *>(data),len,0,remoteAddress,sizeof(struct sockaddr_in)) == (long)len);
+#else
+		const bool result = ((long)::sendto(sws.sock,data,len,0,remoteAddress,sizeof(struct sockaddr_in)) == (long)len);
+#endif
+		setIp4UdpTtl(sock,255);
+		return result;
+	}
+
+	/**
+	 * Send a batch of UDP packets
+	 *
+	 * On Linux this uses sendmmsg() to send up to ZT_PHY_UDP_BATCH_SIZE
+	 * packets per system call. Elsewhere it just calls udpSend() for each.
+	 * A packet that fails is skipped and sending continues with the next
+	 * one, unless the socket's send buffer is full in which case the rest
+	 * of the batch is dropped.
+	 *
+	 * If UDP GSO is in use, consecutive packets to the same destination of
+	 * which all but the last are the same size (such as a ZeroTier packet
+	 * and its fragments) are sent as one UDP_SEGMENT super-packet. If the
+	 * kernel rejects this, GSO is turned off for the socket and they are
+	 * sent again individually.
+	 *
+	 * @param sock UDP socket
+	 * @param datagrams Packets to send (addr is the destination)
+	 * @param count Number of packets
+	 * @return Number of packets that appear to have been sent successfully
+	 */
+	inline unsigned int udpSendBatch(PhySocket *sock,const PhyDatagram *datagrams,unsigned int count)
+	{
+#ifdef ZT_PHY_HAVE_MMSG
+		PhySocketImpl &sws = *(reinterpret_cast<PhySocketImpl *>(sock));
+		struct mmsghdr msgs[ZT_PHY_UDP_BATCH_SIZE];
+		unsigned int segments[ZT_PHY_UDP_BATCH_SIZE]; // number of datagrams in each message
+#ifdef ZT_PHY_HAVE_UDP_GSO
+		struct iovec iov[ZT_PHY_UDP_GSO_MAX_SEGMENTS];
+		char control[ZT_PHY_UDP_BATCH_SIZE][CMSG_SPACE(sizeof(uint16_t))];
+#else
+		struct iovec iov[ZT_PHY_UDP_BATCH_SIZE];
+#endif
+		unsigned int sent = 0;
+		unsigned int i = 0;
+		while (i < count) {
+			unsigned int n = 0;
+			unsigned int nd = 0; // datagrams (and iovecs) in this call
+			memset(msgs,0,sizeof(msgs));
+			while ((n < ZT_PHY_UDP_BATCH_SIZE)&&((i + nd) < count)&&(nd < (unsigned int)(sizeof(iov) / sizeof(struct iovec)))) {
+				const PhyDatagram &d = datagrams[i + nd];
+				unsigned int segs = 1;
+#ifdef ZT_PHY_HAVE_UDP_GSO
+				if (sws.gso) {
+					unsigned long total = d.len;
+					while (((i + nd + segs) < count)&&(segs < ZT_PHY_UDP_GSO_MAX_SEGMENTS)&&((nd + segs) < (unsigned int)(sizeof(iov) / sizeof(struct iovec)))) {
+						const PhyDatagram &nxt = datagrams[i + nd + segs];
+						if ((datagrams[i + nd + segs - 1].len != d.len)||(nxt.len > d.len)||((total + nxt.len) > ZT_PHY_UDP_GSO_MAX_BYTES)||(!_sameAddress(nxt.addr,d.addr)))
+							break;
+						total += nxt.len;
+						++segs;
+					}
+				}
+#endif
+				for(unsigned int k=0;k<segs;++k) {
+					iov[nd + k].iov_base = datagrams[i + nd + k].data;
+					iov[nd + k].iov_len = datagrams[i + nd + k].len;
+				}
+				msgs[n].msg_hdr.msg_name = (void *)d.addr;
+				msgs[n].msg_hdr.msg_namelen = (d.addr->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+				msgs[n].msg_hdr.msg_iov = &(iov[nd]);
+				msgs[n].msg_hdr.msg_iovlen = segs;
+#ifdef ZT_PHY_HAVE_UDP_GSO
+				if (segs > 1) {
+					msgs[n].msg_hdr.msg_control = (void *)control[n];
+					msgs[n].msg_hdr.msg_controllen = sizeof(control[n]);
+					struct cmsghdr *cm = CMSG_FIRSTHDR(&(msgs[n].msg_hdr));
+					cm->cmsg_level = SOL_UDP;
+					cm->cmsg_type = UDP_SEGMENT;
+					cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+					const uint16_t gs = (uint16_t)d.len;
+					memcpy(CMSG_DATA(cm),&gs,sizeof(gs));
+				}
+#endif
+				segments[n++] = segs;
+				nd += segs;
+			}
+
+			const int r = ::sendmmsg(sws.sock,msgs,n,0);
+			if (r > 0) {
+				for(int k=0;k<r;++k) {
+					sent += segments[k];
+					i += segments[k];
+				}
+				continue; // if only some were sent, the next call will report the error for the one that failed
+			} else if ((r < 0)&&(errno == EINTR)) {
+				continue;
+			} else if ((r < 0)&&((errno == EAGAIN)||(errno == EWOULDBLOCK)||(errno == ENOBUFS))) {
+				break;
+			}
+#ifdef ZT_PHY_HAVE_UDP_GSO
+			if ((r < 0)&&(segments[0] > 1)&&((errno == EINVAL)||(errno == EIO))) {
+				sws.gso = false; // e.g. no checksum offload on the route or MTU too small, so send these again without GSO
+				continue;
+			}
+#endif
+			i += segments[0]; // the first packet failed (e.g. unreachable destination), skip it
+		}
+		return sent;
+#else
+		unsigned int sent = 0;
+		for(unsigned int i=0;i<count;++i) {
+			if (this->udpSend(sock,datagrams[i].addr,datagrams[i].data,datagrams[i].len))
+				++sent;
+		}
+		return sent;
+#endif
+	}
+
 #ifdef __UNIX_LIKE__
 	/**
 	 * Listen for connections on a Unix domain socket
@@ -496,11 +1745,13 @@ public:
 		}
 		PhySocketImpl &sws = _socks.back();
 
-		if ((long)s > _nfds)
-			_nfds = (long)s;
-		FD_SET(s,&_readfds);
 		sws.type = ZT_PHY_SOCKET_UNIX_LISTEN;
 		sws.sock = s;
+		if (!_watch(sws,true,false)) {
+			_socks.pop_back();
+			ZT_PHY_CLOSE_SOCKET(s);
+			return (PhySocket *)0;
+		}
 		sws.uptr = uptr;
 		memset(&(sws.saddr),0,sizeof(struct sockaddr_storage));
 		memcpy(&(sws.saddr),&sun,sizeof(struct sockaddr_un));
@@ -562,11 +1813,13 @@ public:
 		}
 		PhySocketImpl &sws = _socks.back();
 
-		if ((long)s > _nfds)
-			_nfds = (long)s;
-		FD_SET(s,&_readfds);
 		sws.type = ZT_PHY_SOCKET_TCP_LISTEN;
 		sws.sock = s;
+		if (!_watch(sws,true,false)) {
+			_socks.pop_back();
+			ZT_PHY_CLOSE_SOCKET(s);
+			return (PhySocket *)0;
+		}
 		sws.uptr = uptr;
 		memset(&(sws.saddr),0,sizeof(struct sockaddr_storage));
 		memcpy(&(sws.saddr),localAddress,(localAddress->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
@@ -647,19 +1900,18 @@ public:
 		}
 		PhySocketImpl &sws = _socks.back();
 
-		if ((long)s > _nfds)
-			_nfds = (long)s;
-		if (connected) {
-			FD_SET(s,&_readfds);
-			sws.type = ZT_PHY_SOCKET_TCP_OUT_CONNECTED;
-		} else {
-			FD_SET(s,&_writefds);
+		sws.type = (connected) ? ZT_PHY_SOCKET_TCP_OUT_CONNECTED : ZT_PHY_SOCKET_TCP_OUT_PENDING;
+		sws.sock = s;
+		if (!_watch(sws,connected,!connected)) {
+			_socks.pop_back();
+			ZT_PHY_CLOSE_SOCKET(s);
+			connected = false;
+			return (PhySocket *)0;
+		}
 #if defined(_WIN32) || defined(_WIN64)
+		if (!connected)
 			FD_SET(s,&_exceptfds);
 #endif
-			sws.type = ZT_PHY_SOCKET_TCP_OUT_PENDING;
-		}
-		sws.sock = s;
 		sws.uptr = uptr;
 		memset(&(sws.saddr),0,sizeof(struct sockaddr_storage));
 		memcpy(&(sws.saddr),remoteAddress,(remoteAddress->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
@@ -810,11 +2062,7 @@ public:
 	inline const void setNotifyWritable(PhySocket *sock,bool notifyWritable)
 	{
 		PhySocketImpl &sws = *(reinterpret_cast<PhySocketImpl *>(sock));
-		if (notifyWritable) {
-			FD_SET(sws.sock,&_writefds);
-		} else {
-			FD_CLR(sws.sock,&_writefds);
-		}
+		_watch(sws,_watchingRead(sws),notifyWritable);
 	}
 
 	/**
@@ -830,11 +2078,7 @@ public:
 	inline const void setNotifyReadable(PhySocket *sock,bool notifyReadable)
 	{
 		PhySocketImpl &sws = *(reinterpret_cast<PhySocketImpl *>(sock));
-		if (notifyReadable) {
-			FD_SET(sws.sock,&_readfds);
-		} else {
-			FD_CLR(sws.sock,&_readfds);
-		}
+		_watch(sws,notifyReadable,_watchingWrite(sws));
 	}
 
 	/**
@@ -849,7 +2093,57 @@ public:
 	inline void poll(unsigned long timeout)
 	{
 		char buf[131072];
-		struct sockaddr_storage ss;
+
+#ifdef ZT_PHY_USE_EPOLL
+		struct epoll_event events[ZT_PHY_EPOLL_MAX_EVENTS];
+
+#ifdef ZT_PHY_HAVE_IO_URING
+		if (_uring) {
+			_uring->pollThread = pthread_self();
+			_uring->inPoll = true;
+		}
+#endif
+
+		const int n = ::epoll_wait(_epfd,events,ZT_PHY_EPOLL_MAX_EVENTS,(timeout > 0) ? ((timeout > 0x7fffffffUL) ? 0x7fffffff : (int)timeout) : -1);
+		for(int i=0;i<n;++i) {
+			PhySocketImpl *const s = reinterpret_cast<PhySocketImpl *>(events[i].data.ptr);
+			if (!s) {
+				char tmp[16];
+				::read(_whackReceiveSocket,tmp,16);
+				continue;
+			}
+#ifdef ZT_PHY_HAVE_IO_URING
+			if (events[i].data.ptr == (void *)_uring) {
+				_uringProcess();
+				continue;
+			}
+#endif
+			if (s->type == ZT_PHY_SOCKET_CLOSED)
+				continue; // closed by a handler earlier in this batch
+			const uint32_t e = events[i].events;
+			_process(s,((e & (EPOLLIN|EPOLLERR|EPOLLHUP))&&(s->events & EPOLLIN)),((e & (EPOLLOUT|EPOLLERR|EPOLLHUP))&&(s->events & EPOLLOUT)),buf,sizeof(buf));
+		}
+
+		if (_haveClosed) {
+			_haveClosed = false;
+			for(typename std::list<PhySocketImpl>::iterator s(_socks.begin());s!=_socks.end();) {
+#ifdef ZT_PHY_HAVE_IO_URING
+				if ((s->type == ZT_PHY_SOCKET_CLOSED)&&(s->uring != ZT_PHY_URING_ARMED))
+#else
+				if (s->type == ZT_PHY_SOCKET_CLOSED)
+#endif
+					_socks.erase(s++);
+				else ++s;
+			}
+		}
+
+#ifdef ZT_PHY_HAVE_IO_URING
+		if (_uring) {
+			_uring->inPoll = false;
+			_uringSubmitSends();
+		}
+#endif
+#else // select()
 		struct timeval tv;
 		fd_set rfds,wfds,efds;
 
@@ -876,171 +2170,19 @@ public:
 		}
 
 		for(typename std::list<PhySocketImpl>::iterator s(_socks.begin());s!=_socks.end();) {
-			switch (s->type) {
-
-				case ZT_PHY_SOCKET_TCP_OUT_PENDING:
-#if defined(_WIN32) || defined(_WIN64)
-					if (FD_ISSET(s->sock,&efds)) {
-						this->close((PhySocket *)&(*s),true);
-					} else // ... if
-#endif
-					if (FD_ISSET(s->sock,&wfds)) {
-						socklen_t slen = sizeof(ss);
-						if (::getpeername(s->sock,(struct sockaddr *)&ss,&slen) != 0) {
-							this->close((PhySocket *)&(*s),true);
-						} else {
-							s->type = ZT_PHY_SOCKET_TCP_OUT_CONNECTED;
-							FD_SET(s->sock,&_readfds);
-							FD_CLR(s->sock,&_writefds);
+			const ZT_PHY_SOCKFD_TYPE sock = s->sock;
 #if defined(_WIN32) || defined(_WIN64)
-							FD_CLR(s->sock,&_exceptfds);
+			if ((s->type == ZT_PHY_SOCKET_TCP_OUT_PENDING)&&(FD_ISSET(sock,&efds)))
+				this->close((PhySocket *)&(*s),true);
+			else
 #endif
-							try {
-								_handler->phyOnTcpConnect((PhySocket *)&(*s),&(s->uptr),true);
-							} catch ( ... ) {}
-						}
-					}
-					break;
-
-				case ZT_PHY_SOCKET_TCP_OUT_CONNECTED:
-				case ZT_PHY_SOCKET_TCP_IN: {
-					ZT_PHY_SOCKFD_TYPE sock = s->sock; // if closed, s->sock becomes invalid as s is no longer dereferencable
-					if (FD_ISSET(sock,&rfds)) {
-						long n = (long)::recv(sock,buf,sizeof(buf),0);
-						if (n <= 0) {
-							this->close((PhySocket *)&(*s),true);
-						} else {
-							try {
-								_handler->phyOnTcpData((PhySocket *)&(*s),&(s->uptr),(void *)buf,(unsigned long)n);
-							} catch ( ... ) {}
-						}
-					}
-					if ((FD_ISSET(sock,&wfds))&&(FD_ISSET(sock,&_writefds))) {
-						try {
-							_handler->phyOnTcpWritable((PhySocket *)&(*s),&(s->uptr));
-						} catch ( ... ) {}
-					}
-				}	break;
-
-				case ZT_PHY_SOCKET_TCP_LISTEN:
-					if (FD_ISSET(s->sock,&rfds)) {
-						memset(&ss,0,sizeof(ss));
-						socklen_t slen = sizeof(ss);
-						ZT_PHY_SOCKFD_TYPE newSock = ::accept(s->sock,(struct sockaddr *)&ss,&slen);
-						if (ZT_PHY_SOCKFD_VALID(newSock)) {
-							if (_socks.size() >= ZT_PHY_MAX_SOCKETS) {
-								ZT_PHY_CLOSE_SOCKET(newSock);
-							} else {
-#if defined(_WIN32) || defined(_WIN64)
-								{ BOOL f = (_noDelay ? TRUE : FALSE); setsockopt(newSock,IPPROTO_TCP,TCP_NODELAY,(char *)&f,sizeof(f)); }
-								{ u_long iMode=1; ioctlsocket(newSock,FIONBIO,&iMode); }
-#else
-								{ int f = (_noDelay ? 1 : 0); setsockopt(newSock,IPPROTO_TCP,TCP_NODELAY,(char *)&f,sizeof(f)); }
-								fcntl(newSock,F_SETFL,O_NONBLOCK);
-#endif
-								_socks.push_back(PhySocketImpl());
-								PhySocketImpl &sws = _socks.back();
-								FD_SET(newSock,&_readfds);
-								if ((long)newSock > _nfds)
-									_nfds = (long)newSock;
-								sws.type = ZT_PHY_SOCKET_TCP_IN;
-								sws.sock = newSock;
-								sws.uptr = (void *)0;
-								memcpy(&(sws.saddr),&ss,sizeof(struct sockaddr_storage));
-								try {
-									_handler->phyOnTcpAccept((PhySocket *)&(*s),(PhySocket *)&(_socks.back()),&(s->uptr),&(sws.uptr),(const struct sockaddr *)&(sws.saddr));
-								} catch ( ... ) {}
-							}
-						}
-					}
-					break;
-
-				case ZT_PHY_SOCKET_UDP:
-					if (FD_ISSET(s->sock,&rfds)) {
-						for(;;) {
-							memset(&ss,0,sizeof(ss));
-							socklen_t slen = sizeof(ss);
-							long n = (long)::recvfrom(s->sock,buf,sizeof(buf),0,(struct sockaddr *)&ss,&slen);
-							if (n > 0) {
-								try {
-									_handler->phyOnDatagram((PhySocket *)&(*s),&(s->uptr),(const struct sockaddr *)&(s->saddr),(const struct sockaddr *)&ss,(void *)buf,(unsigned long)n);
-								} catch ( ... ) {}
-							} else if (n < 0)
-								break;
-						}
-					}
-					break;
-
-				case ZT_PHY_SOCKET_UNIX_IN: {
-#ifdef __UNIX_LIKE__
-					ZT_PHY_SOCKFD_TYPE sock = s->sock; // if closed, s->sock becomes invalid as s is no longer dereferencable
-					if ((FD_ISSET(sock,&wfds))&&(FD_ISSET(sock,&_writefds))) {
-						try {
-							_handler->phyOnUnixWritable((PhySocket *)&(*s),&(s->uptr),false);
-						} catch ( ... ) {}
-					}
-					if (FD_ISSET(sock,&rfds)) {
-						long n = (long)::read(sock,buf,sizeof(buf));
-						if (n <= 0) {
-							this->close((PhySocket *)&(*s),true);
-						} else {
-							try {
-								_handler->phyOnUnixData((PhySocket *)&(*s),&(s->uptr),(void *)buf,(unsigned long)n);
-							} catch ( ... ) {}
-						}
-					}
-#endif // __UNIX_LIKE__
-				}	break;
-
-				case ZT_PHY_SOCKET_UNIX_LISTEN:
-#ifdef __UNIX_LIKE__
-					if (FD_ISSET(s->sock,&rfds)) {
-						memset(&ss,0,sizeof(ss));
-						socklen_t slen = sizeof(ss);
-						ZT_PHY_SOCKFD_TYPE newSock = ::accept(s->sock,(struct sockaddr *)&ss,&slen);
-						if (ZT_PHY_SOCKFD_VALID(newSock)) {
-							if (_socks.size() >= ZT_PHY_MAX_SOCKETS) {
-								ZT_PHY_CLOSE_SOCKET(newSock);
-							} else {
-								fcntl(newSock,F_SETFL,O_NONBLOCK);
-								_socks.push_back(PhySocketImpl());
-								PhySocketImpl &sws = _socks.back();
-								FD_SET(newSock,&_readfds);
-								if ((long)newSock > _nfds)
-									_nfds = (long)newSock;
-								sws.type = ZT_PHY_SOCKET_UNIX_IN;
-								sws.sock = newSock;
-								sws.uptr = (void *)0;
-								memcpy(&(sws.saddr),&ss,sizeof(struct sockaddr_storage));
-								try {
-									//_handler->phyOnUnixAccept((PhySocket *)&(*s),(PhySocket *)&(_socks.back()),&(s->uptr),&(sws.uptr));
-								} catch ( ... ) {}
-							}
-						}
-					}
-#endif // __UNIX_LIKE__
-					break;
-
-				case ZT_PHY_SOCKET_FD: {
-					ZT_PHY_SOCKFD_TYPE sock = s->sock;
-					const bool readable = ((FD_ISSET(sock,&rfds))&&(FD_ISSET(sock,&_readfds)));
-					const bool writable = ((FD_ISSET(sock,&wfds))&&(FD_ISSET(sock,&_writefds)));
-					if ((readable)||(writable)) {
-						try {
-							//_handler->phyOnFileDescriptorActivity((PhySocket *)&(*s),&(s->uptr),readable,writable);
-						} catch ( ... ) {}
-					}
-				}	break;
-
-				default:
-					break;
-
-			}
+			_process(&(*s),(FD_ISSET(sock,&rfds) != 0),(FD_ISSET(sock,&wfds) != 0),buf,sizeof(buf));
 
 			if (s->type == ZT_PHY_SOCKET_CLOSED)
 				_socks.erase(s++);
 			else ++s;
 		}
+#endif // epoll or select
 	}
 
 	/**
@@ -1055,10 +2197,20 @@ public:
 		if (sws.type == ZT_PHY_SOCKET_CLOSED)
 			return;
 
+#ifdef ZT_PHY_USE_EPOLL
+		_watch(sws,false,false); // explicit removal is needed since FD type descriptors stay open
+		_haveClosed = true;
+#ifdef ZT_PHY_HAVE_IO_URING
+		if (sws.uring == ZT_PHY_URING_ARMED)
+			_uringCancel(sws);
+		else sws.uring = ZT_PHY_URING_OFF;
+#endif
+#else
 		FD_CLR(sws.sock,&_readfds);
 		FD_CLR(sws.sock,&_writefds);
 #if defined(_WIN32) || defined(_WIN64)
 		FD_CLR(sws.sock,&_exceptfds);
+#endif
 #endif
 
 		if (sws.type != ZT_PHY_SOCKET_FD)
@@ -1097,6 +2249,7 @@ public:
 		// Causes entry to be deleted from list in poll(), ignored elsewhere
 		sws.type = ZT_PHY_SOCKET_CLOSED;
 
+#ifndef ZT_PHY_USE_EPOLL
 		if ((long)sws.sock >= (long)_nfds) {
 			long nfds = (long)_whackSendSocket;
 			if ((long)_whackReceiveSocket > nfds)
@@ -1107,6 +2260,7 @@ public:
 			}
 			_nfds = nfds;
 		}
+#endif
 	}
 };
 
@@ -0,0 +1,172 @@
+/*
+ * ZeroTier One - Network Virtualization Everywhere
+ * Copyright (C) 2011-2016  ZeroTier, Inc.  https://www.zerotier.com/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ZT_PREFIXSET_HPP
+#define ZT_PREFIXSET_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "../node/Constants.hpp"
+#include "../node/InetAddress.hpp"
+#include "../node/Utils.hpp"
+
+namespace ZeroTier {
+
+/**
+ * Set of IPv4 and IPv6 networks supporting fast containment tests
+ *
+ * Networks are kept as sorted, merged, non-overlapping address ranges so a
+ * lookup is one binary search no matter how many networks were added. Call
+ * build() after the last add() and before contains().
+ *
+ * This class is not thread-safe, but once built it is never modified by
+ * contains() so it can be read concurrently.
+ */
+class PrefixSet
+{
+public:
+	PrefixSet() {}
+
+	/**
+	 * Add a network
+	 *
+	 * Bits past the netmask are ignored, so an interface address such as
+	 * 10.1.2.3/24 adds all of 10.1.2.0/24. A netmask of 0 adds the whole
+	 * address family, and one longer than the address means just that address.
+	 *
+	 * @param net IPv4 or IPv6 address with netmask bits in port
+	 */
+	inline void add(const InetAddress &net)
+	{
+		const unsigned int bits = net.netmaskBits();
+		if (net.ss_family == AF_INET) {
+			const uint32_t mask = (bits == 0) ? 0 : ((bits >= 32) ? 0xffffffffU : ~(0xffffffffU >> bits));
+			const uint32_t a = Utils::ntoh((uint32_t)reinterpret_cast<const struct sockaddr_in *>(&net)->sin_addr.s_addr) & mask;
+			_v4.push_back(std::pair<uint32_t,uint32_t>(a,a | ~mask));
+		} else if (net.ss_family == AF_INET6) {
+			const _U128 a(_v6Key(net));
+			const uint64_t hm = (bits == 0) ? 0 : ((bits >= 64) ? 0xffffffffffffffffULL : ~(0xffffffffffffffffULL >> bits));
+			const uint64_t lm = (bits <= 64) ? 0 : ((bits >= 128) ? 0xffffffffffffffffULL : ~(0xffffffffffffffffULL >> (bits - 64)));
+			_v6.push_back(std::pair<_U128,_U128>(_U128(a.first & hm,a.second & lm),_U128(a.first | ~hm,a.second | ~lm)));
+		}
+	}
+
+	/**
+	 * Sort and merge networks added since the last build
+	 */
+	inline void build()
+	{
+		_merge(_v4);
+		_merge(_v6);
+	}
+
+	/**
+	 * @param ip IP address (port/netmask is ignored)
+	 * @return True if this address is within any network in this set
+	 */
+	inline bool contains(const InetAddress &ip) const
+	{
+		if (ip.ss_family == AF_INET)
+			return _find(_v4,Utils::ntoh((uint32_t)reinterpret_cast<const struct sockaddr_in *>(&ip)->sin_addr.s_addr));
+		else if (ip.ss_family == AF_INET6)
+			return _find(_v6,_v6Key(ip));
+		return false;
+	}
+
+	/**
+	 * @return True if set contains no networks
+	 */
+	inline bool empty() const { return ((_v4.empty())&&(_v6.empty())); }
+
+	/**
+	 * @return Number of disjoint address ranges after build()
+	 */
+	inline unsigned long ranges() const { return (unsigned long)(_v4.size() + _v6.size()); }
+
+	inline void clear()
+	{
+		_v4.clear();
+		_v6.clear();
+	}
+
+private:
+	typedef std::pair<uint64_t,uint64_t> _U128; // high, low
+
+	static inline _U128 _v6Key(const InetAddress &ip)
+	{
+		const uint8_t *const b = reinterpret_cast<const uint8_t *>(reinterpret_cast<const struct sockaddr_in6 *>(&ip)->sin6_addr.s6_addr);
+		uint64_t h = 0,l = 0;
+		for(unsigned int i=0;i<8;++i) {
+			h = (h << 8) | (uint64_t)b[i];
+			l = (l << 8) | (uint64_t)b[i + 8];
+		}
+		return _U128(h,l);
+	}
+
+	static inline bool _isMax(uint32_t k) { return (k == 0xffffffffU); }
+	static inline bool _isMax(const _U128 &k) { return ((k.first == 0xffffffffffffffffULL)&&(k.second == 0xffffffffffffffffULL)); }
+	static inline uint32_t _next(uint32_t k) { return k + 1; }
+	static inline _U128 _next(const _U128 &k) { return (k.second == 0xffffffffffffffffULL) ? _U128(k.first + 1,0) : _U128(k.first,k.second + 1); }
+
+	template<typename K>
+	static inline void _merge(std::vector< std::pair<K,K> > &r)
+	{
+		if (r.size() < 2)
+			return;
+		std::sort(r.begin(),r.end());
+		typename std::vector< std::pair<K,K> >::iterator w(r.begin());
+		for(typename std::vector< std::pair<K,K> >::iterator i(r.begin()+1);i!=r.end();++i) {
+			// Ranges that overlap or touch become one
+			if ((_isMax(w->second))||(i->first <= _next(w->second))) {
+				if (w->second < i->second)
+					w->second = i->second;
+			} else {
+				*(++w) = *i;
+			}
+		}
+		r.erase(w + 1,r.end());
+	}
+
+	template<typename K>
+	static inline bool _find(const std::vector< std::pair<K,K> > &r,const K &k)
+	{
+		// Find the last range starting at or below k and see if it reaches k
+		typename std::vector< std::pair<K,K> >::const_iterator i(std::upper_bound(r.begin(),r.end(),k,_StartsAfter<K>()));
+		if (i == r.begin())
+			return false;
+		return (k <= (--i)->second);
+	}
+
+	template<typename K>
+	struct _StartsAfter
+	{
+		inline bool operator()(const K &k,const std::pair<K,K> &r) const { return (k < r.first); }
+	};
+
+	std::vector< std::pair<uint32_t,uint32_t> > _v4;
+	std::vector< std::pair<_U128,_U128> > _v6;
+};
+
+} // namespace ZeroTier
+
+#endif
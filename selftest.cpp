@@ -42,7 +42,12 @@
 #include "node/SHA512.hpp"
 #include "node/C25519.hpp"
 #include "node/Poly1305.hpp"
+#include "node/AES.hpp"
 #include "node/CertificateOfMembership.hpp"
+#include "node/SignatureBatch.hpp"
+#include "node/SignatureCache.hpp"
+#include "node/PeerKeyCache.hpp"
+#include "node/CPU.hpp"
 #include "node/Node.hpp"
 #include "node/IncomingPacket.hpp"
 
@@ -51,6 +56,7 @@
 #include "osdep/Http.hpp"
 #include "osdep/PortMapper.hpp"
 #include "osdep/Thread.hpp"
+#include "osdep/PrefixSet.hpp"
 
 #include "controller/JSONDB.hpp"
 
@@ -84,6 +90,28 @@ static const unsigned char poly1305TV1Tag[16] = { 0xa6,0xf7,0x45,0x00,0x8f,0x81,
 static const char *sha512TV0Input = "supercalifragilisticexpealidocious";
 static const unsigned char sha512TV0Digest[64] = { 0x18,0x2a,0x85,0x59,0x69,0xe5,0xd3,0xe6,0xcb,0xf6,0x05,0x24,0xad,0xf2,0x88,0xd1,0xbb,0xf2,0x52,0x92,0x81,0x24,0x31,0xf6,0xd2,0x52,0xf1,0xdb,0xc1,0xcb,0x44,0xdf,0x21,0x57,0x3d,0xe1,0xb0,0x6b,0x68,0x75,0x95,0x9f,0x3b,0x6f,0x87,0xb1,0x13,0x81,0xd0,0xbc,0x79,0x2c,0x43,0x3a,0x13,0x55,0x3c,0xe0,0x84,0xc2,0x92,0x55,0x31,0x1c };
 
+static const unsigned char aes256TV0Key[32] = { 0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f,0x10,0x11,0x12,0x13,0x14,0x15,0x16,0x17,0x18,0x19,0x1a,0x1b,0x1c,0x1d,0x1e,0x1f };
+static const unsigned char aes256TV0In[16] = { 0x00,0x11,0x22,0x33,0x44,0x55,0x66,0x77,0x88,0x99,0xaa,0xbb,0xcc,0xdd,0xee,0xff };
+static const unsigned char aes256TV0Out[16] = { 0x8e,0xa2,0xb7,0xca,0x51,0x67,0x45,0xbf,0xea,0xfc,0x49,0x90,0x4b,0x49,0x60,0x89 };
+
+// AES-256-GCM test cases 13-16 from McGrew and Viega, "The Galois/Counter Mode of Operation (GCM)"
+#define ZT_NUM_AES_GCM_TEST_VECTORS 4
+struct AesGcmTestVector
+{
+	const char *key;
+	const char *iv;
+	const char *aad;
+	const char *pt;
+	const char *ct;
+	const char *tag;
+};
+static const AesGcmTestVector AES_GCM_TEST_VECTORS[ZT_NUM_AES_GCM_TEST_VECTORS] = {
+	{ "0000000000000000000000000000000000000000000000000000000000000000","000000000000000000000000","","","","530f8afbc74536b9a963b4f1c4cb738b" },
+	{ "0000000000000000000000000000000000000000000000000000000000000000","000000000000000000000000","","00000000000000000000000000000000","cea7403d4d606b6e074ec5d3baf39d18","d0d1c8a799996bf0265b98b5d48ab919" },
+	{ "feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308","cafebabefacedbaddecaf888","","d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255","522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662898015ad","b094dac5d93471bdec1a502270e3cc6c" },
+	{ "feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308","cafebabefacedbaddecaf888","feedfacedeadbeeffeedfacedeadbeefabaddad2","d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39","522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662","76fc6ece0f4e1768cddf8853bb2d551b" }
+};
+
 struct C25519TestVector
 {
 	unsigned char pub1[64];
@@ -136,11 +164,24 @@ static const C25519TestVector C25519_TEST_VECTORS[ZT_NUM_C25519_TEST_VECTORS] =
 
 static unsigned char fuzzbuf[1048576];
 
+// CPU cycle counter for benchmarks, or 0 where there isn't one
+static inline uint64_t _cycles()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	return (uint64_t)__builtin_ia32_rdtsc();
+#else
+	return 0;
+#endif
+}
+
 static int testCrypto()
 {
 	unsigned char buf1[16384];
 	unsigned char buf2[sizeof(buf1)],buf3[sizeof(buf1)];
 
+	std::cout << "[crypto] CPU features: " << CPU::featureNames() << std::endl;
+	std::cout << "[crypto] Implementations: salsa20=" << Salsa20::implementation() << " poly1305=" << Poly1305::implementation() << " aes=" << AES::implementationName(AES::best()) << " sha512=generic c25519=generic" << std::endl;
+
 	for(int i=0;i<3;++i) {
 		Utils::getSecureRandom(buf1,64);
 		std::cout << "[crypto] getSecureRandom: " << Utils::hex(buf1,64) << std::endl;
@@ -180,6 +221,49 @@ static int testCrypto()
 	}
 	std::cout << "PASS" << std::endl;
 
+	std::cout << "[crypto] Testing Salsa20/12 multi-buffer (" << Salsa20::parallelism() << " in parallel)... "; std::cout.flush();
+	{
+		// Messages of mixed and equal lengths, each encrypted twice in a row to check the stream position carries over
+		unsigned char *mb = (unsigned char *)::malloc(40 * 3000 * 3);
+		for(unsigned int k=0;k<200;++k) {
+			const unsigned int count = 1 + (k % 40);
+			Salsa20 s1[40],s2[40];
+			Salsa20 *sp[40];
+			const void *in[40];
+			void *out[40];
+			unsigned int len[40];
+			for(unsigned int i=0;i<count;++i) {
+				unsigned char key[32],iv[8];
+				Utils::getSecureRandom(key,sizeof(key));
+				Utils::getSecureRandom(iv,sizeof(iv));
+				s1[i].init(key,256,iv);
+				s2[i].init(key,256,iv);
+				sp[i] = &(s2[i]);
+				len[i] = ((k & 1) ? 1400 : (unsigned int)(rand() % 3000));
+			}
+			for(unsigned int pass=0;pass<2;++pass) {
+				for(unsigned int i=0;i<count;++i) {
+					unsigned char *const p = mb + (i * 9000);
+					for(unsigned int j=0;j<len[i];++j)
+						p[j] = (unsigned char)rand();
+					s1[i].crypt12(p,p + 3000,len[i]);
+					in[i] = p;
+					out[i] = ((pass == 0) ? (p + 6000) : p); // second pass is in place
+				}
+				Salsa20::crypt12Many(sp,in,out,len,count);
+				for(unsigned int i=0;i<count;++i) {
+					unsigned char *const p = mb + (i * 9000);
+					if (memcmp(p + 3000,out[i],len[i])) {
+						std::cout << "FAIL (message " << i << " of " << count << ", " << len[i] << " bytes, pass " << pass << ")" << std::endl;
+						return -1;
+					}
+				}
+			}
+		}
+		::free((void *)mb);
+	}
+	std::cout << "PASS" << std::endl;
+
 #ifdef ZT_SALSA20_SSE
 	std::cout << "[crypto] Salsa20 SSE: ENABLED" << std::endl;
 #else
@@ -204,6 +288,41 @@ static int testCrypto()
 		::free((void *)bb);
 	}
 
+	std::cout << "[crypto] Benchmarking Salsa20/12 on 1400-byte messages... "; std::cout.flush();
+	{
+		unsigned char *bb = (unsigned char *)::malloc(1400 * ZT_SALSA20_MAX_PARALLEL);
+		memset(bb,0,1400 * ZT_SALSA20_MAX_PARALLEL);
+		Salsa20 s20s[ZT_SALSA20_MAX_PARALLEL];
+		Salsa20 *sp[ZT_SALSA20_MAX_PARALLEL];
+		const void *in[ZT_SALSA20_MAX_PARALLEL];
+		void *out[ZT_SALSA20_MAX_PARALLEL];
+		unsigned int len[ZT_SALSA20_MAX_PARALLEL];
+		for(unsigned int i=0;i<ZT_SALSA20_MAX_PARALLEL;++i) {
+			sp[i] = &(s20s[i]);
+			in[i] = out[i] = bb + (i * 1400);
+			len[i] = 1400;
+		}
+		for(unsigned int many=0;many<2;++many) {
+			double bytes = 0.0;
+			uint64_t start = OSUtils::now();
+			for(unsigned int k=0;k<20000;++k) {
+				for(unsigned int i=0;i<ZT_SALSA20_MAX_PARALLEL;++i)
+					s20s[i].init(s20TV0Key,256,bb + (i * 1400)); // new key stream for every message, as with packets
+				if (many) {
+					Salsa20::crypt12Many(sp,in,out,len,ZT_SALSA20_MAX_PARALLEL);
+				} else {
+					for(unsigned int i=0;i<ZT_SALSA20_MAX_PARALLEL;++i)
+						s20s[i].crypt12(in[i],out[i],1400);
+				}
+				bytes += 1400.0 * (double)ZT_SALSA20_MAX_PARALLEL;
+			}
+			uint64_t end = OSUtils::now();
+			std::cout << (many ? "crypt12Many(): " : "crypt12(): ") << ((bytes / 1048576.0) / ((double)(end - start) / 1000.0)) << " MiB/second" << (many ? "" : ", ");
+		}
+		std::cout << std::endl;
+		::free((void *)bb);
+	}
+
 	std::cout << "[crypto] Benchmarking Salsa20/20... "; std::cout.flush();
 	{
 		unsigned char *bb = (unsigned char *)::malloc(1234567);
@@ -241,6 +360,41 @@ static int testCrypto()
 		std::cout << "FAIL (2)" << std::endl;
 		return -1;
 	}
+	Poly1305::computeGeneric(buf1,poly1305TV0Input,sizeof(poly1305TV0Input),poly1305TV0Key);
+	if (memcmp(buf1,poly1305TV0Tag,16)) {
+		std::cout << "FAIL (3)" << std::endl;
+		return -1;
+	}
+	Poly1305::computeGeneric(buf1,poly1305TV1Input,sizeof(poly1305TV1Input),poly1305TV1Key);
+	if (memcmp(buf1,poly1305TV1Tag,16)) {
+		std::cout << "FAIL (4)" << std::endl;
+		return -1;
+	}
+	std::cout << "PASS" << std::endl;
+
+	std::cout << "[crypto] Testing Poly1305 " << Poly1305::implementation() << " against generic... "; std::cout.flush();
+	{
+		unsigned char *bb = (unsigned char *)::malloc(4096);
+		unsigned char key[32];
+		for(unsigned int len=0;len<=2200;++len) {
+			for(unsigned int k=0;k<4;++k) {
+				// Also try all-ones keys and messages, which push limbs and carries to their limits
+				for(unsigned int i=0;i<32;++i)
+					key[i] = ((k == 3) ? 0xff : (unsigned char)rand());
+				for(unsigned int i=0;i<len + 1;++i)
+					bb[i] = ((k >= 2) ? 0xff : (unsigned char)rand());
+				// Offset by one byte on odd lengths to test unaligned input
+				const unsigned char *const m = bb + (len & 1);
+				Poly1305::compute(buf1,m,len,key);
+				Poly1305::computeGeneric(buf2,m,len,key);
+				if (memcmp(buf1,buf2,16)) {
+					std::cout << "FAIL (" << len << " bytes, " << k << ")" << std::endl;
+					return -1;
+				}
+			}
+		}
+		::free((void *)bb);
+	}
 	std::cout << "PASS" << std::endl;
 
 	std::cout << "[crypto] Benchmarking Poly1305... "; std::cout.flush();
@@ -248,14 +402,130 @@ static int testCrypto()
 		unsigned char *bb = (unsigned char *)::malloc(1234567);
 		for(unsigned int i=0;i<1234567;++i)
 			bb[i] = (unsigned char)i;
-		double bytes = 0.0;
-		uint64_t start = OSUtils::now();
-		for(unsigned int i=0;i<200;++i) {
-			Poly1305::compute(buf1,bb,1234567,poly1305TV0Key);
-			bytes += 1234567.0;
+		for(unsigned int generic=0;generic<2;++generic) {
+			double bytes = 0.0;
+			uint64_t start = OSUtils::now();
+			for(unsigned int i=0;i<200;++i) {
+				if (generic)
+					Poly1305::computeGeneric(buf1,bb,1234567,poly1305TV0Key);
+				else Poly1305::compute(buf1,bb,1234567,poly1305TV0Key);
+				bytes += 1234567.0;
+			}
+			uint64_t end = OSUtils::now();
+			std::cout << (generic ? "generic: " : "compute(): ") << ((bytes / 1048576.0) / ((double)(end - start) / 1000.0)) << " MiB/second" << (generic ? "" : ", ");
+		}
+		std::cout << std::endl;
+
+		std::cout << "[crypto] Benchmarking Poly1305 on 1400-byte messages... "; std::cout.flush();
+		for(unsigned int generic=0;generic<2;++generic) {
+			double bytes = 0.0;
+			uint64_t start = OSUtils::now();
+			for(unsigned int i=0;i<200000;++i) {
+				if (generic)
+					Poly1305::computeGeneric(buf1,bb + ((i & 511) * 1400),1400,poly1305TV0Key);
+				else Poly1305::compute(buf1,bb + ((i & 511) * 1400),1400,poly1305TV0Key);
+				bytes += 1400.0;
+			}
+			uint64_t end = OSUtils::now();
+			std::cout << (generic ? "generic: " : "compute(): ") << ((bytes / 1048576.0) / ((double)(end - start) / 1000.0)) << " MiB/second" << (generic ? "" : ", ");
+		}
+		std::cout << std::endl;
+		::free((void *)bb);
+	}
+
+	std::cout << "[crypto] Testing AES-256 and AES-256-GCM against test vectors... "; std::cout.flush();
+	for(int impl=(int)AES::IMPL_GENERIC;impl<=(int)AES::best();++impl) {
+		AES aes;
+		aes.init(aes256TV0Key,(AES::Implementation)impl);
+		aes.encrypt(aes256TV0In,buf1);
+		if (memcmp(buf1,aes256TV0Out,16)) {
+			std::cout << "FAIL (" << AES::implementationName((AES::Implementation)impl) << ", block)" << std::endl;
+			return -1;
+		}
+		for(int k=0;k<ZT_NUM_AES_GCM_TEST_VECTORS;++k) {
+			const AesGcmTestVector &tv = AES_GCM_TEST_VECTORS[k];
+			const std::string key(Utils::unhex(tv.key)),iv(Utils::unhex(tv.iv)),aad(Utils::unhex(tv.aad)),pt(Utils::unhex(tv.pt)),ct(Utils::unhex(tv.ct)),tag(Utils::unhex(tv.tag));
+			aes.init(key.data(),(AES::Implementation)impl);
+			aes.gcmEncrypt(iv.data(),aad.data(),(unsigned int)aad.length(),pt.data(),buf1,(unsigned int)pt.length(),buf2);
+			if ((memcmp(buf1,ct.data(),ct.length()))||(memcmp(buf2,tag.data(),16))) {
+				std::cout << "FAIL (" << AES::implementationName((AES::Implementation)impl) << ", encrypt " << k << ")" << std::endl;
+				return -1;
+			}
+			if ((!aes.gcmDecrypt(iv.data(),aad.data(),(unsigned int)aad.length(),buf1,buf1,(unsigned int)ct.length(),tag.data(),16))||(memcmp(buf1,pt.data(),pt.length()))) {
+				std::cout << "FAIL (" << AES::implementationName((AES::Implementation)impl) << ", decrypt " << k << ")" << std::endl;
+				return -1;
+			}
+		}
+	}
+	std::cout << "PASS" << std::endl;
+
+	std::cout << "[crypto] Testing AES-256-GCM " << AES::implementationName(AES::best()) << " against generic... "; std::cout.flush();
+	{
+		unsigned char *bb = (unsigned char *)::malloc(8192);
+		unsigned char *c1 = (unsigned char *)::malloc(8192);
+		unsigned char *c2 = (unsigned char *)::malloc(8192);
+		unsigned char key[32],iv[12],aad[48],tag1[16],tag2[16];
+		for(int impl=(int)AES::IMPL_AESNI;impl<=(int)AES::best();++impl) {
+			for(unsigned int k=0;k<3000;++k) {
+				// Every length up to a few hundred bytes, then random lengths up to 8K
+				const unsigned int len = (k < 600) ? k : (unsigned int)(rand() % 8191);
+				const unsigned int aadLen = (unsigned int)(rand() % sizeof(aad));
+				Utils::getSecureRandom(key,32);
+				Utils::getSecureRandom(iv,12);
+				Utils::getSecureRandom(aad,sizeof(aad));
+				Utils::getSecureRandom(bb,len + 1);
+				// Offset by one byte on odd lengths to test unaligned input
+				const unsigned char *const m = bb + (len & 1);
+				AES generic,fast;
+				generic.init(key,AES::IMPL_GENERIC);
+				fast.init(key,(AES::Implementation)impl);
+				generic.gcmEncrypt(iv,aad,aadLen,m,c1,len,tag1);
+				fast.gcmEncrypt(iv,aad,aadLen,m,c2,len,tag2);
+				if ((memcmp(c1,c2,len))||(memcmp(tag1,tag2,16))) {
+					std::cout << "FAIL (" << AES::implementationName((AES::Implementation)impl) << " encrypt, " << len << " bytes)" << std::endl;
+					return -1;
+				}
+				if ((!fast.gcmDecrypt(iv,aad,aadLen,c2,c2,len,tag1,16))||(memcmp(c2,m,len))) {
+					std::cout << "FAIL (" << AES::implementationName((AES::Implementation)impl) << " decrypt, " << len << " bytes)" << std::endl;
+					return -1;
+				}
+				if (len) {
+					memcpy(c2,c1,len);
+					c2[len - 1] ^= 0x01;
+					memcpy(bb,c2,len);
+					if ((fast.gcmDecrypt(iv,aad,aadLen,c2,c2,len,tag1,16))||(memcmp(c2,bb,len))) {
+						std::cout << "FAIL (" << AES::implementationName((AES::Implementation)impl) << " accepted or modified corrupt message, " << len << " bytes)" << std::endl;
+						return -1;
+					}
+				}
+			}
+		}
+		::free((void *)bb);
+		::free((void *)c1);
+		::free((void *)c2);
+	}
+	std::cout << "PASS" << std::endl;
+
+	std::cout << "[crypto] Benchmarking AES-256-GCM on 1400-byte messages..." << std::endl;
+	{
+		unsigned char *bb = (unsigned char *)::malloc(1400);
+		memset(bb,0,1400);
+		unsigned char iv[12];
+		memset(iv,0,12);
+		for(int impl=(int)AES::best();impl>=(int)AES::IMPL_GENERIC;--impl) {
+			AES aes;
+			aes.init(aes256TV0Key,(AES::Implementation)impl);
+			const unsigned int iters = (impl == (int)AES::IMPL_GENERIC) ? 2000 : 200000;
+			double bytes = 0.0;
+			uint64_t start = OSUtils::now();
+			for(unsigned int i=0;i<iters;++i) {
+				iv[0] = (unsigned char)i;
+				aes.gcmEncrypt(iv,(const void *)0,0,bb,bb,1400,buf1);
+				bytes += 1400.0;
+			}
+			uint64_t end = OSUtils::now();
+			std::cout << "[crypto]   " << AES::implementationName((AES::Implementation)impl) << ": " << ((bytes / 1048576.0) / ((double)((end > start) ? (end - start) : 1) / 1000.0)) << " MiB/second" << std::endl;
 		}
-		uint64_t end = OSUtils::now();
-		std::cout << ((bytes / 1048576.0) / ((double)(end - start) / 1000.0)) << " MiB/second" << std::endl;
 		::free((void *)bb);
 	}
 
@@ -373,6 +643,98 @@ static int testCrypto()
 	}
 	std::cout << "PASS" << std::endl;
 
+	std::cout << "[crypto] Testing Ed25519 batch verification... "; std::cout.flush();
+	{
+		// More than ZT_C25519_BATCH_MAX signatures from a few keys, so some keys repeat and the input is split
+		const unsigned int n = ZT_C25519_BATCH_MAX + 13;
+		C25519::Pair bkeys[5];
+		for(unsigned int k=0;k<5;++k)
+			bkeys[k] = C25519::generate();
+		std::vector<C25519::Signature> bsigs(n);
+		std::vector<std::string> bmsgs(n);
+		std::vector<const C25519::Public *> bpubs(n);
+		std::vector<const void *> bmp(n),bsp(n);
+		std::vector<unsigned int> blens(n);
+		bool *const bok = new bool[n];
+		for(unsigned int i=0;i<n;++i) {
+			bmsgs[i].resize(1 + (rand() % 200));
+			for(unsigned int k=0;k<bmsgs[i].size();++k)
+				bmsgs[i][k] = (char)rand();
+			bpubs[i] = &(bkeys[(i < 7) ? (i % 5) : (i % 3)].pub);
+			bsigs[i] = C25519::sign(bkeys[(i < 7) ? (i % 5) : (i % 3)],bmsgs[i].data(),(unsigned int)bmsgs[i].size());
+			bmp[i] = bmsgs[i].data();
+			bsp[i] = bsigs[i].data;
+			blens[i] = (unsigned int)bmsgs[i].size();
+		}
+		if ((!C25519::verifyBatch(&(bpubs[0]),&(bmp[0]),&(blens[0]),&(bsp[0]),bok,n))||(!C25519::verifyBatch(&(bpubs[0]),&(bmp[0]),&(blens[0]),&(bsp[0]),bok,1))) {
+			std::cout << "FAIL (1)" << std::endl;
+			return -1;
+		}
+		for(unsigned int i=0;i<n;++i) {
+			if (!bok[i]) {
+				std::cout << "FAIL (2)" << std::endl;
+				return -1;
+			}
+		}
+
+		// Corrupt some signatures, keys, and messages; every result must match verify()
+		for(unsigned int t=0;t<16;++t) {
+			std::vector<C25519::Signature> bad(bsigs);
+			std::vector<std::string> badMsgs(bmsgs);
+			for(unsigned int i=0;i<n;++i) {
+				bsp[i] = bad[i].data;
+				bmp[i] = badMsgs[i].data();
+				bpubs[i] = &(bkeys[(i < 7) ? (i % 5) : (i % 3)].pub);
+			}
+			const unsigned int nbad = 1 + (rand() % 3);
+			for(unsigned int b=0;b<nbad;++b) {
+				const unsigned int i = (unsigned int)rand() % n;
+				switch(rand() % 3) {
+					case 0: bad[i].data[rand() % bad[i].size()] ^= (unsigned char)(1 << (rand() & 7)); break;
+					case 1: badMsgs[i][rand() % badMsgs[i].size()] ^= 1; break;
+					case 2: bpubs[i] = &(bkeys[4].pub); break;
+				}
+			}
+			const bool all = C25519::verifyBatch(&(bpubs[0]),&(bmp[0]),&(blens[0]),&(bsp[0]),bok,n);
+			bool allExpected = true;
+			for(unsigned int i=0;i<n;++i) {
+				const bool expected = C25519::verify(*(bpubs[i]),bmp[i],blens[i],bsp[i]);
+				allExpected &= expected;
+				if (bok[i] != expected) {
+					std::cout << "FAIL (3)" << std::endl;
+					return -1;
+				}
+			}
+			if (all != allExpected) {
+				std::cout << "FAIL (4)" << std::endl;
+				return -1;
+			}
+		}
+		std::cout << "PASS" << std::endl;
+
+		std::cout << "[crypto] Benchmarking Ed25519 verify() vs. verifyBatch()... "; std::cout.flush();
+		for(unsigned int i=0;i<n;++i) {
+			bmp[i] = bmsgs[i].data();
+			bsp[i] = bsigs[i].data;
+			bpubs[i] = &(bkeys[(i < 7) ? (i % 5) : (i % 3)].pub);
+		}
+		uint64_t bst = OSUtils::now();
+		for(unsigned int r=0;r<4;++r) {
+			for(unsigned int i=0;i<ZT_C25519_BATCH_MAX;++i)
+				C25519::verify(*(bpubs[i]),bmp[i],blens[i],bsp[i]);
+		}
+		uint64_t bet = OSUtils::now();
+		const double perOne = (double)(bet - bst) / (4.0 * (double)ZT_C25519_BATCH_MAX);
+		bst = OSUtils::now();
+		for(unsigned int r=0;r<4;++r)
+			C25519::verifyBatch(&(bpubs[0]),&(bmp[0]),&(blens[0]),&(bsp[0]),bok,ZT_C25519_BATCH_MAX);
+		bet = OSUtils::now();
+		const double perBatched = (double)(bet - bst) / (4.0 * (double)ZT_C25519_BATCH_MAX);
+		std::cout << perOne << "ms vs. " << perBatched << "ms per signature (" << ZT_C25519_BATCH_MAX << " signatures, 3 keys)" << std::endl;
+
+		delete [] bok;
+	}
+
 	return 0;
 }
 
@@ -474,6 +836,54 @@ static int testIdentity()
 		}
 	}
 
+	{
+		std::cout << "[identity] Testing PeerKeyCache... "; std::cout.flush();
+		Identity other,stranger;
+		other.generate();
+		stranger.generate();
+		uint8_t key[ZT_PEER_SECRET_KEY_LENGTH],key2[ZT_PEER_SECRET_KEY_LENGTH];
+		if (!id.agree(other,key,ZT_PEER_SECRET_KEY_LENGTH)) {
+			std::cout << "FAIL (agree)" << std::endl;
+			return -1;
+		}
+		PeerKeyCache pkc(id);
+		std::string sealed(pkc.seal(other,key));
+		if ((sealed.length() != ZT_PEER_KEY_CACHE_SEALED_LENGTH)||(!pkc.open(other,sealed,key2))||(memcmp(key,key2,sizeof(key)))) {
+			std::cout << "FAIL (open)" << std::endl;
+			return -1;
+		}
+		if (pkc.open(stranger,sealed,key2)) {
+			std::cout << "FAIL (opened for wrong peer)" << std::endl;
+			return -1;
+		}
+		PeerKeyCache pkc2(other);
+		if (pkc2.open(other,sealed,key2)) {
+			std::cout << "FAIL (opened with wrong identity)" << std::endl;
+			return -1;
+		}
+		for(unsigned int i=0;i<(unsigned int)sealed.length();++i) {
+			std::string bad(sealed);
+			bad[i] ^= 0x01;
+			if (pkc.open(other,bad,key2)) {
+				std::cout << "FAIL (opened altered key, byte " << i << ")" << std::endl;
+				return -1;
+			}
+		}
+		std::cout << "PASS" << std::endl;
+
+		std::cout << "[identity] Benchmarking peer key agreement vs. PeerKeyCache (warm start)... "; std::cout.flush();
+		uint64_t st = OSUtils::now();
+		for(unsigned int i=0;i<100;++i)
+			id.agree(other,key,ZT_PEER_SECRET_KEY_LENGTH);
+		uint64_t et = OSUtils::now();
+		const double agreeMs = (double)(et - st) / 100.0;
+		st = OSUtils::now();
+		for(unsigned int i=0;i<10000;++i)
+			pkc.open(other,sealed,key);
+		et = OSUtils::now();
+		std::cout << agreeMs << "ms vs. " << ((double)(et - st) / 10000.0) << "ms per peer" << std::endl;
+	}
+
 	return 0;
 }
 
@@ -536,6 +946,79 @@ static int testCertificate()
 		return -1;
 	}
 
+	std::cout << "[certificate] Checking credential signatures with SignatureBatch... "; std::cout.flush();
+	{
+		char msgs[8][64];
+		C25519::Signature msgSigs[8];
+		for(unsigned int i=0;i<8;++i) {
+			Utils::getSecureRandom(msgs[i],sizeof(msgs[i]));
+			msgSigs[i] = authority.sign(msgs[i],sizeof(msgs[i]));
+		}
+		const C25519::Signature forged(idB.sign(msgs[5],sizeof(msgs[5])));
+
+		SignatureBatch sigs;
+		bool ok = true;
+		for(unsigned int i=0;i<8;++i)
+			ok &= (sigs.check(authority.publicKey(),msgs[i],sizeof(msgs[i]),msgSigs[i]) == 2);
+		ok &= (sigs.check(authority.publicKey(),msgs[5],sizeof(msgs[5]),forged) == 2);
+		ok &= (sigs.check(authority.publicKey(),msgs[3],sizeof(msgs[3]),msgSigs[3]) == 2); // same signature is only queued once
+		ok &= (sigs.pending() == 9);
+		ok &= (sigs.verify() == 9);
+		ok &= (sigs.pending() == 0);
+		for(unsigned int i=0;i<8;++i)
+			ok &= (sigs.check(authority.publicKey(),msgs[i],sizeof(msgs[i]),msgSigs[i]) == 0);
+		ok &= (sigs.check(authority.publicKey(),msgs[5],sizeof(msgs[5]),forged) == -1);
+		if (!ok) {
+			std::cout << "FAIL" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+
+		std::cout << "[certificate] Testing SignatureCache... "; std::cout.flush();
+		SignatureCache cache;
+		for(unsigned int i=0;i<8;++i)
+			ok &= (cache.verify(authority.publicKey(),msgs[i],sizeof(msgs[i]),msgSigs[i]) == 0);
+		ok &= ((cache.hits() == 0)&&(cache.misses() == 8));
+		for(unsigned int i=0;i<8;++i)
+			ok &= (cache.verify(authority.publicKey(),msgs[i],sizeof(msgs[i]),msgSigs[i]) == 0);
+		ok &= ((cache.hits() == 8)&&(cache.misses() == 8));
+		for(unsigned int i=0;i<2;++i) // invalid signatures are never remembered
+			ok &= (cache.verify(authority.publicKey(),msgs[5],sizeof(msgs[5]),forged) == -1);
+		ok &= (cache.verify(idB.publicKey(),msgs[5],sizeof(msgs[5]),msgSigs[5]) == -1);
+		msgs[2][7] ^= 1;
+		ok &= (cache.verify(authority.publicKey(),msgs[2],sizeof(msgs[2]),msgSigs[2]) == -1);
+		msgs[2][7] ^= 1;
+		ok &= ((cache.hits() == 8)&&(cache.misses() == 12));
+
+		// Cached signatures skip the batch, and batch results are cached once verified
+		SignatureBatch sigs2;
+		const C25519::Signature extra(authority.sign(msgs[0],sizeof(msgs[0]) - 1));
+		ok &= (cache.verify(authority.publicKey(),msgs[1],sizeof(msgs[1]),msgSigs[1],&sigs2) == 0);
+		ok &= (cache.verify(authority.publicKey(),msgs[0],sizeof(msgs[0]) - 1,extra,&sigs2) == 2);
+		ok &= (sigs2.pending() == 1);
+		sigs2.verify();
+		ok &= (cache.verify(authority.publicKey(),msgs[0],sizeof(msgs[0]) - 1,extra,&sigs2) == 0);
+		ok &= (cache.verify(authority.publicKey(),msgs[0],sizeof(msgs[0]) - 1,extra) == 0);
+		ok &= ((cache.hits() == 10)&&(cache.misses() == 13));
+		if (!ok) {
+			std::cout << "FAIL" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+
+		std::cout << "[certificate] Benchmarking SignatureCache hits vs. verify()... "; std::cout.flush();
+		uint64_t st = OSUtils::now();
+		for(unsigned int i=0;i<64;++i)
+			authority.verify(msgs[i & 7],sizeof(msgs[i & 7]),msgSigs[i & 7]);
+		uint64_t et = OSUtils::now();
+		const double perVerify = (double)(et - st) / 64.0;
+		st = OSUtils::now();
+		for(unsigned int i=0;i<100000;++i)
+			cache.verify(authority.publicKey(),msgs[i & 7],sizeof(msgs[i & 7]),msgSigs[i & 7]);
+		et = OSUtils::now();
+		std::cout << perVerify << "ms vs. " << ((double)(et - st) / 100000.0) << "ms per check" << std::endl;
+	}
+
 	return 0;
 }
 
@@ -579,6 +1062,253 @@ static int testPacket()
 	}
 
 	std::cout << "PASS" << std::endl;
+
+	std::cout << "[packet] Testing armorMany()/dearmorMany()... "; std::cout.flush();
+	{
+		std::vector<Packet> single(37),many(37);
+		Packet *mp[37];
+		unsigned char keys[37][32];
+		const void *kp[37];
+		unsigned int counters[37];
+		bool ok[37];
+		for(int mode=0;mode<3;++mode) {
+			// 0: MAC only, 1: Salsa20/12, 2: AES-GCM for the first 18 and Salsa20/12 for the rest
+			const bool encrypt = (mode != 0);
+			for(unsigned int i=0;i<37;++i) {
+				Utils::getSecureRandom(keys[i],32);
+				kp[i] = keys[i];
+				counters[i] = (unsigned int)rand();
+				single[i].reset(Address(),Address(),Packet::VERB_FRAME);
+				const unsigned int plen = (unsigned int)(rand() % 1400);
+				for(unsigned int j=0;j<plen;++j)
+					single[i].append((uint8_t)rand());
+				many[i] = single[i];
+				mp[i] = &(many[i]);
+				single[i].armor(keys[i],encrypt,counters[i],((mode == 2)&&(i < 18)));
+			}
+			if (mode == 2) {
+				Packet::armorMany(mp,kp,true,counters,18,true);
+				Packet::armorMany(mp + 18,kp + 18,true,counters + 18,19);
+			} else {
+				Packet::armorMany(mp,kp,encrypt,counters,37);
+			}
+			for(unsigned int i=0;i<37;++i) {
+				if (single[i] != many[i]) {
+					std::cout << "FAIL (armorMany() differs from armor(), packet " << i << ")" << std::endl;
+					return -1;
+				}
+			}
+			many[3][ZT_PACKET_IDX_VERB + 1] ^= 0x01; // corrupt one
+			many[5].setCipher(ZT_PROTO_CIPHER_SUITE__NO_CRYPTO_TRUSTED_PATH); // unsupported cipher suite
+			Packet::dearmorMany(mp,kp,ok,37);
+			for(unsigned int i=0;i<37;++i) {
+				const bool expected = ((i != 3)&&(i != 5));
+				if ((ok[i] != expected)||((expected)&&((!single[i].dearmor(keys[i]))||(single[i] != many[i])))) {
+					std::cout << "FAIL (dearmorMany() differs from dearmor(), packet " << i << ")" << std::endl;
+					return -1;
+				}
+			}
+		}
+	}
+	std::cout << "PASS" << std::endl;
+
+	std::cout << "[packet] Testing fused armor()/dearmor() against two-pass armorMany()/dearmorMany()... "; std::cout.flush();
+	{
+		// armorMany() and dearmorMany() encrypt and MAC in separate passes
+		unsigned char key[32];
+		bool ok = false;
+		for(unsigned int plen=0;plen<=(ZT_PROTO_MAX_PACKET_LENGTH - ZT_PACKET_IDX_PAYLOAD);++plen) {
+			Utils::getSecureRandom(key,32);
+			const void *kp = key;
+			const unsigned int counter = plen;
+			Packet a(Address(),Address(),Packet::VERB_FRAME);
+			for(unsigned int j=0;j<plen;++j)
+				a.append((uint8_t)rand());
+			Packet b(a),plain(a);
+			Packet *bp = &b;
+			a.armor(key,true,counter);
+			Packet::armorMany(&bp,&kp,true,&counter,1);
+			if (a != b) {
+				std::cout << "FAIL (armor() differs, payload " << plen << " bytes)" << std::endl;
+				return -1;
+			}
+			Packet::dearmorMany(&bp,&kp,&ok,1);
+			if ((!ok)||(!a.dearmor(key))||(a != b)||(memcmp(a.field(ZT_PACKET_IDX_VERB,plen + 1),plain.field(ZT_PACKET_IDX_VERB,plen + 1),plen + 1))) {
+				std::cout << "FAIL (dearmor() differs, payload " << plen << " bytes)" << std::endl;
+				return -1;
+			}
+			a.armor(key,true,counter);
+			b = a;
+			a[a.size() - 1] ^= 0x80;
+			b[b.size() - 1] ^= 0x80;
+			if ((a.dearmor(key))||(a != b)) {
+				std::cout << "FAIL (corrupt packet accepted or modified, payload " << plen << " bytes)" << std::endl;
+				return -1;
+			}
+		}
+	}
+	std::cout << "PASS" << std::endl;
+
+	std::cout << "[packet] Testing AES-256-GCM cipher suite negotiation between peers... "; std::cout.flush();
+	{
+		Identity idA,idB;
+		idA.generate();
+		idB.generate();
+		const RuntimeEnvironment rr((Node *)0);
+		Peer bAtA(&rr,idA,idB),aAtB(&rr,idB,idA); // B as seen by A, and A as seen by B
+
+		// Protocol 9 peers never send the flags byte
+		bAtA.setRemoteVersion(9,1,2,0,0);
+		aAtB.setRemoteVersion(10,1,2,3,ZT_PROTO_HELLO_FLAG_AES_GCM);
+		if ((bAtA.aesGcm())||(aAtB.aesGcm() != AES::hardware())) {
+			std::cout << "FAIL (negotiation with old peer)" << std::endl;
+			return -1;
+		}
+		bAtA.setRemoteVersion(10,1,2,3,0);
+		if (bAtA.aesGcm()) {
+			std::cout << "FAIL (AES-GCM used without flag)" << std::endl;
+			return -1;
+		}
+		bAtA.setRemoteVersion(10,1,2,3,ZT_PROTO_HELLO_FLAG_AES_GCM);
+		if (bAtA.aesGcm() != AES::hardware()) {
+			std::cout << "FAIL (negotiation with new peer)" << std::endl;
+			return -1;
+		}
+
+		for(unsigned int plen=0;plen<=(ZT_PROTO_MAX_PACKET_LENGTH - ZT_PACKET_IDX_PAYLOAD);plen+=7) {
+			Packet a(idB.address(),idA.address(),Packet::VERB_FRAME);
+			for(unsigned int j=0;j<plen;++j)
+				a.append((uint8_t)rand());
+			const Packet plain(a);
+			a.armor(bAtA.key(),true,plen,true);
+			if ((a.cipher() != ZT_PROTO_CIPHER_SUITE__C25519_AES256_GCM)||(!memcmp(a.field(ZT_PACKET_IDX_VERB,plen + 1),plain.field(ZT_PACKET_IDX_VERB,plen + 1),plen + 1))) {
+				std::cout << "FAIL (not encrypted, payload " << plen << " bytes)" << std::endl;
+				return -1;
+			}
+			Packet b(a);
+			b[ZT_PACKET_IDX_VERB + (plen / 2)] ^= 0x04;
+			const Packet corrupt(b);
+			if ((b.dearmor(aAtB.key()))||(b != corrupt)) {
+				std::cout << "FAIL (corrupt packet accepted or modified, payload " << plen << " bytes)" << std::endl;
+				return -1;
+			}
+			if ((!a.dearmor(aAtB.key()))||(memcmp(a.field(ZT_PACKET_IDX_VERB,plen + 1),plain.field(ZT_PACKET_IDX_VERB,plen + 1),plen + 1))) {
+				std::cout << "FAIL (dearmor() failed, payload " << plen << " bytes)" << std::endl;
+				return -1;
+			}
+		}
+
+		// Wrong key must be rejected
+		Packet a(idB.address(),idA.address(),Packet::VERB_FRAME);
+		a.append("supercalifragilisticexpealidocious",(unsigned int)strlen("supercalifragilisticexpealidocious"));
+		a.armor(bAtA.key(),true,0,true);
+		if (a.dearmor(salsaKey)) {
+			std::cout << "FAIL (wrong key accepted)" << std::endl;
+			return -1;
+		}
+	}
+	std::cout << "PASS" << std::endl;
+
+	std::cout << "[packet] Benchmarking fused armor()/dearmor() on 1400-byte packets..." << std::endl;
+	{
+		Packet p(Address(),Address(),Packet::VERB_FRAME);
+		p.setSize(1400);
+		Packet *pp = &p;
+		const void *kp = salsaKey;
+		const unsigned int counter = 0;
+		bool ok = false;
+		const unsigned int payloadLen = p.size() - ZT_PACKET_IDX_VERB;
+		for(unsigned int fused=0;fused<2;++fused) {
+			double bytes = 0.0;
+			uint64_t cycles = 0;
+			uint64_t start = OSUtils::now();
+			for(unsigned int k=0;k<100000;++k) {
+				const uint64_t c0 = _cycles();
+				if (fused) {
+					p.armor(salsaKey,true,counter);
+					ok = p.dearmor(salsaKey);
+				} else {
+					Packet::armorMany(&pp,&kp,true,&counter,1);
+					Packet::dearmorMany(&pp,&kp,&ok,1);
+				}
+				cycles += _cycles() - c0;
+				bytes += 2.0 * (double)payloadLen;
+			}
+			uint64_t end = OSUtils::now();
+			if (!ok) {
+				std::cout << "FAIL (dearmor() failed)" << std::endl;
+				return -1;
+			}
+			std::cout << "[packet]   " << (fused ? "fused: " : "two-pass: ") << ((bytes / 1048576.0) / ((double)(end - start) / 1000.0)) << " MiB/second";
+			if (cycles)
+				std::cout << ", " << (bytes / (double)cycles) << " bytes/cycle";
+			std::cout << std::endl;
+		}
+	}
+
+	std::cout << "[packet] Benchmarking Salsa20/12+Poly1305 vs. AES-256-GCM armor()/dearmor() on 1400-byte packets..." << std::endl;
+	{
+		Packet p(Address(),Address(),Packet::VERB_FRAME);
+		p.setSize(1400);
+		bool ok = false;
+		const unsigned int payloadLen = p.size() - ZT_PACKET_IDX_VERB;
+		for(unsigned int aes=0;aes<2;++aes) {
+			double bytes = 0.0;
+			uint64_t cycles = 0;
+			uint64_t start = OSUtils::now();
+			for(unsigned int k=0;k<100000;++k) {
+				const uint64_t c0 = _cycles();
+				p.armor(salsaKey,true,k,(aes != 0));
+				ok = p.dearmor(salsaKey);
+				cycles += _cycles() - c0;
+				bytes += 2.0 * (double)payloadLen;
+			}
+			uint64_t end = OSUtils::now();
+			if (!ok) {
+				std::cout << "FAIL (dearmor() failed)" << std::endl;
+				return -1;
+			}
+			std::cout << "[packet]   " << (aes ? "AES-256-GCM (" : "Salsa20/12+Poly1305: ");
+			if (aes)
+				std::cout << AES::implementationName(AES::best()) << "): ";
+			std::cout << ((bytes / 1048576.0) / ((double)(end - start) / 1000.0)) << " MiB/second";
+			if (cycles)
+				std::cout << ", " << (bytes / (double)cycles) << " bytes/cycle";
+			std::cout << std::endl;
+		}
+	}
+
+	std::cout << "[packet] Benchmarking armor() on 1400-byte packets... "; std::cout.flush();
+	{
+		std::vector<Packet> ps(ZT_SALSA20_MAX_PARALLEL);
+		Packet *pp[ZT_SALSA20_MAX_PARALLEL];
+		const void *kp[ZT_SALSA20_MAX_PARALLEL];
+		unsigned int counters[ZT_SALSA20_MAX_PARALLEL];
+		for(unsigned int i=0;i<ZT_SALSA20_MAX_PARALLEL;++i) {
+			ps[i].reset(Address(),Address(),Packet::VERB_FRAME);
+			ps[i].setSize(1400);
+			pp[i] = &(ps[i]);
+			kp[i] = salsaKey;
+			counters[i] = i;
+		}
+		for(unsigned int many=0;many<2;++many) {
+			double bytes = 0.0;
+			uint64_t start = OSUtils::now();
+			for(unsigned int k=0;k<10000;++k) {
+				if (many) {
+					Packet::armorMany(pp,kp,true,counters,ZT_SALSA20_MAX_PARALLEL);
+				} else {
+					for(unsigned int i=0;i<ZT_SALSA20_MAX_PARALLEL;++i)
+						ps[i].armor(salsaKey,true,i);
+				}
+				bytes += 1400.0 * (double)ZT_SALSA20_MAX_PARALLEL;
+			}
+			uint64_t end = OSUtils::now();
+			std::cout << (many ? "armorMany(): " : "armor(): ") << ((bytes / 1048576.0) / ((double)(end - start) / 1000.0)) << " MiB/second" << (many ? "" : ", ");
+		}
+		std::cout << std::endl;
+	}
+
 	return 0;
 }
 
@@ -789,6 +1519,57 @@ static int testOther()
 	}
 	std::cout << "PASS" << std::endl;
 
+	std::cout << "[other] Testing PrefixSet... "; std::cout.flush();
+	{
+		// Compare against a linear scan with containsAddress(), using few distinct
+		// high bits so that networks overlap, nest, and touch
+		std::vector<InetAddress> nets;
+		PrefixSet ps;
+		for(unsigned int i=0;i<400;++i) {
+			uint8_t ip[16];
+			Utils::getSecureRandom(ip,sizeof(ip));
+			ip[0] &= 0x03;
+			ip[1] &= 0x07;
+			InetAddress n;
+			if (i & 1)
+				n = InetAddress(ip,16,(unsigned int)(rand() % 129)).network();
+			else n = InetAddress(ip,4,(unsigned int)(1 + (rand() % 32))).network();
+			nets.push_back(n);
+			ps.add(n);
+		}
+		ps.build();
+		for(unsigned int k=0;k<100000;++k) {
+			uint8_t ip[16];
+			Utils::getSecureRandom(ip,sizeof(ip));
+			ip[0] &= 0x03;
+			ip[1] &= 0x07;
+			if ((k % 3) == 0) // sometimes land right on a network's first address
+				memcpy(ip,nets[k % nets.size()].rawIpData(),(nets[k % nets.size()].ss_family == AF_INET) ? 4 : 16);
+			const InetAddress a(ip,(k & 1) ? 16 : 4,0);
+			bool ref = false;
+			for(std::vector<InetAddress>::const_iterator n(nets.begin());n!=nets.end();++n) {
+				if (n->containsAddress(a)) {
+					ref = true;
+					break;
+				}
+			}
+			if (ps.contains(a) != ref) {
+				std::cout << "FAILED! (" << a.toString() << " should " << (ref ? "" : "not ") << "be contained)" << std::endl;
+				return -1;
+			}
+		}
+		PrefixSet all;
+		all.add(InetAddress("0.0.0.0/0"));
+		all.add(InetAddress("255.255.255.255/32"));
+		all.add(InetAddress("ffff::/16"));
+		all.build();
+		if ((!all.contains(InetAddress("255.255.255.255/0")))||(!all.contains(InetAddress("0.0.0.0/0")))||(!all.contains(InetAddress("ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff/0")))||(all.contains(InetAddress("fffe::1/0")))||(all.ranges() != 2)) {
+			std::cout << "FAILED! (edge cases)" << std::endl;
+			return -1;
+		}
+	}
+	std::cout << "PASS" << std::endl;
+
 	std::cout << "[other] Testing/fuzzing Dictionary... "; std::cout.flush();
 	for(int k=0;k<1000;++k) {
 		Dictionary<8194> test;
@@ -895,7 +1676,10 @@ static int testOther()
 #define ZT_TEST_PHY_NUM_INVALID_TCP_CONNECTS 2
 #define ZT_TEST_PHY_TCP_MESSAGE_SIZE 1000000
 #define ZT_TEST_PHY_TIMEOUT_MS 20000
+#define ZT_TEST_PHY_BENCH_UDP_PACKETS 200000
+#define ZT_TEST_PHY_BENCH_UDP_PINGS 10000
 static unsigned long phyTestUdpPacketCount = 0;
+static unsigned long phyTestUdpReceiveCallCount = 0;
 static unsigned long phyTestTcpByteCount = 0;
 static unsigned long phyTestTcpConnectSuccessCount = 0;
 static unsigned long phyTestTcpConnectFailCount = 0;
@@ -907,6 +1691,13 @@ struct TestPhyHandlers
 	inline void phyOnDatagram(PhySocket *sock,void **uptr,const struct sockaddr *localAddr,const struct sockaddr *from,void *data,unsigned long len)
 	{
 		++phyTestUdpPacketCount;
+		++phyTestUdpReceiveCallCount;
+	}
+
+	inline void phyOnDatagramBatch(PhySocket *sock,void **uptr,const struct sockaddr *localAddr,const PhyDatagram *datagrams,unsigned int count)
+	{
+		phyTestUdpPacketCount += count;
+		++phyTestUdpReceiveCallCount;
 	}
 
 	inline void phyOnTcpConnect(PhySocket *sock,void **uptr,bool success)
@@ -957,6 +1748,59 @@ struct TestPhyHandlers
 
 	inline void phyOnFileDescriptorActivity(PhySocket *sock,void **uptr,bool readable,bool writable) {}
 };
+static void testPhyUdpBenchmark(Phy<TestPhyHandlers *> &phy,PhySocket *sock,const struct sockaddr *addr,const char *backend)
+{
+	char udpTestPayload[ZT_TEST_PHY_UDP_PACKET_SIZE];
+	memset(udpTestPayload,0xff,sizeof(udpTestPayload));
+
+	// Round trip latency of one datagram at a time through the kernel and back into a handler
+	phyTestUdpPacketCount = 0;
+	uint64_t start = OSUtils::now();
+	uint64_t timeoutAt = start + ZT_TEST_PHY_TIMEOUT_MS;
+	for(unsigned long i=0;((i<ZT_TEST_PHY_BENCH_UDP_PINGS)&&(OSUtils::now() < timeoutAt));++i) {
+		phy.udpSend(sock,addr,udpTestPayload,sizeof(udpTestPayload));
+		while ((phyTestUdpPacketCount <= i)&&(OSUtils::now() < timeoutAt))
+			phy.poll(1);
+	}
+	std::cout << "[phy]   " << backend << " udpSend() latency: " << (((OSUtils::now() - start) * 1000) / ((phyTestUdpPacketCount) ? phyTestUdpPacketCount : 1)) << " microseconds/packet" << std::endl;
+
+	for(int mode=0;mode<3;++mode) {
+		// mode 0: udpSend(), 1: udpSendBatch(), 2: udpSendBatch() with GSO/GRO
+		if ((!phy.setUdpOffload(sock,(mode == 2)))&&(mode == 2))
+			break; // no UDP GSO on this platform (or with io_uring receive)
+		PhyDatagram batch[ZT_PHY_UDP_BATCH_SIZE];
+		for(unsigned int i=0;i<ZT_PHY_UDP_BATCH_SIZE;++i) {
+			batch[i].addr = addr;
+			batch[i].data = udpTestPayload;
+			batch[i].len = sizeof(udpTestPayload);
+		}
+		phyTestUdpPacketCount = 0;
+		phyTestUdpReceiveCallCount = 0;
+		unsigned long phyTestUdpPacketsSent = 0;
+		const clock_t startCpu = clock();
+		start = OSUtils::now();
+		timeoutAt = start + ZT_TEST_PHY_TIMEOUT_MS;
+		while ((OSUtils::now() < timeoutAt)&&(phyTestUdpPacketsSent < ZT_TEST_PHY_BENCH_UDP_PACKETS)) {
+			if (mode) {
+				phyTestUdpPacketsSent += phy.udpSendBatch(sock,batch,ZT_PHY_UDP_BATCH_SIZE);
+			} else {
+				for(unsigned int i=0;i<ZT_PHY_UDP_BATCH_SIZE;++i) {
+					if (phy.udpSend(sock,addr,udpTestPayload,sizeof(udpTestPayload)))
+						++phyTestUdpPacketsSent;
+				}
+			}
+			phy.poll(1);
+		}
+		timeoutAt = OSUtils::now() + 1000;
+		while ((OSUtils::now() < timeoutAt)&&(phyTestUdpPacketCount < phyTestUdpPacketsSent))
+			phy.poll(1);
+		const uint64_t elapsed = OSUtils::now() - start;
+		const double cpuMs = ((double)(clock() - startCpu) * 1000.0) / (double)CLOCKS_PER_SEC;
+		const double mb = ((double)phyTestUdpPacketCount * (double)sizeof(udpTestPayload)) / 1048576.0;
+		std::cout << "[phy]   " << backend << ((mode == 2) ? " udpSendBatch() with GSO/GRO: " : ((mode) ? " udpSendBatch(): " : " udpSend(): ")) << ((phyTestUdpPacketCount * 1000) / ((elapsed) ? elapsed : 1)) << " packets/second, " << ((mb > 0.0) ? (cpuMs / mb) : 0.0) << " CPU ms/MB (" << ((phyTestUdpReceiveCallCount) ? (phyTestUdpPacketCount / phyTestUdpReceiveCallCount) : 0) << " per receive handler call)" << std::endl;
+	}
+	phy.setUdpOffload(sock,true);
+}
 static int testPhy()
 {
 	char udpTestPayload[ZT_TEST_PHY_UDP_PACKET_SIZE];
@@ -993,6 +1837,26 @@ static int testPhy()
 	}
 	std::cout << "OK" << std::endl;
 
+#ifdef SO_REUSEPORT
+	std::cout << "[phy] Binding two SO_REUSEPORT UDP sockets to 127.0.0.1/60006... ";
+	{
+		struct sockaddr_in rpaddr;
+		memset(&rpaddr,0,sizeof(rpaddr));
+		rpaddr.sin_family = AF_INET;
+		rpaddr.sin_port = Utils::hton((uint16_t)60006);
+		rpaddr.sin_addr.s_addr = Utils::hton((uint32_t)0x7f000001);
+		PhySocket *rp1 = testPhyInstance->udpBind((const struct sockaddr *)&rpaddr,(void *)0,0,true);
+		PhySocket *rp2 = testPhyInstance->udpBind((const struct sockaddr *)&rpaddr,(void *)0,0,true);
+		testPhyInstance->close(rp1,false);
+		testPhyInstance->close(rp2,false);
+		if ((!rp1)||(!rp2)) {
+			std::cout << "FAILED." << std::endl;
+			return -1;
+		}
+	}
+	std::cout << "OK" << std::endl;
+#endif
+
 	unsigned long phyTestUdpPacketsSent = 0;
 	unsigned long phyTestTcpValidConnectionsAttempted = 0;
 	unsigned long phyTestTcpInvalidConnectionsAttempted = 0;
@@ -1010,6 +1874,61 @@ static int testPhy()
 	}
 	std::cout << "got " << phyTestUdpPacketCount << " packets, OK" << std::endl;
 
+	std::cout << "[phy] Testing that poll() returns with a flooded UDP socket... "; std::cout.flush();
+	{
+		struct sockaddr_in floodaddr;
+		memset(&floodaddr,0,sizeof(floodaddr));
+		floodaddr.sin_family = AF_INET;
+		floodaddr.sin_port = Utils::hton((uint16_t)60010);
+		floodaddr.sin_addr.s_addr = Utils::hton((uint32_t)0x7f000001);
+		PhySocket *floodSock = testPhyInstance->udpBind((const struct sockaddr *)&floodaddr,(void *)0,4194304);
+		if (!floodSock) {
+			std::cout << "FAILED (bind)" << std::endl;
+			return -1;
+		}
+		const unsigned long perPoll = ZT_PHY_UDP_BATCH_SIZE * ZT_PHY_UDP_MAX_BATCHES_PER_POLL;
+		const unsigned long floodCount = (perPoll * 2) + 17;
+		for(unsigned long i=0;i<floodCount;++i)
+			testPhyInstance->udpSend(udpListenSock,(const struct sockaddr *)&floodaddr,udpTestPayload,100);
+		phyTestUdpPacketCount = 0;
+		testPhyInstance->poll(100);
+		const unsigned long firstPoll = phyTestUdpPacketCount;
+		timeoutAt = OSUtils::now() + ZT_TEST_PHY_TIMEOUT_MS;
+		while ((OSUtils::now() < timeoutAt)&&(phyTestUdpPacketCount < floodCount))
+			testPhyInstance->poll(100);
+		testPhyInstance->close(floodSock,false);
+		if ((firstPoll == 0)||(firstPoll > perPoll)||(phyTestUdpPacketCount != floodCount)) {
+			std::cout << "FAILED (" << firstPoll << " in first poll(), " << phyTestUdpPacketCount << " of " << floodCount << " in all)" << std::endl;
+			return -1;
+		}
+		std::cout << firstPoll << " in first poll(), " << phyTestUdpPacketCount << " in all, OK" << std::endl;
+	}
+
+	std::cout << "[phy] Benchmarking UDP send/receive over loopback..." << std::endl;
+#ifdef ZT_PHY_USE_EPOLL
+	testPhyUdpBenchmark(*testPhyInstance,udpListenSock,(const struct sockaddr *)&bindaddr,"epoll");
+#else
+	testPhyUdpBenchmark(*testPhyInstance,udpListenSock,(const struct sockaddr *)&bindaddr,"select");
+#endif
+	{
+		Phy<TestPhyHandlers *> uringPhy(&testPhyHandlers,false,true);
+		if (uringPhy.enableIoUring()) {
+			struct sockaddr_in uringaddr;
+			memset(&uringaddr,0,sizeof(uringaddr));
+			uringaddr.sin_family = AF_INET;
+			uringaddr.sin_port = Utils::hton((uint16_t)60008);
+			uringaddr.sin_addr.s_addr = Utils::hton((uint32_t)0x7f000001);
+			PhySocket *uringSock = uringPhy.udpBind((const struct sockaddr *)&uringaddr);
+			if (!uringSock) {
+				std::cout << "[phy] Binding io_uring UDP socket to 127.0.0.1/60008... FAILED." << std::endl;
+				return -1;
+			}
+			testPhyUdpBenchmark(uringPhy,uringSock,(const struct sockaddr *)&uringaddr,"io_uring");
+		} else {
+			std::cout << "[phy]   io_uring: not available" << std::endl;
+		}
+	}
+
 	std::cout << "[phy] Testing TCP... "; std::cout.flush();
 	timeoutAt = OSUtils::now() + ZT_TEST_PHY_TIMEOUT_MS;
 	while ((OSUtils::now() < timeoutAt)&&(phyTestTcpByteCount < (ZT_TEST_PHY_NUM_VALID_TCP_CONNECTS * ZT_TEST_PHY_TCP_MESSAGE_SIZE))) {
@@ -47,6 +47,8 @@
 #include "../osdep/PortMapper.hpp"
 #include "../osdep/Binder.hpp"
 #include "../osdep/ManagedRoute.hpp"
+#include "../osdep/PrefixSet.hpp"
+#include "../osdep/BlockingQueue.hpp"
 
 #include "OneService.hpp"
 #include "ClusterGeoIpService.hpp"
@@ -104,6 +106,7 @@ namespace ZeroTier { typedef OSXEthernetTap EthernetTap; }
 #endif // __APPLE__
 #ifdef __LINUX__
 #include "../osdep/LinuxEthernetTap.hpp"
+#include "../osdep/LinuxNetLink.hpp"
 namespace ZeroTier { typedef LinuxEthernetTap EthernetTap; }
 #endif // __LINUX__
 #ifdef __WINDOWS__
@@ -147,9 +150,18 @@ namespace ZeroTier { typedef BSDEthernetTap EthernetTap; }
 // How often to check for local interface addresses
 #define ZT_LOCAL_INTERFACE_CHECK_INTERVAL 60000
 
+// How often to check tap addresses for changes made outside the service
+#define ZT_PATH_INDEX_CHECK_INTERVAL 5000
+
 // Clean files from iddb.d that are older than this (60 days)
 #define ZT_IDDB_CLEANUP_AGE 5184000000ULL
 
+// Maximum number of additional UDP receive worker threads (local.conf "receiveWorkers")
+#define ZT_MAX_RECEIVE_WORKERS 64
+
+// Maximum number of threads validating new peers' identities (local.conf "identityValidationWorkers")
+#define ZT_MAX_IDENTITY_VALIDATION_WORKERS 16
+
 namespace ZeroTier {
 
 namespace {
@@ -299,6 +311,7 @@ static int SnodeWirePacketSendFunction(ZT_Node *node,void *uptr,const struct soc
 static void SnodeVirtualNetworkFrameFunction(ZT_Node *node,void *uptr,uint64_t nwid,void **nuptr,uint64_t sourceMac,uint64_t destMac,unsigned int etherType,unsigned int vlanId,const void *data,unsigned int len);
 static int SnodePathCheckFunction(ZT_Node *node,void *uptr,uint64_t ztaddr,const struct sockaddr_storage *localAddr,const struct sockaddr_storage *remoteAddr);
 static int SnodePathLookupFunction(ZT_Node *node,void *uptr,uint64_t ztaddr,int family,struct sockaddr_storage *result);
+static void SnodeIdentityValidationRequestFunction(ZT_Node *node,void *uptr);
 
 #ifdef ZT_ENABLE_CLUSTER
 static void SclusterSendFunction(void *uptr,unsigned int toMemberId,const void *data,unsigned int len);
@@ -306,6 +319,9 @@ static int SclusterGeoIpFunction(void *uptr,const struct sockaddr_storage *addr,
 #endif
 
 static void StapFrameHandler(void *uptr,uint64_t nwid,const MAC &from,const MAC &to,unsigned int etherType,unsigned int vlanId,const void *data,unsigned int len);
+#ifdef __LINUX__
+static void StapFrameBatchHandler(void *uptr,uint64_t nwid,const EthernetTap::Frame *frames,unsigned int count);
+#endif
 
 static int ShttpOnMessageBegin(http_parser *parser);
 static int ShttpOnUrl(http_parser *parser,const char *ptr,size_t length);
@@ -371,7 +387,63 @@ struct TcpConnection
 	Mutex writeBuf_m;
 };
 
+// Counters for UDP packets received by the main thread or a receive worker
+struct ReceiveStats
+{
+	ReceiveStats() : packets(0),bytes(0),batches(0) {}
+
+	// Only written by the thread that receives on the sockets these belong to
+	volatile uint64_t packets;
+	volatile uint64_t bytes;
+	volatile uint64_t batches;
+};
+
+// A thread with its own Phy<> and SO_REUSEPORT UDP sockets that feeds packets into the shared Node
+struct ReceiveWorker
+{
+	ReceiveWorker(OneServiceImpl *p) :
+		parent(p),
+		phy(p,false,true),
+		refreshNeeded(true),
+		run(true) {}
+
+	void threadMain()
+		throw();
+
+	OneServiceImpl *parent;
+	Phy<OneServiceImpl *> phy;
+	std::vector< std::pair<InetAddress,PhySocket *> > sockets[3]; // per Binder, only touched by this worker's thread
+	ReceiveStats stats;
+	Thread thread;
+	volatile bool refreshNeeded;
+	volatile bool run;
+};
+
+// A thread that validates identities of new peers for the Node, see ZT_IdentityValidationRequestFunction
+struct IdentityValidationWorker
+{
+	IdentityValidationWorker(OneServiceImpl *p) : parent(p) {}
+
+	void threadMain()
+		throw();
+
+	OneServiceImpl *parent;
+	Thread thread;
+};
+
 // Used to pseudo-randomize local source port picking
+#ifdef __LINUX__
+// Taps written to while handling a receive batch, so their put batches can be flushed afterwards
+struct TapPutBatch
+{
+	EthernetTap *taps[ZT_PHY_UDP_BATCH_SIZE];
+	unsigned int count;
+};
+
+// Batch being handled by phyOnDatagramBatch() on this thread, if any
+static thread_local TapPutBatch *_threadTapPutBatch = (TapPutBatch *)0;
+#endif
+
 static volatile unsigned int _udpPortPickerCounter = 0;
 
 class OneServiceImpl : public OneService
@@ -419,6 +491,25 @@ public:
 	PhySocket *_v4TcpControlSocket;
 	PhySocket *_v6TcpControlSocket;
 
+	// Additional UDP receive threads, each sharing our ports via SO_REUSEPORT (main thread only)
+	unsigned int _receiveWorkerCount;
+	std::vector< ReceiveWorker * > _receiveWorkers;
+
+	// Threads validating new peers' identities, woken once per request from the Node (false means exit)
+	unsigned int _identityValidationWorkerCount;
+	std::vector< IdentityValidationWorker * > _identityValidationWorkers;
+	BlockingQueue<bool> _identityValidationRequests;
+
+	// Service UDP sockets with io_uring instead of epoll (local.conf "ioUring", read at startup)
+	bool _ioUring;
+
+	// Number of queues and reader threads for each new tap device (local.conf "tapQueues", Linux only)
+	unsigned int _tapQueues;
+
+	// Create taps with checksum/TSO offload and coalesce TCP segments written to them (local.conf "tapOffload", Linux only)
+	bool _tapOffload;
+	ReceiveStats _mainReceiveStats;
+
 	// Time we last received a packet from a global address
 	uint64_t _lastDirectReceiveFromGlobal;
 #ifdef ZT_TCP_FALLBACK_RELAY
@@ -452,6 +543,22 @@ public:
 	std::map<uint64_t,NetworkState> _nets;
 	Mutex _nets_m;
 
+	// Networks physical paths may not use: tap networks and blacklists
+	struct PathIndex
+	{
+		std::vector<InetAddress> tapIps; // sorted, to notice when taps change
+		PrefixSet global; // tap networks and global blacklist
+		Hashtable< uint64_t,PrefixSet > blacklists; // per ZeroTier address
+	private:
+		friend class SharedPtr<PathIndex>;
+		AtomicCounter __refCount;
+	};
+
+	// Current path index, replaced (never modified) by the main thread; readers take a reference under _pathIndex_m
+	SharedPtr<PathIndex> _pathIndex;
+	Mutex _pathIndex_m;
+	volatile bool _pathIndexDirty;
+
 	// Active TCP/IP connections
 	std::set< TcpConnection * > _tcpConnections; // no mutex for this since it's done in the main loop thread only
 	TcpConnection *_tcpFallbackTunnel;
@@ -490,12 +597,18 @@ public:
 		,_primaryPort(port)
 		,_v4TcpControlSocket((PhySocket *)0)
 		,_v6TcpControlSocket((PhySocket *)0)
+		,_receiveWorkerCount(0)
+		,_identityValidationWorkerCount(1)
+		,_ioUring(false)
+		,_tapQueues(1)
+		,_tapOffload(false)
 		,_lastDirectReceiveFromGlobal(0)
 #ifdef ZT_TCP_FALLBACK_RELAY
 		,_lastSendToGlobalV4(0)
 #endif
 		,_lastRestart(0)
 		,_nextBackgroundTaskDeadline(0)
+		,_pathIndexDirty(true)
 		,_tcpFallbackTunnel((TcpConnection *)0)
 		,_termReason(ONE_STILL_RUNNING)
 		,_portMappingEnabled(true)
@@ -562,9 +675,23 @@ public:
 			OSUtils::rm((_homePath + ZT_PATH_SEPARATOR_S "peers.save").c_str());
 			OSUtils::rm((_homePath + ZT_PATH_SEPARATOR_S "world").c_str());
 
+			// Identity validation workers must be known before the node is created, since
+			// with none the node validates new identities inline and must not call back
+			{
+				Mutex::Lock _l2(_localConfig_m);
+				std::string lcbuf;
+				if (OSUtils::readFile((_homePath + ZT_PATH_SEPARATOR_S "local.conf").c_str(),lcbuf)) {
+					try {
+						json lc(OSUtils::jsonParse(lcbuf));
+						if (lc.is_object())
+							_identityValidationWorkerCount = (unsigned int)std::min(OSUtils::jsonInt(lc["settings"]["identityValidationWorkers"],1ULL),(uint64_t)ZT_MAX_IDENTITY_VALIDATION_WORKERS);
+					} catch ( ... ) {} // reported below when local.conf is read again
+				}
+			}
+
 			{
 				struct ZT_Node_Callbacks cb;
-				cb.version = 0;
+				cb.version = 1;
 				cb.dataStoreGetFunction = SnodeDataStoreGetFunction;
 				cb.dataStorePutFunction = SnodeDataStorePutFunction;
 				cb.wirePacketSendFunction = SnodeWirePacketSendFunction;
@@ -573,6 +700,7 @@ public:
 				cb.eventCallback = SnodeEventCallback;
 				cb.pathCheckFunction = SnodePathCheckFunction;
 				cb.pathLookupFunction = SnodePathLookupFunction;
+				cb.identityValidationRequestFunction = (_identityValidationWorkerCount) ? SnodeIdentityValidationRequestFunction : (ZT_IdentityValidationRequestFunction)0;
 				_node = new Node(this,&cb,OSUtils::now());
 			}
 
@@ -647,6 +775,11 @@ public:
 					_node->setTrustedPaths(reinterpret_cast<const struct sockaddr_storage *>(trustedPathNetworks),trustedPathIds,trustedPathCount);
 			}
 			applyLocalConfig();
+			updatePathIndex();
+
+			// io_uring must be enabled before any UDP sockets are bound to be used for them
+			if ((_ioUring)&&(!_phy.enableIoUring()))
+				fprintf(stderr,"WARNING: io_uring is not available, using epoll for UDP" ZT_EOL_S);
 
 			// Bind TCP control socket
 			const int portTrials = (_primaryPort == 0) ? 256 : 1; // if port is 0, pick random
@@ -816,6 +949,24 @@ public:
 				}
 			}
 
+			// Start receive workers if enabled; ports must be bound with SO_REUSEPORT before the first refresh
+			if (_receiveWorkerCount > 0) {
+				for(int i=0;i<3;++i)
+					_bindings[i].setReusePort(true);
+				for(unsigned int i=0;i<_receiveWorkerCount;++i) {
+					ReceiveWorker *const w = new ReceiveWorker(this);
+					_receiveWorkers.push_back(w);
+					w->thread = Thread::start(w);
+				}
+			}
+
+			// Start identity validation workers; with none, new identities are validated on the packet thread as before
+			for(unsigned int i=0;i<_identityValidationWorkerCount;++i) {
+				IdentityValidationWorker *const w = new IdentityValidationWorker(this);
+				_identityValidationWorkers.push_back(w);
+				w->thread = Thread::start(w);
+			}
+
 			_nextBackgroundTaskDeadline = 0;
 			uint64_t clockShouldBe = OSUtils::now();
 			_lastRestart = clockShouldBe;
@@ -823,6 +974,7 @@ public:
 			uint64_t lastBindRefresh = 0;
 			uint64_t lastUpdateCheck = clockShouldBe;
 			uint64_t lastLocalInterfaceAddressCheck = (clockShouldBe - ZT_LOCAL_INTERFACE_CHECK_INTERVAL) + 15000; // do this in 15s to give portmapper time to configure and other things time to settle
+			uint64_t lastPathIndexCheck = clockShouldBe;
 			uint64_t lastCleanedIddb = 0;
 			for(;;) {
 				_run_m.lock();
@@ -866,6 +1018,10 @@ public:
 							_bindings[i].refresh(_phy,_ports[i],*this);
 						}
 					}
+					for(std::vector<ReceiveWorker *>::const_iterator w(_receiveWorkers.begin());w!=_receiveWorkers.end();++w) {
+						(*w)->refreshNeeded = true;
+						(*w)->phy.whack();
+					}
 					{
 						Mutex::Lock _l(_nets_m);
 						for(std::map<uint64_t,NetworkState>::iterator n(_nets.begin());n!=_nets.end();++n) {
@@ -899,6 +1055,11 @@ public:
 					}
 				}
 
+				if ((_pathIndexDirty)||((now - lastPathIndexCheck) >= ZT_PATH_INDEX_CHECK_INTERVAL)) {
+					lastPathIndexCheck = now;
+					updatePathIndex();
+				}
+
 				if ((now - lastLocalInterfaceAddressCheck) >= ZT_LOCAL_INTERFACE_CHECK_INTERVAL) {
 					lastLocalInterfaceAddressCheck = now;
 
@@ -931,6 +1092,22 @@ public:
 			_fatalErrorMessage = "unexpected exception in main thread";
 		}
 
+		for(std::vector<ReceiveWorker *>::const_iterator w(_receiveWorkers.begin());w!=_receiveWorkers.end();++w) {
+			(*w)->run = false;
+			(*w)->phy.whack();
+			Thread::join((*w)->thread);
+			delete *w;
+		}
+		_receiveWorkers.clear();
+
+		for(unsigned long i=0;i<(unsigned long)_identityValidationWorkers.size();++i)
+			_identityValidationRequests.post(false);
+		for(std::vector<IdentityValidationWorker *>::const_iterator w(_identityValidationWorkers.begin());w!=_identityValidationWorkers.end();++w) {
+			Thread::join((*w)->thread);
+			delete *w;
+		}
+		_identityValidationWorkers.clear();
+
 		try {
 			while (!_tcpConnections.empty())
 				_phy.close((*_tcpConnections.begin())->sock);
@@ -1121,6 +1298,15 @@ public:
 					res["address"] = tmp;
 					res["publicIdentity"] = status.publicIdentity;
 					res["online"] = (bool)(status.online != 0);
+					res["signatureCacheHits"] = status.signatureCacheHits;
+					res["signatureCacheMisses"] = status.signatureCacheMisses;
+					res["cpuFeatures"] = status.cpuFeatures;
+					res["cryptoImplementations"] = status.cryptoImplementations;
+					res["rxQueueSize"] = status.rxQueueSize;
+					res["rxQueueInUse"] = status.rxQueueInUse;
+					res["rxQueueEvictions"] = status.rxQueueEvictions;
+					res["rxQueueSourceLimitEvictions"] = status.rxQueueSourceLimitEvictions;
+					res["rxQueueExpirations"] = status.rxQueueExpirations;
 					res["tcpFallbackActive"] = (_tcpFallbackTunnel != (TcpConnection *)0);
 					res["versionMajor"] = ZEROTIER_ONE_VERSION_MAJOR;
 					res["versionMinor"] = ZEROTIER_ONE_VERSION_MINOR;
@@ -1148,6 +1334,18 @@ public:
 					res["planetWorldId"] = planet.id();
 					res["planetWorldTimestamp"] = planet.timestamp();
 
+					// First entry is the main thread, followed by any receive workers
+					json rwa = json::array();
+					for(unsigned long i=0;i<=(unsigned long)_receiveWorkers.size();++i) {
+						const ReceiveStats &rs = (i == 0) ? _mainReceiveStats : _receiveWorkers[i - 1]->stats;
+						json rwj;
+						rwj["packets"] = (uint64_t)rs.packets;
+						rwj["bytes"] = (uint64_t)rs.bytes;
+						rwj["batches"] = (uint64_t)rs.batches;
+						rwa.push_back(rwj);
+					}
+					res["receiveWorkers"] = rwa;
+
 #ifdef ZT_ENABLE_CLUSTER
 					json cj;
 					ZT_ClusterStatus cs;
@@ -1447,7 +1645,7 @@ public:
 						json &blAddrs = v.value()["blacklist"];
 						if (blAddrs.is_array()) {
 							for(unsigned long i=0;i<blAddrs.size();++i) {
-								const InetAddress ip(OSUtils::jsonString(tryAddrs[i],""));
+								const InetAddress ip(OSUtils::jsonString(blAddrs[i],""));
 								if (ip.ss_family == AF_INET)
 									v4b.push_back(ip);
 								else if (ip.ss_family == AF_INET6)
@@ -1483,6 +1681,8 @@ public:
 			}
 		}
 
+		_pathIndexDirty = true;
+
 		_allowManagementFrom.clear();
 		_interfacePrefixBlacklist.clear();
 
@@ -1490,6 +1690,19 @@ public:
 
 		_primaryPort = (unsigned int)OSUtils::jsonInt(settings["primaryPort"],(uint64_t)_primaryPort) & 0xffff;
 		_portMappingEnabled = OSUtils::jsonBool(settings["portMappingEnabled"],true);
+#if defined(__LINUX__) && defined(SO_REUSEPORT)
+		// Only takes effect on startup; Linux is the only OS that load balances UDP across SO_REUSEPORT sockets
+		if (_receiveWorkers.empty())
+			_receiveWorkerCount = (unsigned int)std::min(OSUtils::jsonInt(settings["receiveWorkers"],0ULL),(uint64_t)ZT_MAX_RECEIVE_WORKERS);
+#endif
+		const unsigned int rxQueueSize = (unsigned int)std::min(OSUtils::jsonInt(settings["rxQueueSize"],(uint64_t)ZT_RX_QUEUE_SIZE),(uint64_t)ZT_RX_QUEUE_MAX_SIZE);
+		if (rxQueueSize != ZT_RX_QUEUE_SIZE) // resizing discards queued packets, so leave the default alone
+			_node->setRxQueueSize(rxQueueSize);
+#ifdef __LINUX__
+		_ioUring = OSUtils::jsonBool(settings["ioUring"],false); // only takes effect on startup
+		_tapQueues = (unsigned int)std::max(std::min(OSUtils::jsonInt(settings["tapQueues"],1ULL),(uint64_t)ZT_LINUX_TAP_MAX_QUEUES),(uint64_t)1);
+		_tapOffload = OSUtils::jsonBool(settings["tapOffload"],false); // applies to taps created after this
+#endif
 
 		const std::string up(OSUtils::jsonString(settings["softwareUpdate"],ZT_SOFTWARE_UPDATE_DEFAULT));
 		const bool udist = OSUtils::jsonBool(settings["softwareUpdateDist"],false);
@@ -1556,6 +1769,64 @@ public:
 		}
 	}
 
+	// Rebuild the path index if it's marked dirty or tap addresses changed (main thread only)
+	void updatePathIndex()
+	{
+		const bool dirty = _pathIndexDirty;
+		_pathIndexDirty = false; // cleared before reading so changes made while we build aren't lost
+
+		std::vector<InetAddress> tapIps;
+		{
+			Mutex::Lock _l(_nets_m);
+			for(std::map<uint64_t,NetworkState>::const_iterator n(_nets.begin());n!=_nets.end();++n) {
+				if (n->second.tap) {
+					std::vector<InetAddress> ips(n->second.tap->ips());
+					tapIps.insert(tapIps.end(),ips.begin(),ips.end());
+				}
+			}
+		}
+		std::sort(tapIps.begin(),tapIps.end());
+
+		SharedPtr<PathIndex> old;
+		{
+			Mutex::Lock _l(_pathIndex_m);
+			old = _pathIndex;
+		}
+		if ((dirty)||(!old)||(old->tapIps != tapIps)) {
+			SharedPtr<PathIndex> idx(new PathIndex());
+			idx->tapIps.swap(tapIps);
+			for(std::vector<InetAddress>::const_iterator i(idx->tapIps.begin());i!=idx->tapIps.end();++i)
+				idx->global.add(*i);
+			{
+				Mutex::Lock _l(_localConfig_m);
+				for(std::vector<InetAddress>::const_iterator i(_globalV4Blacklist.begin());i!=_globalV4Blacklist.end();++i)
+					idx->global.add(*i);
+				for(std::vector<InetAddress>::const_iterator i(_globalV6Blacklist.begin());i!=_globalV6Blacklist.end();++i)
+					idx->global.add(*i);
+				for(int f=0;f<2;++f) {
+					Hashtable< uint64_t,std::vector<InetAddress> >::Iterator bli((f == 0) ? _v4Blacklists : _v6Blacklists);
+					uint64_t *ztaddr = (uint64_t *)0;
+					std::vector<InetAddress> *l = (std::vector<InetAddress> *)0;
+					while (bli.next(ztaddr,l)) {
+						PrefixSet &bl = idx->blacklists[*ztaddr];
+						for(std::vector<InetAddress>::const_iterator i(l->begin());i!=l->end();++i)
+							bl.add(*i);
+					}
+				}
+			}
+			idx->global.build();
+			Hashtable< uint64_t,PrefixSet >::Iterator bli(idx->blacklists);
+			uint64_t *ztaddr = (uint64_t *)0;
+			PrefixSet *bl = (PrefixSet *)0;
+			while (bli.next(ztaddr,bl))
+				bl->build();
+
+			// The old index is deleted when the last path check still using it lets go
+			Mutex::Lock _l(_pathIndex_m);
+			_pathIndex.swap(idx);
+		}
+	}
+
 	// Match only an IP from a vector of IPs -- used in syncManagedStuff()
 	bool matchIpOnly(const std::vector<InetAddress> &ips,const InetAddress &ip) const
 	{
@@ -1571,6 +1842,10 @@ public:
 	{
 		// assumes _nets_m is locked
 		if (syncIps) {
+#ifdef __LINUX__
+			// Address changes go to the kernel together in one netlink transaction
+			LinuxNetLink::instance().beginBatch();
+#endif
 			std::vector<InetAddress> newManagedIps;
 			newManagedIps.reserve(n.config.assignedAddressCount);
 			for(unsigned int i=0;i<n.config.assignedAddressCount;++i) {
@@ -1599,6 +1874,13 @@ public:
 			}
 #endif
 			n.managedIps.swap(newManagedIps);
+#ifdef __LINUX__
+			const unsigned int failures = LinuxNetLink::instance().flushBatch();
+			if (failures)
+				fprintf(stderr,"ERROR: unable to add or remove %u ip address(es) on %s" ZT_EOL_S,failures,n.tap->deviceName().c_str());
+#endif
+			_pathIndexDirty = true;
+			_phy.whack();
 		}
 
 		if (syncRoutes) {
@@ -1611,6 +1893,11 @@ public:
 
 			std::vector<InetAddress> myIps(n.tap->ips());
 
+#ifdef __LINUX__
+			// Likewise all route changes, including removals by ManagedRoute destructors
+			LinuxNetLink::instance().beginBatch();
+#endif
+
 			// Nuke applied routes that are no longer in n.config.routes[] and/or are not allowed
 			for(std::list< SharedPtr<ManagedRoute> >::iterator mr(n.managedRoutes.begin());mr!=n.managedRoutes.end();) {
 				bool haveRoute = false;
@@ -1667,10 +1954,25 @@ public:
 				if (!n.managedRoutes.back()->sync())
 					n.managedRoutes.pop_back();
 			}
+
+#ifdef __LINUX__
+			const unsigned int failures = LinuxNetLink::instance().flushBatch();
+			if (failures)
+				fprintf(stderr,"ERROR: unable to add or remove %u route(s) via %s" ZT_EOL_S,failures,tapdev);
+#endif
 		}
 	}
 
 	// =========================================================================
+	// Called by receive workers in their own threads to sync their sockets with our bindings
+	void refreshReceiveWorker(ReceiveWorker &w)
+	{
+		for(int i=0;i<3;++i) {
+			if (_ports[i])
+				_bindings[i].refreshWorker(w.phy,w.sockets[i],(void *)&(w.stats));
+		}
+	}
+
 	// Handlers for Node and Phy<> callbacks
 	// =========================================================================
 
@@ -1689,6 +1991,10 @@ public:
 			return;
 #endif
 
+		ReceiveStats &rs = (*uptr) ? *(reinterpret_cast<ReceiveStats *>(*uptr)) : _mainReceiveStats;
+		++rs.packets;
+		rs.bytes += len;
+
 		if ((len >= 16)&&(reinterpret_cast<const InetAddress *>(from)->ipScope() == InetAddress::IP_SCOPE_GLOBAL))
 			_lastDirectReceiveFromGlobal = OSUtils::now();
 
@@ -1709,6 +2015,67 @@ public:
 		}
 	}
 
+	inline void phyOnDatagramBatch(PhySocket *sock,void **uptr,const struct sockaddr *localAddr,const PhyDatagram *datagrams,unsigned int count)
+	{
+		// Anything sent while handling this batch goes out together in as few system calls as possible
+		Binder::beginSendBatch();
+
+		bool single = (count > ZT_PHY_UDP_BATCH_SIZE);
+#ifdef ZT_ENABLE_CLUSTER
+		if (sock == _clusterMessageSocket)
+			single = true;
+#endif
+#ifdef ZT_BREAK_UDP
+		single = true;
+#endif
+
+		if (single) {
+			for(unsigned int i=0;i<count;++i)
+				phyOnDatagram(sock,uptr,localAddr,datagrams[i].addr,datagrams[i].data,datagrams[i].len);
+		} else {
+			ReceiveStats &rs = (*uptr) ? *(reinterpret_cast<ReceiveStats *>(*uptr)) : _mainReceiveStats;
+			++rs.batches;
+			rs.packets += count;
+
+#ifdef __LINUX__
+			// Lets offload-enabled taps merge the TCP segments this batch decrypts into super-frames
+			TapPutBatch tapPutBatch;
+			tapPutBatch.count = 0;
+			if (_tapOffload)
+				_threadTapPutBatch = &tapPutBatch;
+#endif
+
+			ZT_WirePacket packets[ZT_PHY_UDP_BATCH_SIZE];
+			for(unsigned int i=0;i<count;++i) {
+				rs.bytes += datagrams[i].len;
+				if ((datagrams[i].len >= 16)&&(reinterpret_cast<const InetAddress *>(datagrams[i].addr)->ipScope() == InetAddress::IP_SCOPE_GLOBAL))
+					_lastDirectReceiveFromGlobal = OSUtils::now();
+				packets[i].localAddress = reinterpret_cast<const struct sockaddr_storage *>(localAddr);
+				packets[i].remoteAddress = (const struct sockaddr_storage *)datagrams[i].addr; // Phy<> uses sockaddr_storage, so it'll always be that big
+				packets[i].packetData = datagrams[i].data;
+				packets[i].packetLength = (unsigned int)datagrams[i].len;
+			}
+
+			const ZT_ResultCode rc = _node->processWirePackets(OSUtils::now(),packets,count,&_nextBackgroundTaskDeadline);
+			if (ZT_ResultCode_isFatal(rc)) {
+				char tmp[256];
+				Utils::snprintf(tmp,sizeof(tmp),"fatal error code from processWirePackets: %d",(int)rc);
+				Mutex::Lock _l(_termReason_m);
+				_termReason = ONE_UNRECOVERABLE_ERROR;
+				_fatalErrorMessage = tmp;
+				this->terminate();
+			}
+
+#ifdef __LINUX__
+			_threadTapPutBatch = (TapPutBatch *)0;
+			for(unsigned int i=0;i<tapPutBatch.count;++i)
+				tapPutBatch.taps[i]->flushPutBatch();
+#endif
+		}
+
+		Binder::flushSendBatch(_phy);
+	}
+
 	inline void phyOnTcpConnect(PhySocket *sock,void **uptr,bool success)
 	{
 		if (!success)
@@ -1922,7 +2289,13 @@ public:
 							nwid,
 							friendlyName,
 							StapFrameHandler,
-							(void *)this);
+							(void *)this
+#ifdef __LINUX__
+							,_tapQueues
+							,_tapOffload
+							,StapFrameBatchHandler
+#endif
+							);
 						*nuptr = (void *)&n;
 
 						char nlcpath[256];
@@ -2005,6 +2378,8 @@ public:
 					*nuptr = (void *)0;
 					delete n.tap;
 					_nets.erase(nwid);
+					_pathIndexDirty = true;
+					_phy.whack();
 #ifdef __WINDOWS__
 					if ((op == ZT_VIRTUAL_NETWORK_CONFIG_OPERATION_DESTROY)&&(winInstanceId.length() > 0))
 						WindowsEthernetTap::deletePersistentTapDevice(winInstanceId.c_str());
@@ -2023,6 +2398,9 @@ public:
 		return 0;
 	}
 
+	// Never re-enter the node here: this can be called with Switch locks held
+	inline void nodeIdentityValidationRequestFunction() { _identityValidationRequests.post(true); }
+
 	inline void nodeEventCallback(enum ZT_Event event,const void *metaData)
 	{
 		switch(event) {
@@ -2181,55 +2559,42 @@ public:
 		NetworkState *n = reinterpret_cast<NetworkState *>(*nuptr);
 		if ((!n)||(!n->tap))
 			return;
+#ifdef __LINUX__
+		TapPutBatch *const tb = _threadTapPutBatch;
+		if (tb) {
+			unsigned int i = 0;
+			while ((i < tb->count)&&(tb->taps[i] != n->tap))
+				++i;
+			if ((i == tb->count)&&(i < ZT_PHY_UDP_BATCH_SIZE)) {
+				n->tap->beginPutBatch();
+				tb->taps[tb->count++] = n->tap;
+			}
+		}
+#endif
 		n->tap->put(MAC(sourceMac),MAC(destMac),etherType,data,len);
 	}
 
 	inline int nodePathCheckFunction(uint64_t ztaddr,const struct sockaddr_storage *localAddr,const struct sockaddr_storage *remoteAddr)
 	{
-		// Make sure we're not trying to do ZeroTier-over-ZeroTier
-		{
-			Mutex::Lock _l(_nets_m);
-			for(std::map<uint64_t,NetworkState>::const_iterator n(_nets.begin());n!=_nets.end();++n) {
-				if (n->second.tap) {
-					std::vector<InetAddress> ips(n->second.tap->ips());
-					for(std::vector<InetAddress>::const_iterator i(ips.begin());i!=ips.end();++i) {
-						if (i->containsAddress(*(reinterpret_cast<const InetAddress *>(remoteAddr)))) {
-							return 0;
-						}
-					}
-				}
-			}
-		}
-
 		/* Note: I do not think we need to scan for overlap with managed routes
 		 * because of the "route forking" and interface binding that we do. This
 		 * ensures (we hope) that ZeroTier traffic will still take the physical
 		 * path even if its managed routes override this for other traffic. Will
 		 * revisit if we see recursion problems. */
 
-		// Check blacklists
-		const Hashtable< uint64_t,std::vector<InetAddress> > *blh = (const Hashtable< uint64_t,std::vector<InetAddress> > *)0;
-		const std::vector<InetAddress> *gbl = (const std::vector<InetAddress> *)0;
-		if (remoteAddr->ss_family == AF_INET) {
-			blh = &_v4Blacklists;
-			gbl = &_globalV4Blacklist;
-		} else if (remoteAddr->ss_family == AF_INET6) {
-			blh = &_v6Blacklists;
-			gbl = &_globalV6Blacklist;
+		// Make sure we're not trying to do ZeroTier-over-ZeroTier, and check blacklists
+		SharedPtr<PathIndex> idx;
+		{
+			Mutex::Lock _l(_pathIndex_m);
+			idx = _pathIndex;
 		}
-		if (blh) {
-			Mutex::Lock _l(_localConfig_m);
-			const std::vector<InetAddress> *l = blh->get(ztaddr);
-			if (l) {
-				for(std::vector<InetAddress>::const_iterator a(l->begin());a!=l->end();++a) {
-					if (a->containsAddress(*reinterpret_cast<const InetAddress *>(remoteAddr)))
-						return 0;
-				}
-			}
-			for(std::vector<InetAddress>::const_iterator a(gbl->begin());a!=gbl->end();++a) {
-				if (a->containsAddress(*reinterpret_cast<const InetAddress *>(remoteAddr)))
-					return 0;
-			}
+		if (idx) {
+			const InetAddress &ra = *reinterpret_cast<const InetAddress *>(remoteAddr);
+			if (idx->global.contains(ra))
+				return 0;
+			const PrefixSet *const bl = idx->blacklists.get(ztaddr);
+			if ((bl)&&(bl->contains(ra)))
+				return 0;
 		}
 
 		return 1;
@@ -2254,8 +2619,23 @@ public:
 
 	inline void tapFrameHandler(uint64_t nwid,const MAC &from,const MAC &to,unsigned int etherType,unsigned int vlanId,const void *data,unsigned int len)
 	{
+		// Queue so that a packet and its fragments leave together (as one GSO send where supported)
+		Binder::beginSendBatch();
 		_node->processVirtualNetworkFrame(OSUtils::now(),nwid,from.toInt(),to.toInt(),etherType,vlanId,data,len,&_nextBackgroundTaskDeadline);
+		Binder::flushSendBatch(_phy);
+	}
+
+#ifdef __LINUX__
+	inline void tapFrameBatchHandler(uint64_t nwid,const EthernetTap::Frame *frames,unsigned int count)
+	{
+		// Everything sent for frames read together from the tap leaves together
+		Binder::beginSendBatch();
+		const uint64_t now = OSUtils::now();
+		for(unsigned int i=0;i<count;++i)
+			_node->processVirtualNetworkFrame(now,nwid,frames[i].from.toInt(),frames[i].to.toInt(),frames[i].etherType,frames[i].vlanId,frames[i].data,frames[i].len,&_nextBackgroundTaskDeadline);
+		Binder::flushSendBatch(_phy);
 	}
+#endif
 
 	inline void onHttpRequestToServer(TcpConnection *tc)
 	{
@@ -2441,6 +2821,8 @@ static int SnodePathCheckFunction(ZT_Node *node,void *uptr,uint64_t ztaddr,const
 { return reinterpret_cast<OneServiceImpl *>(uptr)->nodePathCheckFunction(ztaddr,localAddr,remoteAddr); }
 static int SnodePathLookupFunction(ZT_Node *node,void *uptr,uint64_t ztaddr,int family,struct sockaddr_storage *result)
 { return reinterpret_cast<OneServiceImpl *>(uptr)->nodePathLookupFunction(ztaddr,family,result); }
+static void SnodeIdentityValidationRequestFunction(ZT_Node *node,void *uptr)
+{ reinterpret_cast<OneServiceImpl *>(uptr)->nodeIdentityValidationRequestFunction(); }
 
 #ifdef ZT_ENABLE_CLUSTER
 static void SclusterSendFunction(void *uptr,unsigned int toMemberId,const void *data,unsigned int len)
@@ -2459,6 +2841,34 @@ static int SclusterGeoIpFunction(void *uptr,const struct sockaddr_storage *addr,
 
 static void StapFrameHandler(void *uptr,uint64_t nwid,const MAC &from,const MAC &to,unsigned int etherType,unsigned int vlanId,const void *data,unsigned int len)
 { reinterpret_cast<OneServiceImpl *>(uptr)->tapFrameHandler(nwid,from,to,etherType,vlanId,data,len); }
+#ifdef __LINUX__
+static void StapFrameBatchHandler(void *uptr,uint64_t nwid,const EthernetTap::Frame *frames,unsigned int count)
+{ reinterpret_cast<OneServiceImpl *>(uptr)->tapFrameBatchHandler(nwid,frames,count); }
+#endif
+
+void ReceiveWorker::threadMain()
+	throw()
+{
+	if (parent->_ioUring)
+		phy.enableIoUring();
+	while (run) {
+		if (refreshNeeded) {
+			refreshNeeded = false;
+			parent->refreshReceiveWorker(*this);
+		}
+		phy.poll(ZT_BINDER_REFRESH_PERIOD); // whacked by main thread on refresh and shutdown
+	}
+}
+
+void IdentityValidationWorker::threadMain()
+	throw()
+{
+	while (parent->_identityValidationRequests.get()) {
+		try {
+			parent->_node->processIdentityValidations(OSUtils::now(),1);
+		} catch ( ... ) {}
+	}
+}
 
 static int ShttpOnMessageBegin(http_parser *parser)
 {
@@ -16,16 +16,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-// HACK! Will eventually use epoll() or something in Phy<> instead of select().
-// Also be sure to change ulimit -n and fs.file-max in /etc/sysctl.conf on relays.
-#if defined(__linux__) || defined(__LINUX__) || defined(__LINUX) || defined(LINUX)
-#include <linux/posix_types.h>
-#include <bits/types.h>
-#undef __FD_SETSIZE
-#define __FD_SETSIZE 1048576
-#undef FD_SETSIZE
-#define FD_SETSIZE 1048576
-#endif
+// Phy<> uses epoll() on Linux so there is no FD_SETSIZE limit, but be sure
+// to change ulimit -n and fs.file-max in /etc/sysctl.conf on relays.
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -159,6 +151,12 @@ struct TcpProxyService
 		}
 	}
 
+	void phyOnDatagramBatch(PhySocket *sock,void **uptr,const struct sockaddr *localAddr,const PhyDatagram *datagrams,unsigned int count)
+	{
+		for(unsigned int i=0;i<count;++i)
+			phyOnDatagram(sock,uptr,localAddr,datagrams[i].addr,datagrams[i].data,datagrams[i].len);
+	}
+
 	void phyOnTcpConnect(PhySocket *sock,void **uptr,bool success)
 	{
 		// unused, we don't initiate outbound connections